@@ -26,5 +26,6 @@
 #include <dynamic-graph/command-getter.h>
 #include <dynamic-graph/command.h>
 #include <dynamic-graph/command-setter.h>
+#include <dynamic-graph/command-shared.h>
 
 #endif //! DYNAMIC_GRAPH_ALL_COMMANDS_H
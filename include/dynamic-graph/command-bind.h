@@ -115,7 +115,8 @@ namespace dynamicgraph {
       virtual Value doExecute()
       {
 	assert( getParameterValues().size() == 1 );
-	T val = getParameterValues()[0].value();
+	typename ValueArgument<T>::type val =
+	  ValueArgument<T>::get(getParameterValues()[0]);
 	fptr(val);
 	return Value(); // void
       }
@@ -191,8 +192,10 @@ namespace dynamicgraph {
       virtual Value doExecute()
       {
 	assert( getParameterValues().size() == 2 );
-	T1 val1 = getParameterValues()[0].value();
-	T2 val2 = getParameterValues()[1].value();
+	typename ValueArgument<T1>::type val1 =
+	  ValueArgument<T1>::get(getParameterValues()[0]);
+	typename ValueArgument<T2>::type val2 =
+	  ValueArgument<T2>::get(getParameterValues()[1]);
 	fptr(val1,val2);
 	return Value(); // void
       }
@@ -275,9 +278,12 @@ namespace dynamicgraph {
       virtual Value doExecute()
       {
 	assert( getParameterValues().size() == 3 );
-	T1 val1 = getParameterValues()[0].value();
-	T2 val2 = getParameterValues()[1].value();
-	T3 val3 = getParameterValues()[2].value();
+	typename ValueArgument<T1>::type val1 =
+	  ValueArgument<T1>::get(getParameterValues()[0]);
+	typename ValueArgument<T2>::type val2 =
+	  ValueArgument<T2>::get(getParameterValues()[1]);
+	typename ValueArgument<T3>::type val3 =
+	  ValueArgument<T3>::get(getParameterValues()[2]);
 	fptr(val1,val2,val3);
 	return Value(); // void
       }
@@ -364,10 +370,14 @@ namespace dynamicgraph {
       virtual Value doExecute()
       {
 	assert( getParameterValues().size() == 4 );
-	T1 val1 = getParameterValues()[0].value();
-	T2 val2 = getParameterValues()[1].value();
-	T3 val3 = getParameterValues()[2].value();
-	T4 val4 = getParameterValues()[3].value();
+	typename ValueArgument<T1>::type val1 =
+	  ValueArgument<T1>::get(getParameterValues()[0]);
+	typename ValueArgument<T2>::type val2 =
+	  ValueArgument<T2>::get(getParameterValues()[1]);
+	typename ValueArgument<T3>::type val3 =
+	  ValueArgument<T3>::get(getParameterValues()[2]);
+	typename ValueArgument<T4>::type val4 =
+	  ValueArgument<T4>::get(getParameterValues()[3]);
 	fptr(val1,val2,val3,val4);
 	return Value(); // void
       }
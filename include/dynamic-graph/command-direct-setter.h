@@ -43,11 +43,14 @@ namespace dynamicgraph {
 	,T_ptr(ptr)
       {}
 
+      virtual bool isSetter() const { return true; }
+
     protected:
       virtual Value doExecute()
       {
 	const std::vector<Value>& values = getParameterValues();
-	T val = values[0].value();
+	typename ValueArgument<T>::type val =
+	  ValueArgument<T>::get(values[0]);
 	(*T_ptr) = val;
 	return Value(); // void
       }
@@ -0,0 +1,149 @@
+// -*- mode: c++ -*-
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// dynamic-graph is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// dynamic-graph. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DYNAMIC_GRAPH_COMMAND_QUEUE_H
+# define DYNAMIC_GRAPH_COMMAND_QUEUE_H
+# include <string>
+# include <vector>
+
+# include <boost/atomic.hpp>
+# include <boost/cstdint.hpp>
+# include <boost/noncopyable.hpp>
+# include <boost/shared_ptr.hpp>
+
+# include <dynamic-graph/dynamic-graph-api.h>
+# include <dynamic-graph/value.h>
+
+namespace dynamicgraph {
+  namespace command {
+    class Command;
+
+    /// \brief Result of a command executed by a CommandQueue.
+    class DYNAMIC_GRAPH_DLLAPI CommandFuture
+    {
+    public:
+      /// Future of no command.
+      CommandFuture ();
+
+      bool valid () const
+      {
+	return state_.get () != NULL;
+      }
+      /// Whether the command has been executed.
+      bool ready () const;
+      /// Wait until the command has been executed.
+      void wait () const;
+      /// \brief Wait for the result of the command.
+      ///
+      /// \throw ExceptionAbstract with the code and message of the
+      ///        exception thrown by the command, if any.
+      const Value& get () const;
+      /// Time between the queuing of the command and the end of its
+      /// execution, in seconds. The command must have been executed.
+      double latency () const;
+
+    private:
+      friend class CommandQueue;
+      struct State;
+      explicit CommandFuture (const boost::shared_ptr<State>& state);
+
+      boost::shared_ptr<State> state_;
+    };
+
+    /// \brief Commands queued by any thread and executed by the thread
+    /// evaluating the graph.
+    ///
+    /// Executing a command from another thread races with the evaluation
+    /// of the graph, for instance when a setter writes a member that a
+    /// signal reads. Instead, the other threads enqueue the commands,
+    /// and the thread evaluating the graph executes a bounded number of
+    /// them at the start of each tick:
+    /// \code
+    /// // Any thread.
+    /// std::vector<Value> arguments (1, Value (gain));
+    /// CommandFuture future = queue.enqueue (*command, arguments);
+    /// future.wait ();
+    ///
+    /// // Thread evaluating the graph.
+    /// for (int t = 0; ; ++t) {
+    ///   queue.execute (10);
+    ///   output (t);
+    /// }
+    /// \endcode
+    /// The queue is a bounded lock-free ring, allocated by the
+    /// constructor. The arguments are type-checked and moved into the
+    /// ring by enqueue, and moved into the command by execute, which
+    /// neither allocates nor frees memory besides what the commands do.
+    class DYNAMIC_GRAPH_DLLAPI CommandQueue : private boost::noncopyable
+    {
+    public:
+      /// \param capacity maximal number of commands waiting.
+      explicit CommandQueue (std::size_t capacity);
+      ~CommandQueue ();
+
+      std::size_t capacity () const
+      {
+	return slots_.size ();
+      }
+
+      /// \brief Queue the execution of command with the given arguments.
+      ///
+      /// Can be called by any thread. The arguments are taken without
+      /// copy: arguments is left empty. The command must outlive its
+      /// execution.
+      /// \throw ExceptionAbstract if the arguments do not fit the command
+      ///        or if the queue is full.
+      CommandFuture enqueue (Command& command, std::vector<Value>& arguments);
+
+      /// \brief Execute at most maxCommands commands, in the order they
+      /// were queued.
+      ///
+      /// To be called by the thread evaluating the graph, between two
+      /// evaluations. The exceptions thrown by the commands are passed to
+      /// their futures, those which are not an ExceptionAbstract nor a
+      /// std::exception as an "unknown exception".
+      /// \return the number of commands executed.
+      std::size_t execute (std::size_t maxCommands);
+
+      /// Number of commands waiting.
+      std::size_t size () const
+      {
+	return writeIdx_.load () - readIdx_.load ();
+      }
+
+    private:
+      struct Slot
+      {
+	/// Position of the command the slot is ready for, as in
+	/// RealTimeLogger.
+	boost::atomic<std::size_t> sequence;
+	Command* command;
+	std::vector<Value> arguments;
+	/// Kept until the slot is reused, so that the thread executing the
+	/// commands does not free it.
+	boost::shared_ptr<CommandFuture::State> state;
+      };
+
+      std::vector<Slot*> slots_;
+      /// Position of the next command to execute.
+      boost::atomic<std::size_t> readIdx_;
+      /// Position of the next command to queue.
+      boost::atomic<std::size_t> writeIdx_;
+    };
+  } // namespace command
+} // namespace dynamicgraph
+
+#endif //! DYNAMIC_GRAPH_COMMAND_QUEUE_H
@@ -61,6 +61,8 @@ namespace dynamicgraph {
       Setter(E& entity, SetterMethod setterMethod,
 	     const std::string& docString);
 
+      virtual bool isSetter() const { return true; }
+
     protected:
       virtual Value doExecute();
 
@@ -248,7 +248,7 @@ namespace dynamicgraph {
     {
       const std::vector<Value>& values = getParameterValues();
       // Get parameter
-      std::string value = values[0].value();
+      const std::string& value = values[0].stringRef();
       E& entity = static_cast<E&>(owner());
       (entity.*setterMethod_)(value);
       return Value();
@@ -286,7 +286,7 @@ namespace dynamicgraph {
     {
       const std::vector<Value>& values = getParameterValues();
       // Get parameter
-      Vector value = values[0].value();
+      const Vector& value = values[0].vectorRef();
       E& entity = static_cast<E&>(owner());
       (entity.*setterMethod_)(value);
       return Value();
@@ -324,7 +324,7 @@ namespace dynamicgraph {
     {
       const std::vector<Value>& values = getParameterValues();
       // Get parameter
-      Matrix value = values[0].value();
+      const Matrix& value = values[0].matrixXdRef();
       E& entity = static_cast<E&>(owner());
       (entity.*setterMethod_)(value);
       return Value();
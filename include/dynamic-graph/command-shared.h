@@ -0,0 +1,352 @@
+// -*- mode: c++ -*-
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// dynamic-graph is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// dynamic-graph. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DYNAMIC_GRAPH_COMMAND_SHARED_H
+# define DYNAMIC_GRAPH_COMMAND_SHARED_H
+# include <cassert>
+# include <string>
+# include <vector>
+
+# include <boost/assign/list_of.hpp>
+# include <boost/noncopyable.hpp>
+
+# include <dynamic-graph/fwd.hh>
+# include <dynamic-graph/dynamic-graph-api.h>
+# include <dynamic-graph/interned-map.h>
+# include <dynamic-graph/value.h>
+
+namespace dynamicgraph {
+  namespace command {
+
+    /// \brief Command shared by all the instances of an entity class.
+    ///
+    /// Unlike Command, a shared command is not bound to an entity: the
+    /// entity is given at each execution. The prototype and the
+    /// documentation are therefore stored once per class instead of once
+    /// per instance.
+    class DYNAMIC_GRAPH_DLLAPI SharedCommand : private boost::noncopyable
+    {
+    public:
+      SharedCommand (const std::vector<Value::Type>& valueTypes,
+		     const std::string& docstring);
+      virtual ~SharedCommand ();
+
+      const std::vector<Value::Type>& valueTypes () const
+      {
+	return valueTypes_;
+      }
+      const std::string& getDocstring () const
+      {
+	return docstring_;
+      }
+
+      /// Execute the command on entity. The values are expected to match
+      /// valueTypes ().
+      Value execute (Entity& entity, const std::vector<Value>& values) const
+      {
+	return doExecute (entity, values);
+      }
+
+      /// Create a Command executing this command on entity. The returned
+      /// command references this one, which must outlive it.
+      Command* bind (Entity& entity) const;
+
+      /// See Command::isSetter.
+      virtual bool isSetter () const
+      {
+	return false;
+      }
+
+    protected:
+      virtual Value doExecute (Entity& entity,
+			       const std::vector<Value>& values) const = 0;
+
+    private:
+      std::vector<Value::Type> valueTypes_;
+      std::string docstring_;
+    };
+
+    /// \brief Table of the shared commands of an entity class.
+    ///
+    /// The table is meant to be a function-local static built by a
+    /// function adding the commands:
+    /// <code>
+    /// static void addCommands (command::ClassCommands& commands)
+    /// {
+    ///   commands.add ("getValue",
+    ///                 command::makeSharedDirectGetter (&MyEntity::value_,
+    ///                                                  "Get the value."));
+    /// }
+    ///
+    /// MyEntity::MyEntity (const std::string& name) : Entity (name)
+    /// {
+    ///   static const command::ClassCommands commands (&addCommands);
+    ///   setClassCommands (commands);
+    /// }
+    /// </code>
+    class DYNAMIC_GRAPH_DLLAPI ClassCommands : private boost::noncopyable
+    {
+    public:
+      typedef InternedMap<const SharedCommand*> Table;
+      typedef void (*Builder) (ClassCommands&);
+
+      ClassCommands ();
+      /// Create the table and fill it with builder.
+      explicit ClassCommands (Builder builder);
+      ~ClassCommands ();
+
+      /// Add a command, taking its ownership.
+      /// \throw ExceptionFactory OBJECT_CONFLICT if name is already used.
+      void add (const std::string& name, const SharedCommand* command);
+
+      /// Command called name, NULL if there is none.
+      const SharedCommand* find (const std::string& name) const
+      {
+	const SharedCommand* const* command = commands_.find (name);
+	return command == NULL ? NULL : *command;
+      }
+
+      const Table& commands () const
+      {
+	return commands_;
+      }
+
+    private:
+      Table commands_;
+    };
+
+    /* --- HELPERS -------------------------------------------------------- */
+
+    /// Shared getter of the data member of an entity class.
+    template <class E, typename T>
+    class SharedDirectGetter : public SharedCommand
+    {
+    public:
+      SharedDirectGetter (T E::* member, const std::string& docString)
+	: SharedCommand (std::vector<Value::Type> (), docString)
+	, member_ (member)
+      {}
+
+    protected:
+      virtual Value doExecute (Entity& entity,
+			       const std::vector<Value>&) const
+      {
+	return Value (static_cast<E&> (entity).*member_);
+      }
+
+    private:
+      T E::* member_;
+    };
+
+    template <class E, typename T>
+    SharedDirectGetter<E,T>*
+    makeSharedDirectGetter (T E::* member, const std::string& docString)
+    {
+      return new SharedDirectGetter<E,T> (member, docString);
+    }
+
+    /// Shared setter of the data member of an entity class.
+    template <class E, typename T>
+    class SharedDirectSetter : public SharedCommand
+    {
+    public:
+      SharedDirectSetter (T E::* member, const std::string& docString)
+	: SharedCommand (boost::assign::list_of (ValueHelper<T>::TypeID),
+			 docString)
+	, member_ (member)
+      {}
+
+      virtual bool isSetter () const
+      {
+	return true;
+      }
+
+    protected:
+      virtual Value doExecute (Entity& entity,
+			       const std::vector<Value>& values) const
+      {
+	typename ValueArgument<T>::type val =
+	  ValueArgument<T>::get (values[0]);
+	static_cast<E&> (entity).*member_ = val;
+	return Value (); // void
+      }
+
+    private:
+      T E::* member_;
+    };
+
+    template <class E, typename T>
+    SharedDirectSetter<E,T>*
+    makeSharedDirectSetter (T E::* member, const std::string& docString)
+    {
+      return new SharedDirectSetter<E,T> (member, docString);
+    }
+
+    /// Shared command calling a member function without argument.
+    template <class E>
+    class SharedCommandVoid0 : public SharedCommand
+    {
+    public:
+      typedef void (E::*function_t) ();
+
+      SharedCommandVoid0 (function_t function, const std::string& docString)
+	: SharedCommand (std::vector<Value::Type> (), docString)
+	, function_ (function)
+      {}
+
+    protected:
+      virtual Value doExecute (Entity& entity,
+			       const std::vector<Value>& values) const
+      {
+	assert (values.size () == 0);
+	(static_cast<E&> (entity).*function_) ();
+	return Value (); // void
+      }
+
+    private:
+      function_t function_;
+    };
+
+    template <class E>
+    SharedCommandVoid0<E>*
+    makeSharedCommandVoid0 (void (E::*function) (),
+			    const std::string& docString)
+    {
+      return new SharedCommandVoid0<E> (function, docString);
+    }
+
+    /// Shared command calling a member function with one argument.
+    template <class E, typename T>
+    class SharedCommandVoid1 : public SharedCommand
+    {
+    public:
+      typedef void (E::*function_t) (const T&);
+
+      SharedCommandVoid1 (function_t function, const std::string& docString)
+	: SharedCommand (boost::assign::list_of (ValueHelper<T>::TypeID),
+			 docString)
+	, function_ (function)
+      {}
+
+    protected:
+      virtual Value doExecute (Entity& entity,
+			       const std::vector<Value>& values) const
+      {
+	assert (values.size () == 1);
+	typename ValueArgument<T>::type val =
+	  ValueArgument<T>::get (values[0]);
+	(static_cast<E&> (entity).*function_) (val);
+	return Value (); // void
+      }
+
+    private:
+      function_t function_;
+    };
+
+    template <class E, typename T>
+    SharedCommandVoid1<E,T>*
+    makeSharedCommandVoid1 (void (E::*function) (const T&),
+			    const std::string& docString)
+    {
+      return new SharedCommandVoid1<E,T> (function, docString);
+    }
+
+    /// Shared command calling a member function with two arguments.
+    template <class E, typename T1, typename T2>
+    class SharedCommandVoid2 : public SharedCommand
+    {
+    public:
+      typedef void (E::*function_t) (const T1&, const T2&);
+
+      SharedCommandVoid2 (function_t function, const std::string& docString)
+	: SharedCommand (boost::assign::list_of
+			 (ValueHelper<T1>::TypeID)
+			 (ValueHelper<T2>::TypeID), docString)
+	, function_ (function)
+      {}
+
+    protected:
+      virtual Value doExecute (Entity& entity,
+			       const std::vector<Value>& values) const
+      {
+	assert (values.size () == 2);
+	typename ValueArgument<T1>::type val1 =
+	  ValueArgument<T1>::get (values[0]);
+	typename ValueArgument<T2>::type val2 =
+	  ValueArgument<T2>::get (values[1]);
+	(static_cast<E&> (entity).*function_) (val1, val2);
+	return Value (); // void
+      }
+
+    private:
+      function_t function_;
+    };
+
+    template <class E, typename T1, typename T2>
+    SharedCommandVoid2<E,T1,T2>*
+    makeSharedCommandVoid2 (void (E::*function) (const T1&, const T2&),
+			    const std::string& docString)
+    {
+      return new SharedCommandVoid2<E,T1,T2> (function, docString);
+    }
+
+    /// Shared command calling a member function with three arguments.
+    template <class E, typename T1, typename T2, typename T3>
+    class SharedCommandVoid3 : public SharedCommand
+    {
+    public:
+      typedef void (E::*function_t) (const T1&, const T2&, const T3&);
+
+      SharedCommandVoid3 (function_t function, const std::string& docString)
+	: SharedCommand (boost::assign::list_of
+			 (ValueHelper<T1>::TypeID)
+			 (ValueHelper<T2>::TypeID)
+			 (ValueHelper<T3>::TypeID), docString)
+	, function_ (function)
+      {}
+
+    protected:
+      virtual Value doExecute (Entity& entity,
+			       const std::vector<Value>& values) const
+      {
+	assert (values.size () == 3);
+	typename ValueArgument<T1>::type val1 =
+	  ValueArgument<T1>::get (values[0]);
+	typename ValueArgument<T2>::type val2 =
+	  ValueArgument<T2>::get (values[1]);
+	typename ValueArgument<T3>::type val3 =
+	  ValueArgument<T3>::get (values[2]);
+	(static_cast<E&> (entity).*function_) (val1, val2, val3);
+	return Value (); // void
+      }
+
+    private:
+      function_t function_;
+    };
+
+    template <class E, typename T1, typename T2, typename T3>
+    SharedCommandVoid3<E,T1,T2,T3>*
+    makeSharedCommandVoid3 (void (E::*function) (const T1&, const T2&,
+						 const T3&),
+			    const std::string& docString)
+    {
+      return new SharedCommandVoid3<E,T1,T2,T3> (function, docString);
+    }
+
+  } // namespace command
+} // namespace dynamicgraph
+
+#endif //! DYNAMIC_GRAPH_COMMAND_SHARED_H
@@ -25,6 +25,8 @@
 namespace dynamicgraph {
   class Entity;
   namespace command {
+    class SharedCommand;
+
     /// Abstract class for entity commands
     ///
     /// This class provide a mean to control entities from external python script.
@@ -39,7 +41,10 @@ namespace dynamicgraph {
     ///
     /// Parameters are set by calling Command::setParameterValues with a
     /// vector of Values the types of which should fit the vector specified
-    /// at construction.
+    /// at construction. Command::swapParameterValues and
+    /// Command::execute(std::vector<Value>&) take the values without
+    /// copying them, and the commands built by the helpers of this library
+    /// read the strings, vectors and matrices by reference.
     class DYNAMIC_GRAPH_DLLAPI Command
     {
     public:
@@ -54,21 +59,51 @@ namespace dynamicgraph {
       const std::vector<Value::Type>& valueTypes() const;
       /// Set parameter values
       void setParameterValues(const std::vector<Value>& values);
+      /// \brief Set parameter values without copying them.
+      ///
+      /// The values are swapped with the parameter values: values
+      /// receives previous ones, which the caller frees.
+      void swapParameterValues(std::vector<Value>& values);
+      /// Check that values fit the prototype of the command.
+      /// \throw ExceptionAbstract otherwise.
+      void checkParameterValues(const std::vector<Value>& values) const;
       /// Get parameter values
       const std::vector<Value>& getParameterValues() const;
+      /// Parameter values of the last execution of a setter, empty if
+      /// the command is not a setter or has not been executed.
+      const std::vector<Value>& getExecutedValues() const;
       /// Execute the command after checking parameters
       Value execute();
+      /// Swap the parameter values with values, then execute the command.
+      Value execute(std::vector<Value>& values);
       /// Get a reference to the Entity owning this command
       Entity& owner();
       /// Get documentation string
       std::string getDocstring() const;
+      /// Whether the command only sets a parameter of its entity, so
+      /// that executing it again with the same parameter values restores
+      /// this parameter.
+      virtual bool isSetter() const { return false; }
     protected:
+      /// Command executing shared on entity. The prototype and the
+      /// documentation are read from shared, which must outlive this
+      /// command.
+      Command(Entity& entity, const SharedCommand& shared);
       /// Specific action performed by the command
       virtual Value doExecute() = 0;
     private:
+      /// Move the parameter values to executedValues_ if they are those
+      /// of the last execution.
+      void keepExecutedValues();
+
       Entity& owner_;
+      const SharedCommand* shared_;
       std::vector<Value::Type> valueTypeVector_;
       std::vector<Value> valueVector_;
+      /// Values of the last execution of a setter, unless executed_.
+      std::vector<Value> executedValues_;
+      /// Whether valueVector_ holds the values of the last execution.
+      bool executed_;
       std::string docstring_;
     public:
       static const std::vector<Value::Type> EMPTY_ARG;
@@ -17,11 +17,15 @@
 
 #ifndef DYNAMIC_GRAPH_DEBUG_HH
 # define DYNAMIC_GRAPH_DEBUG_HH
+# include <climits>
 # include <cstdio>
 # include <cstdarg>
 # include <fstream>
 # include <sstream>
 
+# include <boost/atomic.hpp>
+# include <boost/noncopyable.hpp>
+
 # include <dynamic-graph/fwd.hh>
 # include <dynamic-graph/dynamic-graph-api.h>
 
@@ -34,15 +38,6 @@
 #  define VP_TEMPLATE_DEBUG_MODE 0
 # endif //! VP_TEMPLATE_DEBUG_MODE
 
-#define DG_COMMON_TRACES						\
-    do {								\
-	va_list arg;							\
-	va_start (arg, format);						\
-	vsnprintf (charbuffer, SIZE, format, arg);			\
-	va_end (arg);							\
-	outputbuffer << tmpbuffer.str  () << charbuffer << std::endl;	\
-    } while(0)
-
 namespace dynamicgraph
 {
   /// \ingroup debug
@@ -51,67 +46,131 @@ namespace dynamicgraph
   ///
   /// This class should never be used directly, please use the
   /// debugging macro instead.
+  ///
+  /// The traces are formatted in a buffer of the calling thread, then
+  /// passed to an asynchronous logger whose thread writes them to
+  /// outputbuffer. Writing a trace thus neither blocks on the file nor
+  /// mixes with the traces of other threads. The level of a trace is
+  /// checked before anything is formatted.
+  ///
+  /// When the ring of the logger is full, the traces are dropped and a
+  /// line gives how many were, except for dgERRORFLOW whose traces are
+  /// then written directly. Traces longer than an entry of the logger,
+  /// about 500 characters, are written directly too. Both block the
+  /// calling thread until the traces already passed to the logger are
+  /// written.
   class DYNAMIC_GRAPH_DLLAPI DebugTrace
   {
   public:
     static const int SIZE = 512;
 
-    std::stringstream tmpbuffer;
-    std::ostream& outputbuffer;
-    char charbuffer[SIZE+1];
-    int traceLevel;
-    int traceLevelTemplate;
+    /// \brief Trace being written by the calling thread.
+    ///
+    /// The trace is passed to the logger when the entry is destroyed,
+    /// that is at the end of the statement of the debugging macros.
+    class DYNAMIC_GRAPH_DLLAPI Entry : private boost::noncopyable
+    {
+    public:
+      explicit Entry (const DebugTrace& trace);
+      ~Entry ();
+      std::ostream& stream ()
+      {
+	return *os_;
+      }
+    private:
+      const DebugTrace& trace_;
+      std::ostream* os_;
+    };
 
-    DebugTrace (std::ostream& os)
-      : outputbuffer (os)
+    /// \brief Location of a printf-style trace.
+    class DYNAMIC_GRAPH_DLLAPI Formatter
+    {
+    public:
+      Formatter (const DebugTrace& trace, const char* file,
+		 const char* function, int line, int maxLevel)
+	: trace_ (trace), file_ (file), function_ (function), line_ (line),
+	  maxLevel_ (maxLevel)
       {}
+      void trace (const int level, const char* format, ...);
+      void trace (const char* format, ...);
+      void traceTemplate (const int level, const char* format, ...);
+      void traceTemplate (const char* format, ...);
+    private:
+      void write (const char* format, va_list arg) const;
+
+      const DebugTrace& trace_;
+      const char* file_;
+      const char* function_;
+      int line_;
+      int maxLevel_;
+    };
 
-    inline void trace (const int level, const char* format, ...)
-    {
-      if (level <= traceLevel)
-	DG_COMMON_TRACES; tmpbuffer.str("");
-    }
+    std::ostream& outputbuffer;
+    /// Written before the location of the printf-style traces.
+    const char* marker;
+    /// Levels above which the traces are ignored, may be changed at any
+    /// time.
+    boost::atomic<int> traceLevel;
+    boost::atomic<int> traceLevelTemplate;
+
+    DebugTrace (std::ostream& os, const char* marker = "")
+      : outputbuffer (os), marker (marker), traceLevel (VP_DEBUG_MODE),
+	traceLevelTemplate (VP_TEMPLATE_DEBUG_MODE), outputOpen_ (os.good ())
+      {}
 
-    inline void trace (const char* format, ...)
+    /// Whether the output of this trace is open.
+    bool enabled () const
     {
-      DG_COMMON_TRACES;
-      tmpbuffer.str("");
+      return outputOpen_.load (boost::memory_order_relaxed);
     }
 
-    inline void trace (const int level=-1)
+    /// Whether the traces of the given level are written.
+    bool enabled (const int level) const
     {
-      if (level <= traceLevel) {
-	outputbuffer << tmpbuffer.str (); tmpbuffer.str("");
-      }
+      return level <= traceLevel.load (boost::memory_order_relaxed)
+	&& enabled ();
     }
 
-    inline void traceTemplate (const int level, const char* format, ...)
+    /// Whether the template traces of the given level are written.
+    bool templateEnabled (const int level) const
     {
-      if (level <= traceLevelTemplate)
-	DG_COMMON_TRACES;
-      tmpbuffer.str("");
+      return level <= traceLevelTemplate.load (boost::memory_order_relaxed)
+	&& enabled ();
     }
 
-    inline void traceTemplate (const char* format, ...)
+    void setTraceLevel (const int level)
     {
-      DG_COMMON_TRACES;
-      tmpbuffer.str("");
+      traceLevel = level;
     }
 
-    inline DebugTrace& pre (const std::ostream&)
+    int getTraceLevel () const
     {
-      return *this;
+      return traceLevel;
     }
 
-    inline DebugTrace& pre (const std::ostream&, int level)
+    void trace (const int level, const char* format, ...);
+    void trace (const char* format, ...);
+    void traceTemplate (const int level, const char* format, ...);
+    void traceTemplate (const char* format, ...);
+
+    Formatter pre (const char* file, const char* function, int line,
+		   int maxLevel = INT_MAX) const
     {
-      traceLevel = level;
-      return *this;
+      return Formatter (*this, file, function, line, maxLevel);
     }
 
     static const char* DEBUG_FILENAME_DEFAULT;
+    /// Open the debug file, once the traces written before are.
     static void openFile (const char* filename = DEBUG_FILENAME_DEFAULT);
+    /// Close the debug file, once the traces written before are.
     static void closeFile( const char* filename = DEBUG_FILENAME_DEFAULT);
+
+  private:
+    void write (const char* format, va_list arg) const;
+
+    /// Whether the output is open: set at construction, and by openFile
+    /// and closeFile for the traces written in the debug file.
+    boost::atomic<bool> outputOpen_;
   };
 
   DYNAMIC_GRAPH_DLLAPI extern DebugTrace dgDEBUGFLOW;
@@ -126,57 +185,59 @@ namespace dynamicgraph
   "\t!! "<<__FILE__ << ": " <<__FUNCTION__ << "(#" << __LINE__ << ") :"
 
 #  define dgDEBUG(level)						\
-  if ((level > VP_DEBUG_MODE) || (!dgDEBUGFLOW.outputbuffer.good  ()))	\
+  if ((level > VP_DEBUG_MODE) || (!dgDEBUGFLOW.enabled (level)))	\
     ;									\
   else									\
-    dgDEBUGFLOW.outputbuffer << dgPREDEBUG
+    ::dynamicgraph::DebugTrace::Entry (dgDEBUGFLOW).stream () << dgPREDEBUG
 
 #  define dgDEBUGMUTE(level)						\
-  if ((level > VP_DEBUG_MODE) || (!dgDEBUGFLOW.outputbuffer.good  ()))	\
+  if ((level > VP_DEBUG_MODE) || (!dgDEBUGFLOW.enabled (level)))	\
     ;									\
   else									\
-    dgDEBUGFLOW.outputbuffer
+    ::dynamicgraph::DebugTrace::Entry (dgDEBUGFLOW).stream ()
 
 #  define dgERROR							\
-  if (!dgDEBUGFLOW.outputbuffer.good  ())				\
+  if (!dgERRORFLOW.enabled ())						\
     ;									\
   else									\
-    dgERRORFLOW.outputbuffer << dgPREERROR
+    ::dynamicgraph::DebugTrace::Entry (dgERRORFLOW).stream () << dgPREERROR
 
 #  define dgDEBUGF							\
-  if (!dgDEBUGFLOW.outputbuffer.good  ())				\
+  if (!dgDEBUGFLOW.enabled ())						\
     ;									\
   else									\
-    dgDEBUGFLOW.pre (dgDEBUGFLOW.tmpbuffer << dgPREDEBUG, VP_DEBUG_MODE).trace
+    dgDEBUGFLOW.pre (__FILE__, __FUNCTION__, __LINE__, VP_DEBUG_MODE).trace
 
 #  define dgERRORF							\
-  if (!dgDEBUGFLOW.outputbuffer.good  ())				\
+  if (!dgERRORFLOW.enabled ())						\
     ;									\
   else									\
-    dgERRORFLOW.pre (dgERRORFLOW.tmpbuffer << dgPREERROR).trace
+    dgERRORFLOW.pre (__FILE__, __FUNCTION__, __LINE__).trace
 
 // TEMPLATE
 #  define dgTDEBUG(level)						\
-  if ((level > VP_TEMPLATE_DEBUG_MODE) || (!dgDEBUGFLOW.outputbuffer.good  ())) \
+  if ((level > VP_TEMPLATE_DEBUG_MODE)					\
+      || (!dgDEBUGFLOW.templateEnabled (level)))			\
     ;									\
   else									\
-    dgDEBUGFLOW.outputbuffer << dgPREDEBUG
+    ::dynamicgraph::DebugTrace::Entry (dgDEBUGFLOW).stream () << dgPREDEBUG
 
 #  define dgTDEBUGF							\
-  if (!dgDEBUGFLOW.outputbuffer.good  ())				\
+  if (!dgDEBUGFLOW.enabled ())						\
     ;									\
   else									\
-    dgDEBUGFLOW.pre							\
-      (dgDEBUGFLOW.tmpbuffer << dgPREDEBUG, VP_TEMPLATE_DEBUG_MODE).trace
+    dgDEBUGFLOW.pre (__FILE__, __FUNCTION__, __LINE__,			\
+		     VP_TEMPLATE_DEBUG_MODE).traceTemplate
 
 inline bool dgDEBUG_ENABLE (const int & level)
 {
-  return level<=VP_DEBUG_MODE;
+  return level<=VP_DEBUG_MODE && dynamicgraph::dgDEBUGFLOW.enabled (level);
 }
 
 inline bool dgTDEBUG_ENABLE (const int & level)
 {
-  return level<=VP_TEMPLATE_DEBUG_MODE;
+  return level<=VP_TEMPLATE_DEBUG_MODE
+    && dynamicgraph::dgDEBUGFLOW.templateEnabled (level);
 }
 
 # else // VP_DEBUG
@@ -197,7 +258,10 @@ inline bool dgTDEBUG_ENABLE (const int & level)
     ::dynamicgraph::__null_stream()
 
 #  define dgERROR				\
-  dgERRORFLOW.outputbuffer << dgPREERROR
+  if (!dgERRORFLOW.enabled ())			\
+    ;						\
+  else						\
+    ::dynamicgraph::DebugTrace::Entry (dgERRORFLOW).stream () << dgPREERROR
 
 inline void dgDEBUGF (const int, const char*, ...)
 {
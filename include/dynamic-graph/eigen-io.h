@@ -18,9 +18,13 @@
 #ifndef DYNAMIC_GRAPH_EIGEN_IO_H
 #define DYNAMIC_GRAPH_EIGEN_IO_H
 
+#include <cstddef>
+#include <streambuf>
+
 #include <boost/format.hpp>
 #include <boost/numeric/conversion/cast.hpp>
 
+#include <dynamic-graph/dynamic-graph-api.h>
 #include <dynamic-graph/exception-signal.h>
 #include <dynamic-graph/linear-algebra.h>
 #include <Eigen/Geometry>
@@ -30,6 +34,112 @@ using dynamicgraph::ExceptionSignal;
 //TODO: Eigen 3.3 onwards has a global Eigen::Index definition.
 //If Eigen version is updated, use Eigen::Index instead of this macro.
 
+namespace dynamicgraph {
+
+  /* \brief Reader of the text format of vectors and matrices.
+   *
+   * The characters are taken directly from the stream buffer and the values
+   * are written directly in the destination, so that reading does not
+   * allocate memory except to resize the destination. Sizes which cannot
+   * fit in the input are rejected before allocating: for inputs of unknown
+   * size, such as files or pipes, the values are allocated as they are
+   * read. The methods return false on parse errors; building an error
+   * message is left to the caller.
+   *
+   * Values may be separated by blanks and at most one comma. Besides the
+   * usual decimal notation, nan, inf and -inf are accepted.
+   */
+  class DYNAMIC_GRAPH_DLLAPI EigenReader
+  {
+  public:
+    explicit EigenReader (std::streambuf& sb) : sb_ (sb) {}
+
+    /// Skip blanks and consume the character c.
+    bool expect (char c);
+    /// Skip blanks and one optional comma.
+    void separator ();
+    /// Skip blanks and read a non-negative integer.
+    bool readSize (std::size_t& n);
+    /// Skip blanks and read a double.
+    bool readDouble (double& value);
+    /// Read n values separated by blanks or commas.
+    bool readDoubles (double* values, std::size_t n);
+
+    /// Read [N](val1,val2,...,valN).
+    bool readVector (Vector& v);
+    /// Read [M,N]((val11,...,val1N),...,(valM1,...,valMN)).
+    template<typename Derived>
+    bool readMatrix (Eigen::DenseBase<Derived>& m);
+
+  private:
+    bool readMatrixHeader (std::size_t& rows, std::size_t& cols);
+    /// Whether the number of characters left in the input is known, as
+    /// it is for string buffers.
+    bool sizeKnown () const;
+    /// Whether rows x cols values may fit in the remaining input, the
+    /// size of which must be known.
+    bool fitsInput (std::size_t rows, std::size_t cols);
+    /// \brief Read rows of cols values between parentheses, then the
+    /// closing parenthesis, in row-major order.
+    ///
+    /// The values are allocated as they are read, so that a size which
+    /// does not fit in an input of unknown size is not allocated.
+    bool readRows (Vector& values, std::size_t rows, std::size_t cols);
+
+    std::streambuf& sb_;
+  };
+
+  template<typename Derived>
+  bool EigenReader::readMatrix (Eigen::DenseBase<Derived>& m)
+  {
+    std::size_t rows, cols;
+    if (!readMatrixHeader (rows, cols)) return false;
+    if ((Derived::RowsAtCompileTime != Eigen::Dynamic
+	 && rows != static_cast<std::size_t> (Derived::RowsAtCompileTime))
+	|| (Derived::ColsAtCompileTime != Eigen::Dynamic
+	    && cols != static_cast<std::size_t> (Derived::ColsAtCompileTime)))
+      return false;
+    if (!sizeKnown ())
+      {
+	// Read the values before allocating the matrix.
+	Vector values;
+	if (!readRows (values, rows, cols)) return false;
+	m.derived ().resize (rows, cols);
+	for (std::size_t i = 0; i < rows; ++i)
+	  for (std::size_t j = 0; j < cols; ++j)
+	    m (i, j) = values.data ()[i * cols + j];
+	return true;
+      }
+    if (!fitsInput (rows, cols)) return false;
+    m.derived ().resize (rows, cols);
+
+    double value;
+    for (std::size_t i = 0; i < rows; ++i)
+      {
+	if (i > 0) separator ();
+	if (!expect ('(')) return false;
+	for (std::size_t j = 0; j < cols; ++j)
+	  {
+	    if (j > 0) separator ();
+	    if (!readDouble (value)) return false;
+	    m (i, j) = value;
+	  }
+	if (!expect (')')) return false;
+      }
+    return expect (')');
+  }
+
+  /* \brief Parse n values separated by blanks or commas from [first,last).
+   *
+   * This is the bulk path of EigenReader when the text is already in
+   * memory. An ExceptionSignal is thrown if the values cannot be read.
+   *
+   * \return pointer past the last character read.
+   */
+  DYNAMIC_GRAPH_DLLAPI const char* parseDoubles
+  (const char* first, const char* last, double* values, std::size_t n);
+
+} // namespace dynamicgraph
 
   /* \brief Eigen Vector input from istream
    *
@@ -41,37 +151,11 @@ namespace Eigen {
 
   inline std::istringstream& operator >> (std::istringstream &iss, 
 					  dynamicgraph::Vector &inst) {
-    unsigned int _size;
-    double _dbl_val;
-    char _ch;
-    boost::format fmt ("Failed to enter %s as vector. Reenter as [N](val1,val2,val3,...,valN)");
-    fmt %iss.str();
-    if(iss>> _ch && _ch != '['){
+    if (!dynamicgraph::EigenReader (*iss.rdbuf ()).readVector (inst)) {
+      boost::format fmt ("Failed to enter %s as vector. Reenter as [N](val1,val2,val3,...,valN)");
+      fmt %iss.str();
       throw ExceptionSignal(ExceptionSignal::GENERIC, fmt.str());
     }
-    else {
-      if(iss >> _size && !iss.fail()){
-	inst.resize(_size);
-      }
-      else
-	throw ExceptionSignal(ExceptionSignal::GENERIC, fmt.str());
-      if(iss >> _ch && _ch != ']')
-	throw ExceptionSignal(ExceptionSignal::GENERIC, fmt.str());
-      else {
-	if(iss>> _ch && _ch != '(')
-	  throw ExceptionSignal(ExceptionSignal::GENERIC, fmt.str());
-	else {
-	  for (unsigned int i=0;i<_size; i++){
-	    iss >> _dbl_val;
-	    if (iss.peek() == ',' || iss.peek() == ' ')
-	      iss.ignore();
-	    inst(i) = _dbl_val;
-	  }
-	  if(iss >> _ch && _ch != ')')
-	    throw ExceptionSignal(ExceptionSignal::GENERIC, fmt.str());
-	}
-      }
-    }
     return iss;
   }
 
@@ -84,59 +168,18 @@ namespace Eigen {
   template<typename Derived>
   inline std::istringstream& operator >> (std::istringstream &iss, 
 					  DenseBase<Derived> &inst) {
-    unsigned int _colsize;
-    unsigned int _rowsize;
-    double _dbl_val;
-    char _ch;
-    boost::format fmt ("Failed to enter %s as matrix. Reenter as ((val11,val12,val13,...,val1N),...,(valM1,valM2,...,valMN))");
-    MatrixXd _tmp_matrix;
-    fmt %iss.str();
-    if(iss>> _ch && _ch != '['){
+    if (!dynamicgraph::EigenReader (*iss.rdbuf ()).readMatrix (inst)) {
+      boost::format fmt ("Failed to enter %s as matrix. Reenter as ((val11,val12,val13,...,val1N),...,(valM1,valM2,...,valMN))");
+      fmt %iss.str();
       throw ExceptionSignal(ExceptionSignal::GENERIC, fmt.str());
     }
-    else {
-      iss >>_rowsize;
-      if (iss.peek() == ',' || iss.peek() == ' ')
-	iss.ignore();
-      iss >> _colsize;
-      if (iss.fail())
-	throw ExceptionSignal(ExceptionSignal::GENERIC,fmt.str());
-      else {
-	_tmp_matrix.resize(_rowsize,_colsize);
-	if(iss >> _ch && _ch != ']')
-	  throw ExceptionSignal(ExceptionSignal::GENERIC, fmt.str());
-	else {
-	  if(iss>> _ch && _ch != '(')
-	    throw ExceptionSignal(ExceptionSignal::GENERIC, fmt.str());
-	  else {
-	    for (unsigned int j=0;j<_rowsize; j++){
-	      if(iss>> _ch && _ch != '(')
-		throw ExceptionSignal(ExceptionSignal::GENERIC, fmt.str());
-	      for (unsigned int i=0;i<_colsize; i++){
-		iss >> _dbl_val;
-		if (iss.peek() == ',' || iss.peek() == ' ')
-		  iss.ignore();
-		_tmp_matrix(j,i) = _dbl_val;
-	      }
-	      if(iss >> _ch && _ch != ')')
-		throw ExceptionSignal(ExceptionSignal::GENERIC, fmt.str());
-	      if (iss.peek() == ',' || iss.peek() == ' ')
-		iss.ignore();
-	    }
-	    if(iss >> _ch && _ch != ')')
-	      throw ExceptionSignal(ExceptionSignal::GENERIC, fmt.str());
-	  }
-	}
-      }
-    }
-    inst = _tmp_matrix;
     return iss;
   }
 
   
   inline std::istringstream& operator >> (std::istringstream &iss, 
 					  Transform<double,3,Affine> &inst) {
-    MatrixXd M;    iss >> M;    inst.matrix() = M;    return iss;  }
+    iss >> inst.matrix();    return iss;  }
   
   
   
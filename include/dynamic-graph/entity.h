@@ -27,8 +27,10 @@
 # include <dynamic-graph/fwd.hh>
 # include <dynamic-graph/dynamic-graph-api.h>
 # include <dynamic-graph/exception-factory.h>
+# include <dynamic-graph/interned-map.h>
 # include <dynamic-graph/signal-array.h>
 # include <dynamic-graph/signal-base.h>
+# include <dynamic-graph/snapshot-table.h>
 
 /// \brief Helper macro for entity declaration.
 ///
@@ -70,6 +72,13 @@ namespace dynamicgraph
   public:
     typedef std::map< std::string,SignalBase<int>* > SignalMap;
     typedef std::map<const std::string, command::Command*> CommandMap_t;
+    /// Hash tables of the signals and commands, keyed by their local
+    /// name. They index the same signals and commands as the sorted
+    /// signalMap and commandMap, and are used for the lookups by name.
+    typedef InternedMap<SignalBase<int>*> SignalTable;
+    typedef InternedMap<command::Command*> CommandTable;
+    /// Signal table readable from any thread, see getSignalSnapshot.
+    typedef SnapshotTable<SignalBase<int>*> ConcurrentSignalTable;
 
     explicit Entity (const std::string& name);
     virtual ~Entity  ();
@@ -89,6 +98,15 @@ namespace dynamicgraph
 
     virtual void display (std::ostream& os) const;
 
+    /// \brief Write the internal state of the entity in a checkpoint.
+    ///
+    /// Signal states are saved by PoolStorage::checkpoint. Entities only
+    /// overload this method, and restoreState, to save the state they
+    /// keep outside of their signals. Does nothing by default.
+    virtual void saveState (std::ostream& os) const;
+    /// \brief Read back the state written by saveState.
+    virtual void restoreState (std::istream& is);
+
     virtual SignalBase<int>* test ()
     {
       return 0;
@@ -100,22 +118,83 @@ namespace dynamicgraph
     }
 
     const std::string& getCommandList () const;
+    /// Sorted list of the commands of the instance and of its class.
     CommandMap_t getNewStyleCommandMap();
+    /// Command called cmdName: the command of the instance, or else the
+    /// class command bound to it.
     command::Command* getNewStyleCommand( const std::string& cmdName );
+    /// Commands added to this instance by addCommand.
+    const CommandTable& getCommands () const
+    {
+      return commandTable;
+    }
+    /// Class commands bound to this instance by setClassCommands.
+    const CommandTable& getBoundCommands () const
+    {
+      return boundCommands;
+    }
+    /// Commands shared by the instances of the class, NULL if none.
+    const command::ClassCommands* getClassCommands () const
+    {
+      return classCommands;
+    }
 
-    SignalMap getSignalMap() const;
+    /// Signals sorted by name.
+    const SignalMap& getSignalMap() const
+    {
+      return signalMap;
+    }
+    const SignalTable& getSignals () const
+    {
+      return signalTable;
+    }
+    /// Snapshot of the signal table for the threads which do not modify
+    /// the graph. It does not change when signals are registered later.
+    /// The signals of a snapshot stay valid until the snapshot is
+    /// released if the entity is deleted by PoolStorage::deleteEntity
+    /// and its signals deregistered by signalDeregistration.
+    ConcurrentSignalTable::SnapshotPtr getSignalSnapshot () const
+    {
+      return concurrentSignals.snapshot ();
+    }
+    /// Empty the signal snapshots and wait until the readers release the
+    /// previous ones. Called by PoolStorage::deleteEntity.
+    void releaseSignalSnapshots ()
+    {
+      concurrentSignals.clear ();
+      concurrentSignals.synchronize ();
+    }
   protected:
+    /// Add a command to this instance. It overrides the class command
+    /// of the same name, if any, even if the latter is already bound.
     void addCommand(const std::string& name,command::Command* command);
+    /// \brief Set the commands shared by the instances of the class.
+    ///
+    /// They are all bound to this instance now, so that looking them up
+    /// later does not modify the entity and can be done by any thread.
+    /// The commands bound by a previous call are deleted.
+    void setClassCommands (const command::ClassCommands& commands);
 
     void entityRegistration ();
     void entityDeregistration ();
 
     void signalRegistration (const SignalArray<int>& signals);
+    /// Deregister a signal. Waits until the signal snapshots which may
+    /// contain it are released, so that it can then be destroyed.
     void signalDeregistration (const std::string& name);
 
     std::string name;
+    /// Signals and commands of the instance, to be modified through
+    /// signalRegistration, signalDeregistration and addCommand only.
     SignalMap signalMap;
     CommandMap_t commandMap;
+    CommandTable boundCommands;
+    const command::ClassCommands* classCommands;
+    ConcurrentSignalTable concurrentSignals;
+
+  private:
+    SignalTable signalTable;
+    CommandTable commandTable;
   };
 
   DYNAMIC_GRAPH_DLLAPI std::ostream&
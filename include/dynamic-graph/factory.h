@@ -26,6 +26,7 @@
 # include <dynamic-graph/fwd.hh>
 # include <dynamic-graph/exception-factory.h>
 # include <dynamic-graph/dynamic-graph-api.h>
+# include <dynamic-graph/plugin-index.h>
 
 /// \ingroup dgraph
 ///
@@ -142,6 +143,9 @@ namespace dynamicgraph
     /// It is <b>the caller</b> responsibility to free the
     /// returned object.
     ///
+    /// If the class is not registered but is provided by an indexed
+    /// plugin (see indexPlugins), the plugin is loaded first.
+    ///
     /// If the class name does not exist, an ExceptionFactory
     /// exception will be raised with the code UNREFERED_OBJECT.
     ///
@@ -169,6 +173,34 @@ namespace dynamicgraph
     /// \param list Available entities will be appended to list.
     void listEntities (std::vector <std::string>& list) const;
 
+    /// \brief Index the plugins of a directory without loading them.
+    ///
+    /// The entity classes of the indexed plugins can then be
+    /// instantiated by newEntity, which loads their plugin on first use.
+    ///
+    /// \param directory plugin directory, the installation plug-in
+    /// directory by default.
+    void indexPlugins (const std::string& directory);
+    void indexPlugins ();
+
+    /// \brief Make an entity class available, loading its indexed
+    /// plugin if needed.
+    ///
+    /// \return whether the class is registered.
+    /// \throw ExceptionFactory DYNAMIC_LOADING if the plugin fails to load.
+    bool loadEntityClass (const std::string& classname);
+
+    /// \brief Path of the shared object defining an entity class, empty
+    /// if unknown.
+    std::string getEntityLibrary (const std::string& classname) const;
+
+    /// \brief Index of the plugins, which also reports the time spent
+    /// scanning and loading them.
+    const PluginIndex& getPluginIndex () const
+    {
+      return pluginIndex;
+    }
+
   private:
 
     /// \brief Constructor the factory.
@@ -188,6 +220,9 @@ namespace dynamicgraph
     /// instantiate an Entity.
     EntityMap entityMap;
 
+    /// \brief Plugins providing entity classes not loaded yet.
+    mutable PluginIndex pluginIndex;
+
     /// \pointer to the unique object of the class
     static FactoryStorage* instance_;
   };
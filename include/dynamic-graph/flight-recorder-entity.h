@@ -0,0 +1,62 @@
+// -*- mode: c++ -*-
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// dynamic-graph is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// dynamic-graph. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DYNAMIC_GRAPH_FLIGHT_RECORDER_ENTITY_H
+# define DYNAMIC_GRAPH_FLIGHT_RECORDER_ENTITY_H
+# include <string>
+
+# include <boost/shared_ptr.hpp>
+
+# include <dynamic-graph/entity.h>
+# include <dynamic-graph/flight-recorder.h>
+# include <dynamic-graph/config-flight-recorder-entity.hh>
+
+namespace dynamicgraph
+{
+  /// \ingroup plugin
+  ///
+  /// \brief Entity recording the entries of the real-time logger.
+  ///
+  /// The entity adds a FlightRecorder to the outputs of
+  /// RealTimeLogger::instance () and gives access to it through commands.
+  /// The destructor removes the crash handler and the recorder from the
+  /// outputs of the logger, which frees the ring.
+  class DG_FLIGHTRECORDERENTITY_DLLAPI FlightRecorderEntity : public Entity
+  {
+    DYNAMIC_GRAPH_ENTITY_DECL ();
+  public:
+    FlightRecorderEntity (const std::string& name);
+    virtual ~FlightRecorderEntity ();
+
+    /// Write the entries kept to filename.
+    void dump (const std::string& filename);
+    /// Dump the entries to filename when the process crashes. An empty
+    /// filename removes the crash handler.
+    void setCrashFile (const std::string& filename);
+
+    const FlightRecorder& recorder () const
+    {
+      return *recorder_;
+    }
+
+    static const std::size_t BUFFER_SIZE_DEFAULT = 16777216; // 16Mo
+
+  private:
+    boost::shared_ptr<FlightRecorder> recorder_;
+  };
+} // end of namespace dynamicgraph
+
+#endif //! DYNAMIC_GRAPH_FLIGHT_RECORDER_ENTITY_H
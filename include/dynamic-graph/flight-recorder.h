@@ -0,0 +1,113 @@
+// -*- mode: c++ -*-
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// dynamic-graph is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// dynamic-graph. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DYNAMIC_GRAPH_FLIGHT_RECORDER_H
+# define DYNAMIC_GRAPH_FLIGHT_RECORDER_H
+# include <cstddef>
+# include <ostream>
+# include <string>
+# include <vector>
+
+# include <boost/atomic.hpp>
+# include <boost/noncopyable.hpp>
+# include <boost/thread/mutex.hpp>
+
+# include <dynamic-graph/dynamic-graph-api.h>
+# include <dynamic-graph/real-time-logger.h>
+
+namespace dynamicgraph
+{
+  /// \ingroup debug
+  ///
+  /// \brief Output of the real-time logger keeping the last entries in
+  /// memory.
+  ///
+  /// The entries are copied in a ring of fixed size, allocated by the
+  /// constructor, overwriting the oldest ones. Nothing is written to disk
+  /// until the ring is dumped, on demand or when the process crashes:
+  /// \code
+  /// FlightRecorder* recorder = new FlightRecorder (16 << 20);
+  /// RealTimeLogger::instance ().addOutputStream (LoggerStreamPtr_t (recorder));
+  /// recorder->installCrashHandler ("/tmp/flight-recorder.log");
+  /// \endcode
+  /// The recorder is written by the thread of the logger: the real-time
+  /// threads only pay for their entries in the logger. Signal values are
+  /// recorded by logging them, preferably with \ref dgRTLOGF.
+  class DYNAMIC_GRAPH_DLLAPI FlightRecorder : public LoggerStream,
+					      private boost::noncopyable
+  {
+  public:
+    /// \param capacity number of characters kept.
+    FlightRecorder (std::size_t capacity);
+    ~FlightRecorder ();
+
+    using LoggerStream::write;
+    virtual void write (const char* text, std::size_t size);
+    virtual void writev (const LoggerEntry* entries, std::size_t nbEntries);
+
+    std::size_t capacity () const
+    {
+      return buffer_.size ();
+    }
+
+    /// Number of characters kept.
+    std::size_t size () const;
+
+    /// \brief Write the content of the ring, from the oldest complete
+    /// entry.
+    void dump (std::ostream& os) const;
+    /// \brief Write the content of the ring to a file.
+    ///
+    /// \throw ExceptionTraces if the file cannot be written.
+    void dump (const std::string& filename) const;
+
+    /// \brief Dump the ring to filename when the process receives SIGSEGV,
+    /// SIGABRT, SIGBUS, SIGFPE or SIGILL.
+    ///
+    /// The handler only uses async-signal-safe functions, then calls the
+    /// handler installed before. Only one recorder can be installed at a
+    /// time; installing another one replaces it. The handler runs on an
+    /// alternate stack in the calling thread, so that stack overflows are
+    /// dumped too.
+    ///
+    /// Only the entries already copied by the thread of the logger are
+    /// dumped: those still in the ring of the logger when the process
+    /// crashes are lost. Formatting them, for those written by
+    /// RealTimeLogger::log, is not async-signal-safe. The loss is at most
+    /// the size of the ring of the logger, and usually a few entries since
+    /// the thread of the logger is woken up by each entry.
+    /// \return false if crash handlers are not supported.
+    bool installCrashHandler (const std::string& filename);
+    /// Restore the handlers replaced by installCrashHandler.
+    void uninstallCrashHandler ();
+
+  private:
+    void append (const char* text, std::size_t size);
+    /// Write the content of the ring to the file descriptor fd, without
+    /// lock nor allocation.
+    bool dump (int fd) const;
+
+    static void crashHandler (int signal);
+
+    std::vector<char> buffer_;
+    /// Number of characters written since the construction.
+    boost::atomic<std::size_t> end_;
+    /// Serializes the writes and the dumps on demand.
+    mutable boost::mutex mutex_;
+  };
+} // end of namespace dynamicgraph
+
+#endif //! DYNAMIC_GRAPH_FLIGHT_RECORDER_H
@@ -23,6 +23,7 @@ namespace dynamicgraph
 
   class PluginRefMap;
   class Entity;
+  struct EntityHandle;
   class EntityRegisterer;
   class ExceptionAbstract;
   class ExceptionFactory;
@@ -34,7 +35,9 @@ namespace dynamicgraph
   class OutStringStream;
   class PluginLoader;
   class PoolStorage;
+  class Reconfiguration;
 
+  struct SignalHandle;
   class SignalCaster;
   class SignalCastRegisterer;
 
@@ -67,6 +70,8 @@ namespace dynamicgraph
   namespace command
   {
     class Command;
+    class SharedCommand;
+    class ClassCommands;
   } // end of namespace command.
 
 } // end of namespace dynamicgraph.
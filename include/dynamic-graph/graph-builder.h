@@ -0,0 +1,138 @@
+// -*- mode: c++ -*-
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// dynamic-graph is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// dynamic-graph. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DYNAMIC_GRAPH_GRAPH_BUILDER_H
+# define DYNAMIC_GRAPH_GRAPH_BUILDER_H
+# include <string>
+# include <vector>
+
+# include <boost/noncopyable.hpp>
+
+# include <dynamic-graph/fwd.hh>
+# include <dynamic-graph/dynamic-graph-api.h>
+# include <dynamic-graph/value.h>
+
+namespace dynamicgraph
+{
+  /// \ingroup dgraph
+  ///
+  /// \brief Build a part of the graph from a declarative description.
+  ///
+  /// The entities to create, the signals to plug and the commands to
+  /// run are declared first, then build () creates the whole graph:
+  ///
+  /// \li all the declarations are checked in a single pass, and all the
+  ///     errors are reported by a single exception,
+  /// \li the entities are constructed in parallel, outside of the pool
+  ///     (see PoolStorage::DeferredRegistration),
+  /// \li the signals are plugged, the dependencies added, the commands of
+  ///     the new entities run, the entities registered in the pool with
+  ///     PoolStorage::registerEntities, and the commands of the entities
+  ///     already in the pool run.
+  ///
+  /// If any step fails, the plugs and dependencies are undone and the new
+  /// entities deleted, so that the pool is left as it was. The effects of the
+  /// commands already run on the entities of the pool cannot be undone:
+  /// they run last, so that this only happens when one of them fails.
+  ///
+  /// Entity classes must support being constructed concurrently with
+  /// other classes and instances. Use a single thread otherwise.
+  class DYNAMIC_GRAPH_DLLAPI GraphBuilder : private boost::noncopyable
+  {
+  public:
+    /// \param nbThreads number of threads constructing the entities,
+    /// the number of hardware threads if 0.
+    explicit GraphBuilder (unsigned nbThreads = 0);
+
+    /// Declare an entity of class className called name.
+    void newEntity (const std::string& className, const std::string& name);
+
+    /// \brief Declare a plug.
+    ///
+    /// \param source signal "entity.signal" providing the value,
+    /// \param destination signal "entity.signal" plugged on source.
+    void plug (const std::string& source, const std::string& destination);
+
+    /// \brief Declare a time dependency, unless it already exists.
+    ///
+    /// \param signal signal "entity.signal" depending on dependency,
+    /// \param dependency signal "entity.signal".
+    void addDependency (const std::string& signal,
+			const std::string& dependency);
+
+    /// \brief Declare a command to run with the given arguments.
+    ///
+    /// The commands of the new entities run in the order of declaration,
+    /// before they are registered in the pool, then those of the other
+    /// entities.
+    void runCommand (const std::string& entity, const std::string& command,
+		     const std::vector<command::Value>& arguments =
+		     std::vector<command::Value> ());
+
+    /// \brief Create the declared graph and clear the declarations.
+    ///
+    /// \throw ExceptionFactory if the graph cannot be built. The message
+    ///        lists all the errors found.
+    void build ();
+
+    /// Remove the declarations.
+    void clear ();
+
+    /// Number of declared entities.
+    std::size_t size () const
+    {
+      return entities_.size ();
+    }
+
+  private:
+    struct EntityDecl
+    {
+      std::string className;
+      std::string name;
+    };
+    struct PlugDecl
+    {
+      std::string source;
+      std::string destination;
+    };
+    struct DependencyDecl
+    {
+      std::string signal;
+      std::string dependency;
+    };
+    struct CommandDecl
+    {
+      std::string entity;
+      std::string command;
+      std::vector<command::Value> arguments;
+    };
+
+    /// Thread constructing entities.
+    struct Worker;
+
+    /// Construct the entities, in parallel.
+    void construct (std::vector<Entity*>& entities,
+		    std::vector<std::string>& errors) const;
+
+    unsigned nbThreads_;
+    std::vector<EntityDecl> entities_;
+    std::vector<PlugDecl> plugs_;
+    std::vector<DependencyDecl> dependencies_;
+    std::vector<CommandDecl> commands_;
+  };
+} // end of namespace dynamicgraph
+
+#endif //! DYNAMIC_GRAPH_GRAPH_BUILDER_H
@@ -25,4 +25,10 @@
 /// Default script path as known by CMake at configure time.
 # define DG_IMPORT_DEFAULT_PATHS "@DG_IMPORT_DEFAULT_PATHS@"
 
+/// Plug-in directory as known by CMake at configure time.
+# define DG_PLUGINDIR "@PLUGINDIR@"
+
+/// Suffix of the plug-in files on the target platform.
+# define DG_SHARED_LIBRARY_SUFFIX "@CMAKE_SHARED_LIBRARY_SUFFIX@"
+
 #endif //! SOT_FACTORY_COMMAND_IMPORT_DEFAULT_PATHS_H
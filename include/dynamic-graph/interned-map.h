@@ -0,0 +1,185 @@
+// -*- mode: c++ -*-
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// dynamic-graph is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// dynamic-graph. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DYNAMIC_GRAPH_INTERNED_MAP_H
+# define DYNAMIC_GRAPH_INTERNED_MAP_H
+# include <cstddef>
+# include <string>
+# include <utility>
+# include <vector>
+
+# include <boost/cstdint.hpp>
+
+# include <dynamic-graph/interned-string.h>
+
+namespace dynamicgraph
+{
+  /// \brief Hash map from interned names to values.
+  ///
+  /// The entries are stored contiguously, in insertion order until an
+  /// entry is erased: the last entry then takes its place. They are
+  /// indexed by an open-addressing table with linear probing, so a
+  /// lookup hashes the key once and compares a few hashes. Keys can be
+  /// looked up as plain strings without being interned.
+  template <typename T>
+  class InternedMap
+  {
+  public:
+    typedef std::pair<InternedString, T> value_type;
+    typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+    InternedMap ()
+    {}
+
+    std::size_t size () const
+    {
+      return entries_.size ();
+    }
+
+    bool empty () const
+    {
+      return entries_.empty ();
+    }
+
+    const_iterator begin () const
+    {
+      return entries_.begin ();
+    }
+
+    const_iterator end () const
+    {
+      return entries_.end ();
+    }
+
+    /// Value associated to key, NULL if there is none.
+    T* find (const std::string& key)
+    {
+      const std::size_t slot = findSlot (key, InternedString::hash (key));
+      return slot == NONE ? NULL : &entries_[slots_[slot] - 1].second;
+    }
+
+    const T* find (const std::string& key) const
+    {
+      return const_cast<InternedMap*> (this)->find (key);
+    }
+
+    T* find (const InternedString& key)
+    {
+      const std::size_t slot = findSlot (key.str (), key.hash ());
+      return slot == NONE ? NULL : &entries_[slots_[slot] - 1].second;
+    }
+
+    const T* find (const InternedString& key) const
+    {
+      return const_cast<InternedMap*> (this)->find (key);
+    }
+
+    /// Insert a value. Return false, leaving the map unchanged, if the
+    /// key is already present.
+    bool insert (const InternedString& key, const T& value)
+    {
+      if (findSlot (key.str (), key.hash ()) != NONE) return false;
+      if (2 * (entries_.size () + 1) > slots_.size ())
+	rehash (slots_.empty () ? 8 : 2 * slots_.size ());
+      entries_.push_back (value_type (key, value));
+      slots_[freeSlot (key.hash ())] =
+	static_cast<boost::uint32_t> (entries_.size ());
+      return true;
+    }
+
+    /// Remove the entry of key. Return false if there is none.
+    bool erase (const std::string& key)
+    {
+      std::size_t slot = findSlot (key, InternedString::hash (key));
+      if (slot == NONE) return false;
+
+      // Move the last entry in place of the erased one.
+      const boost::uint32_t index = slots_[slot];
+      if (index != entries_.size ())
+	{
+	  const std::size_t last =
+	    findSlot (entries_.back ().first.str (),
+		      entries_.back ().first.hash ());
+	  entries_[index - 1] = entries_.back ();
+	  slots_[last] = index;
+	}
+      entries_.pop_back ();
+
+      // Backward shift deletion: move up the entries of the cluster
+      // which would not be found anymore.
+      const std::size_t mask = slots_.size () - 1;
+      std::size_t next = (slot + 1) & mask;
+      while (slots_[next] != 0)
+	{
+	  const std::size_t ideal =
+	    entries_[slots_[next] - 1].first.hash () & mask;
+	  if (((next - ideal) & mask) >= ((next - slot) & mask))
+	    {
+	      slots_[slot] = slots_[next];
+	      slot = next;
+	    }
+	  next = (next + 1) & mask;
+	}
+      slots_[slot] = 0;
+      return true;
+    }
+
+    void clear ()
+    {
+      entries_.clear ();
+      slots_.clear ();
+    }
+
+  private:
+    static const std::size_t NONE = static_cast<std::size_t> (-1);
+
+    std::size_t findSlot (const std::string& key, std::size_t hash) const
+    {
+      if (slots_.empty ()) return NONE;
+      const std::size_t mask = slots_.size () - 1;
+      for (std::size_t slot = hash & mask; slots_[slot] != 0;
+	   slot = (slot + 1) & mask)
+	{
+	  const InternedString& k = entries_[slots_[slot] - 1].first;
+	  if (k.hash () == hash && k.str () == key) return slot;
+	}
+      return NONE;
+    }
+
+    std::size_t freeSlot (std::size_t hash) const
+    {
+      const std::size_t mask = slots_.size () - 1;
+      std::size_t slot = hash & mask;
+      while (slots_[slot] != 0) slot = (slot + 1) & mask;
+      return slot;
+    }
+
+    void rehash (std::size_t nbSlots)
+    {
+      slots_.assign (nbSlots, 0);
+      for (std::size_t i = 0; i < entries_.size (); ++i)
+	slots_[freeSlot (entries_[i].first.hash ())] =
+	  static_cast<boost::uint32_t> (i + 1);
+    }
+
+    /// Entries, in insertion order until an erasure.
+    std::vector<value_type> entries_;
+    /// Index plus one of the entry in each slot, 0 for empty slots.
+    std::vector<boost::uint32_t> slots_;
+  };
+} // end of namespace dynamicgraph
+
+#endif //! DYNAMIC_GRAPH_INTERNED_MAP_H
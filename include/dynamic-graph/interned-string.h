@@ -0,0 +1,100 @@
+// -*- mode: c++ -*-
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// dynamic-graph is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// dynamic-graph. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DYNAMIC_GRAPH_INTERNED_STRING_H
+# define DYNAMIC_GRAPH_INTERNED_STRING_H
+# include <cstddef>
+# include <iosfwd>
+# include <string>
+# include <utility>
+
+# include <dynamic-graph/dynamic-graph-api.h>
+
+namespace dynamicgraph
+{
+  /// \brief String stored once in a library-wide table.
+  ///
+  /// Equal strings share the same storage, hence copies are a pointer
+  /// copy and comparisons a pointer comparison. The hash of the content
+  /// is computed once, when the string is interned. Interned strings are
+  /// never freed. Interning is thread-safe: the table is split in shards
+  /// with their own lock, and interning a string which is already in the
+  /// table does not allocate.
+  class DYNAMIC_GRAPH_DLLAPI InternedString
+  {
+  public:
+    /// The empty string.
+    InternedString ();
+    explicit InternedString (const std::string& str);
+    InternedString (const char* first, const char* last);
+
+    const std::string& str () const
+    {
+      return entry_->first;
+    }
+
+    bool empty () const
+    {
+      return entry_->first.empty ();
+    }
+
+    /// Hash of the content, equal to hash (str ()).
+    std::size_t hash () const
+    {
+      return entry_->second;
+    }
+
+    /// Hash function of the content of strings (FNV-1a).
+    static std::size_t hash (const std::string& str)
+    {
+      return hash (str.data (), str.data () + str.size ());
+    }
+
+    static std::size_t hash (const char* first, const char* last)
+    {
+      std::size_t h = 2166136261u;
+      for (; first != last; ++first)
+	h = (h ^ static_cast<unsigned char> (*first)) * 16777619u;
+      return h;
+    }
+
+    bool operator== (const InternedString& other) const
+    {
+      return entry_ == other.entry_;
+    }
+
+    bool operator!= (const InternedString& other) const
+    {
+      return entry_ != other.entry_;
+    }
+
+    /// Arbitrary but consistent order, for use in sorted containers.
+    bool operator< (const InternedString& other) const
+    {
+      return entry_ < other.entry_;
+    }
+
+    typedef std::pair<const std::string, std::size_t> Entry;
+
+  private:
+    const Entry* entry_;
+  };
+
+  DYNAMIC_GRAPH_DLLAPI std::ostream&
+  operator<< (std::ostream& os, const InternedString& str);
+} // end of namespace dynamicgraph
+
+#endif //! DYNAMIC_GRAPH_INTERNED_STRING_H
@@ -0,0 +1,90 @@
+// -*- mode: c++ -*-
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// dynamic-graph is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// dynamic-graph. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DYNAMIC_GRAPH_NUMBER_FORMAT_H
+# define DYNAMIC_GRAPH_NUMBER_FORMAT_H
+# include <cstddef>
+# include <ostream>
+
+# include <dynamic-graph/dynamic-graph-api.h>
+# include <dynamic-graph/linear-algebra.h>
+
+namespace dynamicgraph
+{
+  /// \brief Maximal number of characters written by formatDouble.
+  static const std::size_t DOUBLE_MAX_CHARS = 25;
+
+  /// \brief Write the shortest representation of value which reads back
+  /// to the same double.
+  ///
+  /// The digits are generated with the Grisu2 algorithm. Special values
+  /// are written "nan", "inf" and "-inf" so that the default double cast
+  /// can read them back.
+  ///
+  /// \param first beginning of a buffer of at least DOUBLE_MAX_CHARS chars.
+  /// \return pointer one past the last written character. No terminating
+  ///         null character is written.
+  DYNAMIC_GRAPH_DLLAPI char* formatDouble (char* first, double value);
+
+  /// \brief Buffered writer of numbers on an output stream.
+  ///
+  /// Characters are accumulated in a fixed-size buffer which is handed to
+  /// std::ostream::write when full and on destruction. The stream is
+  /// never flushed by this class.
+  class DYNAMIC_GRAPH_DLLAPI NumberWriter
+  {
+  public:
+    explicit NumberWriter (std::ostream& os)
+      : os_ (os), end_ (buffer_)
+    {}
+
+    ~NumberWriter ()
+    {
+      flush ();
+    }
+
+    inline NumberWriter& put (char c)
+    {
+      if (end_ == buffer_ + SIZE) flush ();
+      *end_++ = c;
+      return *this;
+    }
+
+    inline NumberWriter& put (double value)
+    {
+      if (end_ + DOUBLE_MAX_CHARS > buffer_ + SIZE) flush ();
+      end_ = formatDouble (end_, value);
+      return *this;
+    }
+
+    /// Write the coefficients, each of them preceded by separator.
+    NumberWriter& put (const Vector& v, char separator);
+    /// Write the coefficients row by row, each of them preceded by separator.
+    NumberWriter& put (const Matrix& m, char separator);
+
+    /// Hand the buffered characters to the stream.
+    void flush ();
+
+  private:
+    static const std::size_t SIZE = 1024;
+
+    std::ostream& os_;
+    char buffer_[SIZE];
+    char* end_;
+  };
+} // end of namespace dynamicgraph
+
+#endif //! DYNAMIC_GRAPH_NUMBER_FORMAT_H
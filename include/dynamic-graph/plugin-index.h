@@ -0,0 +1,123 @@
+// -*- mode: c++ -*-
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// dynamic-graph is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// dynamic-graph. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DYNAMIC_GRAPH_PLUGIN_INDEX_H
+# define DYNAMIC_GRAPH_PLUGIN_INDEX_H
+# include <iosfwd>
+# include <map>
+# include <string>
+# include <vector>
+
+# include <boost/cstdint.hpp>
+# include <boost/noncopyable.hpp>
+
+# include <dynamic-graph/dynamic-graph-api.h>
+
+namespace dynamicgraph
+{
+  /// \ingroup dgraph
+  ///
+  /// \brief Index of the entity classes provided by the plugins of
+  /// directories.
+  ///
+  /// Entity classes are registered in the factory when their plugin is
+  /// loaded. The index maps class names to plugins so that a plugin is
+  /// only loaded when one of its classes is instantiated.
+  ///
+  /// The index of a directory is stored in the file INDEX_FILE of this
+  /// directory. When scanning, plugins which are missing from this file,
+  /// or which changed since it was written, are loaded once to find the
+  /// classes they register, and the file is rewritten. If the directory
+  /// is not writable, as in a system-wide install, the index is written
+  /// in the cache of the user instead ($XDG_CACHE_HOME/dynamic-graph, or
+  /// $HOME/.cache/dynamic-graph). Plugins which fail to load are
+  /// recorded as such and not loaded again until they change.
+  ///
+  /// Plugin files are recognized by the shared library suffix of the
+  /// platform. A class registered by a library loaded along with a
+  /// plugin, e.g. another plugin it links to, is attributed to the
+  /// library defining its constructor.
+  class DYNAMIC_GRAPH_DLLAPI PluginIndex : private boost::noncopyable
+  {
+  public:
+    /// Name of the index file of a plugin directory.
+    static const std::string INDEX_FILE;
+
+    struct Plugin
+    {
+      Plugin ();
+
+      /// Absolute path of the library.
+      std::string path;
+      /// Size and modification time of the library when indexed.
+      boost::uint64_t size;
+      boost::int64_t mtime;
+      /// Entity classes registered by the library.
+      std::vector<std::string> classes;
+      /// Whether the library has been loaded by the index.
+      bool loaded;
+      /// Time spent loading the library, in seconds.
+      double loadTime;
+      /// Loading error, empty if none.
+      std::string error;
+    };
+
+    PluginIndex ();
+
+    /// \brief Index the plugins of a directory.
+    ///
+    /// Libraries which cannot be loaded are reported, not thrown, so
+    /// that a broken plugin does not prevent the others from being used.
+    /// Their error is kept in the index.
+    /// \throw ExceptionFactory READ_FILE if directory cannot be read.
+    void scan (const std::string& directory);
+
+    /// Plugin providing an entity class, NULL if none is indexed.
+    const Plugin* find (const std::string& className) const;
+
+    /// \brief Load the plugin providing an entity class, if not loaded yet.
+    ///
+    /// \return false if no indexed plugin provides the class.
+    /// \throw ExceptionFactory DYNAMIC_LOADING if the library fails to
+    ///        load.
+    bool load (const std::string& className);
+
+    const std::vector<Plugin>& plugins () const
+    {
+      return plugins_;
+    }
+
+    /// Write the time spent scanning and loading each plugin.
+    void report (std::ostream& os) const;
+
+  private:
+    /// Load a library, recording the classes it registers.
+    void loadPlugin (Plugin& plugin);
+    /// Add a plugin, replacing the previous plugin of the same path.
+    void addPlugin (const Plugin& plugin);
+
+    std::vector<Plugin> plugins_;
+    /// Index in plugins_ of the plugin of each class.
+    std::map<std::string, std::size_t> classes_;
+    /// Scanned directories and time spent scanning them, in seconds.
+    std::vector<std::pair<std::string, double> > scans_;
+    /// Classes registered by the libraries loaded as dependencies of a
+    /// plugin, by file name of the library.
+    std::map<std::string, std::vector<std::string> > dependencies_;
+  };
+} // end of namespace dynamicgraph
+
+#endif //! DYNAMIC_GRAPH_PLUGIN_INDEX_H
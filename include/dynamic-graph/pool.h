@@ -20,14 +20,48 @@
 # include <map>
 # include <string>
 # include <sstream>
+# include <vector>
+
+# include <boost/atomic.hpp>
+# include <boost/cstdint.hpp>
+# include <boost/noncopyable.hpp>
 
 # include <dynamic-graph/fwd.hh>
 # include <dynamic-graph/exception-factory.h>
 # include <dynamic-graph/signal-base.h>
+# include <dynamic-graph/command-queue.h>
+# include <dynamic-graph/snapshot-table.h>
+# include <dynamic-graph/value.h>
 # include <dynamic-graph/dynamic-graph-api.h>
 
 namespace dynamicgraph
 {
+  /*! \brief Handle on an entity of the pool.
+
+    A handle is an index in the table of the pool and the generation of
+    the slot. When the entity is removed from the pool, the generation of
+    its slot changes and the handle becomes invalid. A default
+    constructed handle is invalid.
+  */
+  struct EntityHandle
+  {
+    EntityHandle () : index (0), generation (0) {}
+    boost::uint32_t index;
+    boost::uint32_t generation;
+  };
+
+  /*! \brief Handle on a signal of an entity of the pool.
+
+    It becomes invalid when the signal is deregistered or its entity is
+    removed from the pool.
+  */
+  struct SignalHandle
+  {
+    SignalHandle () : index (0), generation (0) {}
+    boost::uint32_t index;
+    boost::uint32_t generation;
+  };
+
   /*! @ingroup dgraph
     \brief Singleton that keeps track of all the entities.
 
@@ -51,6 +85,8 @@ namespace dynamicgraph
     */
     /*! \brief Sorted set of entities with unique key (name). */
     typedef std::map< std::string,Entity* > Entities;
+    /*! \brief Entities readable from any thread. */
+    typedef SnapshotTable<Entity*> EntityTable;
 
     /// \brief Get unique instance of the class.
     static PoolStorage *getInstance();
@@ -58,6 +94,12 @@ namespace dynamicgraph
     /// \brief Destroy the unique instance of the class
     static void destroy();
 
+    /// \brief Whether the unique instance exists, without creating it.
+    static bool existInstance ()
+    {
+      return instance_ != NULL;
+    }
+
     /*! @} */
 
     /*! \brief Default destructor */
@@ -72,6 +114,41 @@ namespace dynamicgraph
     */
     void registerEntity (const std::string& entname, Entity* ent);
 
+    /*! \brief Register several entities at once.
+
+      Either all the entities are registered, or none of them and an
+      ExceptionFactory OBJECT_CONFLICT is raised.
+    */
+    void registerEntities (const std::vector<Entity*>& entities);
+
+    /*! \brief Defer the registration of the entities constructed by the
+      current thread.
+
+      While an instance exists, registerEntity called from the thread
+      which created it records the entity in the instance instead of
+      registering it. This lets entities be constructed outside of the
+      pool, for instance in parallel, and registered later with
+      registerEntities.
+    */
+    class DYNAMIC_GRAPH_DLLAPI DeferredRegistration
+      : private boost::noncopyable
+    {
+    public:
+      DeferredRegistration ();
+      ~DeferredRegistration ();
+
+      /// Entities whose registration has been deferred.
+      const std::vector<Entity*>& entities () const
+      {
+	return entities_;
+      }
+
+    private:
+      friend class PoolStorage;
+      std::vector<Entity*> entities_;
+      DeferredRegistration* previous_;
+    };
+
     /*! \brief Unregister an entity.
       \par[in] entname: The name of the entity,
     */
@@ -101,17 +178,238 @@ namespace dynamicgraph
     void clearPlugin (const std::string& name);
     /*! @} */
 
+    /*! \name Concurrent readers
+      The methods above must be called by the thread modifying the
+      graph. Other threads, for instance to monitor the graph, read the
+      entities through a snapshot of the pool. Taking a snapshot never
+      waits for the modifications of the pool, and the snapshot does not
+      change afterwards.
+
+      An entity deregistered while other threads may still use it must be
+      deleted by deleteEntity, which waits until the snapshots containing
+      the entity, and the signal snapshots of the entity (see
+      Entity::getSignalSnapshot), have been released.
+      @{
+    */
+    /*! \brief Snapshot of the registered entities. Can be called from
+        any thread. */
+    EntityTable::SnapshotPtr getEntitySnapshot () const
+    {
+      return concurrentEntities_.snapshot ();
+    }
+
+    /*! \brief Deregister an entity, wait for the readers of the pool and
+        delete it. */
+    void deleteEntity (const std::string& name);
+
+    /*! \brief Wait until the snapshots of the pool preceding the last
+        modification have been released. */
+    void synchronizeReaders ();
+    /*! @} */
+
     ///
     /// \brief Get a signal by name
     ///
     /// \param sigpath stream containing a string of the form "entity.signal"
     SignalBase<int>& getSignal( std::istringstream& sigpath );
 
+    /*! \name Handles
+      Resolve a name once, then access the object in constant time.
+      Invalid handles raise an ExceptionFactory.
+      @{
+    */
+    EntityHandle getEntityHandle (const std::string& name);
+    Entity& getEntity (const EntityHandle& handle) const;
+    bool isValid (const EntityHandle& handle) const;
+
+    SignalHandle getSignalHandle (const EntityHandle& entity,
+				  const std::string& signame);
+    /*! \param sigpath string of the form "entity.signal" */
+    SignalHandle getSignalHandle (const std::string& sigpath);
+    SignalBase<int>& getSignal (const SignalHandle& handle) const;
+    bool isValid (const SignalHandle& handle) const;
+
+    /*! \brief Invalidate the handles on a signal removed from an entity. */
+    void invalidateSignalHandles (const Entity& entity,
+				  const SignalBase<int>& signal);
+    /*! @} */
+
+    /*! \name Bulk signal access
+      Read or write the values of many signals at once, in their binary
+      representation (see SignalBase::serialize) packed in one buffer.
+      The values are read and written in one pass, by the thread
+      evaluating the graph between two evaluations: they all belong to
+      the same tick. Other threads reach them through the commands of a
+      SignalMonitorEntity queued in getCommandQueue.
+      @{
+    */
+    /*! \brief Position of the value of a signal in a packed buffer. */
+    struct PackedSignal
+    {
+      PackedSignal () : offset (0), size (0), time (0), type (0) {}
+      boost::uint64_t offset;
+      boost::uint64_t size;
+      /// Time of the signal when it was read. Ignored by writeSignals.
+      int time;
+      /// Type of the value, see SignalCaster::getEntry (std::size_t).
+      /// Ignored by writeSignals.
+      boost::uint32_t type;
+    };
+
+    /*! \brief Copy the current values of the signals, see
+        Signal::accessCopy, into buffer.
+
+        The signals are not recomputed. The handles are checked before
+        anything is read. The values of the types registered by
+        DefaultCastRegisterer are written straight into buffer, which
+        keeps its capacity: reading the same signals again does not
+        allocate. Other types go through a boost::any copy of the value.
+        \param layout position, time and type of each value, in order.
+        \throw ExceptionFactory if a handle is invalid, ExceptionSignal
+        if a signal has no binary representation.
+    */
+    void readSignals (const std::vector<SignalHandle>& signals,
+		      std::string& buffer,
+		      std::vector<PackedSignal>& layout) const;
+
+    /*! \brief Set the signals to the values packed in buffer, as
+        described by layout.
+
+        All the values are read into the spare copy of their signal
+        first, see SignalBase::deserializePending, then the signals are
+        set as by Signal::operator=: an input signal is no longer
+        plugged. Either all the signals are set, or none. The values of
+        the types registered by DefaultCastRegisterer are read without
+        allocating if their size does not change. Other types go through
+        a boost::any copy of the value.
+        \throw ExceptionFactory if a handle is invalid or the layout does
+        not fit buffer, ExceptionSignal if a value does not fit its
+        signal.
+    */
+    void writeSignals (const std::vector<SignalHandle>& signals,
+		       const std::string& buffer,
+		       const std::vector<PackedSignal>& layout);
+    /*! @} */
+
+    /*! \name Commands
+      @{
+    */
+    /*! \brief Call of a command of an entity, see executeCommands. */
+    struct CommandCall
+    {
+      std::string entity;
+      std::string command;
+      std::vector<command::Value> arguments;
+    };
+
+    /*! \brief Execute a batch of commands in one pass.
+
+        The entities and the commands are resolved, and the arguments
+        checked, before any command is executed: if one of them is
+        wrong, nothing is executed. The arguments are then moved into
+        the commands, not copied, and each call receives the previous
+        parameter values of its command.
+        \param results result of each call, in order.
+        \throw ExceptionFactory if an entity or a command does not exist,
+        ExceptionAbstract if arguments do not fit their command.
+    */
+    void executeCommands (std::vector<CommandCall>& calls,
+			  std::vector<command::Value>& results);
+
+    /*! \brief Commands queued by other threads, executed by the thread
+        evaluating the graph.
+
+        The thread evaluating the graph calls
+        command::CommandQueue::execute at the start of each tick, so that
+        the commands do not race with the evaluation.
+    */
+    command::CommandQueue& getCommandQueue ()
+    {
+      return commandQueue_;
+    }
+    /*! @} */
+
     /*! \brief This method write a graph description on the file named
         FileName. */
     void writeGraph (const std::string& aFileName);
     void writeCompletionList (std::ostream& os);
 
+    /*! \brief Save the state of all the entities and their signals in
+        the binary file named aFileName.
+
+        For each signal, the current copy, time, readiness and type are
+        saved, see SignalBase::saveState. Entities may add their own
+        state through Entity::saveState.
+        \return the signals whose value is not saved, because their type
+        has no binary functions (see SignalBase::canSaveState): restore
+        leaves their value unchanged.
+    */
+    std::vector<std::string> checkpoint (const std::string& aFileName);
+    /*! \brief Restore a checkpoint written by checkpoint into a graph
+        constructed identically.
+
+        Each entity and signal of the file must exist in the pool. Those
+        which are not in the file are left unchanged.
+    */
+    void restore (const std::string& aFileName);
+
+    /*! \name Reconfiguration
+      The thread evaluating the graph applies the reconfigurations staged
+      by other threads between two evaluations.
+      @{
+    */
+    /*! \brief Hand a reconfiguration over to the thread evaluating the
+        graph, preparing it if needed.
+
+        The reconfiguration must not be destroyed before its state is
+        Reconfiguration::APPLIED or Reconfiguration::REJECTED.
+        \return false if another reconfiguration is already staged.
+    */
+    bool stageReconfiguration (Reconfiguration& reconfiguration);
+    /*! \brief Apply the staged reconfiguration, if any.
+
+        To be called by the thread evaluating the graph, between two
+        evaluations. It does not wait for the other threads.
+        \return true if a reconfiguration was applied.
+    */
+    bool applyStagedReconfiguration ();
+    /*! \brief Number of entities deregistered and signals removed from
+        an entity since the creation of the pool. Can be called from any
+        thread.
+
+        A reconfiguration prepared before a removal may hold pointers on
+        the removed signals: it is rejected. */
+    boost::uint32_t getRemovalCount () const
+    {
+      return removals_.load ();
+    }
+    /*! @} */
+
+    /*! \brief Save the topology of the graph in the binary file named
+        aFileName.
+
+        The file describes the class and name of the entities, the plugs,
+        the time dependencies and the parameter values of the last
+        execution of the setter commands (see
+        command::Command::getExecutedValues). It also records the size
+        and modification time of the libraries defining the entity
+        classes.
+
+        Only the dependencies between signals of the pool are saved, and
+        importTopology reproduces them exactly: the dependencies added by
+        the constructors which have been removed are removed again.
+    */
+    void exportTopology (const std::string& aFileName);
+    /*! \brief Rebuild a graph saved by exportTopology.
+
+        The graph is built by a GraphBuilder, without interpreting any
+        script.
+        \return false, leaving the pool unchanged, if the file does not
+        exist or if a library defining an entity class changed since the
+        file was written.
+    */
+    bool importTopology (const std::string& aFileName);
+
   protected:
     /*! \name Fields of the class to manage the three entities.
       Also the name is singular, those are true sets.
@@ -121,7 +419,38 @@ namespace dynamicgraph
     Entities entityMap;
 
   private:
-    PoolStorage () {}
+    struct EntitySlot
+    {
+      Entity* entity;
+      boost::uint32_t generation;
+      /// Signal slots allocated for the entity.
+      std::vector<boost::uint32_t> signals;
+    };
+    struct SignalSlot
+    {
+      SignalBase<int>* signal;
+      boost::uint32_t generation;
+    };
+
+    /// Release the slot of an entity and of its signals.
+    void releaseEntitySlot (const std::string& entname);
+    void releaseSignalSlot (boost::uint32_t index);
+
+    std::vector<EntitySlot> entitySlots_;
+    std::vector<SignalSlot> signalSlots_;
+    std::vector<boost::uint32_t> freeEntitySlots_;
+    std::vector<boost::uint32_t> freeSignalSlots_;
+    /// Slot of each registered entity.
+    std::map<std::string, boost::uint32_t> entitySlotIndex_;
+    /// Copy of entityMap published to the other threads.
+    EntityTable concurrentEntities_;
+    boost::atomic<Reconfiguration*> stagedReconfiguration_;
+    /// See getRemovalCount.
+    boost::atomic<boost::uint32_t> removals_;
+    command::CommandQueue commandQueue_;
+
+    PoolStorage ()
+      : stagedReconfiguration_ (NULL), removals_ (0), commandQueue_ (1024) {}
     static PoolStorage* instance_;
   };
 
@@ -16,30 +16,58 @@
 
 #ifndef DYNAMIC_GRAPH_LOGGER_REAL_TIME_H
 # define DYNAMIC_GRAPH_LOGGER_REAL_TIME_H
+# include <algorithm>
+# include <cstring>
 # include <sstream>
+# include <string>
 # include <vector>
 
+# include <boost/atomic.hpp>
 # include <boost/circular_buffer.hpp>
+# include <boost/noncopyable.hpp>
+# include <boost/cstdint.hpp>
 # include <boost/shared_ptr.hpp>
 # include <boost/thread/mutex.hpp>
+# include <boost/thread/tss.hpp>
 
 # include <dynamic-graph/config.hh>
 # include <dynamic-graph/debug.h>
+# include <dynamic-graph/linear-algebra.h>
 
 
 namespace dynamicgraph
 {
+  /// \brief Text of a log entry: size characters followed by a null
+  /// character.
+  struct LoggerEntry
+  {
+    const char* text;
+    std::size_t size;
+  };
+
   /// \ingroup debug
   ///
   /// \brief Stream for the real-time logger.
   ///
   /// You should inherit from this class in order to redirect the logs where you
-  /// want.
+  /// want. Override one of the write methods: by default, each calls the
+  /// other.
   /// \sa LoggerIOStream
   class LoggerStream
   {
     public:
-      virtual void write (const char* c) = 0;
+      virtual void write (const char* c) { write (c, std::strlen (c)); }
+      virtual void write (const char* text, std::size_t size)
+      {
+        (void) size;
+        write (text);
+      }
+      /// Write several entries at once. By default, write each of them.
+      virtual void writev (const LoggerEntry* entries, std::size_t nbEntries)
+      {
+        for (std::size_t i = 0; i < nbEntries; ++i)
+          write (entries[i].text, entries[i].size);
+      }
   };
 
   /// Write to an ostream object.
@@ -50,7 +78,18 @@ namespace dynamicgraph
   {
     public:
       LoggerIOStream (std::ostream& os) : os_ (os) {}
-      virtual void write (const char* c) { os_ << c; }
+      using LoggerStream::write;
+      virtual void write (const char* text, std::size_t size)
+      {
+        os_.write (text, static_cast<std::streamsize> (size));
+      }
+      virtual void writev (const LoggerEntry* entries, std::size_t nbEntries)
+      {
+        for (std::size_t i = 0; i < nbEntries; ++i)
+          os_.write (entries[i].text,
+                     static_cast<std::streamsize> (entries[i].size));
+        os_.flush ();
+      }
     private:
       std::ostream& os_;
   };
@@ -59,6 +98,35 @@ namespace dynamicgraph
   class RealTimeLogger;
 
   /// \cond DEVEL
+  /// \brief Stream buffer writing to an array of fixed size.
+  ///
+  /// The characters which do not fit are dropped, and the truncation
+  /// recorded.
+  class FixedStreamBuffer : public std::streambuf
+  {
+    public:
+      FixedStreamBuffer () : truncated_ (false) {}
+      void reset (char* begin, char* end)
+      {
+        setp (begin, end);
+        truncated_ = false;
+      }
+      std::size_t size () const
+      {
+        return static_cast<std::size_t> (pptr () - pbase ());
+      }
+      bool truncated () const { return truncated_; }
+    protected:
+      virtual int_type overflow (int_type c)
+      {
+        if (!traits_type::eq_int_type (c, traits_type::eof ()))
+          truncated_ = true;
+        return traits_type::eof ();
+      }
+    private:
+      bool truncated_;
+  };
+
   /// \brief write entries to intenal buffer.
   ///
   /// The entry starts when an instance is created and ends when is is deleted.
@@ -66,7 +134,8 @@ namespace dynamicgraph
   class RTLoggerStream
   {
     public:
-      RTLoggerStream (RealTimeLogger* logger, std::ostream& os) : logger_(logger), os_ (os) {}
+      RTLoggerStream (RealTimeLogger* logger, std::size_t position, std::ostream& os)
+        : logger_(logger), position_ (position), os_ (os) {}
       template <typename T> inline RTLoggerStream& operator<< (T  t) { if (logger_!=NULL) os_ << t; return *this; }
       inline RTLoggerStream& operator<< (std::ostream& (*pf)(std::ostream&)) { if (logger_!=NULL) os_ << pf; return *this; }
 
@@ -74,8 +143,102 @@ namespace dynamicgraph
     private:
 
       RealTimeLogger* logger_;
+      std::size_t position_;
       std::ostream& os_;
   };
+
+  /// \brief Encode the arguments of a log entry formatted by the thread
+  /// of the logger.
+  ///
+  /// Each argument is stored as a type tag followed by its raw bytes. An
+  /// argument which does not fit is replaced by a truncation mark, after
+  /// which nothing is written. This class is only used by RealTimeLogger.
+  class LogRecordWriter
+  {
+    public:
+      enum Type { BOOL, CHAR, INT, UNSIGNED_INT, LONG, UNSIGNED_LONG, DOUBLE,
+        POINTER, STRING, MATRIX, TRUNCATED };
+
+      LogRecordWriter () : cursor_ (NULL), end_ (NULL), truncated_ (false) {}
+      void reset (char* begin, char* end) { cursor_ = begin; end_ = end; }
+      char* cursor () const { return cursor_; }
+      bool truncated () const { return truncated_; }
+
+      void put (bool value) { putScalar (BOOL, value); }
+      void put (char value) { putScalar (CHAR, value); }
+      void put (int value) { putScalar (INT, value); }
+      void put (unsigned int value) { putScalar (UNSIGNED_INT, value); }
+      void put (long value) { putScalar (LONG, value); }
+      void put (unsigned long value) { putScalar (UNSIGNED_LONG, value); }
+      void put (double value) { putScalar (DOUBLE, value); }
+      void put (const void* value) { putScalar (POINTER, value); }
+      void put (const char* value) { putString (value, std::strlen (value)); }
+      void put (const std::string& value) { putString (value.data (), value.size ()); }
+      /// The coefficients are stored as double, in column-major order.
+      template <typename Derived>
+      void put (const Eigen::MatrixBase<Derived>& value)
+      {
+        const int rows = static_cast<int> (value.rows ());
+        const int cols = static_cast<int> (value.cols ());
+        if (!reserve (2 * sizeof (int)
+                      + static_cast<std::size_t> (rows * cols) * sizeof (double)))
+          return;
+        *cursor_++ = MATRIX;
+        copy (rows);
+        copy (cols);
+        for (int j = 0; j < cols; ++j)
+          for (int i = 0; i < rows; ++i)
+            copy (static_cast<double> (value (i, j)));
+      }
+
+    private:
+      template <typename T> void copy (const T& value)
+      {
+        std::memcpy (cursor_, &value, sizeof (T));
+        cursor_ += sizeof (T);
+      }
+      template <typename T> void putScalar (Type type, const T& value)
+      {
+        if (!reserve (sizeof (T))) return;
+        *cursor_++ = static_cast<char> (type);
+        copy (value);
+      }
+      void putString (const char* value, std::size_t size)
+      {
+        const std::size_t header = 2 + sizeof (std::size_t);
+        if (cursor_ == end_) return;
+        if (static_cast<std::size_t> (end_ - cursor_) < header) {
+          truncate ();
+          return;
+        }
+        const std::size_t room = static_cast<std::size_t> (end_ - cursor_) - header;
+        const std::size_t length = std::min (size, room);
+        *cursor_++ = STRING;
+        copy (length);
+        std::memcpy (cursor_, value, length);
+        cursor_ += length;
+        if (length < size) truncate ();
+      }
+      /// Whether an argument of size bytes fits with its type tag, keeping
+      /// one byte for the truncation mark.
+      bool reserve (std::size_t size)
+      {
+        if (cursor_ == end_) return false;
+        if (static_cast<std::size_t> (end_ - cursor_) >= size + 2) return true;
+        truncate ();
+        return false;
+      }
+      void truncate ()
+      {
+        *cursor_++ = TRUNCATED;
+        end_ = cursor_;
+        truncated_ = true;
+      }
+
+      char* cursor_;
+      char* end_;
+      bool truncated_;
+  };
   /// \endcond DEVEL
 
   /// \ingroup debug
@@ -96,89 +259,425 @@ namespace dynamicgraph
   /// dgRTLOG() << "your message. Prefer to use \n than std::endl."
   /// \endcode
   ///
+  /// dgRTLOG formats the message in the calling thread, which may
+  /// allocate memory. Real-time threads should rather use the deferred
+  /// formatting of \ref dgRTLOGF, which only copies a pointer to the
+  /// format string, a timestamp and the arguments into the ring:
+  /// \code
+  /// dgRTLOGF ("iteration {}: error {}, state {}\n", t, error, state);
+  /// \endcode
+  /// Each {} of the format is replaced by the next argument; the
+  /// arguments left are appended. The arguments may be integers, floating
+  /// point numbers, booleans, pointers, strings and Eigen matrices. The
+  /// arguments beyond RECORD_SIZE bytes are truncated.
+  ///
   /// \note Thread safety. This class expects to have:
   /// - only one reader: the one who take the log entries and write them somewhere.
-  /// - one writer at a time. Writing to the logs is **never** a blocking
-  ///   operation. If the resource is busy, the log entry is discarded.
+  /// - any number of writers. The entries are kept in a bounded lock-free
+  ///   ring: a writer reserves a slot, writes its entry in it and commits it.
+  ///   Writing to the logs is **never** a blocking operation. If the ring is
+  ///   full, the log entry is discarded and counted in the statistics of the
+  ///   writer thread.
+  ///
+  /// \note Memory. The slots of the ring, and the batch of entries given to
+  /// the outputs, are allocated by the constructor: neither the writers nor
+  /// the thread of the logger allocate memory afterwards. An entry is
+  /// truncated to ENTRY_SIZE characters, and counted in the statistics of
+  /// the writer thread. An entry written by log is truncated to TEXT_SIZE
+  /// characters once formatted.
   class DYNAMIC_GRAPH_DLLAPI RealTimeLogger
   {
   public:
+    /// Statistics of a thread writing to the logger.
+    struct ProducerStatistics
+    {
+      std::string name;
+      std::size_t nbWritten;
+      std::size_t nbDiscarded;
+      /// Number of entries written but truncated.
+      std::size_t nbTruncated;
+    };
+
+    /// Size of an entry in the ring.
+    static const std::size_t ENTRY_SIZE = 512;
+    /// Size of the arguments of an entry written by log.
+    static const std::size_t RECORD_SIZE =
+      ENTRY_SIZE - sizeof (const char*) - sizeof (boost::int64_t);
+    /// Size of an entry written by log, once formatted.
+    static const std::size_t TEXT_SIZE = 4 * ENTRY_SIZE;
+    /// Size of the text of the entries passed at once to the outputs.
+    static const std::size_t BATCH_SIZE = 64 * 1024;
+
     static RealTimeLogger& instance();
 
     static void destroy();
 
     /// \todo add an argument to preallocate the internal string to a given size.
+    /// \param bufferSize the logger holds up to bufferSize - 1 entries.
     RealTimeLogger (const std::size_t& bufferSize);
 
-    inline void clearOutputStreams () { outputs_.clear(); }
+    /// \brief Start a thread writing the entries to the outputs.
+    ///
+    /// The thread of instance () is started by instance ().
+    void start ();
+
+    /// Stop the thread started by start, once the entries are written.
+    void stop ();
 
-    inline void addOutputStream (const LoggerStreamPtr_t& os) { outputs_.push_back(os); }
+    void clearOutputStreams ();
+
+    void addOutputStream (const LoggerStreamPtr_t& os);
+
+    /// \brief Remove an output added by addOutputStream.
+    ///
+    /// Once it returns, the thread of the logger no longer writes to os.
+    /// The entries not read yet are not written to os.
+    void removeOutputStream (const LoggerStreamPtr_t& os);
 
     /// Write next message to output.
-    /// It does nothing if the buffer is empty.
+    /// It does nothing if the buffer is empty or if the next message is still
+    /// being written.
     /// \return true if it wrote something
     bool spinOnce ();
 
+    /// Write all the messages ready to the outputs, with one call to
+    /// LoggerStream::writev per output and per BATCH_SIZE characters.
+    /// \return the number of messages written.
+    std::size_t spin ();
+
     /// Return an object onto which a real-time thread can write.
     /// The message is considered finished when the object is destroyed.
     RTLoggerStream front();
 
-    inline void frontReady() { backIdx_ = (backIdx_+1) % buffer_.size(); wmutex.unlock(); }
+    /// Commit the entry reserved at position by front.
+    void frontReady (std::size_t position);
+
+    /// \brief Write an entry of size characters, already formatted.
+    ///
+    /// The characters beyond ENTRY_SIZE are dropped.
+    /// \return false if the entry was discarded.
+    bool write (const char* text, std::size_t size);
+
+    /// \name Deferred formatting
+    /// \brief Write an entry formatted by the thread of the logger.
+    ///
+    /// The format must be a string literal, or an array which outlives
+    /// the entry: only its address is kept. This does not allocate memory.
+    /// \{
+    template <std::size_t N>
+    void log (const char (&format)[N])
+    {
+      std::size_t position;
+      LogRecordWriter record;
+      if (!beginRecord (format, position, record)) return;
+      endRecord (position, record);
+    }
+
+    template <std::size_t N, typename A1>
+    void log (const char (&format)[N], const A1& a1)
+    {
+      std::size_t position;
+      LogRecordWriter record;
+      if (!beginRecord (format, position, record)) return;
+      record.put (a1);
+      endRecord (position, record);
+    }
+
+    template <std::size_t N, typename A1, typename A2>
+    void log (const char (&format)[N], const A1& a1, const A2& a2)
+    {
+      std::size_t position;
+      LogRecordWriter record;
+      if (!beginRecord (format, position, record)) return;
+      record.put (a1); record.put (a2);
+      endRecord (position, record);
+    }
+
+    template <std::size_t N, typename A1, typename A2, typename A3>
+    void log (const char (&format)[N], const A1& a1, const A2& a2,
+              const A3& a3)
+    {
+      std::size_t position;
+      LogRecordWriter record;
+      if (!beginRecord (format, position, record)) return;
+      record.put (a1); record.put (a2); record.put (a3);
+      endRecord (position, record);
+    }
+
+    template <std::size_t N, typename A1, typename A2, typename A3,
+              typename A4>
+    void log (const char (&format)[N], const A1& a1, const A2& a2,
+              const A3& a3, const A4& a4)
+    {
+      std::size_t position;
+      LogRecordWriter record;
+      if (!beginRecord (format, position, record)) return;
+      record.put (a1); record.put (a2); record.put (a3); record.put (a4);
+      endRecord (position, record);
+    }
+
+    template <std::size_t N, typename A1, typename A2, typename A3,
+              typename A4, typename A5>
+    void log (const char (&format)[N], const A1& a1, const A2& a2,
+              const A3& a3, const A4& a4, const A5& a5)
+    {
+      std::size_t position;
+      LogRecordWriter record;
+      if (!beginRecord (format, position, record)) return;
+      record.put (a1); record.put (a2); record.put (a3); record.put (a4);
+      record.put (a5);
+      endRecord (position, record);
+    }
+
+    template <std::size_t N, typename A1, typename A2, typename A3,
+              typename A4, typename A5, typename A6>
+    void log (const char (&format)[N], const A1& a1, const A2& a2,
+              const A3& a3, const A4& a4, const A5& a5, const A6& a6)
+    {
+      std::size_t position;
+      LogRecordWriter record;
+      if (!beginRecord (format, position, record)) return;
+      record.put (a1); record.put (a2); record.put (a3); record.put (a4);
+      record.put (a5); record.put (a6);
+      endRecord (position, record);
+    }
+    /// \}
+
+    /// \brief Register the calling thread as a writer.
+    ///
+    /// This is done by the first call to front of each thread, and
+    /// allocates its statistics. Real-time threads should call it before
+    /// their loop.
+    /// \param name name of the thread in the statistics.
+    void registerProducer (const std::string& name = std::string ());
+
+    /// Statistics of each thread which wrote to the logger.
+    std::vector<ProducerStatistics> getProducerStatistics () const;
+
+    /// Number of entries discarded, by all the threads.
+    std::size_t getNbDiscarded () const;
 
     inline bool empty () const
     {
-      return frontIdx_ == backIdx_;
+      return readIdx_.load () == writeIdx_.load ();
     }
 
     inline bool full () const
     {
-      return ((backIdx_ + 1) % buffer_.size()) == frontIdx_;
+      return size () >= buffer_.size();
     }
 
+    /// Number of entries reserved and not read yet.
     inline std::size_t size () const
     {
-      if (frontIdx_ <= backIdx_)
-        return backIdx_ - frontIdx_;
-      else
-        return backIdx_ + buffer_.size() - frontIdx_;
+      return writeIdx_.load () - readIdx_.load ();
     }
 
-    inline std::size_t getBufferSize () { return buffer_.size(); }
+    inline std::size_t getBufferSize () { return buffer_.size() + 1; }
 
     ~RealTimeLogger ();
 
   private:
 
     struct Data {
-      std::stringbuf buf;
+      Data () : os (&buf) {}
+      FixedStreamBuffer buf;
+      std::ostream os;
+      /// Position of the entry the slot is ready for: equal to the position
+      /// when the slot is free, to the position plus one once committed.
+      boost::atomic<std::size_t> sequence;
+      /// Whether the entry was written by log rather than front.
+      bool deferred;
+      /// Text of an entry written by front, or format, timestamp and
+      /// arguments of an entry written by log.
+      char entry[ENTRY_SIZE];
+      std::size_t size;
     };
 
+    struct Producer {
+      std::string name;
+      boost::atomic<std::size_t> nbWritten;
+      boost::atomic<std::size_t> nbDiscarded;
+      boost::atomic<std::size_t> nbTruncated;
+    };
+
+    /// Reserve a slot, or count the entry as discarded and return NULL.
+    Data* reserve (std::size_t& position);
+    /// Reserve a slot for log and write the header of the entry.
+    bool beginRecord (const char* format, std::size_t& position,
+                      LogRecordWriter& record);
+    /// Commit the entry written by log.
+    void endRecord (std::size_t position, const LogRecordWriter& record);
+    /// Make the entry at position available to the reader.
+    void commit (std::size_t position);
+    /// Append the text of the entry of data to the batch.
+    void readEntry (Data* data);
+    /// Write the batch to the outputs and empty it.
+    void writeBatch ();
+
+    /// Wake the thread of the logger up if it waits for entries. Only
+    /// the first writer after it started waiting does a system call.
+    void wakeConsumer ();
+    /// Wait until an entry is committed, until stop is set and
+    /// wakeConsumer called, or for at most timeout nanoseconds if it is
+    /// positive.
+    void waitForEntries (const boost::atomic<bool>& stop,
+                         boost::int64_t timeout);
+    /// Whether the next entry to read has been committed.
+    bool ready () const;
+
+    /// Producer of the calling thread, registered if needed.
+    Producer& producer ();
+    /// The producers are owned by producers_, not by the threads.
+    static void keepProducer (Producer*) {}
+
+    /// Protects outputs_ against the thread of the logger.
+    boost::mutex outputsMutex_;
     std::vector<LoggerStreamPtr_t> outputs_;
+    /// Size of outputs_, read by the writers without lock.
+    boost::atomic<std::size_t> nbOutputs_;
     std::vector<Data*> buffer_;
-    /// Index of the next value to be read.
-    std::size_t frontIdx_;
-    /// Index of the slot where to write next value (does not contain valid data).
-    std::size_t backIdx_;
+    /// Position of the next entry to be read.
+    boost::atomic<std::size_t> readIdx_;
+    /// Position of the next entry to be reserved.
+    boost::atomic<std::size_t> writeIdx_;
+    /// Stream of the discarded entries.
     std::ostream oss_;
+    /// Formats the entries written by log into the batch.
+    FixedStreamBuffer formatterBuf_;
+    std::ostream formatter_;
+    /// Text of the entries read by spin, and views on them.
+    std::vector<char> batch_;
+    std::size_t batchSize_;
+    std::vector<LoggerEntry> batchEntries_;
+
+    /// Whether the thread of the logger waits for entries.
+    boost::atomic<bool> consumerWaiting_;
+    /// Incremented to wake the thread of the logger up (futex word).
+    boost::atomic<int> wakeups_;
 
-    /// The writer mutex.
-    boost::mutex wmutex;
-    std::size_t nbDiscarded_;
+    /// Protects the registration of the producers.
+    mutable boost::mutex producersMutex_;
+    std::vector<Producer*> producers_;
+    boost::thread_specific_ptr<Producer> producer_;
 
     struct thread;
+    thread* thread_;
 
     static RealTimeLogger* instance_;
-    static thread* thread_;
+  };
+
+  /// \ingroup debug
+  ///
+  /// \brief Levels of the entries of the real-time logger.
+  ///
+  /// The entries below DG_RTLOG_MIN_LEVEL are removed at compile time.
+  enum RTLogLevel
+  {
+    RTLOG_DEBUG,
+    RTLOG_INFO,
+    RTLOG_WARNING,
+    RTLOG_ERROR
+  };
+
+  /// \ingroup debug
+  ///
+  /// \brief Token bucket of a rate-limited call site of the real-time
+  /// logger.
+  ///
+  /// Instances are static variables declared by \ref dgRTLOG_LIMIT and
+  /// \ref dgRTLOGF_LIMIT. A call site consumes a token per entry. The
+  /// thread of RealTimeLogger::instance () gives the tokens back at the
+  /// given rate. Periodically, it also writes the number of entries
+  /// suppressed by each call site.
+  class DYNAMIC_GRAPH_DLLAPI RTLogCallsite : private boost::noncopyable
+  {
+  public:
+    /// \param rate number of entries per second in the long run.
+    /// \param burst number of entries which can be written at once.
+    RTLogCallsite (const char* file, int line, double rate, int burst);
+    ~RTLogCallsite ();
+
+    /// Whether an entry can be written. Otherwise, the entry is counted
+    /// as suppressed.
+    bool acquire ()
+    {
+      if (tokens_.load (boost::memory_order_relaxed) > 0
+          && tokens_.fetch_sub (1, boost::memory_order_relaxed) > 0)
+        return true;
+      suppressed_.fetch_add (1, boost::memory_order_relaxed);
+      return false;
+    }
+
+    /// Number of entries suppressed since the last report.
+    std::size_t getNbSuppressed () const { return suppressed_.load (); }
+
+    /// Give the tokens earned during elapsed seconds to each call site.
+    static void refill (double elapsed);
+    /// Write to logger the number of entries suppressed by each call site
+    /// since the last report.
+    static void reportSuppressed (RealTimeLogger& logger);
+    /// Number of call sites.
+    static std::size_t count ();
+
+  private:
+    const char* file_;
+    int line_;
+    double rate_;
+    int burst_;
+    /// Part of a token earned, only used by refill.
+    double credit_;
+    boost::atomic<int> tokens_;
+    boost::atomic<std::size_t> suppressed_;
   };
 } // end of namespace dynamicgraph
 
+# ifndef DG_RTLOG_MIN_LEVEL
+/// Minimal level of the entries of the real-time logger compiled in.
+#  define DG_RTLOG_MIN_LEVEL ::dynamicgraph::RTLOG_DEBUG
+# endif
+
 #ifdef ENABLE_RT_LOG
 # define dgADD_OSTREAM_TO_RTLOG(ostr) ::dynamicgraph::RealTimeLogger::instance() \
   .addOutputStream(::dynamicgraph::LoggerStreamPtr_t(new ::dynamicgraph::LoggerIOStream(ostr)))
 # define dgRTLOG() ::dynamicgraph::RealTimeLogger::instance().front()
+# define dgRTLOGF ::dynamicgraph::RealTimeLogger::instance().log
+# define dgRTLOG_LIMITED_(level, rate, burst)                             \
+  if ((level) < DG_RTLOG_MIN_LEVEL) ;                                   \
+  else if (bool dgRTLOG_done_ = false) ;                                \
+  else for (static ::dynamicgraph::RTLogCallsite dgRTLOG_callsite_      \
+              (__FILE__, __LINE__, rate, burst);                        \
+            !dgRTLOG_done_ && dgRTLOG_callsite_.acquire ();             \
+            dgRTLOG_done_ = true)
 #else // ENABLE_RT_LOG
 # define dgADD_OSTREAM_TO_RTLOG(ostr) struct __end_with_semicolon
 # define dgRTLOG() if (1) ; else __null_stream()
+# define dgRTLOGF if (1) ; else ::dynamicgraph::RealTimeLogger::instance().log
+# define dgRTLOG_LIMITED_(level, rate, burst) if (1) ; else
 #endif
 
+/// \brief Entries of the given level, removed at compile time below
+/// DG_RTLOG_MIN_LEVEL.
+/// \code
+/// dgRTLOG_LEVEL (RTLOG_WARNING) << "joint limit reached\n";
+/// dgRTLOGF_LEVEL (RTLOG_INFO) ("iteration {}\n", t);
+/// \endcode
+#define dgRTLOG_LEVEL(level) if ((level) < DG_RTLOG_MIN_LEVEL) ; else dgRTLOG()
+#define dgRTLOGF_LEVEL(level) if ((level) < DG_RTLOG_MIN_LEVEL) ; else dgRTLOGF
+
+/// \brief Entries of the given level, limited to rate entries per second
+/// with bursts of burst entries by a token bucket per call site.
+///
+/// Once the call site is registered by its first call, a suppressed entry
+/// costs a test and an atomic increment. The number of suppressed entries
+/// is written to the logger every second.
+/// \code
+/// dgRTLOG_LIMIT (RTLOG_WARNING, 1., 5) << "tracking error too large\n";
+/// dgRTLOGF_LIMIT (RTLOG_WARNING, 1., 5) ("tracking error {}\n", error);
+/// \endcode
+#define dgRTLOG_LIMIT(level, rate, burst)                               \
+  dgRTLOG_LIMITED_ (level, rate, burst) dgRTLOG()
+#define dgRTLOGF_LIMIT(level, rate, burst)                              \
+  dgRTLOG_LIMITED_ (level, rate, burst) dgRTLOGF
+
 #endif //! DYNAMIC_GRAPH_LOGGER_REAL_TIME_H
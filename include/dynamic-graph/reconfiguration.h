@@ -0,0 +1,159 @@
+// -*- mode: c++ -*-
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// dynamic-graph is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// dynamic-graph. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DYNAMIC_GRAPH_RECONFIGURATION_H
+# define DYNAMIC_GRAPH_RECONFIGURATION_H
+# include <string>
+# include <vector>
+
+# include <boost/atomic.hpp>
+# include <boost/cstdint.hpp>
+# include <boost/noncopyable.hpp>
+
+# include <dynamic-graph/fwd.hh>
+# include <dynamic-graph/dynamic-graph-api.h>
+# include <dynamic-graph/signal-base.h>
+# include <dynamic-graph/time-dependency.h>
+
+namespace dynamicgraph
+{
+  /// \ingroup dgraph
+  ///
+  /// \brief Set of topology changes applied at once.
+  ///
+  /// The changes are recorded first, then prepare () validates them
+  /// against a shadow copy of the edges of the graph: the signals are
+  /// resolved, the plugs type-checked, the dependencies checked, and
+  /// the changes creating a cycle rejected. prepare () also computes
+  /// the net effect of the changes and allocates what applying them
+  /// needs. It is meant to run outside of the real-time thread.
+  ///
+  /// apply () then performs the changes between two evaluations of the
+  /// graph, in a time proportional to their number and without any
+  /// allocation or lookup by name. If the graph changed since prepare
+  /// (), or if an entity or a signal was removed from the pool, apply ()
+  /// changes nothing and returns false.
+  ///
+  /// The thread preparing the reconfiguration usually hands it over to
+  /// the thread evaluating the graph with
+  /// PoolStorage::stageReconfiguration.
+  ///
+  /// \note The plugs of signals of different types, which go through
+  /// SignalBase::checkCompatibility, are not bounded in time.
+  class DYNAMIC_GRAPH_DLLAPI Reconfiguration : private boost::noncopyable
+  {
+  public:
+    enum State
+      {
+	/// Changes may be recorded.
+	RECORDING,
+	/// Validated, ready to be applied.
+	PREPARED,
+	/// Handed over to the thread evaluating the graph.
+	STAGED,
+	APPLIED,
+	/// Not applied: the graph changed since prepare ().
+	REJECTED
+      };
+
+    Reconfiguration ();
+
+    /// \name Changes
+    /// Signals are designated as "entity.signal".
+    /// \{
+    void plug (const std::string& source, const std::string& destination);
+    void unplug (const std::string& destination);
+    void addDependency (const std::string& signal,
+			const std::string& dependency);
+    void removeDependency (const std::string& signal,
+			   const std::string& dependency);
+    /// \}
+
+    /// Number of recorded changes.
+    std::size_t size () const
+    {
+      return changes_.size ();
+    }
+
+    /// \brief Validate the changes and get ready to apply them.
+    ///
+    /// \throw ExceptionFactory if the changes cannot be applied. The
+    ///        message lists all the errors found.
+    void prepare ();
+
+    /// \brief Apply the prepared changes.
+    ///
+    /// \return false, changing nothing, if the edges modified by the
+    ///         reconfiguration changed since prepare (), or if an entity
+    ///         or a signal was removed since (see
+    ///         PoolStorage::getRemovalCount).
+    bool apply ();
+
+    /// Remove the changes. Must not be called while staged.
+    void clear ();
+
+    State state () const
+    {
+      return static_cast<State> (state_.load ());
+    }
+
+  private:
+    friend class PoolStorage;
+    typedef TimeDependency<int>::Dependencies Dependencies;
+
+    struct Change
+    {
+      enum Kind { PLUG, UNPLUG, ADD_DEPENDENCY, REMOVE_DEPENDENCY };
+      Kind kind;
+      std::string first;
+      std::string second;
+    };
+    struct PlugEdit
+    {
+      SignalBase<int>* destination;
+      SignalBase<int>* source;
+      /// Source of destination when prepared.
+      SignalBase<int>* previous;
+    };
+    struct DependencyEdit
+    {
+      SignalBase<int>* signal;
+      const SignalBase<int>* dependency;
+      bool add;
+      /// Dependency list of signal, NULL if signal does not use
+      /// TimeDependency.
+      TimeDependency<int>* list;
+      /// Node inserted in list by an addition.
+      Dependencies node;
+      /// Node removed from list by a removal.
+      Dependencies::iterator position;
+    };
+
+    void record (Change::Kind kind, const std::string& first,
+		 const std::string& second);
+
+    std::vector<Change> changes_;
+    std::vector<PlugEdit> plugs_;
+    std::vector<DependencyEdit> dependencies_;
+    /// Nodes removed from the dependency lists, freed by clear ().
+    Dependencies removed_;
+    /// PoolStorage::getRemovalCount when prepared.
+    boost::uint32_t removals_;
+    boost::atomic<int> state_;
+  };
+} // end of namespace dynamicgraph
+
+#endif //! DYNAMIC_GRAPH_RECONFIGURATION_H
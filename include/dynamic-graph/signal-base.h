@@ -20,10 +20,13 @@
 # include <string>
 # include <sstream>
 # include <typeinfo>
+# include <vector>
 # include <boost/noncopyable.hpp>
 
 # include <dynamic-graph/fwd.hh>
 # include <dynamic-graph/exception-signal.h>
+# include <dynamic-graph/interned-string.h>
+# include <dynamic-graph/signal-caster.h>
 
 
 namespace dynamicgraph
@@ -41,10 +44,31 @@ namespace dynamicgraph
   {
   public:
     explicit SignalBase(std::string name = "")
-      : name (name),
-	signalTime (0),
-	ready (false)
-    {}
+      : signalTime (0),
+	ready (false),
+	hasNode (false)
+    {
+      // Split the name, "Class(entity)::io(type)::name" in general, in
+      // components shared with the other signals.
+      const std::string::size_type colon = name.rfind (':');
+      const std::string::size_type local =
+	colon == std::string::npos ? 0 : colon + 1;
+      const std::string::size_type open = name.find ('(');
+      const std::string::size_type close = name.find (')');
+      std::string::size_type infixBegin = 0;
+      if (open < close && close < local)
+	{
+	  hasNode = true;
+	  nodeClassName = InternedString (name.data (), name.data () + open);
+	  nodeName = InternedString (name.data () + open + 1,
+				     name.data () + close);
+	  infixBegin = close + 1;
+	}
+      infix = InternedString (name.data () + infixBegin,
+			      name.data () + local);
+      localName = InternedString (name.data () + local,
+				  name.data () + name.size ());
+    }
 
     virtual ~SignalBase ()
     {}
@@ -66,9 +90,41 @@ namespace dynamicgraph
       return ready;
     }
 
-    const std::string& getName () const
+    /// Full name of the signal, rebuilt from its components.
+    std::string getName () const
+    {
+      if (!hasNode) return infix.str () + localName.str ();
+      std::string res;
+      res.reserve (nodeClassName.str ().size () + nodeName.str ().size ()
+		   + infix.str ().size () + localName.str ().size () + 2);
+      res += nodeClassName.str ();
+      res += '(';
+      res += nodeName.str ();
+      res += ')';
+      res += infix.str ();
+      res += localName.str ();
+      return res;
+    }
+
+    /// Part of the name after the last ':', i.e. the name of the signal
+    /// in its entity for names of the form "Class(entity)::io(type)::name".
+    const InternedString& getLocalName () const
     {
-      return name;
+      return localName;
+    }
+
+    /// Part of the name between the first parentheses, i.e. the name of
+    /// the entity, empty if there is none.
+    const InternedString& getNodeName () const
+    {
+      return nodeName;
+    }
+
+    /// Part of the name before the first parenthesis, i.e. the class of
+    /// the entity, empty if the name has no entity.
+    const InternedString& getNodeClassName () const
+    {
+      return nodeClassName;
     }
 
     void getClassName(std::string & aClassName) const
@@ -96,6 +152,11 @@ namespace dynamicgraph
     virtual void clearDependencies ()
     {}
 
+    /// Append the signals this signal depends on to list.
+    virtual void listDependencies
+    (std::vector<const SignalBase<Time>*>&) const
+    {}
+
     virtual bool needUpdate (const Time&) const
     {
       return ready;
@@ -143,6 +204,18 @@ namespace dynamicgraph
 	 this->getName ().c_str () );
     }
 
+    /// Check that plug (sigarg) would succeed, without plugging.
+    /// \throw ExceptionSignal PLUG_IMPOSSIBLE otherwise.
+    virtual void checkPlug (SignalBase<Time>* sigarg)
+    {
+      DG_THROW ExceptionSignal
+	(ExceptionSignal::PLUG_IMPOSSIBLE,
+	 "Plug-in operation not possible with this signal. ",
+	 "(while trying to plug %s on %s).",
+	 sigarg == NULL ? "nothing" : sigarg->getName ().c_str (),
+	 this->getName ().c_str () );
+    }
+
     virtual void unplug ()
     {
       DG_THROW ExceptionSignal
@@ -214,6 +287,87 @@ namespace dynamicgraph
 	 this->getName ().c_str () );
     }
 
+    /// Write the binary representation of the signal value.
+    virtual void serialize (std::ostream&) const
+    {
+      DG_THROW ExceptionSignal
+	(ExceptionSignal::SET_IMPOSSIBLE,
+	 "Serialize operation not possible with this signal. ",
+	 "(while trying to serialize %s).",
+	 this->getName ().c_str () );
+    }
+
+    /// Set the signal value from its binary representation.
+    virtual void deserialize (std::istream&)
+    {
+      DG_THROW ExceptionSignal
+	(ExceptionSignal::SET_IMPOSSIBLE,
+	 "Deserialize operation not possible with this signal. ",
+	 "(while trying to deserialize %s).",
+	 this->getName ().c_str () );
+    }
+
+    /// \brief Read a binary representation as deserialize does, without
+    /// changing the signal value yet.
+    ///
+    /// The signal keeps one pending value, set by commitPending, so that
+    /// several signals can be read before any of them is set.
+    virtual void deserializePending (std::istream&)
+    {
+      DG_THROW ExceptionSignal
+	(ExceptionSignal::SET_IMPOSSIBLE,
+	 "Deserialize operation not possible with this signal. ",
+	 "(while trying to deserialize %s).",
+	 this->getName ().c_str () );
+    }
+
+    /// Set the signal to the value read by deserializePending.
+    virtual void commitPending ()
+    {}
+
+    /// Cast entry of the type of the value, NULL if the signal has no
+    /// value.
+    virtual const SignalCaster::Entry* getCastEntry () const
+    {
+      return NULL;
+    }
+
+    /// \}
+
+    /// \name Checkpoint
+    /// \{
+
+    /// Write the time and readiness of the signal. Signals holding a
+    /// value extend it.
+    virtual void saveState (std::ostream& os) const
+    {
+      const char r = ready ? 1 : 0;
+      os.write (reinterpret_cast<const char*> (&signalTime), sizeof (Time));
+      os.write (&r, 1);
+    }
+
+    /// Whether saveState writes the whole state of the signal. The
+    /// value of a signal whose type has no binary functions is skipped.
+    virtual bool canSaveState () const
+    {
+      return true;
+    }
+
+    /// Read back the state written by saveState.
+    virtual void restoreState (std::istream& is)
+    {
+      char r;
+      is.read (reinterpret_cast<char*> (&signalTime), sizeof (Time));
+      is.read (&r, 1);
+      if (!is)
+	DG_THROW ExceptionSignal
+	  (ExceptionSignal::SET_IMPOSSIBLE,
+	   "Truncated signal state. ",
+	   "(while trying to restore %s).",
+	   this->getName ().c_str () );
+      ready = (r != 0);
+    }
+
     /// \}
 
     /// \name Display
@@ -221,21 +375,13 @@ namespace dynamicgraph
 
     virtual std::ostream& display (std::ostream& os) const
     {
-      os << "Sig:" << name;
+      os << "Sig:" << getName ();
       return os;
     }
 
-    std::string shortName () const
+    const std::string& shortName () const
     {
-      std::istringstream iss (name);
-      const int SIZE = 128;
-      char buffer[SIZE];
-      while (iss.good ())
-	{
-	  iss.getline(buffer,SIZE,':');
-	}
-      const std::string res (buffer);
-      return res;
+      return localName.str ();
     }
     /// \}
 
@@ -245,15 +391,8 @@ namespace dynamicgraph
     virtual void ExtractNodeAndLocalNames (std::string& LocalName,
 					   std::string & NodeName) const
     {
-      std::string fullname = this->getName ();
-
-      size_t IdxPosLocalName = fullname.rfind (":");
-      LocalName = fullname.substr (IdxPosLocalName + 1,
-				   fullname.length () - IdxPosLocalName + 1);
-      size_t IdxPosNodeNameStart = fullname.find ("(");
-      size_t IdxPosNodeNameEnd = fullname.find (")");
-      NodeName = fullname.substr (IdxPosNodeNameStart + 1,
-				  IdxPosNodeNameEnd - IdxPosNodeNameStart - 1);
+      LocalName = localName.str ();
+      NodeName = nodeName.str ();
     }
 
     /// \}
@@ -271,9 +410,19 @@ namespace dynamicgraph
     /// \}
 
   protected:
-    std::string name;
     Time signalTime;
     bool ready;
+
+  private:
+    /// Whether the name has an entity and a class.
+    bool hasNode;
+    /// Components of the name: the signal stores no string of its own.
+    InternedString nodeClassName;
+    InternedString nodeName;
+    /// Part between the entity and the local name, e.g.
+    /// "::output(double)::".
+    InternedString infix;
+    InternedString localName;
   };
 
   /// Forward to a virtual fonction.
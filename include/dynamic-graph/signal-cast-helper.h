@@ -21,11 +21,15 @@
 # include <vector>
 
 # include <boost/any.hpp>
+# include <boost/cstdint.hpp>
 # include <boost/format.hpp>
 # include <boost/function/function1.hpp>
 # include <boost/function/function2.hpp>
 # include <boost/lexical_cast.hpp>
+# include <boost/static_assert.hpp>
 # include <boost/tuple/tuple.hpp>
+# include <boost/type_traits/has_trivial_copy.hpp>
+# include <boost/type_traits/is_pointer.hpp>
 
 #include <dynamic-graph/eigen-io.h>
 
@@ -36,6 +40,176 @@
 namespace dynamicgraph
 {
 
+  /* --- BINARY SERIALIZATION ---------------------------------------------- */
+
+  /// \brief Binary representation of objects.
+  ///
+  /// The default implementation copies the bytes of trivially copyable
+  /// types. Other types are not supported unless the class is
+  /// specialized; Eigen dense types and std::string are. Unsupported
+  /// types have no serialize and deserialize functions, so that using
+  /// them does not compile.
+  template <typename T,
+	    bool Trivial = boost::has_trivial_copy<T>::value
+	    && !boost::is_pointer<T>::value>
+  struct BinaryCast
+  {
+    static const bool supported = false;
+  };
+
+  /// Check that a binary value has been read entirely.
+  inline void checkBinaryRead (std::istream& is)
+  {
+    if (!is)
+      throw ExceptionSignal (ExceptionSignal::GENERIC,
+			     "truncated binary value");
+  }
+
+  template <typename T>
+  struct BinaryCast<T, true>
+  {
+    static const bool supported = true;
+    static void serialize (const T& value, std::ostream& os)
+    {
+      os.write (reinterpret_cast<const char*> (&value), sizeof (T));
+    }
+    static void deserialize (std::istream& is, T& value)
+    {
+      is.read (reinterpret_cast<char*> (&value), sizeof (T));
+      checkBinaryRead (is);
+    }
+  };
+
+  /// Dense Eigen objects: number of rows and columns followed by the
+  /// coefficients in storage order.
+  template <typename Derived>
+  struct EigenBinaryCast
+  {
+    static const bool supported = true;
+    static void serialize (const Derived& value, std::ostream& os)
+    {
+      const boost::uint64_t size[2] =
+	{ static_cast<boost::uint64_t> (value.rows ()),
+	  static_cast<boost::uint64_t> (value.cols ()) };
+      os.write (reinterpret_cast<const char*> (size), sizeof (size));
+      os.write (reinterpret_cast<const char*> (value.data ()),
+		static_cast<std::streamsize>
+		(value.size () * sizeof (typename Derived::Scalar)));
+    }
+    static void deserialize (std::istream& is, Derived& value)
+    {
+      boost::uint64_t size[2];
+      is.read (reinterpret_cast<char*> (size), sizeof (size));
+      checkBinaryRead (is);
+      if ((Derived::RowsAtCompileTime != Eigen::Dynamic
+	   && size[0] != boost::uint64_t (Derived::RowsAtCompileTime))
+	  || (Derived::ColsAtCompileTime != Eigen::Dynamic
+	      && size[1] != boost::uint64_t (Derived::ColsAtCompileTime)))
+	throw ExceptionSignal (ExceptionSignal::GENERIC,
+			       "binary value has a wrong size");
+      value.resize (static_cast<typename Derived::Index> (size[0]),
+		    static_cast<typename Derived::Index> (size[1]));
+      is.read (reinterpret_cast<char*> (value.data ()),
+	       static_cast<std::streamsize>
+	       (value.size () * sizeof (typename Derived::Scalar)));
+      checkBinaryRead (is);
+    }
+  };
+
+  template <typename S, int R, int C, int O, int MR, int MC>
+  struct BinaryCast<Eigen::Matrix<S, R, C, O, MR, MC>, false>
+    : EigenBinaryCast<Eigen::Matrix<S, R, C, O, MR, MC> >
+  {};
+
+  template <typename S, int R, int C, int O, int MR, int MC>
+  struct BinaryCast<Eigen::Array<S, R, C, O, MR, MC>, false>
+    : EigenBinaryCast<Eigen::Array<S, R, C, O, MR, MC> >
+  {};
+
+  template <>
+  struct BinaryCast<std::string, false>
+  {
+    static const bool supported = true;
+    static void serialize (const std::string& value, std::ostream& os)
+    {
+      const boost::uint64_t size = value.size ();
+      os.write (reinterpret_cast<const char*> (&size), sizeof (size));
+      os.write (value.data (), static_cast<std::streamsize> (size));
+    }
+    static void deserialize (std::istream& is, std::string& value)
+    {
+      boost::uint64_t size;
+      is.read (reinterpret_cast<char*> (&size), sizeof (size));
+      checkBinaryRead (is);
+      value.resize (static_cast<std::size_t> (size));
+      if (size > 0)
+	is.read (&value[0], static_cast<std::streamsize> (size));
+      checkBinaryRead (is);
+    }
+  };
+
+  /// Binary functions registered by DefaultCastRegisterer: none for the
+  /// types BinaryCast does not support.
+  template <typename T, bool Supported = BinaryCast<T>::supported>
+  struct DefaultBinaryFunctions
+  {
+    static SignalCaster::serializer_type serializer ()
+    {
+      return SignalCaster::serializer_type ();
+    }
+    static SignalCaster::deserializer_type deserializer ()
+    {
+      return SignalCaster::deserializer_type ();
+    }
+    static SignalCaster::binary_writer_type binaryWriter ()
+    {
+      return NULL;
+    }
+    static SignalCaster::binary_reader_type binaryReader ()
+    {
+      return NULL;
+    }
+  };
+
+  template <typename T>
+  struct DefaultBinaryFunctions<T, true>
+  {
+    static void serialize (const boost::any& object, std::ostream& os)
+    {
+      BinaryCast<T>::serialize (boost::any_cast<const T&> (object), os);
+    }
+    static boost::any deserialize (std::istream& is)
+    {
+      T inst;
+      BinaryCast<T>::deserialize (is, inst);
+      return inst;
+    }
+    static SignalCaster::serializer_type serializer ()
+    {
+      return serialize;
+    }
+    static SignalCaster::deserializer_type deserializer ()
+    {
+      return deserialize;
+    }
+    static void write (const void* object, std::ostream& os)
+    {
+      BinaryCast<T>::serialize (*static_cast<const T*> (object), os);
+    }
+    static void read (std::istream& is, void* object)
+    {
+      BinaryCast<T>::deserialize (is, *static_cast<T*> (object));
+    }
+    static SignalCaster::binary_writer_type binaryWriter ()
+    {
+      return write;
+    }
+    static SignalCaster::binary_reader_type binaryReader ()
+    {
+      return read;
+    }
+  };
+
   /* --- NON GENERIC CASTER ------------------------------------------------- */
 
   /// This class can be used to register default casts, i.e. casts
@@ -46,7 +220,12 @@ namespace dynamicgraph
   {
   public:
     DefaultCastRegisterer ()
-      : SignalCastRegisterer (typeid(T), disp, cast, trace)
+      : SignalCastRegisterer
+	(typeid(T), disp, cast, trace,
+	 DefaultBinaryFunctions<T>::serializer (),
+	 DefaultBinaryFunctions<T>::deserializer (),
+	 DefaultBinaryFunctions<T>::binaryWriter (),
+	 DefaultBinaryFunctions<T>::binaryReader ())
     {}
 
     static boost::any cast (std::istringstream& iss);
@@ -103,6 +282,16 @@ namespace dynamicgraph
       static T cast( std::istringstream& ) { throw 1;}
       static void disp( const T&,std::ostream&)  { throw 1;  }
       static void trace( const T& t,std::ostream& os ) { disp(t,os); }
+      static void serialize( const T& t,std::ostream& os )
+      {
+	BOOST_STATIC_ASSERT (BinaryCast<T>::supported);
+	BinaryCast<T>::serialize(t,os);
+      }
+      static T deserialize( std::istream& is )
+      {
+	BOOST_STATIC_ASSERT (BinaryCast<T>::supported);
+	T res; BinaryCast<T>::deserialize(is,res); return res;
+      }
     public:
       // adapter functions for SignalCast
       static boost::any cast_( std::istringstream& stringValue ) {
@@ -114,6 +303,12 @@ namespace dynamicgraph
       static void trace_( const boost::any& t,std::ostream& os ) {
 	trace(boost::any_cast<T>(t),os);
       }
+      static void serialize_( const boost::any& t,std::ostream& os ) {
+	serialize(boost::any_cast<T>(t),os);
+      }
+      static boost::any deserialize_( std::istream& is ) {
+	return deserialize(is);
+      }
     private:
       SignalCast() {}
     };
@@ -165,6 +360,52 @@ public:            		                                                      \
 	}          								      \
 }
 
+/* Same as DG_SIGNAL_CAST_FULL_DEFINITION, with the binary functions
+ * <serialize> and <deserialize>. Register the cast with
+ * DG_SIGNAL_CAST_DECLARATION_BINARY or DG_ADD_CASTER_BINARY.
+ */
+#define DG_SIGNAL_CAST_FULL_DEFINITION_BINARY(TYPE,CAST,DISP,TRACE,SER,DESER) \
+template<>                                                                    \
+ class SignalCast<TYPE>                                                       \
+{                                                                             \
+public:                                                                       \
+        static TYPE cast( std::istringstream& iss )         CAST              \
+	static void disp( TYPE const& t,std::ostream& os )  DISP             \
+	static void trace( TYPE const& t,std::ostream& os ) TRACE            \
+	static void serialize( TYPE const& t,std::ostream& os ) SER          \
+	static TYPE deserialize( std::istream& is )         DESER            \
+public:                                                                       \
+	static boost::any cast_( std::istringstream& stringValue ) {         \
+		  return boost::any_cast<TYPE>(cast(stringValue));           \
+	}                                                                    \
+	static void disp_( const boost::any& t,std::ostream& os )  {         \
+	  disp(boost::any_cast<TYPE>(t), os);                                \
+	}                                                                    \
+	static void trace_( const boost::any& t,std::ostream& os ) {         \
+		  trace(boost::any_cast<TYPE>(t),os);                        \
+	}                                                                    \
+	static void serialize_( const boost::any& t,std::ostream& os ) {     \
+		  serialize(boost::any_cast<TYPE>(t),os);                    \
+	}                                                                    \
+	static boost::any deserialize_( std::istream& is ) {                 \
+		  return deserialize(is);                                    \
+	}                                                                    \
+}
+
+/* Lazy definition with binary serialization: <cast> and <disp> are
+ * proxys on std::io operations, <serialize> and <deserialize> on
+ * BinaryCast<TYPE>, which has to support TYPE.
+ */
+#define DG_SIGNAL_CAST_DEFINITION_BINARY(TYPE)                           \
+ DG_SIGNAL_CAST_FULL_DEFINITION_BINARY(TYPE,                             \
+ {TYPE res; iss >> res; return res; },                                   \
+ { os << t <<std::endl; },                                               \
+ { disp(t,os); },                                                        \
+ { BOOST_STATIC_ASSERT (BinaryCast<TYPE>::supported);                    \
+   BinaryCast<TYPE>::serialize(t,os); },                                 \
+ { BOOST_STATIC_ASSERT (BinaryCast<TYPE>::supported);                    \
+   TYPE res; BinaryCast<TYPE>::deserialize(is,res); return res; })
+
 /* Standard definition macros: the functions <cast> and <disp> have
  * to be implemented in the cpp files. The function <trace> is
  * implemented as a proxy on <disp>.
@@ -210,6 +451,27 @@ public:            		                                                      \
      SignalCast<TYPE>::cast_,                                             \
      SignalCast<TYPE>::trace_)
 
+/* Registration of the five functions, for casts defined with
+ * DG_SIGNAL_CAST_FULL_DEFINITION_BINARY or DG_SIGNAL_CAST_DEFINITION_BINARY.
+ */
+#define DG_SIGNAL_CAST_DECLARATION_BINARY(TYPE)                           \
+  ::dynamicgraph::SignalCastRegisterer sotCastRegisterer_##TYPE		  \
+    (typeid(TYPE),                                                        \
+     SignalCast<TYPE>::disp_,                                             \
+     SignalCast<TYPE>::cast_,                                             \
+     SignalCast<TYPE>::trace_,                                            \
+     SignalCast<TYPE>::serialize_,                                        \
+     SignalCast<TYPE>::deserialize_)
+
+#define DG_ADD_CASTER_BINARY(TYPE,ID)                                     \
+  ::dynamicgraph::SignalCastRegisterer sotCastRegisterer_##ID		  \
+    (typeid(TYPE),                                                        \
+     SignalCast<TYPE>::disp_,                                             \
+     SignalCast<TYPE>::cast_,                                             \
+     SignalCast<TYPE>::trace_,                                            \
+     SignalCast<TYPE>::serialize_,                                        \
+     SignalCast<TYPE>::deserialize_)
+
 
 
 #endif  // #ifndef DYNAMIC_GRAPH_SIGNAL_CASTER_HELPER_HH
@@ -21,10 +21,12 @@
 # include <vector>
 
 # include <boost/any.hpp>
+# include <boost/atomic.hpp>
 # include <boost/format.hpp>
 # include <boost/function/function1.hpp>
 # include <boost/function/function2.hpp>
 # include <boost/lexical_cast.hpp>
+# include <boost/thread/mutex.hpp>
 # include <boost/tuple/tuple.hpp>
 
 # include <dynamic-graph/dynamic-graph-api.h>
@@ -41,13 +43,22 @@ namespace dynamicgraph
   /// It also allows registering of user-defined casts. A cast is
   /// identified by the compiler. The mapping from a type to a
   /// serialization function is dynamic, hence it is more complex than
-  /// a typical template-based compile-time resolve. So disp, cast and
-  /// trace are costly functions and should be used as such.
+  /// a typical template-based compile-time resolve.
+  ///
+  /// Each type name is given a compact identifier and an Entry which
+  /// lives as long as the process. Signals resolve the entry of their
+  /// type once and call its functions directly. disp, trace and cast
+  /// find the entry by type_info without locking. Registration may
+  /// happen concurrently from several threads.
   class DYNAMIC_GRAPH_DLLAPI SignalCaster
   {
   public:
     virtual ~SignalCaster ();
-    /// Destroy the unique instance.
+    /// \brief Destroy the unique instance and unregister all the casts.
+    ///
+    /// The entries are kept, so that the signals still alive do not
+    /// dangle: their casts fail until registered again. No other thread
+    /// may use a cast meanwhile.
     static void destroy();
     /// Typedef of displayer functions that take an encapsulated 'any'
     /// object and displays, cast, or trace it on an output stream
@@ -57,6 +68,68 @@ namespace dynamicgraph
     typedef boost::function1<boost::any, std::istringstream&> caster_type;
     typedef boost::function2<void, const boost::any&, std::ostream&>
       tracer_type;
+    /// Typedef of the optional binary functions, which write the raw
+    /// representation of an object on a stream and read it back.
+    typedef boost::function2<void, const boost::any&, std::ostream&>
+      serializer_type;
+    typedef boost::function1<boost::any, std::istream&> deserializer_type;
+    /// \brief Typedef of the optional binary functions on an object given
+    /// by its address, of the registered type.
+    ///
+    /// They write the same representation as serializer_type and
+    /// deserializer_type without boxing the object in a boost::any.
+    /// The reader sets an existing object, which keeps its memory.
+    typedef void (*binary_writer_type) (const void* object, std::ostream& os);
+    typedef void (*binary_reader_type) (std::istream& is, void* object);
+
+    /// Functions registered for one type.
+    struct CastFunctions
+    {
+      displayer_type displayer;
+      caster_type caster;
+      tracer_type tracer;
+      serializer_type serializer;
+      deserializer_type deserializer;
+      binary_writer_type binaryWriter;
+      binary_reader_type binaryReader;
+    };
+
+    /// \brief Registry entry of one type name.
+    ///
+    /// The functions are replaced as a whole by registerCast and
+    /// unregisterCast, so that an entry can be read without locking
+    /// while another thread registers a cast.
+    class DYNAMIC_GRAPH_DLLAPI Entry
+    {
+    public:
+      /// Compact identifier of the type, index of the entry.
+      std::size_t id () const { return id_; }
+      const std::string& typeName () const { return typeName_; }
+      bool registered () const
+      {
+	return functions_.load (boost::memory_order_acquire) != NULL;
+      }
+      /// Registered functions. Throw ExceptionSignal if there is none.
+      const CastFunctions& functions () const
+      {
+	const CastFunctions* f = functions_.load (boost::memory_order_acquire);
+	if (f == NULL)
+	  throw ExceptionSignal (ExceptionSignal::BAD_CAST,
+				 "Cast not registered");
+	return *f;
+      }
+
+    private:
+      friend class SignalCaster;
+      Entry (std::size_t id, const std::string& typeName)
+	: id_ (id), typeName_ (typeName), type_ (NULL), functions_ (NULL)
+      {}
+
+      std::size_t id_;
+      std::string typeName_;
+      const std::type_info* type_;
+      boost::atomic<const CastFunctions*> functions_;
+    };
 
     /// Get a reference to the unique object of the class.
     static SignalCaster* getInstance(void);
@@ -66,33 +139,90 @@ namespace dynamicgraph
     void trace (const boost::any& object, std::ostream& os);
     /// Casts an object using a registered cast function.
     boost::any cast (const std::type_info&, std::istringstream& iss);
+    /// Writes the binary representation of an object.
+    void serialize (const boost::any& object, std::ostream& os);
+    /// Reads an object from its binary representation.
+    boost::any deserialize (const std::type_info&, std::istream& is);
     /// Registers a cast.
     void registerCast (const std::type_info& type, displayer_type displayer,
 		       caster_type caster, tracer_type tracer);
+    /// Registers a cast with binary serialization.
+    void registerCast (const std::type_info& type, displayer_type displayer,
+		       caster_type caster, tracer_type tracer,
+		       serializer_type serializer,
+		       deserializer_type deserializer,
+		       binary_writer_type binaryWriter = NULL,
+		       binary_reader_type binaryReader = NULL);
     /// Unregister a cast.
     void unregisterCast (const std::type_info& type);
     /// Checks if there is a displayer registered with type_name.
     bool existsCast (const std::type_info& type) const;
     /// Return the list of type names registered.
     std::vector<std::string> listTypenames () const;
-  private:
-    /// Container for the three cast functions.
-    typedef boost::tuple<displayer_type, caster_type, tracer_type>
-      cast_functions_type;
 
-    /// \brief Retrieve cast structure from its name.
-    cast_functions_type& getCast (const std::string& type_name);
+    /// \brief Get the entry of a type, creating it if needed.
+    ///
+    /// The reference stays valid until the end of the process, whether a
+    /// cast is registered for the type or not.
+    const Entry& getEntry (const std::type_info& type);
+    /// Get the entry of a compact type identifier.
+    const Entry& getEntry (std::size_t id) const;
+    /// \brief Get the entry of type T.
+    ///
+    /// It is looked up once per type, so that constructing signals does
+    /// not take the mutex of the caster.
+    template <typename T>
+    static const Entry& getEntry ()
+    {
+      static const Entry& entry = getInstance ()->getEntry (typeid (T));
+      return entry;
+    }
+
+    /// \brief Free the functions replaced by registerCast and
+    /// unregisterCast, and the lookup tables replaced since.
+    ///
+    /// They are otherwise kept until destroy, since a reader may still
+    /// use them. No other thread may use a cast meanwhile, for instance
+    /// call it once the plugins are loaded.
+    void collectRetired ();
+  private:
+    /// Copy of the entries published to the readers, see Registry.
+    struct Lookup;
+    /// Entry of a type published to the readers, NULL if there is none.
+    static const Entry* findPublished (const std::type_info& type);
+    /// Find or create the entry of the name of type, and publish it for
+    /// type. The mutex must be locked.
+    Entry& findEntry (const std::type_info& type);
 
-    /// This map associates the typename of objects and the corresponding
-    /// using boost::function with 'compatible' syntax
-    std::map<std::string, cast_functions_type> functions_;
+    /// \brief Entries of all the instances, indexed by their compact
+    /// identifier.
+    ///
+    /// The readers do not lock: they look the entries up by identifier
+    /// or type_info address in the last published Lookup. A new Lookup
+    /// is published for each new type_info, under the mutex.
+    struct Registry
+    {
+      Registry () : lookup (NULL) {}
+      std::vector<Entry*> entries;
+      /// Compact identifier of each type name.
+      std::map<std::string, std::size_t> ids;
+      boost::atomic<const Lookup*> lookup;
+    };
+    /// Never freed, so that signals may outlive the instance.
+    static Registry& registry ();
 
-    std::map<std::string, const std::type_info*> type_info_;
+    /// Functions replaced while a reader may still use them.
+    std::vector<const CastFunctions*> retired_;
+    /// Lookups replaced while a reader may still use them.
+    std::vector<const Lookup*> retiredLookups_;
+    /// Protects the registry, the retired objects and the entry types.
+    /// Only registration and the first lookup of a type take it.
+    mutable boost::mutex mutex_;
 
   private:
     explicit SignalCaster ();
     /// Pointer to the unique instance of the class.
-    static SignalCaster* instance_;
+    static boost::atomic<SignalCaster*> instance_;
   };
 
   ///The SignalCast registerer class. Can be used to automatically
@@ -111,6 +241,23 @@ namespace dynamicgraph
       SignalCaster::getInstance()->registerCast(type, displayer,
 						caster, tracer);
     }
+
+    inline SignalCastRegisterer (const std::type_info& type,
+				 SignalCaster::displayer_type displayer,
+				 SignalCaster::caster_type caster,
+				 SignalCaster::tracer_type tracer,
+				 SignalCaster::serializer_type serializer,
+				 SignalCaster::deserializer_type deserializer,
+				 SignalCaster::binary_writer_type binaryWriter
+				 = NULL,
+				 SignalCaster::binary_reader_type binaryReader
+				 = NULL)
+    {
+      SignalCaster::getInstance()->registerCast(type, displayer,
+						caster, tracer,
+						serializer, deserializer,
+						binaryWriter, binaryReader);
+    }
   };
 
 
@@ -19,18 +19,43 @@
 
 /* --- COMMON INCLUDE -------------------------------------------------- */
 
+#include <cstring>
+#include <string>
+
 /* dg signals */
 #include <dynamic-graph/entity.h>
 #include <dynamic-graph/signal-ptr.h>
 #include <dynamic-graph/signal-time-dependent.h>
 
+namespace dynamicgraph
+{
+  /// Build the signal name "className(entityName)::io(type)::name" with a
+  /// single allocation.
+  inline std::string makeSignalName (const std::string& className,
+				     const std::string& entityName,
+				     const char* io, const char* type,
+				     const char* name)
+  {
+    const std::size_t ioLength = std::strlen (io);
+    const std::size_t typeLength = std::strlen (type);
+    const std::size_t nameLength = std::strlen (name);
+    std::string res;
+    res.reserve (className.size () + entityName.size () + ioLength
+		 + typeLength + nameLength + 8);
+    res.append (className).append (1, '(').append (entityName)
+      .append (")::").append (io, ioLength).append (1, '(')
+      .append (type, typeLength).append (")::").append (name, nameLength);
+    return res;
+  }
+} // end of namespace dynamicgraph
+
 /* --- MACROS ---------------------------------------------------------- */
 
 #define DECLARE_SIGNAL( name,IO,type )    ::dynamicgraph::Signal<type,int> name##S##IO
-#define CONSTRUCT_SIGNAL( name,IO,type )  name##S##IO( getClassName()+"("+getName()+")::"+#IO+"put("+#type+")::"+#name )
+#define CONSTRUCT_SIGNAL( name,IO,type )  name##S##IO( ::dynamicgraph::makeSignalName(getClassName(),getName(),#IO "put",#type,#name) )
 
 #define DECLARE_SIGNAL_IN( name,type )    ::dynamicgraph::SignalPtr<type,int> name##SIN
-#define CONSTRUCT_SIGNAL_IN( name,type )  name##SIN( NULL,getClassName()+"("+getName()+")::input("+#type+")::"+#name )
+#define CONSTRUCT_SIGNAL_IN( name,type )  name##SIN( NULL,::dynamicgraph::makeSignalName(getClassName(),getName(),"input",#type,#name) )
 
 #define SIGNAL_OUT_FUNCTION( name )  name##SOUT_function
 #define DECLARE_SIGNAL_OUT( name,type )                         \
@@ -40,7 +65,7 @@
   type& SIGNAL_OUT_FUNCTION(name)( type&,int )
 #define CONSTRUCT_SIGNAL_OUT( name,type,dep )		\
   name##SOUT( boost::bind(&  EntityClassName::name##SOUT_function,this,_1,_2), \
-	      dep,getClassName()+"("+getName()+")::output("+#type+")::"+#name )
+	      dep,::dynamicgraph::makeSignalName(getClassName(),getName(),"output",#type,#name) )
 
 
 
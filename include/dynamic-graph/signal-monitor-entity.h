@@ -0,0 +1,86 @@
+// -*- mode: c++ -*-
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// dynamic-graph is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// dynamic-graph. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DYNAMIC_GRAPH_SIGNAL_MONITOR_ENTITY_H
+# define DYNAMIC_GRAPH_SIGNAL_MONITOR_ENTITY_H
+# include <string>
+# include <vector>
+
+# include <dynamic-graph/entity.h>
+# include <dynamic-graph/linear-algebra.h>
+# include <dynamic-graph/pool.h>
+# include <dynamic-graph/config-signal-monitor-entity.hh>
+
+namespace dynamicgraph
+{
+  /// \ingroup plugin
+  ///
+  /// \brief Entity reading and writing many signals at once through
+  /// commands, see PoolStorage::readSignals and PoolStorage::writeSignals.
+  ///
+  /// The signals are resolved once by setSignals. The commands must be
+  /// executed by the thread evaluating the graph: other threads queue
+  /// them in PoolStorage::getCommandQueue, so that all the values belong
+  /// to the same tick:
+  /// \code
+  /// std::vector<command::Value> none;
+  /// command::CommandFuture future = pool->getCommandQueue ().enqueue
+  ///   (*monitor->getNewStyleCommand ("read"), none);
+  /// const std::string& buffer = future.get ().stringRef ();
+  /// \endcode
+  /// The commands copy the buffer into their result: the methods avoid
+  /// that copy.
+  class DG_SIGNALMONITORENTITY_DLLAPI SignalMonitorEntity : public Entity
+  {
+    DYNAMIC_GRAPH_ENTITY_DECL ();
+  public:
+    SignalMonitorEntity (const std::string& name);
+
+    /// \brief Set the signals read and written, as paths
+    /// <c>entity.signal</c> separated by spaces.
+    ///
+    /// \throw ExceptionFactory if a signal does not exist. The signals
+    /// are then unchanged.
+    void setSignals (const std::string& paths);
+
+    /// \brief Read the signals into the buffer, and their layout.
+    ///
+    /// The buffer and the layout keep their memory: reading again the
+    /// same signals does not allocate.
+    const std::string& read ();
+    /// Layout of the last read, one row per signal: offset, size, time
+    /// and type identifier of its value in the buffer.
+    Matrix getLayout () const;
+    /// Names of the types of the last read, one per line, see
+    /// SignalCaster::Entry::typeName.
+    std::string getTypeNames () const;
+    /// \brief Set the signals to the values of buffer.
+    ///
+    /// \param layout one row per signal: offset and size of its value in
+    /// buffer. Other columns are ignored, so that the layout returned
+    /// by getLayout can be passed back.
+    void write (const std::string& buffer, const Matrix& layout);
+
+  private:
+    std::vector<SignalHandle> signals_;
+    std::string buffer_;
+    std::vector<PoolStorage::PackedSignal> layout_;
+    /// Layout passed to write.
+    std::vector<PoolStorage::PackedSignal> writeLayout_;
+  };
+} // end of namespace dynamicgraph
+
+#endif //! DYNAMIC_GRAPH_SIGNAL_MONITOR_ENTITY_H
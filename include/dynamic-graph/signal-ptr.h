@@ -73,6 +73,7 @@ namespace dynamicgraph
     SignalBase<Time>* getAbstractPtr (); // throw
     const SignalBase<Time>* getAbstractPtr () const; // throw
     virtual void plug( SignalBase<Time>* ref );
+    virtual void checkPlug( SignalBase<Time>* ref );
     virtual void unplug () { plug(NULL); }
     virtual bool isPluged () const DYNAMIC_GRAPH_DEPRECATED {
       return isPlugged ();
@@ -50,7 +50,7 @@ namespace dynamicgraph
   const Signal<T,Time>* SignalPtr<T,Time>::
   getPtr   () const
   {
-    dgTDEBUGIN(25) << SignalBase<Time>::name <<"("<< isPlugged () <<")"
+    dgTDEBUGIN(25) << SignalBase<Time>::getName () <<"("<< isPlugged () <<")"
 		   << this << "->"<<signalPtr <<std::endl;
     dgTDEBUGIN(25);
     if(! isPlugged () )
@@ -149,6 +149,29 @@ namespace dynamicgraph
     else Signal<T,Time>::checkCompatibility();
   }
 
+  template< class T,class Time >
+  void SignalPtr<T,Time>::
+  checkPlug( SignalBase<Time>* unknown_ref )
+  {
+    if(! unknown_ref ) return;
+    if( NULL!=dynamic_cast< Signal<T,Time>* > (unknown_ref) ) return;
+    try {
+      unknown_ref->checkCompatibility ();
+    }
+    catch( T* )
+      { return; }
+    catch(...)
+      {}
+    DG_THROW ExceptionSignal( ExceptionSignal::PLUG_IMPOSSIBLE,
+			      "Compl. Uncompatible types for plugin.",
+			      "(while trying to plug <%s> on <%s>)"
+			      " with types <%s> on <%s>.",
+			      unknown_ref->getName ().c_str (),
+			      this->getName ().c_str (),
+			      typeid(T).name(),
+			      typeid(unknown_ref).name());
+  }
+
   template< class T,class Time >
   bool SignalPtr<T,Time>::
   needUpdate( const Time& t ) const
@@ -233,7 +256,7 @@ namespace dynamicgraph
   std::ostream& SignalPtr<T,Time>::
   display( std::ostream& os ) const
   {
-    dgTDEBUGIN(25) << SignalBase<Time>::name << this << "||" << isPlugged () << "||"<<signalPtr;
+    dgTDEBUGIN(25) << SignalBase<Time>::getName () << this << "||" << isPlugged () << "||"<<signalPtr;
     { Signal<T,Time>::display(os); }
 
     if( (isAbstractPluged ())&&(!autoref ()) )
@@ -261,7 +284,7 @@ namespace dynamicgraph
     dgTDEBUGIN(25);
     if( (isAbstractPluged ())&&(!autoref ()) )
       { getAbstractPtr ()->displayDependencies(os,depth,space,next1+"-- "
-					       +SignalBase<Time>::name+" -->",next2); }
+					       +SignalBase<Time>::getName ()+" -->",next2); }
     else
       {
 	SignalBase<Time>::displayDependencies(os,depth,space,next1,next2);
@@ -54,6 +54,10 @@ namespace dynamicgraph
     virtual void addDependency( const SignalBase<Time>& signal ) ;
     virtual void removeDependency( const SignalBase<Time>& signal ) ;
     virtual void clearDependencies  ();
+    virtual void listDependencies
+    ( std::vector<const SignalBase<Time>*>& list ) const
+      { list.insert( list.end (),TimeDependency<Time>::dependencies.begin (),
+		     TimeDependency<Time>::dependencies.end () ); }
 
     std::ostream& writeGraph(std::ostream &os) const
       { return os;}
@@ -68,6 +72,10 @@ namespace dynamicgraph
     virtual void setPeriodTime( const Time& p ) ;
     virtual Time getPeriodTime  () const;
 
+    /// The state of the signal, then whether an update is pending.
+    virtual void saveState( std::ostream& os ) const;
+    virtual void restoreState( std::istream& is );
+
   };
 
 
@@ -149,6 +157,30 @@ namespace dynamicgraph
     getPeriodTime  ()  const
     { return TimeDependency<Time>::getPeriodTime ();  }
 
+  template< class T,class Time>
+    void SignalTimeDependent<T,Time>::
+    saveState( std::ostream& os ) const
+    {
+      Signal<T,Time>::saveState (os);
+      const char pending = TimeDependency<Time>::lastAskForUpdate ? 1 : 0;
+      os.write (&pending,1);
+    }
+
+  template< class T,class Time>
+    void SignalTimeDependent<T,Time>::
+    restoreState( std::istream& is )
+    {
+      Signal<T,Time>::restoreState (is);
+      char pending;
+      is.read (&pending,1);
+      if( !is )
+	DG_THROW ExceptionSignal( ExceptionSignal::SET_IMPOSSIBLE,
+				  "Truncated signal state. ",
+				  "(while restoring %s).",
+				  SignalBase<Time>::getName ().c_str ());
+      TimeDependency<Time>::lastAskForUpdate = ( pending!=0 );
+    }
+
 } // end of namespace dynamicgraph
 
 #endif //! DYNAMIC_GRAPH_SIGNAL_TIME_DEPENDENT_H
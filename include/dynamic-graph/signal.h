@@ -22,12 +22,14 @@
 #define __SIGNAL_HH
 
 #include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
 #include <boost/function.hpp>
 
 #include <string>
 
 #include <dynamic-graph/exception-signal.h>
 #include <dynamic-graph/signal-base.h>
+#include <dynamic-graph/signal-caster.h>
 
 #ifdef HAVE_LIBBOOST_THREAD
 #include <boost/thread.hpp>
@@ -76,6 +78,9 @@ class Signal
   bool keepReference;
   const static bool KEEP_REFERENCE_DEFAULT = false;
 
+  /// Cast functions of T, resolved once at construction.
+  const SignalCaster::Entry* castEntry;
+
  public:
 #ifdef HAVE_LIBBOOST_THREAD
   typedef boost::try_mutex Mutex;
@@ -102,6 +107,15 @@ protected:
   virtual void get( std::ostream& value ) const;
   virtual void set( std::istringstream& value ) ;
   virtual void trace( std::ostream& os ) const;
+  virtual void serialize( std::ostream& os ) const;
+  virtual void deserialize( std::istream& is );
+  virtual void deserializePending( std::istream& is );
+  virtual void commitPending ();
+  virtual const SignalCaster::Entry* getCastEntry () const
+  { return castEntry; }
+  virtual void saveState( std::ostream& os ) const;
+  virtual bool canSaveState () const;
+  virtual void restoreState( std::istream& is );
 
   /* --- Generic Set function --- */
   virtual void setConstant( const T& t );
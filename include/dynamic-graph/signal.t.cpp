@@ -34,6 +34,7 @@
     ,TreferenceNonConst (TrefNC)			\
     ,Tfunction ()					\
     ,keepReference (KEEP_REFERENCE_DEFAULT)		\
+    ,castEntry (&SignalCaster::getEntry<T> ())		\
     ,providerMutex (mutex)
 
 namespace dynamicgraph
@@ -55,21 +56,25 @@ namespace dynamicgraph
   void Signal<T,Time>::
   set( std::istringstream& stringValue )
   {
-    (*this) = signal_cast<T>( stringValue );
+    (*this) = boost::any_cast<T>
+      ( castEntry->functions ().caster (stringValue) );
   }
 
   template< class T,class Time >
   void Signal<T,Time>::
   get( std::ostream& os ) const
   {
-    signal_disp<T>( this->accessCopy (),os );
+    castEntry->functions ().displayer (boost::any (this->accessCopy ()),os);
   }
 
   template< class T,class Time >
   void Signal<T,Time>::
   trace( std::ostream& os ) const
   {
-    try { signal_trace<T>( this->accessCopy (),os ); }
+    try
+      {
+	castEntry->functions ().tracer (boost::any (this->accessCopy ()),os);
+      }
     catch DG_RETHROW
       catch (...)
 	{ DG_THROW ExceptionSignal( ExceptionSignal::SET_IMPOSSIBLE,
@@ -81,6 +86,113 @@ namespace dynamicgraph
   }
 
 
+  template< class T,class Time >
+  void Signal<T,Time>::
+  serialize( std::ostream& os ) const
+  {
+    const SignalCaster::CastFunctions& f = castEntry->functions ();
+    if( !f.serializer )
+      DG_THROW ExceptionSignal( ExceptionSignal::BAD_CAST,
+				"Binary serialization not registered. ",
+				"(while serializing %s).",
+				SignalBase<Time>::getName ().c_str ());
+    if( f.binaryWriter ) f.binaryWriter (&this->accessCopy (),os);
+    else f.serializer (boost::any (this->accessCopy ()),os);
+  }
+
+  template< class T,class Time >
+  void Signal<T,Time>::
+  deserialize( std::istream& is )
+  {
+    deserializePending (is);
+    commitPending ();
+  }
+
+  /* Read the value into the copy not in use, which keeps its memory. On
+   * error, the current value is unchanged. */
+  template< class T,class Time >
+  void Signal<T,Time>::
+  deserializePending( std::istream& is )
+  {
+    const SignalCaster::CastFunctions& f = castEntry->functions ();
+    if( !f.deserializer )
+      DG_THROW ExceptionSignal( ExceptionSignal::BAD_CAST,
+				"Binary serialization not registered. ",
+				"(while deserializing %s).",
+				SignalBase<Time>::getName ().c_str ());
+    if( f.binaryReader ) f.binaryReader (is,&getTwork ());
+    else getTwork () = boost::any_cast<T> ( f.deserializer (is) );
+  }
+
+  /* setTcopy assigns the copy not in use to itself. */
+  template< class T,class Time >
+  void Signal<T,Time>::
+  commitPending ()
+  {
+    (*this) = getTwork ();
+  }
+
+  /* The state is the base state, the signal type, then the current copy
+   * if T has binary functions. */
+  template< class T,class Time >
+  void Signal<T,Time>::
+  saveState( std::ostream& os ) const
+  {
+    SignalBase<Time>::saveState (os);
+    const boost::int32_t type = signalType;
+    const char hasValue = canSaveState () ? 1 : 0;
+    os.write (reinterpret_cast<const char*> (&type),sizeof (type));
+    os.write (&hasValue,1);
+    if( hasValue ) castEntry->functions ().serializer (boost::any (*Tcopy),os);
+  }
+
+  template< class T,class Time >
+  bool Signal<T,Time>::
+  canSaveState () const
+  {
+    return castEntry->registered () && castEntry->functions ().serializer;
+  }
+
+  template< class T,class Time >
+  void Signal<T,Time>::
+  restoreState( std::istream& is )
+  {
+    SignalBase<Time>::restoreState (is);
+    boost::int32_t type;
+    char hasValue;
+    is.read (reinterpret_cast<char*> (&type),sizeof (type));
+    is.read (&hasValue,1);
+    if( !is )
+      DG_THROW ExceptionSignal( ExceptionSignal::SET_IMPOSSIBLE,
+				"Truncated signal state. ",
+				"(while restoring %s).",
+				SignalBase<Time>::getName ().c_str ());
+    if( hasValue )
+      {
+	const SignalCaster::CastFunctions& f = castEntry->functions ();
+	if( !f.deserializer )
+	  DG_THROW ExceptionSignal( ExceptionSignal::BAD_CAST,
+				    "Binary serialization not registered. ",
+				    "(while restoring %s).",
+				    SignalBase<Time>::getName ().c_str ());
+	setTcopy (boost::any_cast<T> (f.deserializer (is)));
+      }
+
+    // The value source must have been set up when building the graph.
+    const bool sourceAvailable =
+      ( type==CONSTANT )
+      || ( type==REFERENCE && NULL!=Treference )
+      || ( type==REFERENCE_NON_CONST && NULL!=TreferenceNonConst )
+      || ( type==FUNCTION && !Tfunction.empty () );
+    if( !sourceAvailable )
+      DG_THROW ExceptionSignal( ExceptionSignal::SET_IMPOSSIBLE,
+				"Signal type cannot be restored. ",
+				"(%s has no source for type %d).",
+				SignalBase<Time>::getName ().c_str (),
+				static_cast<int> (type));
+    signalType = static_cast<SignalType> (type);
+  }
+
   /* -------------------------------------------------------------------------- */
 
   template< class T,class Time >
@@ -294,7 +406,7 @@ namespace dynamicgraph
   std::ostream& Signal<T,Time>::
   display (std::ostream& os) const
   {
-    os<<"Sig:"<<this->name<<" (Type ";
+    os<<"Sig:"<<this->getName ()<<" (Type ";
     switch( this->signalType )
       {
       case Signal<T,Time>::CONSTANT: os<< "Cst";break;
@@ -0,0 +1,217 @@
+// -*- mode: c++ -*-
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// dynamic-graph is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// dynamic-graph. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DYNAMIC_GRAPH_SNAPSHOT_TABLE_H
+# define DYNAMIC_GRAPH_SNAPSHOT_TABLE_H
+# include <algorithm>
+# include <cstddef>
+# include <string>
+# include <vector>
+
+# include <boost/noncopyable.hpp>
+# include <boost/shared_ptr.hpp>
+# include <boost/thread/thread.hpp>
+# include <boost/weak_ptr.hpp>
+
+# include <dynamic-graph/interned-map.h>
+# include <dynamic-graph/interned-string.h>
+
+namespace dynamicgraph
+{
+  /// \brief Table of names readable from any thread while it is updated.
+  ///
+  /// The table is published as immutable snapshots, in the style of
+  /// read-copy-update. A reader takes the current snapshot and uses it
+  /// without any lock; it only synchronizes with the writer for the
+  /// copy of a shared pointer. A writer copies the bucket it modifies
+  /// and the array of buckets, then publishes the new snapshot. The
+  /// number of buckets follows the square root of the size, so that an
+  /// update copies O(sqrt (size)) entries.
+  ///
+  /// Updates must be serialized by the caller. Once an entry is removed,
+  /// synchronize waits for the readers which may still see it, after
+  /// which the object it refers to can be destroyed.
+  template <typename T>
+  class SnapshotTable : private boost::noncopyable
+  {
+  public:
+    typedef InternedMap<T> Bucket;
+    typedef typename Bucket::value_type value_type;
+
+    /// \brief Immutable state of the table.
+    class Snapshot
+    {
+    public:
+      std::size_t size () const
+      {
+	return size_;
+      }
+
+      /// Value associated to key, NULL if there is none.
+      const T* find (const std::string& key) const
+      {
+	return bucket (InternedString::hash (key)).find (key);
+      }
+
+      /// Append the entries to entries, in no particular order.
+      void list (std::vector<value_type>& entries) const
+      {
+	for (std::size_t i = 0; i < buckets_.size (); ++i)
+	  entries.insert (entries.end (), buckets_[i]->begin (),
+			  buckets_[i]->end ());
+      }
+
+    private:
+      friend class SnapshotTable;
+
+      Snapshot () : size_ (0)
+      {}
+
+      std::size_t index (std::size_t hash) const
+      {
+	// The buckets use the low bits of the hash for their slots.
+	return (hash >> 20) & (buckets_.size () - 1);
+      }
+
+      const Bucket& bucket (std::size_t hash) const
+      {
+	return *buckets_[index (hash)];
+      }
+
+      std::vector<boost::shared_ptr<const Bucket> > buckets_;
+      std::size_t size_;
+    };
+    typedef boost::shared_ptr<const Snapshot> SnapshotPtr;
+
+    SnapshotTable ()
+      : pruneSize_ (MIN_PRUNE_SIZE)
+    {
+      Snapshot* snapshot = new Snapshot;
+      snapshot->buckets_.push_back (boost::shared_ptr<const Bucket>
+				    (new Bucket));
+      current_.reset (snapshot);
+    }
+
+    /// Current snapshot. Can be called from any thread.
+    SnapshotPtr snapshot () const
+    {
+      return boost::atomic_load (&current_);
+    }
+
+    /// Insert a value and publish the table. Return false, leaving the
+    /// table unchanged, if the key is already present.
+    bool insert (const InternedString& key, const T& value)
+    {
+      if (current_->find (key.str ()) != NULL) return false;
+      const std::size_t size = current_->size () + 1;
+      std::size_t nbBuckets = current_->buckets_.size ();
+      while (nbBuckets * nbBuckets < size) nbBuckets *= 2;
+
+      Snapshot* snapshot;
+      if (nbBuckets != current_->buckets_.size ())
+	snapshot = rehash (nbBuckets);
+      else
+	snapshot = new Snapshot (*current_);
+      Bucket* bucket = new Bucket (snapshot->bucket (key.hash ()));
+      bucket->insert (key, value);
+      snapshot->buckets_[snapshot->index (key.hash ())].reset (bucket);
+      snapshot->size_ = size;
+      publish (snapshot);
+      return true;
+    }
+
+    /// Remove the entry of key and publish the table. Return false if
+    /// there is none.
+    bool erase (const std::string& key)
+    {
+      const std::size_t hash = InternedString::hash (key);
+      if (current_->bucket (hash).find (key) == NULL) return false;
+      Snapshot* snapshot = new Snapshot (*current_);
+      Bucket* bucket = new Bucket (snapshot->bucket (hash));
+      bucket->erase (key);
+      snapshot->buckets_[snapshot->index (hash)].reset (bucket);
+      --snapshot->size_;
+      publish (snapshot);
+      return true;
+    }
+
+    /// Remove all the entries and publish the empty table.
+    void clear ()
+    {
+      Snapshot* snapshot = new Snapshot;
+      snapshot->buckets_.push_back (boost::shared_ptr<const Bucket>
+				    (new Bucket));
+      publish (snapshot);
+    }
+
+    /// Wait until the readers release the snapshots preceding the
+    /// current one.
+    void synchronize ()
+    {
+      for (std::size_t i = 0; i < retired_.size (); ++i)
+	while (!retired_[i].expired ())
+	  boost::this_thread::yield ();
+      retired_.clear ();
+      pruneSize_ = MIN_PRUNE_SIZE;
+    }
+
+  private:
+    static const std::size_t MIN_PRUNE_SIZE = 64;
+
+    Snapshot* rehash (std::size_t nbBuckets) const
+    {
+      std::vector<value_type> entries;
+      current_->list (entries);
+      std::vector<Bucket*> buckets (nbBuckets);
+      Snapshot* snapshot = new Snapshot;
+      for (std::size_t i = 0; i < nbBuckets; ++i)
+	{
+	  buckets[i] = new Bucket;
+	  snapshot->buckets_.push_back (boost::shared_ptr<const Bucket>
+					(buckets[i]));
+	}
+      for (std::size_t i = 0; i < entries.size (); ++i)
+	buckets[snapshot->index (entries[i].first.hash ())]
+	  ->insert (entries[i].first, entries[i].second);
+      snapshot->size_ = entries.size ();
+      return snapshot;
+    }
+
+    void publish (Snapshot* snapshot)
+    {
+      retired_.push_back (boost::weak_ptr<const Snapshot> (current_));
+      boost::atomic_store (&current_, SnapshotPtr (snapshot));
+
+      // Forget the snapshots which are no longer read.
+      if (retired_.size () < pruneSize_) return;
+      std::size_t kept = 0;
+      for (std::size_t i = 0; i < retired_.size (); ++i)
+	if (!retired_[i].expired ()) retired_[kept++] = retired_[i];
+      retired_.resize (kept);
+      pruneSize_ = std::max<std::size_t> (MIN_PRUNE_SIZE, 2 * kept);
+    }
+
+    SnapshotPtr current_;
+    /// Previous snapshots, possibly still read.
+    std::vector<boost::weak_ptr<const Snapshot> > retired_;
+    std::size_t pruneSize_;
+  };
+
+  template <typename T>
+  const std::size_t SnapshotTable<T>::MIN_PRUNE_SIZE;
+} // end of namespace dynamicgraph
+
+#endif //! DYNAMIC_GRAPH_SNAPSHOT_TABLE_H
@@ -24,7 +24,8 @@
 # include <dynamic-graph/debug.h>
 
 # define __TIME_DEPENDENCY_INIT(sig,dep)	 \
-  leader(*sig)					 \
+  lastAskForUpdate (false)			 \
+    ,leader(*sig)				 \
     ,dependencies ()                             \
     ,updateFromAllChildren (ALL_READY_DEFAULT)	 \
     ,dependencyType (dep)			 \
@@ -107,6 +107,9 @@ namespace dynamicgraph
     /* --- PARAMS --- */
     void display( std::ostream& os ) const;
 
+  private:
+    static void addCommands (command::ClassCommands& commands);
+
   };
 
 } // end of namespace dynamicgraph
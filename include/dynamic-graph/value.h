@@ -27,6 +27,8 @@
 namespace dynamicgraph {
   namespace command {
     class Value;
+    /// Conversion of a value to the type of its payload. It refers to the
+    /// value without copying it, and must not outlive it.
     class DYNAMIC_GRAPH_DLLAPI EitherType {
     public:
       EitherType(const Value& value);
@@ -44,6 +46,12 @@ namespace dynamicgraph {
       const Value* value_;
     };
 
+    /// \brief Argument or result of a command.
+    ///
+    /// The payload is stored in the value itself: scalars and 4x4
+    /// matrices do not allocate memory, strings, vectors and matrices
+    /// only allocate their content. Values are swapped, and moved in
+    /// C++11, without allocation.
     class DYNAMIC_GRAPH_DLLAPI Value {
     public:
       enum Type {
@@ -60,6 +68,7 @@ namespace dynamicgraph {
 	NB_TYPES
       };
       ~Value();
+      /// Destroy the payload: the value becomes None.
       void deleteValue ();
       explicit Value(const bool& value);
       explicit Value(const unsigned& value);
@@ -75,7 +84,14 @@ namespace dynamicgraph {
       // Construct an empty value (None)
       explicit Value();
       // operator assignement
-      Value operator=(const Value& value);
+      Value& operator=(const Value& value);
+#if __cplusplus >= 201103L
+      /// The moved value becomes None.
+      Value(Value&& value);
+      Value& operator=(Value&& value);
+#endif
+      /// Exchange the payloads, without allocation.
+      void swap(Value& value);
       /// Return the type of the value
       Type type() const;
 
@@ -107,8 +123,47 @@ namespace dynamicgraph {
       Vector vectorValue() const;
       Eigen::MatrixXd matrixXdValue() const;
       Eigen::Matrix4d matrix4dValue() const;
+
+      /// \name Access to the payload without copy
+      /// Throw if the value is of another type.
+      /// \{
+      const std::string& stringRef() const;
+      const Vector& vectorRef() const;
+      const Eigen::MatrixXd& matrixXdRef() const;
+      /// Matrix or 4x4 matrix.
+      Eigen::Ref<const Eigen::MatrixXd> matrixRef() const;
+      /// \}
       Type type_;
-      const void* const value_;
+
+    private:
+      /// Not aligned, so that values may be stored in standard containers.
+      typedef Eigen::Matrix<double, 4, 4, Eigen::DontAlign> Matrix4d;
+
+      /// Move the payload of value, which becomes None, to this value,
+      /// which must be None.
+      void moveFrom(Value& value);
+      /// Throw if the payload is not of the given type.
+      void checkType(Type type, const char* message) const;
+
+      template <typename T> T& payload()
+      {
+	return *reinterpret_cast<T*>(storage_.buffer);
+      }
+      template <typename T> const T& payload() const
+      {
+	return *reinterpret_cast<const T*>(storage_.buffer);
+      }
+
+      union Storage {
+	bool boolValue;
+	unsigned unsignedValue;
+	int intValue;
+	float floatValue;
+	double doubleValue;
+	void* pointer;
+	char buffer[sizeof(Matrix4d) > sizeof(std::string)
+		    ? sizeof(Matrix4d) : sizeof(std::string)];
+      } storage_;
     };
 
     /* ---- HELPER ---------------------------------------------------------- */
@@ -120,6 +175,70 @@ namespace dynamicgraph {
       {
 	static const Value::Type TypeID;
       };
+
+    /// \brief Read an argument of type T from a value.
+    ///
+    /// The strings, vectors and matrices are passed by reference to the
+    /// payload, and so are the arguments of type Eigen::Ref.
+    template <typename T>
+      struct ValueArgument
+      {
+	typedef T type;
+	static type get(const Value& value)
+	{
+	  return value.value();
+	}
+      };
+
+    template <>
+      struct ValueArgument<std::string>
+      {
+	typedef const std::string& type;
+	static type get(const Value& value)
+	{
+	  return value.stringRef();
+	}
+      };
+
+    template <>
+      struct ValueArgument<Vector>
+      {
+	typedef const Vector& type;
+	static type get(const Value& value)
+	{
+	  return value.vectorRef();
+	}
+      };
+
+    template <>
+      struct ValueArgument<Eigen::MatrixXd>
+      {
+	typedef const Eigen::MatrixXd& type;
+	static type get(const Value& value)
+	{
+	  return value.matrixXdRef();
+	}
+      };
+
+    template <>
+      struct ValueArgument<Eigen::Ref<const Vector> >
+      {
+	typedef Eigen::Ref<const Vector> type;
+	static type get(const Value& value)
+	{
+	  return value.vectorRef();
+	}
+      };
+
+    template <>
+      struct ValueArgument<Eigen::Ref<const Eigen::MatrixXd> >
+      {
+	typedef Eigen::Ref<const Eigen::MatrixXd> type;
+	static type get(const Value& value)
+	{
+	  return value.matrixRef();
+	}
+      };
   } // namespace command
 } //namespace dynamicgraph
 
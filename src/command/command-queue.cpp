@@ -0,0 +1,249 @@
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+// dynamic-graph is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.  You should
+// have received a copy of the GNU Lesser General Public License
+// along with dynamic-graph.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <exception>
+
+#include <time.h>
+#ifdef __linux__
+# include <linux/futex.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#endif
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "dynamic-graph/command.h"
+#include "dynamic-graph/command-queue.h"
+#include "dynamic-graph/exception-abstract.h"
+
+namespace dynamicgraph {
+  namespace command {
+
+    namespace {
+      /// Monotonic time in nanoseconds.
+      boost::int64_t timestamp ()
+      {
+#ifdef CLOCK_MONOTONIC
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return static_cast<boost::int64_t> (ts.tv_sec) * 1000000000
+	  + ts.tv_nsec;
+#else
+	return (boost::posix_time::microsec_clock::universal_time ()
+		- boost::posix_time::ptime (boost::gregorian::date (1970, 1, 1)))
+	  .total_microseconds () * 1000;
+#endif
+      }
+    } // end of anonymous namespace.
+
+    struct CommandFuture::State
+    {
+      State () : ready (0), waiting (false), failed (false), code (0),
+		 queued (timestamp ()), executed (0)
+      {}
+
+      /// Set to 1 once the command is executed (futex word).
+      boost::atomic<int> ready;
+      /// Whether a thread waits for the command.
+      boost::atomic<bool> waiting;
+      Value result;
+      /// Whether the command threw, with the code and message of the
+      /// exception.
+      bool failed;
+      int code;
+      std::string message;
+      boost::int64_t queued;
+      boost::int64_t executed;
+
+      /// Record the exception thrown by the command. Does not throw, so
+      /// that the slot of the command is always given back.
+      void fail (int error, const char* what)
+      {
+	failed = true;
+	code = error;
+	try
+	  {
+	    message = what;
+	  }
+	catch (...)
+	  {
+	    message.clear ();
+	  }
+      }
+    };
+
+    CommandFuture::CommandFuture ()
+    {
+    }
+
+    CommandFuture::CommandFuture (const boost::shared_ptr<State>& state)
+      : state_ (state)
+    {
+    }
+
+    bool CommandFuture::ready () const
+    {
+      return valid () && state_->ready.load (boost::memory_order_acquire);
+    }
+
+    void CommandFuture::wait () const
+    {
+      if (!valid ())
+	throw ExceptionAbstract (ExceptionAbstract::TOOLS,
+				 "future of no command");
+      State& state = *state_;
+      if (state.ready.load (boost::memory_order_acquire)) return;
+      state.waiting.store (true);
+      // Order waiting before reading ready, see CommandQueue::execute.
+      boost::atomic_thread_fence (boost::memory_order_seq_cst);
+      while (!state.ready.load (boost::memory_order_acquire))
+	{
+#ifdef __linux__
+	  // Returns at once if ready changed in the meantime.
+	  syscall (SYS_futex, reinterpret_cast<int*> (&state.ready),
+		   FUTEX_WAIT_PRIVATE, 0, NULL, NULL, 0);
+#else
+	  boost::this_thread::sleep (boost::posix_time::milliseconds (1));
+#endif
+	}
+    }
+
+    const Value& CommandFuture::get () const
+    {
+      wait ();
+      if (state_->failed)
+	throw ExceptionAbstract (state_->code, state_->message);
+      return state_->result;
+    }
+
+    double CommandFuture::latency () const
+    {
+      if (!ready ())
+	throw ExceptionAbstract (ExceptionAbstract::TOOLS,
+				 "command not executed yet");
+      return 1e-9 * static_cast<double> (state_->executed - state_->queued);
+    }
+
+    CommandQueue::CommandQueue (std::size_t capacity)
+      : slots_ (std::max<std::size_t> (capacity, 1), NULL)
+      , readIdx_ (0)
+      , writeIdx_ (0)
+    {
+      for (std::size_t i = 0; i < slots_.size (); ++i)
+	{
+	  slots_[i] = new Slot;
+	  slots_[i]->sequence = i;
+	  slots_[i]->command = NULL;
+	}
+    }
+
+    CommandQueue::~CommandQueue ()
+    {
+      for (std::size_t i = 0; i < slots_.size (); ++i) delete slots_[i];
+    }
+
+    CommandFuture CommandQueue::enqueue (Command& command,
+					 std::vector<Value>& arguments)
+    {
+      command.checkParameterValues (arguments);
+      // Reserve a slot, as RealTimeLogger::reserve.
+      std::size_t position = writeIdx_.load (boost::memory_order_relaxed);
+      Slot* slot;
+      for (;;)
+	{
+	  slot = slots_[position % slots_.size ()];
+	  const std::size_t sequence =
+	    slot->sequence.load (boost::memory_order_acquire);
+	  const std::ptrdiff_t diff =
+	    static_cast<std::ptrdiff_t> (sequence - position);
+	  if (diff == 0)
+	    {
+	      if (writeIdx_.compare_exchange_weak
+		  (position, position + 1, boost::memory_order_relaxed))
+		break;
+	    }
+	  else if (diff < 0)
+	    throw ExceptionAbstract (ExceptionAbstract::TOOLS,
+				     "the command queue is full");
+	  else
+	    position = writeIdx_.load (boost::memory_order_relaxed);
+	}
+
+      // The previous arguments and state of the slot are freed here,
+      // rather than by the thread executing the commands.
+      slot->command = &command;
+      slot->arguments.swap (arguments);
+      arguments.clear ();
+      slot->state = boost::make_shared<CommandFuture::State> ();
+      CommandFuture future (slot->state);
+      slot->sequence.store (position + 1, boost::memory_order_release);
+      return future;
+    }
+
+    std::size_t CommandQueue::execute (std::size_t maxCommands)
+    {
+      std::size_t nbCommands = 0;
+      for (; nbCommands < maxCommands; ++nbCommands)
+	{
+	  const std::size_t position =
+	    readIdx_.load (boost::memory_order_relaxed);
+	  Slot& slot = *slots_[position % slots_.size ()];
+	  // Empty, or the next command is still being queued.
+	  if (slot.sequence.load (boost::memory_order_acquire) != position + 1)
+	    break;
+
+	  CommandFuture::State& state = *slot.state;
+	  try
+	    {
+	      Value result (slot.command->execute (slot.arguments));
+	      state.result.swap (result);
+	    }
+	  catch (const ExceptionAbstract& exc)
+	    {
+	      state.fail (exc.getCode (), exc.getMessage ());
+	    }
+	  catch (const std::exception& exc)
+	    {
+	      state.fail (ExceptionAbstract::TOOLS, exc.what ());
+	    }
+	  catch (...)
+	    {
+	      state.fail (ExceptionAbstract::TOOLS, "unknown exception");
+	    }
+	  state.executed = timestamp ();
+	  state.ready.store (1, boost::memory_order_release);
+	  // Order ready before reading waiting, see CommandFuture::wait.
+	  boost::atomic_thread_fence (boost::memory_order_seq_cst);
+	  if (state.waiting.load (boost::memory_order_relaxed))
+	    {
+#ifdef __linux__
+	      syscall (SYS_futex, reinterpret_cast<int*> (&state.ready),
+		       FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#endif
+	    }
+
+	  // Give the slot back to the writers.
+	  slot.sequence.store (position + slots_.size (),
+			       boost::memory_order_release);
+	  readIdx_.store (position + 1, boost::memory_order_release);
+	}
+      return nbCommands;
+    }
+  } // namespace command
+} // namespace dynamicgraph
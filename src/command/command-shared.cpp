@@ -0,0 +1,88 @@
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+// dynamic-graph is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.  You should
+// have received a copy of the GNU Lesser General Public License along
+// with dynamic-graph.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <dynamic-graph/command.h>
+#include <dynamic-graph/command-shared.h>
+#include <dynamic-graph/exception-factory.h>
+
+namespace dynamicgraph {
+  namespace command {
+
+    namespace {
+      /// Command of an entity instance forwarding to a shared command.
+      class BoundCommand : public Command
+      {
+      public:
+	BoundCommand (Entity& entity, const SharedCommand& shared)
+	  : Command (entity, shared), shared_ (shared)
+	{}
+
+	virtual bool isSetter () const
+	{
+	  return shared_.isSetter ();
+	}
+
+      protected:
+	virtual Value doExecute ()
+	{
+	  return shared_.execute (owner (), getParameterValues ());
+	}
+
+      private:
+	const SharedCommand& shared_;
+      };
+    } // end of anonymous namespace.
+
+    SharedCommand::SharedCommand (const std::vector<Value::Type>& valueTypes,
+				  const std::string& docstring)
+      : valueTypes_ (valueTypes), docstring_ (docstring)
+    {}
+
+    SharedCommand::~SharedCommand ()
+    {}
+
+    Command* SharedCommand::bind (Entity& entity) const
+    {
+      return new BoundCommand (entity, *this);
+    }
+
+    ClassCommands::ClassCommands ()
+    {}
+
+    ClassCommands::ClassCommands (Builder builder)
+    {
+      builder (*this);
+    }
+
+    ClassCommands::~ClassCommands ()
+    {
+      for (Table::const_iterator it = commands_.begin ();
+	   it != commands_.end (); ++it)
+	delete it->second;
+    }
+
+    void ClassCommands::add (const std::string& name,
+			     const SharedCommand* command)
+    {
+      if (!commands_.insert (InternedString (name), command))
+	{
+	  delete command;
+	  DG_THROW ExceptionFactory (ExceptionFactory::OBJECT_CONFLICT,
+				     "Command " + name +
+				     " already registered in class.");
+	}
+    }
+
+  } // namespace command
+} // namespace dynamicgraph
@@ -17,6 +17,7 @@
 
 #include <sstream>
 #include "dynamic-graph/command.h"
+#include "dynamic-graph/command-shared.h"
 #include "dynamic-graph/exception-abstract.h"
 
 namespace dynamicgraph {
@@ -29,16 +30,23 @@ namespace dynamicgraph {
     Command::Command(Entity& entity,
 		     const std::vector<Value::Type>& valueTypes,
 		     const std::string& docstring) :
-      owner_(entity), valueTypeVector_(valueTypes), docstring_(docstring)
+      owner_(entity), shared_(NULL), valueTypeVector_(valueTypes),
+      executed_(false), docstring_(docstring)
+    {
+    }
+
+    Command::Command(Entity& entity, const SharedCommand& shared) :
+      owner_(entity), shared_(&shared), executed_(false)
     {
     }
 
     const std::vector<Value::Type>& Command::valueTypes() const
     {
+      if (shared_) return shared_->valueTypes();
       return valueTypeVector_;
     }
 
-    void Command::setParameterValues(const std::vector<Value>& values)
+    void Command::checkParameterValues(const std::vector<Value>& values) const
     {
       const std::vector<Value::Type>& paramTypes = valueTypes();
       // Check that number of parameters is correct
@@ -56,18 +64,56 @@ namespace dynamicgraph {
 	  throw ExceptionAbstract(ExceptionAbstract::TOOLS, ss.str());
 	}
       }
+    }
+
+    void Command::setParameterValues(const std::vector<Value>& values)
+    {
+      checkParameterValues(values);
+      keepExecutedValues();
       // Copy vector of values in private part
       valueVector_ = values;
     }
 
+    void Command::swapParameterValues(std::vector<Value>& values)
+    {
+      checkParameterValues(values);
+      keepExecutedValues();
+      valueVector_.swap(values);
+    }
+
     const std::vector<Value>& Command::getParameterValues() const
     {
       return valueVector_;
     }
 
+    const std::vector<Value>& Command::getExecutedValues() const
+    {
+      return executed_ ? valueVector_ : executedValues_;
+    }
+
+    void Command::keepExecutedValues()
+    {
+      // The parameter values are about to be replaced: move them aside
+      // if they are those of the last execution.
+      if (!executed_) return;
+      executedValues_.swap(valueVector_);
+      executed_ = false;
+    }
+
     Value Command::execute()
     {
-      return doExecute();
+      Value result = doExecute();
+      // Only the setters are replayed, see PoolStorage::exportTopology.
+      // The values are not copied: they stay the parameter values until
+      // replaced.
+      if (isSetter()) executed_ = true;
+      return result;
+    }
+
+    Value Command::execute(std::vector<Value>& values)
+    {
+      swapParameterValues(values);
+      return execute();
     }
 
     Entity& Command::owner()
@@ -76,6 +122,7 @@ namespace dynamicgraph {
     }
     std::string Command::getDocstring() const
     {
+      if (shared_) return shared_->getDocstring();
       return docstring_;
     }
   } // namespace command
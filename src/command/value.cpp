@@ -15,21 +15,28 @@
 // have received a copy of the GNU Lesser General Public License along
 // with dynamic-graph.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <new>
+#include <boost/static_assert.hpp>
+
 #include "dynamic-graph/value.h"
 #include "dynamic-graph/exception-abstract.h"
 
 namespace dynamicgraph {
   namespace command {
 
-    static void* copyValue(const Value& value);
+    namespace {
+      template <typename T> void destroy(T& payload)
+      {
+	payload.~T();
+      }
+    } // end of anonymous namespace.
 
-    EitherType::EitherType(const Value& value) : value_(new Value(value))
+    EitherType::EitherType(const Value& value) : value_(&value)
     {
     }
 
     EitherType::~EitherType()
     {
-      delete value_;
       value_ = NULL;
     }
 
@@ -74,35 +81,18 @@ namespace dynamicgraph {
     void Value::deleteValue ()
     {
       switch(type_) {
-      case BOOL:
-	delete(const bool*)value_;
-	break;
-      case UNSIGNED:
-	delete(const unsigned*)value_;
-	break;
-      case INT:
-	delete(const int*)value_;
-	break;
-      case FLOAT:
-	delete(const float*)value_;
-	break;
-      case DOUBLE:
-	delete(const double*)value_;
-	break;
       case STRING:
-	delete(const std::string*)value_;
+	destroy(payload<std::string>());
 	break;
       case VECTOR:
-	delete(const Vector*)value_;
+	destroy(payload<Vector>());
 	break;
       case MATRIX:
-	delete(const Eigen::MatrixXd*)value_;
-	break;
-      case MATRIX4D:
-	delete(const Eigen::Matrix4d*)value_;
+	destroy(payload<Eigen::MatrixXd>());
 	break;
       default:;
       }
+      type_ = NONE;
     }
 
     Value::~Value()
@@ -110,103 +100,141 @@ namespace dynamicgraph {
       deleteValue ();
     }
 
-    Value::Value(const bool& value) : type_(BOOL), value_(new bool(value))
+    Value::Value(const bool& value) : type_(BOOL)
     {
+      storage_.boolValue = value;
     }
-    Value::Value(const unsigned& value) : type_(UNSIGNED),
-					  value_(new unsigned(value))
+    Value::Value(const unsigned& value) : type_(UNSIGNED)
     {
+      storage_.unsignedValue = value;
     }
-    Value::Value(const int& value) : type_(INT),
-				     value_(new int(value))
+    Value::Value(const int& value) : type_(INT)
     {
+      storage_.intValue = value;
     }
-    Value::Value(const float& value) : type_(FLOAT),
-				       value_(new float(value))
+    Value::Value(const float& value) : type_(FLOAT)
     {
+      storage_.floatValue = value;
     }
-    Value::Value(const double& value) : type_(DOUBLE),
-					value_(new double(value))
+    Value::Value(const double& value) : type_(DOUBLE)
     {
+      storage_.doubleValue = value;
     }
-    Value::Value(const std::string& value) : type_(STRING),
-					     value_(new std::string(value))
+    Value::Value(const std::string& value) : type_(STRING)
     {
+      new (storage_.buffer) std::string(value);
     }
-    Value::Value(const Vector& value) : type_(VECTOR),
-					value_(new Vector(value))
+    Value::Value(const Vector& value) : type_(VECTOR)
     {
+      new (storage_.buffer) Vector(value);
     }
-    Value::Value(const Eigen::MatrixXd& value) : type_(MATRIX),
-						 value_(new Eigen::MatrixXd(value))
+    Value::Value(const Eigen::MatrixXd& value) : type_(MATRIX)
     {
+      new (storage_.buffer) Eigen::MatrixXd(value);
     }
-    Value::Value(const Eigen::Matrix4d& value) : type_(MATRIX4D),
-						 value_(new Eigen::Matrix4d(value))
+    Value::Value(const Eigen::Matrix4d& value) : type_(MATRIX4D)
     {
+      new (storage_.buffer) Matrix4d(value);
     }
 
-
-    Value::Value(const Value& value) : type_(value.type_),
-				       value_(copyValue(value))
+    Value::Value(const Value& value) : type_(NONE)
     {
-    }
-
-    void* copyValue(const Value& value)
-    {
-      void* copy;
-      switch(value.type()) {
-      case Value::NONE:
-	copy = NULL;
-	break;
-      case Value::BOOL:
-	copy = new bool(value.boolValue());
-	break;
-      case Value::UNSIGNED:
-	copy = new unsigned(value.unsignedValue());
-	break;
-      case Value::INT:
-	copy = new int(value.intValue());
-	break;
-      case Value::FLOAT:
-	copy = new float(value.floatValue());
-	break;
-      case Value::DOUBLE:
-	copy = new double(value.doubleValue());
-	break;
-      case Value::STRING:
-	copy = new std::string(value.stringValue());
-	break;
-      case Value::VECTOR:
-	copy = new Vector(value.vectorValue());
+      switch(value.type_) {
+      case STRING:
+	new (storage_.buffer) std::string(value.payload<std::string>());
 	break;
-      case Value::MATRIX:
-	copy = new Eigen::MatrixXd(value.matrixXdValue());
+      case VECTOR:
+	new (storage_.buffer) Vector(value.payload<Vector>());
 	break;
-      case Value::MATRIX4D:
-	copy = new Eigen::Matrix4d(value.matrix4dValue());
+      case MATRIX:
+	new (storage_.buffer) Eigen::MatrixXd(value.payload<Eigen::MatrixXd>());
 	break;
       default:
-	abort();
+	// Trivially copyable payload.
+	storage_ = value.storage_;
       }
-      return copy;
+      type_ = value.type_;
     }
 
-    Value::Value() : type_(NONE), value_(NULL)
+    Value::Value() : type_(NONE)
     {
+      BOOST_STATIC_ASSERT(sizeof(Vector) <= sizeof(Storage));
+      BOOST_STATIC_ASSERT(sizeof(Eigen::MatrixXd) <= sizeof(Storage));
     }
 
-    Value Value::operator=(const Value& value)
+    Value& Value::operator=(const Value& value)
+    {
+      if (&value == this) return *this;
+      // Reuse the memory of the payload if the types match.
+      if (type_ == value.type_) {
+	switch(type_) {
+	case STRING:
+	  payload<std::string>() = value.payload<std::string>();
+	  break;
+	case VECTOR:
+	  payload<Vector>() = value.payload<Vector>();
+	  break;
+	case MATRIX:
+	  payload<Eigen::MatrixXd>() = value.payload<Eigen::MatrixXd>();
+	  break;
+	default:
+	  storage_ = value.storage_;
+	}
+	return *this;
+      }
+      Value copy(value);
+      deleteValue();
+      moveFrom(copy);
+      return *this;
+    }
+
+#if __cplusplus >= 201103L
+    Value::Value(Value&& value) : type_(NONE)
+    {
+      moveFrom(value);
+    }
+
+    Value& Value::operator=(Value&& value)
     {
       if (&value != this) {
-	if(value_ != 0x0)
-	  deleteValue ();
-	type_ = value.type_;
-	void** ptValue = const_cast<void**>(&value_);
-	*ptValue = copyValue(value);
+	deleteValue();
+	moveFrom(value);
       }
       return *this;
     }
+#endif
+
+    void Value::moveFrom(Value& value)
+    {
+      assert(type_ == NONE);
+      switch(value.type_) {
+      case STRING:
+	new (storage_.buffer) std::string();
+	payload<std::string>().swap(value.payload<std::string>());
+	break;
+      case VECTOR:
+	new (storage_.buffer) Vector();
+	payload<Vector>().swap(value.payload<Vector>());
+	break;
+      case MATRIX:
+	new (storage_.buffer) Eigen::MatrixXd();
+	payload<Eigen::MatrixXd>().swap(value.payload<Eigen::MatrixXd>());
+	break;
+      default:
+	storage_ = value.storage_;
+      }
+      type_ = value.type_;
+      value.deleteValue();
+    }
+
+    void Value::swap(Value& value)
+    {
+      if (&value == this) return;
+      Value tmp;
+      tmp.moveFrom(*this);
+      moveFrom(value);
+      value.moveFrom(tmp);
+    }
 
     const EitherType Value::value() const
     {
@@ -218,80 +246,89 @@ namespace dynamicgraph {
       return type_;
     }
 
+    void Value::checkType(Type type, const char* message) const
+    {
+      if(type_ != type)
+	throw ExceptionAbstract(ExceptionAbstract::TOOLS, message);
+    }
+
     bool Value::boolValue() const
     {
-      if(type_ == BOOL)
-	return *((const bool*)value_);
-      throw ExceptionAbstract(ExceptionAbstract::TOOLS,
-			      "value is not an bool");
+      checkType(BOOL, "value is not an bool");
+      return storage_.boolValue;
     }
 
     unsigned Value::unsignedValue() const
     {
-      if(type_ == UNSIGNED)
-	return *((const unsigned*)value_);
-      throw ExceptionAbstract(ExceptionAbstract::TOOLS,
-			      "value is not an unsigned int");
+      checkType(UNSIGNED, "value is not an unsigned int");
+      return storage_.unsignedValue;
     }
 
     int Value::intValue() const
     {
-      if(type_ == INT)
-	return *((const int*)value_);
-      throw ExceptionAbstract(ExceptionAbstract::TOOLS,
-			      "value is not an int int");
+      checkType(INT, "value is not an int int");
+      return storage_.intValue;
     }
 
     float Value::floatValue() const
     {
-      float result;
-      if(FLOAT != type_)
-	throw ExceptionAbstract(ExceptionAbstract::TOOLS,
-				"value is not a float");
-      result = *((const float*)value_);
-      return result;
+      checkType(FLOAT, "value is not a float");
+      return storage_.floatValue;
     }
 
     double Value::doubleValue() const
     {
-      double result;
-      if(DOUBLE != type_)
-	throw ExceptionAbstract(ExceptionAbstract::TOOLS,
-				"value is not a double");
-      result = *((const double*)value_);
-      return result;
+      checkType(DOUBLE, "value is not a double");
+      return storage_.doubleValue;
     }
 
     std::string Value::stringValue() const
     {
-      if(type_ == STRING)
-	return *((const std::string*)value_);
-      throw ExceptionAbstract(ExceptionAbstract::TOOLS,
-			      "value is not an string");
+      checkType(STRING, "value is not an string");
+      return payload<std::string>();
     }
 
     Vector Value::vectorValue() const
     {
-      if(type_ == VECTOR)
-	return *((const Vector*)value_);
-      throw ExceptionAbstract(ExceptionAbstract::TOOLS,
-			      "value is not an vector");
+      checkType(VECTOR, "value is not an vector");
+      return payload<Vector>();
     }
 
     Eigen::MatrixXd Value::matrixXdValue() const
     {
-      if(type_ == MATRIX)
-	return *((const Eigen::MatrixXd*)value_);
-      throw ExceptionAbstract(ExceptionAbstract::TOOLS,
-			      "value is not a Eigen matrixXd");
+      checkType(MATRIX, "value is not a Eigen matrixXd");
+      return payload<Eigen::MatrixXd>();
     }
 
     Eigen::Matrix4d Value::matrix4dValue() const
+    {
+      checkType(MATRIX4D, "value is not a Eigen matrix4d");
+      return payload<Matrix4d>();
+    }
+
+    const std::string& Value::stringRef() const
+    {
+      checkType(STRING, "value is not an string");
+      return payload<std::string>();
+    }
+
+    const Vector& Value::vectorRef() const
+    {
+      checkType(VECTOR, "value is not an vector");
+      return payload<Vector>();
+    }
+
+    const Eigen::MatrixXd& Value::matrixXdRef() const
+    {
+      checkType(MATRIX, "value is not a Eigen matrixXd");
+      return payload<Eigen::MatrixXd>();
+    }
+
+    Eigen::Ref<const Eigen::MatrixXd> Value::matrixRef() const
     {
       if(type_ == MATRIX4D)
-	return *((const Eigen::Matrix4d*)value_);
-      throw ExceptionAbstract(ExceptionAbstract::TOOLS,
-			      "value is not a Eigen matrix4d");
+	return payload<Matrix4d>();
+      return matrixXdRef();
     }
 
     std::string Value::typeName(Type type)
@@ -367,6 +404,8 @@ namespace dynamicgraph {
     template<> const Value::Type ValueHelper<Vector>::TypeID = Value::VECTOR;
     template<> const Value::Type ValueHelper<Eigen::MatrixXd>::TypeID = Value::MATRIX;
     template<> const Value::Type ValueHelper<Eigen::Matrix4d>::TypeID = Value::MATRIX4D;
+    template<> const Value::Type ValueHelper<Eigen::Ref<const Vector> >::TypeID = Value::VECTOR;
+    template<> const Value::Type ValueHelper<Eigen::Ref<const Eigen::MatrixXd> >::TypeID = Value::MATRIX;
 
   } // namespace command
 } //namespace dynamicgraph
@@ -19,9 +19,14 @@
  */
 
 #include <dynamic-graph/debug.h>
+#include <dynamic-graph/real-time-logger.h>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <ios>
 
+#include <boost/thread/thread.hpp>
+
 using namespace dynamicgraph;
 
 #ifdef WIN32
@@ -52,19 +57,384 @@ std::ofstream dg_debugfile; //( "/dev/null", std::ios::trunc&std::ios::out );
 
 namespace dynamicgraph {
 	DebugTrace dgDEBUGFLOW(dg_debugfile);
-	DebugTrace dgERRORFLOW(dg_debugfile);
+	DebugTrace dgERRORFLOW(dg_debugfile, "\t!! ");
+}
+
+namespace {
+  /// Serializes the writes to the debug file with its opening and
+  /// closing.
+  /// Never destroyed, as the logger.
+  boost::mutex& outputMutex = *new boost::mutex;
+
+  /// Number of entries accepted by the logger, and written by its thread.
+  boost::atomic<std::size_t> nbSent (0);
+  boost::atomic<std::size_t> nbWritten (0);
+
+  /// Text of an entry: the trace it belongs to, then its characters.
+  const std::size_t HEADER_SIZE = sizeof (const DebugTrace*);
+  const std::size_t CHUNK_SIZE = RealTimeLogger::ENTRY_SIZE - HEADER_SIZE;
+
+  /// Write the text of a trace to its output. outputMutex must be locked.
+  void writeTrace (const DebugTrace& trace, const char* text, std::size_t size)
+  {
+    trace.outputbuffer.write (text, static_cast<std::streamsize> (size));
+  }
+
+  /// Write the entries of the traces to their output, in the thread of
+  /// the logger.
+  class TraceOutput : public LoggerStream
+  {
+  public:
+    using LoggerStream::write;
+    virtual void write (const char* text, std::size_t size)
+    {
+      LoggerEntry entry = { text, size };
+      writev (&entry, 1);
+    }
+
+    virtual void writev (const LoggerEntry* entries, std::size_t nbEntries)
+    {
+      if (nbEntries == 0) return;
+      boost::mutex::scoped_lock lock (outputMutex);
+      const DebugTrace* last = NULL;
+      for (std::size_t i = 0; i < nbEntries; ++i)
+	{
+	  const DebugTrace* trace;
+	  std::memcpy (&trace, entries[i].text, HEADER_SIZE);
+	  if (last != NULL && trace != last) last->outputbuffer.flush ();
+	  writeTrace (*trace, entries[i].text + HEADER_SIZE,
+		      entries[i].size - HEADER_SIZE);
+	  last = trace;
+	}
+      last->outputbuffer.flush ();
+      nbWritten.fetch_add (nbEntries);
+    }
+  };
+
+  /// Wait until the traces accepted by the logger so far are written.
+  /// The entries are written in order.
+  void drain ()
+  {
+    const std::size_t sent = nbSent.load ();
+    while (nbWritten.load () < sent)
+      boost::this_thread::yield ();
+  }
+
+  /// Logger of the traces, with its own thread. The traces are written
+  /// directly once it is stopped, at exit.
+  class Backend
+  {
+  public:
+    Backend ()
+      : logger_ (4096)
+      , running_ (true)
+      , nbDropped_ (0)
+    {
+      logger_.addOutputStream (LoggerStreamPtr_t (new TraceOutput));
+      logger_.start ();
+    }
+
+    /// Never destroyed: the destructors of other static objects may
+    /// still write traces.
+    static Backend& instance ()
+    {
+      static Backend* backend = new Backend;
+      return *backend;
+    }
+
+    /// Stop the thread of the logger: the later traces are written
+    /// directly.
+    void stop ()
+    {
+      running_ = false;
+      logger_.stop ();
+    }
+
+    /// \brief Pass an entry to the logger, or write it directly if the
+    /// logger is stopped.
+    ///
+    /// The number of traces dropped is written before the entry.
+    /// \return false if the ring of the logger is full.
+    bool write (const char* entry, std::size_t size)
+    {
+      if (!running_.load (boost::memory_order_relaxed))
+	{
+	  const DebugTrace* trace;
+	  std::memcpy (&trace, entry, HEADER_SIZE);
+	  writeDirect (*trace, entry + HEADER_SIZE, size - HEADER_SIZE);
+	  return true;
+	}
+      if (nbDropped_.load (boost::memory_order_relaxed) > 0)
+	reportDropped ();
+      if (logger_.write (entry, size))
+	{
+	  nbSent.fetch_add (1);
+	  return true;
+	}
+      return false;
+    }
+
+    /// Count a trace which did not fit in the ring of the logger.
+    void drop ()
+    {
+      nbDropped_.fetch_add (1);
+    }
+
+    /// \brief Write a trace from the calling thread, once the entries
+    /// already accepted by the logger are written.
+    ///
+    /// The calling thread blocks on the file.
+    void writeDirect (const DebugTrace& trace, const char* text,
+		      std::size_t size)
+    {
+      drain ();
+      boost::mutex::scoped_lock lock (outputMutex);
+      writeTrace (trace, text, size);
+      trace.outputbuffer.flush ();
+    }
+
+    /// Write the number of traces dropped since the last report, if any.
+    void flushDropped ()
+    {
+      const std::size_t n = nbDropped_.exchange (0);
+      if (n == 0) return;
+      char text[64];
+      const int size = snprintf (text, sizeof (text), "%s%lu traces dropped\n",
+				 dgERRORFLOW.marker,
+				 static_cast<unsigned long> (n));
+      writeDirect (dgERRORFLOW, text, static_cast<std::size_t> (size));
+    }
+
+  private:
+    /// Pass the number of traces dropped to the logger.
+    void reportDropped ()
+    {
+      const std::size_t n = nbDropped_.exchange (0);
+      if (n == 0) return;
+      char entry[RealTimeLogger::ENTRY_SIZE];
+      const DebugTrace* header = &dgERRORFLOW;
+      std::memcpy (entry, &header, HEADER_SIZE);
+      const int size = snprintf (entry + HEADER_SIZE, CHUNK_SIZE,
+				 "%s%lu traces dropped\n", dgERRORFLOW.marker,
+				 static_cast<unsigned long> (n));
+      if (logger_.write (entry, HEADER_SIZE + static_cast<std::size_t> (size)))
+	nbSent.fetch_add (1);
+      else
+	nbDropped_.fetch_add (n);
+    }
+
+    RealTimeLogger logger_;
+    boost::atomic<bool> running_;
+    /// Number of entries dropped since the last report.
+    boost::atomic<std::size_t> nbDropped_;
+  };
+
+  /// Stops the logger at exit, before the static objects constructed
+  /// before it are destroyed.
+  struct BackendStop
+  {
+    ~BackendStop ()
+    {
+      Backend::instance ().stop ();
+    }
+  } backendStop;
+
+  /// Buffer of a trace being written.
+  class TraceBuffer : public std::stringbuf
+  {
+  public:
+    const char* data () const
+    {
+      return pbase ();
+    }
+    std::size_t size () const
+    {
+      return static_cast<std::size_t> (pptr () - pbase ());
+    }
+  };
+
+  struct TraceStream
+  {
+    TraceStream () : os (&buffer) {}
+    TraceBuffer buffer;
+    std::ostream os;
+  };
+
+  /// Buffers of the calling thread: a trace may be written while the
+  /// arguments of another one are evaluated.
+  struct ThreadBuffers
+  {
+    ThreadBuffers () : depth (0) {}
+    ~ThreadBuffers ()
+    {
+      for (std::size_t i = 0; i < streams.size (); ++i) delete streams[i];
+    }
+    std::vector<TraceStream*> streams;
+    std::size_t depth;
+  };
+
+  boost::thread_specific_ptr<ThreadBuffers> threadBuffers;
+
+  ThreadBuffers& buffers ()
+  {
+    ThreadBuffers* buffers = threadBuffers.get ();
+    if (buffers == NULL)
+      {
+	buffers = new ThreadBuffers;
+	threadBuffers.reset (buffers);
+      }
+    return *buffers;
+  }
+
+  /// \brief Pass a trace to the logger.
+  ///
+  /// A trace longer than an entry of the logger would have to be cut in
+  /// several entries, between which the traces of other threads could be
+  /// written or dropped: it is written directly. So are the errors which
+  /// do not fit in the ring of the logger.
+  void send (const DebugTrace& trace, const char* text, std::size_t size)
+  {
+    Backend& backend = Backend::instance ();
+    if (size > CHUNK_SIZE)
+      {
+	backend.writeDirect (trace, text, size);
+	return;
+      }
+    char entry[RealTimeLogger::ENTRY_SIZE];
+    const DebugTrace* header = &trace;
+    std::memcpy (entry, &header, HEADER_SIZE);
+    std::memcpy (entry + HEADER_SIZE, text, size);
+    if (backend.write (entry, HEADER_SIZE + size)) return;
+    if (&trace == &dgERRORFLOW)
+      backend.writeDirect (trace, text, size);
+    else
+      backend.drop ();
+  }
+} // end of anonymous namespace.
+
+DebugTrace::Entry::Entry (const DebugTrace& trace)
+  : trace_ (trace)
+{
+  ThreadBuffers& b = buffers ();
+  if (b.depth == b.streams.size ()) b.streams.push_back (new TraceStream);
+  TraceStream& stream = *b.streams[b.depth++];
+  stream.buffer.pubseekpos (0, std::ios::out);
+  stream.os.clear ();
+  os_ = &stream.os;
+}
+
+DebugTrace::Entry::~Entry ()
+{
+  ThreadBuffers& b = buffers ();
+  const TraceBuffer& buffer = b.streams[--b.depth]->buffer;
+  if (buffer.size () > 0) send (trace_, buffer.data (), buffer.size ());
+}
+
+void DebugTrace::write (const char* format, va_list arg) const
+{
+  char text[SIZE+1];
+  vsnprintf (text, SIZE, format, arg);
+  Entry (*this).stream () << text << std::endl;
+}
+
+void DebugTrace::trace (const int level, const char* format, ...)
+{
+  if (!enabled (level)) return;
+  va_list arg;
+  va_start (arg, format);
+  write (format, arg);
+  va_end (arg);
+}
+
+void DebugTrace::trace (const char* format, ...)
+{
+  if (!enabled ()) return;
+  va_list arg;
+  va_start (arg, format);
+  write (format, arg);
+  va_end (arg);
+}
+
+void DebugTrace::traceTemplate (const int level, const char* format, ...)
+{
+  if (!templateEnabled (level)) return;
+  va_list arg;
+  va_start (arg, format);
+  write (format, arg);
+  va_end (arg);
+}
+
+void DebugTrace::traceTemplate (const char* format, ...)
+{
+  if (!enabled ()) return;
+  va_list arg;
+  va_start (arg, format);
+  write (format, arg);
+  va_end (arg);
+}
+
+void DebugTrace::Formatter::write (const char* format, va_list arg) const
+{
+  char text[SIZE+1];
+  vsnprintf (text, SIZE, format, arg);
+  Entry (trace_).stream () << trace_.marker << file_ << ": " << function_
+			   << "(#" << line_ << ") :" << text << std::endl;
+}
+
+void DebugTrace::Formatter::trace (const int level, const char* format, ...)
+{
+  if (level > maxLevel_ || !trace_.enabled (level)) return;
+  va_list arg;
+  va_start (arg, format);
+  write (format, arg);
+  va_end (arg);
+}
+
+void DebugTrace::Formatter::trace (const char* format, ...)
+{
+  va_list arg;
+  va_start (arg, format);
+  write (format, arg);
+  va_end (arg);
+}
+
+void DebugTrace::Formatter::traceTemplate (const int level,
+					   const char* format, ...)
+{
+  if (level > maxLevel_ || !trace_.templateEnabled (level)) return;
+  va_list arg;
+  va_start (arg, format);
+  write (format, arg);
+  va_end (arg);
+}
+
+void DebugTrace::Formatter::traceTemplate (const char* format, ...)
+{
+  va_list arg;
+  va_start (arg, format);
+  write (format, arg);
+  va_end (arg);
 }
 
 void DebugTrace::openFile( const char * filename )
 {
+  Backend::instance ().flushDropped ();
+  drain ();
+  boost::mutex::scoped_lock lock (outputMutex);
   if( dg_debugfile.good ()&&dg_debugfile.is_open () ) dg_debugfile.close ();
   dg_debugfile.clear ();
   dg_debugfile.open( filename, std::ios::trunc&std::ios::out );
-  //std::cout << filename << dg_debugfile.good () << dg_debugfile.is_open () << std::endl;
+  dgDEBUGFLOW.outputOpen_ = dg_debugfile.good ();
+  dgERRORFLOW.outputOpen_ = dg_debugfile.good ();
 }
 
 void DebugTrace::closeFile(const char *)
 {
+  dgDEBUGFLOW.outputOpen_ = false;
+  dgERRORFLOW.outputOpen_ = false;
+  Backend::instance ().flushDropped ();
+  drain ();
+  boost::mutex::scoped_lock lock (outputMutex);
   if( dg_debugfile.good ()&&dg_debugfile.is_open () ) { dg_debugfile.close (); }
   dg_debugfile.setstate( std::ios::failbit ) ;
 }
@@ -72,4 +442,3 @@ void DebugTrace::closeFile(const char *)
 
 //DebugTrace dgDebugFLOW(std::cout);
 //DebugTrace dgERRORFLOW(std::cerr);
-
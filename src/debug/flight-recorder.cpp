@@ -0,0 +1,225 @@
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+// dynamic-graph is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.  You should
+// have received a copy of the GNU Lesser General Public License
+// along with dynamic-graph.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+
+#ifndef WIN32
+# include <fcntl.h>
+# include <signal.h>
+# include <unistd.h>
+#endif /*WIN32*/
+
+#include "dynamic-graph/exception-traces.h"
+#include "dynamic-graph/flight-recorder.h"
+
+namespace dynamicgraph
+{
+  namespace {
+    /// Position of the oldest complete entry of a ring of capacity
+    /// characters, end characters having been written.
+    std::size_t oldest (const std::vector<char>& buffer, std::size_t end)
+    {
+      const std::size_t capacity = buffer.size ();
+      if (end <= capacity) return 0;
+      // Skip the entry partially overwritten.
+      std::size_t begin = end - capacity;
+      while (begin < end && buffer[begin % capacity] != '\n') ++begin;
+      return std::min (begin + 1, end);
+    }
+
+#ifndef WIN32
+    const int crashSignals[] = { SIGSEGV, SIGABRT, SIGBUS, SIGFPE, SIGILL };
+    enum { NB_CRASH_SIGNALS = sizeof (crashSignals) / sizeof (int) };
+    struct sigaction previousActions[NB_CRASH_SIGNALS];
+
+    /// State of the crash handler, prepared by installCrashHandler since
+    /// the handler cannot allocate.
+    boost::atomic<FlightRecorder*> crashRecorder (NULL);
+    char crashFilename[4096];
+    char alternateStack[64 * 1024];
+#endif /*WIN32*/
+  } // end of anonymous namespace.
+
+  FlightRecorder::FlightRecorder (std::size_t capacity)
+    : buffer_ (std::max<std::size_t> (capacity, 1))
+    , end_ (0)
+  {}
+
+  FlightRecorder::~FlightRecorder ()
+  {
+    uninstallCrashHandler ();
+  }
+
+  void FlightRecorder::append (const char* text, std::size_t size)
+  {
+    const std::size_t capacity = buffer_.size ();
+    if (size > capacity)
+      {
+	text += size - capacity;
+	size = capacity;
+      }
+    const std::size_t end = end_.load (boost::memory_order_relaxed);
+    const std::size_t offset = end % capacity;
+    const std::size_t first = std::min (size, capacity - offset);
+    std::memcpy (&buffer_[offset], text, first);
+    std::memcpy (&buffer_[0], text + first, size - first);
+    end_.store (end + size, boost::memory_order_release);
+  }
+
+  void FlightRecorder::write (const char* text, std::size_t size)
+  {
+    boost::mutex::scoped_lock lock (mutex_);
+    append (text, size);
+  }
+
+  void FlightRecorder::writev (const LoggerEntry* entries,
+			       std::size_t nbEntries)
+  {
+    boost::mutex::scoped_lock lock (mutex_);
+    for (std::size_t i = 0; i < nbEntries; ++i)
+      append (entries[i].text, entries[i].size);
+  }
+
+  std::size_t FlightRecorder::size () const
+  {
+    const std::size_t end = end_.load (boost::memory_order_acquire);
+    return std::min (end, buffer_.size ());
+  }
+
+  void FlightRecorder::dump (std::ostream& os) const
+  {
+    boost::mutex::scoped_lock lock (mutex_);
+    const std::size_t capacity = buffer_.size ();
+    const std::size_t end = end_.load (boost::memory_order_acquire);
+    std::size_t begin = oldest (buffer_, end);
+    while (begin < end)
+      {
+	const std::size_t offset = begin % capacity;
+	const std::size_t n = std::min (end - begin, capacity - offset);
+	os.write (&buffer_[offset], static_cast<std::streamsize> (n));
+	begin += n;
+      }
+  }
+
+  void FlightRecorder::dump (const std::string& filename) const
+  {
+    std::ofstream file (filename.c_str ());
+    if (file.good ()) dump (file);
+    if (!file.good ())
+      DG_THROW ExceptionTraces (ExceptionTraces::NOT_OPEN,
+				"Cannot dump the flight recorder to <"
+				+ filename + ">.");
+  }
+
+#ifndef WIN32
+  bool FlightRecorder::dump (int fd) const
+  {
+    const std::size_t capacity = buffer_.size ();
+    const std::size_t end = end_.load (boost::memory_order_acquire);
+    std::size_t begin = oldest (buffer_, end);
+    while (begin < end)
+      {
+	const std::size_t offset = begin % capacity;
+	const std::size_t n = std::min (end - begin, capacity - offset);
+	const ssize_t written = ::write (fd, &buffer_[offset], n);
+	if (written < 0)
+	  {
+	    if (errno == EINTR) continue;
+	    return false;
+	  }
+	begin += static_cast<std::size_t> (written);
+      }
+    return true;
+  }
+
+  void FlightRecorder::crashHandler (int signal)
+  {
+    const int error = errno;
+    FlightRecorder* recorder = crashRecorder.exchange (NULL);
+    if (recorder != NULL)
+      {
+	const int fd = ::open (crashFilename, O_WRONLY | O_CREAT | O_TRUNC,
+			       0644);
+	if (fd >= 0)
+	  {
+	    recorder->dump (fd);
+	    ::close (fd);
+	  }
+      }
+    // Let the previous handler, or the default action, handle the signal
+    // once this handler returns.
+    for (int i = 0; i < NB_CRASH_SIGNALS; ++i)
+      if (crashSignals[i] == signal)
+	sigaction (signal, &previousActions[i], NULL);
+    raise (signal);
+    errno = error;
+  }
+
+  bool FlightRecorder::installCrashHandler (const std::string& filename)
+  {
+    if (filename.size () >= sizeof (crashFilename))
+      DG_THROW ExceptionTraces (ExceptionTraces::GENERIC,
+				"The name of the crash file is too long.");
+    FlightRecorder* previous = crashRecorder.load ();
+    if (previous != NULL) previous->uninstallCrashHandler ();
+    std::memcpy (crashFilename, filename.c_str (), filename.size () + 1);
+
+    stack_t stack;
+    if (sigaltstack (NULL, &stack) == 0 && (stack.ss_flags & SS_DISABLE))
+      {
+	stack.ss_sp = alternateStack;
+	stack.ss_size = sizeof (alternateStack);
+	stack.ss_flags = 0;
+	sigaltstack (&stack, NULL);
+      }
+
+    struct sigaction action;
+    std::memset (&action, 0, sizeof (action));
+    action.sa_handler = &FlightRecorder::crashHandler;
+    action.sa_flags = SA_ONSTACK;
+    sigemptyset (&action.sa_mask);
+    crashRecorder = this;
+    for (int i = 0; i < NB_CRASH_SIGNALS; ++i)
+      sigaction (crashSignals[i], &action, &previousActions[i]);
+    return true;
+  }
+
+  void FlightRecorder::uninstallCrashHandler ()
+  {
+    FlightRecorder* expected = this;
+    if (!crashRecorder.compare_exchange_strong (expected, NULL)) return;
+    for (int i = 0; i < NB_CRASH_SIGNALS; ++i)
+      sigaction (crashSignals[i], &previousActions[i], NULL);
+  }
+#else /*WIN32*/
+  void FlightRecorder::crashHandler (int)
+  {}
+
+  bool FlightRecorder::dump (int) const
+  {
+    return false;
+  }
+
+  bool FlightRecorder::installCrashHandler (const std::string&)
+  {
+    return false;
+  }
+
+  void FlightRecorder::uninstallCrashHandler ()
+  {}
+#endif /*WIN32*/
+} // end of namespace dynamicgraph
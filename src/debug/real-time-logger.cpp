@@ -19,72 +19,553 @@
 
 #include <dynamic-graph/real-time-logger.h>
 
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iomanip>
+
+#include <time.h>
+#ifdef __linux__
+# include <linux/futex.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#endif
+
 #include <boost/thread/thread.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
 namespace dynamicgraph
 {
+  namespace {
+    template <typename T> const char* read (const char* cursor, T& value)
+    {
+      std::memcpy (&value, cursor, sizeof (T));
+      return cursor + sizeof (T);
+    }
+
+    /// Monotonic time in nanoseconds.
+    boost::int64_t timestamp ()
+    {
+#ifdef CLOCK_MONOTONIC
+      struct timespec ts;
+      clock_gettime (CLOCK_MONOTONIC, &ts);
+      return static_cast<boost::int64_t> (ts.tv_sec) * 1000000000
+        + ts.tv_nsec;
+#else
+      return (boost::posix_time::microsec_clock::universal_time()
+              - boost::posix_time::ptime (boost::gregorian::date (1970, 1, 1)))
+        .total_microseconds() * 1000;
+#endif
+    }
+
+    /// Write the argument at cursor, of the given type, and return the
+    /// position of the next one.
+    const char* formatArgument (std::ostream& os, LogRecordWriter::Type type,
+                                const char* cursor)
+    {
+      switch (type) {
+        case LogRecordWriter::BOOL:
+          { bool v; cursor = read (cursor, v); os << (v ? "true" : "false"); }
+          break;
+        case LogRecordWriter::CHAR:
+          { char v; cursor = read (cursor, v); os << v; }
+          break;
+        case LogRecordWriter::INT:
+          { int v; cursor = read (cursor, v); os << v; }
+          break;
+        case LogRecordWriter::UNSIGNED_INT:
+          { unsigned int v; cursor = read (cursor, v); os << v; }
+          break;
+        case LogRecordWriter::LONG:
+          { long v; cursor = read (cursor, v); os << v; }
+          break;
+        case LogRecordWriter::UNSIGNED_LONG:
+          { unsigned long v; cursor = read (cursor, v); os << v; }
+          break;
+        case LogRecordWriter::DOUBLE:
+          { double v; cursor = read (cursor, v); os << v; }
+          break;
+        case LogRecordWriter::POINTER:
+          { const void* v; cursor = read (cursor, v); os << v; }
+          break;
+        case LogRecordWriter::STRING:
+          {
+            std::size_t size;
+            cursor = read (cursor, size);
+            os.write (cursor, static_cast<std::streamsize> (size));
+            cursor += size;
+          }
+          break;
+        case LogRecordWriter::MATRIX:
+          {
+            int rows, cols;
+            cursor = read (cursor, rows);
+            cursor = read (cursor, cols);
+            // Vectors on one line, matrices row by row.
+            const std::size_t stride = static_cast<std::size_t> (rows)
+              * sizeof (double);
+            os << '[';
+            for (int i = 0; i < rows; ++i) {
+              if (cols != 1) os << (i == 0 ? "[" : ", [");
+              else if (i > 0) os << ", ";
+              for (int j = 0; j < cols; ++j) {
+                double v;
+                read (cursor + j * stride + i * sizeof (double), v);
+                os << (j == 0 ? "" : ", ") << v;
+              }
+              if (cols != 1) os << ']';
+            }
+            os << ']';
+            cursor += static_cast<std::size_t> (cols) * stride;
+          }
+          break;
+        case LogRecordWriter::TRUNCATED:
+          os << "...";
+          break;
+      }
+      return cursor;
+    }
+
+    /// Write the entry of a record: its timestamp, then its format with
+    /// each {} replaced by the next argument, then the remaining arguments.
+    void formatRecord (std::ostream& os, const char* record, std::size_t size)
+    {
+      const char* end = record + size;
+      const char* format;
+      boost::int64_t ns;
+      const char* cursor = read (read (record, format), ns);
+      os << '[' << ns / 1000000000 << '.' << std::setfill ('0')
+         << std::setw (6) << (ns % 1000000000) / 1000 << std::setfill (' ')
+         << "] ";
+      for (const char* c = format; *c != '\0'; ++c) {
+        if (c[0] == '{' && c[1] == '}' && cursor != end) {
+          const LogRecordWriter::Type type =
+            static_cast<LogRecordWriter::Type> (*cursor);
+          cursor = formatArgument (os, type, cursor + 1);
+          ++c;
+        } else
+          os << *c;
+      }
+      while (cursor != end) {
+        const LogRecordWriter::Type type =
+          static_cast<LogRecordWriter::Type> (*cursor);
+        os << ' ';
+        cursor = formatArgument (os, type, cursor + 1);
+      }
+    }
+  } // end of anonymous namespace.
+
+  const std::size_t RealTimeLogger::ENTRY_SIZE;
+  const std::size_t RealTimeLogger::RECORD_SIZE;
+  const std::size_t RealTimeLogger::TEXT_SIZE;
+  const std::size_t RealTimeLogger::BATCH_SIZE;
+
   RealTimeLogger::RealTimeLogger (const std::size_t& bufferSize)
-    : buffer_(bufferSize, NULL)
-    , frontIdx_ (0)
-    , backIdx_ (0)
+    : nbOutputs_ (0)
+    , buffer_(std::max<std::size_t> (bufferSize, 2) - 1, NULL)
+    , readIdx_ (0)
+    , writeIdx_ (0)
     , oss_ (NULL)
-    , nbDiscarded_ (0)
+    , formatter_ (&formatterBuf_)
+    , batch_ (BATCH_SIZE)
+    , batchSize_ (0)
+    , consumerWaiting_ (false)
+    , wakeups_ (0)
+    , producer_ (&RealTimeLogger::keepProducer)
+    , thread_ (NULL)
   {
-    for (std::size_t i = 0; i < buffer_.size(); ++i)
+    for (std::size_t i = 0; i < buffer_.size(); ++i) {
       buffer_[i] = new Data;
+      buffer_[i]->sequence = i;
+    }
+    batchEntries_.reserve (buffer_.size());
   }
 
   RealTimeLogger::~RealTimeLogger ()
   {
+    stop();
     // Check that we are not spinning...
     for (std::size_t i = 0; i < buffer_.size(); ++i) delete buffer_[i];
+    for (std::size_t i = 0; i < producers_.size(); ++i) delete producers_[i];
+  }
+
+  void RealTimeLogger::clearOutputStreams ()
+  {
+    boost::mutex::scoped_lock lock (outputsMutex_);
+    outputs_.clear();
+    nbOutputs_ = 0;
+  }
+
+  void RealTimeLogger::addOutputStream (const LoggerStreamPtr_t& os)
+  {
+    boost::mutex::scoped_lock lock (outputsMutex_);
+    outputs_.push_back(os);
+    nbOutputs_ = outputs_.size();
+  }
+
+  void RealTimeLogger::removeOutputStream (const LoggerStreamPtr_t& os)
+  {
+    boost::mutex::scoped_lock lock (outputsMutex_);
+    outputs_.erase (std::remove (outputs_.begin(), outputs_.end(), os),
+                    outputs_.end());
+    nbOutputs_ = outputs_.size();
+  }
+
+  void RealTimeLogger::readEntry (Data* data)
+  {
+    LoggerEntry entry;
+    entry.text = &batch_[batchSize_];
+    if (data->deferred) {
+      formatterBuf_.reset (&batch_[batchSize_], &batch_[batchSize_] + TEXT_SIZE);
+      formatter_.clear();
+      formatRecord (formatter_, data->entry, data->size);
+      entry.size = formatterBuf_.size();
+    } else {
+      std::memcpy (&batch_[batchSize_], data->entry, data->size);
+      entry.size = data->size;
+    }
+    batch_[batchSize_ + entry.size] = '\0';
+    batchSize_ += entry.size + 1;
+    batchEntries_.push_back (entry);
+  }
+
+  void RealTimeLogger::writeBatch ()
+  {
+    if (batchEntries_.empty()) return;
+    boost::mutex::scoped_lock lock (outputsMutex_);
+    for (std::size_t i = 0; i < outputs_.size(); ++i)
+      outputs_[i]->writev (&batchEntries_[0], batchEntries_.size());
+    batchEntries_.clear();
+    batchSize_ = 0;
   }
 
   bool RealTimeLogger::spinOnce ()
   {
-    if (empty()) return false;
-    Data* data = buffer_[frontIdx_];
-    frontIdx_ = (frontIdx_ + 1) % buffer_.size();
-    std::string str = data->buf.str();
-    // It is important to pass str.c_str() and not str
-    // because the str object may contains a '\0' so
-    // str.size() may be different from strlen(str.c_str())
+    const std::size_t position = readIdx_.load (boost::memory_order_relaxed);
+    Data* data = buffer_[position % buffer_.size()];
+    // Empty, or the next entry is still being written.
+    if (data->sequence.load (boost::memory_order_acquire) != position + 1)
+      return false;
+    readEntry (data);
+    // Give the slot back to the writers.
+    data->sequence.store (position + buffer_.size(), boost::memory_order_release);
+    readIdx_.store (position + 1, boost::memory_order_release);
+    const LoggerEntry& entry = batchEntries_.back();
+    boost::mutex::scoped_lock lock (outputsMutex_);
     for (std::size_t i = 0; i < outputs_.size(); ++i)
-      outputs_[i]->write (str.c_str());
+      outputs_[i]->write (entry.text, entry.size);
+    batchEntries_.clear();
+    batchSize_ = 0;
     return true;
   }
 
-  RTLoggerStream RealTimeLogger::front ()
+  bool RealTimeLogger::ready () const
+  {
+    const std::size_t position = readIdx_.load (boost::memory_order_relaxed);
+    return buffer_[position % buffer_.size()]->sequence.load
+      (boost::memory_order_acquire) == position + 1;
+  }
+
+  std::size_t RealTimeLogger::spin ()
   {
-    // If no output or if buffer is full, discard message.
-    if (outputs_.empty() || full()) {
-      nbDiscarded_++;
-      return RTLoggerStream (NULL, oss_);
+    // Copy the entries, formatting those written by log, and free their
+    // slots before writing them, which may take time. Read at most the
+    // size of the buffer at once.
+    std::size_t nbEntries = 0;
+    for (; nbEntries < buffer_.size() && ready(); ++nbEntries) {
+      const std::size_t position = readIdx_.load (boost::memory_order_relaxed);
+      Data* data = buffer_[position % buffer_.size()];
+      const std::size_t size = data->deferred ? TEXT_SIZE : data->size;
+      if (batchSize_ + size + 1 > batch_.size()) writeBatch();
+      readEntry (data);
+      data->sequence.store (position + buffer_.size(), boost::memory_order_release);
+      readIdx_.store (position + 1, boost::memory_order_release);
     }
-    bool alone = wmutex.try_lock();
-    // If someone is writting, discard message.
-    if (!alone) {
-      nbDiscarded_++;
-      return RTLoggerStream (NULL, oss_);
+    writeBatch();
+    return nbEntries;
+  }
+
+  void RealTimeLogger::wakeConsumer ()
+  {
+    // Order the commit of the entry before reading consumerWaiting_.
+    boost::atomic_thread_fence (boost::memory_order_seq_cst);
+    if (!consumerWaiting_.load (boost::memory_order_relaxed)
+        || !consumerWaiting_.exchange (false))
+      return;
+    wakeups_.fetch_add (1);
+#ifdef __linux__
+    syscall (SYS_futex, reinterpret_cast<int*> (&wakeups_),
+             FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#endif
+  }
+
+  void RealTimeLogger::waitForEntries (const boost::atomic<bool>& stop,
+                                       boost::int64_t timeout)
+  {
+    const int wakeups = wakeups_.load();
+    consumerWaiting_.store (true);
+    boost::atomic_thread_fence (boost::memory_order_seq_cst);
+    if (!ready() && !stop.load()) {
+#ifdef __linux__
+      struct timespec ts;
+      ts.tv_sec = static_cast<time_t> (timeout / 1000000000);
+      ts.tv_nsec = static_cast<long> (timeout % 1000000000);
+      // Returns at once if a writer incremented wakeups_ in the meantime.
+      syscall (SYS_futex, reinterpret_cast<int*> (&wakeups_),
+               FUTEX_WAIT_PRIVATE, wakeups, timeout > 0 ? &ts : NULL, NULL, 0);
+#else
+      boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+#endif
     }
-    Data* data = buffer_[backIdx_];
-    //backIdx_ = (backIdx_+1) % buffer_.size();
-    // Reset position of cursor
-    data->buf.pubseekpos(0);
-    oss_.rdbuf(&data->buf);
-    return RTLoggerStream (this, oss_);
+    consumerWaiting_.store (false);
+  }
+
+  RealTimeLogger::Data* RealTimeLogger::reserve (std::size_t& position)
+  {
+    Producer& p = producer();
+    // If no output, discard message.
+    if (nbOutputs_.load (boost::memory_order_relaxed) == 0) {
+      p.nbDiscarded.fetch_add (1, boost::memory_order_relaxed);
+      return NULL;
+    }
+    position = writeIdx_.load (boost::memory_order_relaxed);
+    for (;;) {
+      Data* data = buffer_[position % buffer_.size()];
+      const std::size_t sequence =
+        data->sequence.load (boost::memory_order_acquire);
+      const std::ptrdiff_t diff =
+        static_cast<std::ptrdiff_t> (sequence - position);
+      if (diff == 0) {
+        // The slot is free: reserve it. On failure, position is updated.
+        if (writeIdx_.compare_exchange_weak (position, position + 1,
+                                             boost::memory_order_relaxed)) {
+          p.nbWritten.fetch_add (1, boost::memory_order_relaxed);
+          return data;
+        }
+      } else if (diff < 0) {
+        // The slot still holds the entry of the previous round: the buffer
+        // is full, discard message.
+        p.nbDiscarded.fetch_add (1, boost::memory_order_relaxed);
+        return NULL;
+      } else {
+        // Another writer reserved the slot.
+        position = writeIdx_.load (boost::memory_order_relaxed);
+      }
+    }
+  }
+
+  RTLoggerStream RealTimeLogger::front ()
+  {
+    std::size_t position;
+    Data* data = reserve (position);
+    if (data == NULL) return RTLoggerStream (NULL, 0, oss_);
+    data->deferred = false;
+    data->buf.reset (data->entry, data->entry + ENTRY_SIZE);
+    data->os.clear();
+    return RTLoggerStream (this, position, data->os);
+  }
+
+  bool RealTimeLogger::beginRecord (const char* format, std::size_t& position,
+                                    LogRecordWriter& record)
+  {
+    Data* data = reserve (position);
+    if (data == NULL) return false;
+    const boost::int64_t ns = timestamp();
+    data->deferred = true;
+    std::memcpy (data->entry, &format, sizeof (format));
+    std::memcpy (data->entry + sizeof (format), &ns, sizeof (ns));
+    record.reset (data->entry + sizeof (format) + sizeof (ns),
+                  data->entry + ENTRY_SIZE);
+    return true;
+  }
+
+  void RealTimeLogger::endRecord (std::size_t position,
+                                  const LogRecordWriter& record)
+  {
+    Data* data = buffer_[position % buffer_.size()];
+    data->size = static_cast<std::size_t> (record.cursor() - data->entry);
+    if (record.truncated())
+      producer().nbTruncated.fetch_add (1, boost::memory_order_relaxed);
+    commit (position);
+  }
+
+  void RealTimeLogger::frontReady (std::size_t position)
+  {
+    Data* data = buffer_[position % buffer_.size()];
+    data->size = data->buf.size();
+    if (data->buf.truncated())
+      producer().nbTruncated.fetch_add (1, boost::memory_order_relaxed);
+    commit (position);
+  }
+
+  bool RealTimeLogger::write (const char* text, std::size_t size)
+  {
+    std::size_t position;
+    Data* data = reserve (position);
+    if (data == NULL) return false;
+    data->deferred = false;
+    data->size = std::min (size, ENTRY_SIZE);
+    std::memcpy (data->entry, text, data->size);
+    if (data->size < size)
+      producer().nbTruncated.fetch_add (1, boost::memory_order_relaxed);
+    commit (position);
+    return true;
+  }
+
+  void RealTimeLogger::commit (std::size_t position)
+  {
+    buffer_[position % buffer_.size()]->sequence.store
+      (position + 1, boost::memory_order_release);
+    wakeConsumer();
   }
 
   RTLoggerStream::~RTLoggerStream()
   {
-    os_ << std::ends;
-    if (logger_ != NULL) logger_->frontReady();
+    if (logger_ == NULL) return;
+    logger_->frontReady(position_);
+  }
+
+  RealTimeLogger::Producer& RealTimeLogger::producer ()
+  {
+    Producer* p = producer_.get();
+    if (p == NULL) {
+      registerProducer();
+      p = producer_.get();
+    }
+    return *p;
+  }
+
+  void RealTimeLogger::registerProducer (const std::string& name)
+  {
+    std::string producerName (name);
+    if (producerName.empty()) {
+      std::ostringstream oss;
+      oss << "thread " << boost::this_thread::get_id();
+      producerName = oss.str();
+    }
+    boost::mutex::scoped_lock lock (producersMutex_);
+    Producer* p = producer_.get();
+    if (p == NULL) {
+      p = new Producer;
+      p->nbWritten = 0;
+      p->nbDiscarded = 0;
+      p->nbTruncated = 0;
+      producers_.push_back (p);
+      producer_.reset (p);
+      p->name = producerName;
+    } else if (!name.empty()) {
+      p->name = producerName;
+    }
+  }
+
+  std::vector<RealTimeLogger::ProducerStatistics>
+  RealTimeLogger::getProducerStatistics () const
+  {
+    boost::mutex::scoped_lock lock (producersMutex_);
+    std::vector<ProducerStatistics> statistics (producers_.size());
+    for (std::size_t i = 0; i < producers_.size(); ++i) {
+      statistics[i].name = producers_[i]->name;
+      statistics[i].nbWritten = producers_[i]->nbWritten.load();
+      statistics[i].nbDiscarded = producers_[i]->nbDiscarded.load();
+      statistics[i].nbTruncated = producers_[i]->nbTruncated.load();
+    }
+    return statistics;
+  }
+
+  std::size_t RealTimeLogger::getNbDiscarded () const
+  {
+    boost::mutex::scoped_lock lock (producersMutex_);
+    std::size_t nbDiscarded = 0;
+    for (std::size_t i = 0; i < producers_.size(); ++i)
+      nbDiscarded += producers_[i]->nbDiscarded.load();
+    return nbDiscarded;
+  }
+
+  namespace {
+    /// Rate-limited call sites, registered by their constructor.
+    boost::mutex& callsitesMutex ()
+    {
+      static boost::mutex mutex;
+      return mutex;
+    }
+
+    std::vector<RTLogCallsite*>& callsites ()
+    {
+      static std::vector<RTLogCallsite*> callsites;
+      return callsites;
+    }
+  } // end of anonymous namespace.
+
+  RTLogCallsite::RTLogCallsite (const char* file, int line, double rate,
+                                int burst)
+    : file_ (file)
+    , line_ (line)
+    , rate_ (rate)
+    , burst_ (burst)
+    , credit_ (0)
+    , tokens_ (burst)
+    , suppressed_ (0)
+  {
+    boost::mutex::scoped_lock lock (callsitesMutex());
+    callsites().push_back (this);
+  }
+
+  RTLogCallsite::~RTLogCallsite ()
+  {
+    boost::mutex::scoped_lock lock (callsitesMutex());
+    std::vector<RTLogCallsite*>& list = callsites();
+    list.erase (std::remove (list.begin(), list.end(), this), list.end());
+  }
+
+  void RTLogCallsite::refill (double elapsed)
+  {
+    boost::mutex::scoped_lock lock (callsitesMutex());
+    std::vector<RTLogCallsite*>& list = callsites();
+    for (std::size_t i = 0; i < list.size(); ++i) {
+      RTLogCallsite& callsite = *list[i];
+      callsite.credit_ += callsite.rate_ * elapsed;
+      const int earned = static_cast<int> (std::min<double>
+                                           (callsite.credit_, callsite.burst_));
+      callsite.credit_ -= earned;
+      if (earned == 0) continue;
+      // The writers may have taken the tokens below zero.
+      int tokens = callsite.tokens_.load();
+      int next;
+      do {
+        next = std::min (callsite.burst_, std::max (tokens, 0) + earned);
+      } while (!callsite.tokens_.compare_exchange_weak (tokens, next));
+      // Do not accumulate credit while the bucket is full.
+      if (next == callsite.burst_) callsite.credit_ = 0;
+    }
+  }
+
+  void RTLogCallsite::reportSuppressed (RealTimeLogger& logger)
+  {
+    boost::mutex::scoped_lock lock (callsitesMutex());
+    std::vector<RTLogCallsite*>& list = callsites();
+    for (std::size_t i = 0; i < list.size(); ++i) {
+      if (list[i]->suppressed_.load (boost::memory_order_relaxed) == 0)
+        continue;
+      const std::size_t nbSuppressed = list[i]->suppressed_.exchange (0);
+      logger.log ("{}:{}: {} entries suppressed\n", list[i]->file_,
+                  list[i]->line_, nbSuppressed);
+    }
+  }
+
+  std::size_t RTLogCallsite::count ()
+  {
+    boost::mutex::scoped_lock lock (callsitesMutex());
+    return callsites().size();
   }
 
   struct RealTimeLogger::thread
   {
-    bool requestShutdown_;
+    /// Period of the refill of the rate-limited call sites.
+    static const boost::int64_t REFILL_PERIOD = 100000000;
+    /// Number of refills between two reports of the suppressed entries.
+    static const int REPORT_PERIOD = 10;
+
+    boost::atomic<bool> requestShutdown_;
     boost::thread t_;
 
     thread (RealTimeLogger* logger)
@@ -94,24 +575,55 @@ namespace dynamicgraph
 
     void spin (RealTimeLogger* logger)
     {
-      while (!requestShutdown_ || !logger->empty())
+      boost::int64_t lastRefill = timestamp();
+      int nbRefills = 0;
+      for (;;)
       {
-        // If the logger did not write anything, it means the buffer is empty.
-        // Do a pause
-        if (!logger->spinOnce())
-          boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+        const boost::int64_t now = timestamp();
+        // The rate-limited call sites write to instance ().
+        if (logger == instance_ && now - lastRefill >= REFILL_PERIOD) {
+          RTLogCallsite::refill (1e-9 * static_cast<double> (now - lastRefill));
+          lastRefill = now;
+          if (++nbRefills % REPORT_PERIOD == 0)
+            RTLogCallsite::reportSuppressed (*logger);
+        }
+        if (logger->spin() > 0) continue;
+        if (requestShutdown_) {
+          if (logger->empty()) break;
+          // An entry is still being written.
+          boost::this_thread::yield();
+        } else
+          // Without rate-limited call site, only wake up for entries.
+          logger->waitForEntries (requestShutdown_,
+                                  logger == instance_ && RTLogCallsite::count() > 0
+                                  ? REFILL_PERIOD : 0);
       }
     }
   };
 
   RealTimeLogger* RealTimeLogger::instance_ = NULL;
-  RealTimeLogger::thread* RealTimeLogger::thread_ = NULL;
+
+  void RealTimeLogger::start ()
+  {
+    if (thread_ == NULL) thread_ = new thread (this);
+  }
+
+  void RealTimeLogger::stop ()
+  {
+    if (thread_ == NULL) return;
+    thread_->requestShutdown_ = true;
+    consumerWaiting_ = true;
+    wakeConsumer();
+    thread_->t_.join();
+    delete thread_;
+    thread_ = NULL;
+  }
 
   RealTimeLogger& RealTimeLogger::instance()
   {
     if (instance_ == NULL) {
       instance_ = new RealTimeLogger (1000);
-      thread_ = new thread (instance_);
+      instance_->start();
     }
     return *instance_;
   }
@@ -119,9 +631,8 @@ namespace dynamicgraph
   void RealTimeLogger::destroy ()
   {
     if (instance_ == NULL) return;
-    thread_->requestShutdown_ = true;
-    thread_->t_.join();
+    instance_->stop();
     delete instance_;
-    delete thread_;
+    instance_ = NULL;
   }
 }
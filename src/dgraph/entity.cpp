@@ -24,6 +24,7 @@
 #include <dynamic-graph/pool.h>
 #include <dynamic-graph/debug.h>
 #include <dynamic-graph/command.h>
+#include <dynamic-graph/command-shared.h>
 
 /*! System includes */
 #include <stdlib.h>
@@ -49,7 +50,7 @@ entityDeregistration  ()
 
 Entity::
 Entity( const string& name__ )
-  : name(name__)
+  : name(name__), classCommands(NULL)
 {
   dgDEBUG(15) << "New entity <"<<name__<<">"<<endl;
   if( name.length ()==0 )
@@ -67,10 +68,21 @@ Entity::
 ~Entity  ()
 {
   dgDEBUG(25) << "# In (" << name << " { " << endl;
-  for (std::map<const std::string, Command*>::iterator it =
+  for (CommandMap_t::const_iterator it =
 	 commandMap.begin(); it != commandMap.end(); it++) {
     delete it->second;
   }
+  for (CommandTable::const_iterator it =
+	 boundCommands.begin(); it != boundCommands.end(); it++) {
+    delete it->second;
+  }
+  // Invalidate the handles on the entity if it is still in the pool.
+  // The pool is not recreated if it has already been destroyed.
+  Entity* registered;
+  if (PoolStorage::existInstance ()
+      && PoolStorage::getInstance()->existEntity (name, registered)
+      && registered == this)
+    entityDeregistration ();
   dgDEBUGOUT(25);
 }
 
@@ -83,19 +95,13 @@ signalRegistration( const SignalArray<int>& signals )
   for( unsigned int i=0;i<signals.getSize ();++i )
     {
       SignalBase<int>& sig = signals[i];
-      //const string& signame = sig.getName ();
-      istringstream iss( sig.getName () );
-      const int SIZE = 128;
-      char buffer[SIZE];
-      while( iss.good () )
-	{ iss.getline(buffer,SIZE,':'); }
-      const string& signame( buffer );
-
-      SignalMap::iterator sigkey = signalMap.find(signame);
-      if( sigkey != signalMap.end () ) // key does exist
+      const string& signame = sig.getLocalName ().str ();
+
+      SignalBase<int>** sigkey = signalTable.find(sig.getLocalName ());
+      if( sigkey != NULL ) // key does exist
 	{
 	  dgERRORF( "Key %s already exist in the signalMap.",signame.c_str () );
-	  if( sigkey->second!=&sig )
+	  if( *sigkey!=&sig )
 	    {
 	      throw ExceptionFactory( ExceptionFactory::SIGNAL_CONFLICT,
 					 "Another signal already defined with the same name. ",
@@ -107,6 +113,8 @@ signalRegistration( const SignalArray<int>& signals )
 	  dgDEBUG(10) << "Register signal <"<< signame << "> for entity <"
 		        << getName () << "> ."<<endl;
 	  signalMap[signame] = &sig;
+	  signalTable.insert(sig.getLocalName (), &sig);
+	  concurrentSignals.insert(sig.getLocalName (), &sig);
 	}
     }
 }
@@ -115,8 +123,8 @@ signalRegistration( const SignalArray<int>& signals )
 void Entity::
 signalDeregistration( const std::string& signame )
 {
-  SignalMap::iterator sigkey = signalMap.find(signame);
-  if( sigkey == signalMap.end () ) // key does not exist
+  SignalBase<int>** sigkey = signalTable.find(signame);
+  if( sigkey == NULL ) // key does not exist
     {
       dgERRORF( "Key %s does not exist in the signalMap.",signame.c_str () );
       throw ExceptionFactory( ExceptionFactory::UNREFERED_SIGNAL,
@@ -127,7 +135,15 @@ signalDeregistration( const std::string& signame )
     {
       dgDEBUG(10) << "Deregister signal <"<< signame << "> for entity <"
 		   << getName () << "> ."<<endl;
+      // The handles are invalidated once the signal can no longer be
+      // found, see Reconfiguration::prepare.
+      const SignalBase<int>* signal = *sigkey;
       signalMap.erase(signame);
+      signalTable.erase(signame);
+      concurrentSignals.erase(signame);
+      concurrentSignals.synchronize();
+      if( PoolStorage::existInstance () )
+	PoolStorage::getInstance()->invalidateSignalHandles (*this, *signal);
     }
 }
 
@@ -138,33 +154,33 @@ std::string Entity::getDocString () const
   return docString;
 }
 
-#define __DG_ENTITY_GET_SIGNAL__(ITER_TYPE) \
-  SignalMap::ITER_TYPE sigkey = signalMap.find(signame); \
-  if( sigkey == signalMap.end () ) /* key does NOT exist */ \
+#define __DG_ENTITY_GET_SIGNAL__(PTR_TYPE) \
+  PTR_TYPE sigkey = signalTable.find(signame); \
+  if( sigkey == NULL ) /* key does NOT exist */ \
     { \
       throw ExceptionFactory( ExceptionFactory::UNREFERED_SIGNAL,\
 				 "The requested signal is not registered",\
 				 ": %s",signame.c_str () );\
     }\
-  return *(sigkey ->second) ;
+  return **sigkey ;
 
 
 bool Entity::
 hasSignal( const string & signame ) const
 {
-  return (!(signalMap.find(signame) == signalMap.end ()));
+  return signalTable.find(signame) != NULL;
 }
 
 SignalBase<int>& Entity::
 getSignal( const string & signame )
 {
-  __DG_ENTITY_GET_SIGNAL__(iterator);
+  __DG_ENTITY_GET_SIGNAL__(SignalBase<int>**);
 }
 
 const SignalBase<int>& Entity::
 getSignal( const string & signame ) const
 {
-  __DG_ENTITY_GET_SIGNAL__(const_iterator);
+  __DG_ENTITY_GET_SIGNAL__(SignalBase<int>* const*);
 }
 
 
@@ -219,10 +235,13 @@ std::ostream& dynamicgraph::operator<< (std::ostream& os, const Entity& ent )
   return os;
 }
 
-Entity::SignalMap Entity::getSignalMap() const
-{
-  return signalMap;
-}
+void Entity::
+saveState (std::ostream&) const
+{}
+
+void Entity::
+restoreState (std::istream&)
+{}
 
 /* --- PARAMS --------------------------------------------------------------- */
 /* --- PARAMS --------------------------------------------------------------- */
@@ -239,31 +258,59 @@ getCommandList  () const
 void Entity::
 addCommand(const std::string& inName, Command* command)
 {
-  if (commandMap.count(inName) != 0) {
+  if (!commandTable.insert(InternedString (inName), command)) {
     DG_THROW ExceptionFactory(ExceptionFactory::OBJECT_CONFLICT,
 			      "Command " + inName +
 			      " already registered in Entity.");
   }
-  std::pair<const std::string, Command*> item(inName, command);
-  commandMap.insert(item);
+  commandMap[inName] = command;
 }
 
-/// Return the list of command objects
-std::map<const std::string, Command*> Entity::
+/// Return the list of commands.
+Entity::CommandMap_t Entity::
 getNewStyleCommandMap()
 {
-  return commandMap;
+  CommandMap_t res (commandMap);
+  // Commands of the instance override the class commands.
+  for (CommandTable::const_iterator it =
+	 boundCommands.begin(); it != boundCommands.end(); it++) {
+    if (res.count (it->first.str ()) == 0)
+      res[it->first.str ()] = it->second;
+  }
+  return res;
 }
 
 Command* Entity::
 getNewStyleCommand( const std::string& commandName )
 {
-  if (commandMap.count(commandName) != 1)
+  Command* const* command = commandTable.find (commandName);
+  if (command != NULL)
+    return *command;
+  command = boundCommands.find (commandName);
+  if (command == NULL)
     {
       DG_THROW ExceptionFactory(ExceptionFactory::UNREFERED_FUNCTION,
 				"Command <" + commandName +
 				"> is not registered in Entity.");
     }
-  return commandMap[commandName];
+  return *command;
+}
+
+/// Bind the class commands to this instance. They are kept apart from
+/// the commands of the instance so that addCommand can still override
+/// them.
+void Entity::
+setClassCommands (const command::ClassCommands& commands)
+{
+  for (CommandTable::const_iterator it =
+	 boundCommands.begin(); it != boundCommands.end(); it++) {
+    delete it->second;
+  }
+  boundCommands.clear ();
+  classCommands = &commands;
+  const command::ClassCommands::Table& table = commands.commands ();
+  for (command::ClassCommands::Table::const_iterator it = table.begin ();
+       it != table.end (); ++it)
+    boundCommands.insert (it->first, it->second->bind (*this));
 }
 
@@ -14,10 +14,13 @@
 // received a copy of the GNU Lesser General Public License along with
 // dynamic-graph. If not, see <http://www.gnu.org/licenses/>.
 
+#include <dlfcn.h>
+
 #include <boost/foreach.hpp>
 
 #include "dynamic-graph/debug.h"
 #include "dynamic-graph/factory.h"
+#include "dynamic-graph/import-default-paths.h"
 
 using namespace std;
 using namespace dynamicgraph;
@@ -113,6 +116,8 @@ namespace dynamicgraph
 		 << objname << ">" << std::endl;
 
     EntityMap::const_iterator entPtr = entityMap.find (classname);
+    if (entPtr == entityMap.end () && pluginIndex.load (classname))
+      entPtr = entityMap.find (classname);
     if (entPtr == entityMap.end  ())
       {
 	DG_THROW ExceptionFactory
@@ -144,6 +149,37 @@ namespace dynamicgraph
       outList.push_back(entity.first);
   }
 
+  void
+  FactoryStorage::indexPlugins (const std::string& directory)
+  {
+    pluginIndex.scan (directory);
+  }
+
+  void
+  FactoryStorage::indexPlugins ()
+  {
+    pluginIndex.scan (DG_PLUGINDIR);
+  }
+
+  bool
+  FactoryStorage::loadEntityClass (const std::string& classname)
+  {
+    if (existEntity (classname)) return true;
+    return pluginIndex.load (classname) && existEntity (classname);
+  }
+
+  std::string
+  FactoryStorage::getEntityLibrary (const std::string& classname) const
+  {
+    EntityMap::const_iterator it = entityMap.find (classname);
+    Dl_info info;
+    if (it == entityMap.end ()
+	|| dladdr (reinterpret_cast<void*> (it->second), &info) == 0
+	|| info.dli_fname == NULL)
+      return std::string ();
+    return info.dli_fname;
+  }
+
   EntityRegisterer::EntityRegisterer
   (const std::string& entityClassName, FactoryStorage::EntityConstructor_ptr maker)
     : entityName (entityClassName)
@@ -0,0 +1,351 @@
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+// dynamic-graph is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.  You should
+// have received a copy of the GNU Lesser General Public License
+// along with dynamic-graph.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+#include <boost/atomic.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "dynamic-graph/command.h"
+#include "dynamic-graph/entity.h"
+#include "dynamic-graph/exception-factory.h"
+#include "dynamic-graph/factory.h"
+#include "dynamic-graph/graph-builder.h"
+#include "dynamic-graph/pool.h"
+
+namespace dynamicgraph
+{
+  namespace {
+    typedef std::map<std::string, std::size_t> NameIndex;
+    typedef std::pair<SignalBase<int>*, SignalBase<int>*> SignalPair;
+
+    /// Split "entity.signal" at the first dot.
+    bool splitSignalPath (const std::string& path,
+			  std::string& entity, std::string& signal)
+    {
+      const std::string::size_type dot = path.find ('.');
+      if (dot == std::string::npos || dot == 0 || dot + 1 == path.size ())
+	return false;
+      entity = path.substr (0, dot);
+      signal = path.substr (dot + 1);
+      return true;
+    }
+
+    /// Declared entity, or entity of the pool.
+    Entity* findEntity (const std::string& name, const NameIndex& names,
+			const std::vector<Entity*>& created)
+    {
+      NameIndex::const_iterator it = names.find (name);
+      if (it != names.end ()) return created[it->second];
+      Entity* entity = NULL;
+      PoolStorage::getInstance ()->existEntity (name, entity);
+      return entity;
+    }
+
+    /// Restore the plugs of the destination signals, in reverse order.
+    void unplug (const std::vector<SignalPair>& previous)
+    {
+      for (std::size_t i = previous.size (); i > 0; --i)
+	previous[i - 1].first->plug (previous[i - 1].second);
+    }
+
+    void destroy (const std::vector<Entity*>& entities)
+    {
+      for (std::size_t i = 0; i < entities.size (); ++i)
+	delete entities[i];
+    }
+
+    void throwErrors (const std::vector<std::string>& errors)
+    {
+      std::string message = "Cannot build the graph:";
+      for (std::size_t i = 0; i < errors.size (); ++i)
+	if (!errors[i].empty ())
+	  message += "\n  " + errors[i];
+      DG_THROW ExceptionFactory (ExceptionFactory::GENERIC, message);
+    }
+
+    bool hasErrors (const std::vector<std::string>& errors)
+    {
+      for (std::size_t i = 0; i < errors.size (); ++i)
+	if (!errors[i].empty ()) return true;
+      return false;
+    }
+  } // end of anonymous namespace.
+
+  struct GraphBuilder::Worker
+  {
+    Worker (const std::vector<EntityDecl>& decls,
+	    std::vector<Entity*>& entities, std::vector<std::string>& errors,
+	    boost::atomic<std::size_t>& next)
+      : decls (decls), entities (entities), errors (errors), next (next)
+    {}
+
+    void operator() () const
+    {
+      PoolStorage::DeferredRegistration deferred;
+      FactoryStorage* factory = FactoryStorage::getInstance ();
+      for (std::size_t i = next++; i < decls.size (); i = next++)
+	{
+	  try
+	    {
+	      entities[i] = factory->newEntity (decls[i].className,
+						decls[i].name);
+	    }
+	  catch (const ExceptionAbstract& exc)
+	    {
+	      errors[i] = exc.getStringMessage ();
+	    }
+	  catch (const std::exception& exc)
+	    {
+	      errors[i] = std::string ("Entity <") + decls[i].name + ">: "
+		+ exc.what ();
+	    }
+	}
+    }
+
+    const std::vector<EntityDecl>& decls;
+    std::vector<Entity*>& entities;
+    std::vector<std::string>& errors;
+    boost::atomic<std::size_t>& next;
+  };
+
+  GraphBuilder::GraphBuilder (unsigned nbThreads)
+    : nbThreads_ (nbThreads == 0 ? boost::thread::hardware_concurrency ()
+		  : nbThreads)
+  {
+    if (nbThreads_ == 0) nbThreads_ = 1;
+  }
+
+  void GraphBuilder::newEntity (const std::string& className,
+				const std::string& name)
+  {
+    EntityDecl decl;
+    decl.className = className;
+    decl.name = name;
+    entities_.push_back (decl);
+  }
+
+  void GraphBuilder::plug (const std::string& source,
+			   const std::string& destination)
+  {
+    PlugDecl decl;
+    decl.source = source;
+    decl.destination = destination;
+    plugs_.push_back (decl);
+  }
+
+  void GraphBuilder::addDependency (const std::string& signal,
+				    const std::string& dependency)
+  {
+    DependencyDecl decl;
+    decl.signal = signal;
+    decl.dependency = dependency;
+    dependencies_.push_back (decl);
+  }
+
+  void GraphBuilder::runCommand (const std::string& entity,
+				 const std::string& command,
+				 const std::vector<command::Value>& arguments)
+  {
+    CommandDecl decl;
+    decl.entity = entity;
+    decl.command = command;
+    decl.arguments = arguments;
+    commands_.push_back (decl);
+  }
+
+  void GraphBuilder::clear ()
+  {
+    entities_.clear ();
+    plugs_.clear ();
+    dependencies_.clear ();
+    commands_.clear ();
+  }
+
+  void GraphBuilder::construct (std::vector<Entity*>& entities,
+				std::vector<std::string>& errors) const
+  {
+    entities.assign (entities_.size (), NULL);
+    errors.assign (entities_.size (), std::string ());
+    boost::atomic<std::size_t> next (0);
+    Worker worker (entities_, entities, errors, next);
+
+    const std::size_t nbThreads =
+      std::min<std::size_t> (nbThreads_, entities_.size ());
+    if (nbThreads <= 1)
+      {
+	worker ();
+	return;
+      }
+    boost::thread_group threads;
+    for (std::size_t i = 0; i < nbThreads; ++i)
+      threads.create_thread (worker);
+    threads.join_all ();
+  }
+
+  void GraphBuilder::build ()
+  {
+    FactoryStorage* factory = FactoryStorage::getInstance ();
+    PoolStorage* pool = PoolStorage::getInstance ();
+    std::vector<std::string> errors;
+
+    // Check the declarations, loading the plugins of the classes.
+    NameIndex names;
+    for (std::size_t i = 0; i < entities_.size (); ++i)
+      {
+	const EntityDecl& decl = entities_[i];
+	if (decl.name.empty ())
+	  errors.push_back ("Entity of class <" + decl.className
+			    + "> has no name.");
+	else if (!names.insert (std::make_pair (decl.name, i)).second)
+	  errors.push_back ("Entity <" + decl.name + "> declared twice.");
+	else if (pool->existEntity (decl.name))
+	  errors.push_back ("Entity <" + decl.name + "> already exists.");
+	try
+	  {
+	    if (!factory->loadEntityClass (decl.className))
+	      errors.push_back ("Unknown entity class <" + decl.className
+				+ "> (for entity <" + decl.name + ">).");
+	  }
+	catch (const ExceptionAbstract& exc)
+	  {
+	    errors.push_back (exc.getStringMessage ());
+	  }
+      }
+    std::vector<const std::string*> paths;
+    for (std::size_t i = 0; i < plugs_.size (); ++i)
+      {
+	paths.push_back (&plugs_[i].source);
+	paths.push_back (&plugs_[i].destination);
+      }
+    for (std::size_t i = 0; i < dependencies_.size (); ++i)
+      {
+	paths.push_back (&dependencies_[i].signal);
+	paths.push_back (&dependencies_[i].dependency);
+      }
+    std::string entity, signal;
+    for (std::size_t i = 0; i < paths.size (); ++i)
+      if (!splitSignalPath (*paths[i], entity, signal))
+	errors.push_back ("Bad signal name <" + *paths[i] + ">.");
+      else if (!names.count (entity) && !pool->existEntity (entity))
+	errors.push_back ("Unknown entity <" + entity
+			  + "> (for signal <" + *paths[i] + ">).");
+    for (std::size_t i = 0; i < commands_.size (); ++i)
+      if (!names.count (commands_[i].entity)
+	  && !pool->existEntity (commands_[i].entity))
+	errors.push_back ("Unknown entity <" + commands_[i].entity
+			  + "> (for command <" + commands_[i].command + ">).");
+    if (!errors.empty ()) throwErrors (errors);
+
+    // Construct the entities outside of the pool.
+    std::vector<Entity*> created;
+    construct (created, errors);
+    if (hasErrors (errors))
+      {
+	destroy (created);
+	throwErrors (errors);
+      }
+    errors.clear ();
+
+    // Resolve the signals and check the command arguments.
+    std::vector<SignalBase<int>*> signals;
+    for (std::size_t i = 0; i < paths.size (); ++i)
+      try
+	{
+	  splitSignalPath (*paths[i], entity, signal);
+	  signals.push_back
+	    (&findEntity (entity, names, created)->getSignal (signal));
+	}
+      catch (const ExceptionAbstract& exc)
+	{
+	  errors.push_back (exc.getStringMessage ());
+	}
+    // The commands of the new entities run before those of the entities
+    // of the pool, which cannot be undone.
+    std::vector<command::Command*> commands (commands_.size ());
+    std::vector<std::size_t> newCommands, poolCommands;
+    for (std::size_t i = 0; i < commands_.size (); ++i)
+      try
+	{
+	  commands[i] = findEntity (commands_[i].entity, names, created)
+	    ->getNewStyleCommand (commands_[i].command);
+	  commands[i]->checkParameterValues (commands_[i].arguments);
+	  if (names.count (commands_[i].entity))
+	    newCommands.push_back (i);
+	  else
+	    poolCommands.push_back (i);
+	}
+      catch (const ExceptionAbstract& exc)
+	{
+	  errors.push_back ("Command <" + commands_[i].entity + "."
+			    + commands_[i].command + ">: "
+			    + exc.getStringMessage ());
+	}
+    if (!errors.empty ())
+      {
+	destroy (created);
+	throwErrors (errors);
+      }
+
+    // Plug, add the dependencies, run the commands of the new entities,
+    // register them and run the other commands. Undo on failure.
+    std::vector<SignalPair> previous, added;
+    try
+      {
+	for (std::size_t i = 0; i < plugs_.size (); ++i)
+	  {
+	    SignalBase<int>* source = signals[2 * i];
+	    SignalBase<int>* destination = signals[2 * i + 1];
+	    SignalBase<int>* plugged = destination->getPluged ();
+	    destination->plug (source);
+	    previous.push_back (SignalPair (destination, plugged));
+	  }
+	std::vector<const SignalBase<int>*> list;
+	for (std::size_t i = plugs_.size (); 2 * i < signals.size (); ++i)
+	  {
+	    SignalBase<int>* sig = signals[2 * i];
+	    SignalBase<int>* dependency = signals[2 * i + 1];
+	    list.clear ();
+	    sig->listDependencies (list);
+	    if (std::find (list.begin (), list.end (), dependency) != list.end ())
+	      continue;
+	    sig->addDependency (*dependency);
+	    added.push_back (SignalPair (sig, dependency));
+	  }
+	for (std::size_t i = 0; i < newCommands.size (); ++i)
+	  {
+	    const std::size_t j = newCommands[i];
+	    commands[j]->execute (commands_[j].arguments);
+	  }
+	pool->registerEntities (created);
+	for (std::size_t i = 0; i < poolCommands.size (); ++i)
+	  {
+	    const std::size_t j = poolCommands[i];
+	    commands[j]->execute (commands_[j].arguments);
+	  }
+      }
+    catch (...)
+      {
+	for (std::size_t i = added.size (); i > 0; --i)
+	  added[i - 1].first->removeDependency (*added[i - 1].second);
+	unplug (previous);
+	// The entities deregister themselves.
+	destroy (created);
+	throw;
+      }
+    clear ();
+  }
+} // end of namespace dynamicgraph
@@ -0,0 +1,102 @@
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+//
+// dynamic-graph is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// dynamic-graph. If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstring>
+#include <ostream>
+#include <map>
+
+#include <boost/thread/mutex.hpp>
+
+#include <dynamic-graph/interned-string.h>
+
+namespace dynamicgraph
+{
+  namespace
+  {
+    /// Table of the interned strings and their hash. The entries are
+    /// allocated once and never moved nor freed. The table is split in
+    /// shards, chosen by hash, each with its own lock, so that threads
+    /// building signals concurrently seldom wait for each other. Strings
+    /// are looked up by hash then content, hence without building a
+    /// std::string.
+    struct StringTable
+    {
+      typedef InternedString::Entry Entry;
+      typedef std::multimap<std::size_t, const Entry*> Entries;
+
+      struct Shard
+      {
+	boost::mutex mutex;
+	Entries entries;
+      };
+
+      static const std::size_t NB_SHARDS = 32;
+
+      StringTable ()
+	: empty (new Entry (std::string (), InternedString::hash (0, 0)))
+      {}
+
+      const Entry* intern (const char* first, const char* last)
+      {
+	if (first == last) return empty;
+	const std::size_t h = InternedString::hash (first, last);
+	const std::size_t length = static_cast<std::size_t> (last - first);
+	Shard& shard = shards[(h >> 16) % NB_SHARDS];
+	boost::mutex::scoped_lock lock (shard.mutex);
+	std::pair<Entries::iterator, Entries::iterator> range =
+	  shard.entries.equal_range (h);
+	for (Entries::iterator it = range.first; it != range.second; ++it)
+	  {
+	    const std::string& str = it->second->first;
+	    if (str.size () == length
+		&& std::memcmp (str.data (), first, length) == 0)
+	      return it->second;
+	  }
+	const Entry* entry = new Entry (std::string (first, last), h);
+	shard.entries.insert (range.second, Entries::value_type (h, entry));
+	return entry;
+      }
+
+      Shard shards[NB_SHARDS];
+      const Entry* empty;
+    };
+
+    /// Built on first use, since signals may be constructed during the
+    /// static initialization of other libraries. Never destroyed, so
+    /// that interned strings outlive static objects.
+    StringTable& table ()
+    {
+      static StringTable* table = new StringTable;
+      return *table;
+    }
+  } // end of anonymous namespace.
+
+  InternedString::InternedString ()
+    : entry_ (table ().empty)
+  {}
+
+  InternedString::InternedString (const std::string& str)
+    : entry_ (table ().intern (str.data (), str.data () + str.size ()))
+  {}
+
+  InternedString::InternedString (const char* first, const char* last)
+    : entry_ (table ().intern (first, last))
+  {}
+
+  std::ostream& operator<< (std::ostream& os, const InternedString& str)
+  {
+    return os << str.str ();
+  }
+} // end of namespace dynamicgraph
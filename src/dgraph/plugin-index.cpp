@@ -0,0 +1,383 @@
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+// dynamic-graph is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.  You should
+// have received a copy of the GNU Lesser General Public License
+// along with dynamic-graph.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <ostream>
+#include <sstream>
+
+#include <dirent.h>
+#include <dlfcn.h>
+#include <sys/stat.h>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "dynamic-graph/debug.h"
+#include "dynamic-graph/exception-factory.h"
+#include "dynamic-graph/factory.h"
+#include "dynamic-graph/import-default-paths.h"
+#include "dynamic-graph/plugin-index.h"
+
+namespace dynamicgraph
+{
+  const std::string PluginIndex::INDEX_FILE = "dynamic-graph-plugins.index";
+
+  namespace {
+    const std::string LIBRARY_SUFFIX = DG_SHARED_LIBRARY_SUFFIX;
+    const std::string INDEX_HEADER = "# dynamic-graph plugin index";
+    /// Prefix of the lines of the plugins which failed to load.
+    const char FAILED_MARK = '!';
+
+    typedef std::map<std::string, PluginIndex::Plugin> Plugins;
+
+    double elapsed (const boost::posix_time::ptime& start)
+    {
+      return static_cast<double>
+	((boost::posix_time::microsec_clock::local_time () - start)
+	 .total_microseconds ()) * 1e-6;
+    }
+
+    bool endsWith (const std::string& str, const std::string& suffix)
+    {
+      return str.size () > suffix.size ()
+	&& str.compare (str.size () - suffix.size (), suffix.size (),
+			suffix) == 0;
+    }
+
+    std::string baseName (const std::string& path)
+    {
+      const std::string::size_type slash = path.rfind ('/');
+      return slash == std::string::npos ? path : path.substr (slash + 1);
+    }
+
+    /// Index file of directory in the cache of the user, used when the
+    /// directory is not writable. Empty if there is no cache directory.
+    std::string cachedIndexPath (const std::string& directory)
+    {
+      std::string cache;
+      if (const char* xdg = std::getenv ("XDG_CACHE_HOME"))
+	cache = xdg;
+      else if (const char* home = std::getenv ("HOME"))
+	cache = std::string (home) + "/.cache";
+      if (cache.empty ()) return std::string ();
+
+      // One file per directory, named after its absolute path.
+      char* absolute = realpath (directory.c_str (), NULL);
+      const std::string path = absolute ? absolute : directory;
+      std::free (absolute);
+      std::string name;
+      for (std::size_t i = 0; i < path.size (); ++i)
+	switch (path[i])
+	  {
+	  case '/': name += "%2F"; break;
+	  case '%': name += "%25"; break;
+	  default: name += path[i];
+	  }
+      return cache + "/dynamic-graph/" + name + ".index";
+    }
+
+    /// Read an index file of directory. Plugins are keyed by file name.
+    void readIndex (const std::string& path, const std::string& directory,
+		    Plugins& plugins)
+    {
+      std::ifstream file (path.c_str ());
+      std::string line;
+      if (!std::getline (file, line) || line != INDEX_HEADER) return;
+      while (std::getline (file, line))
+	{
+	  const bool failed = !line.empty () && line[0] == FAILED_MARK;
+	  std::istringstream is (failed ? line.substr (1) : line);
+	  std::string name;
+	  PluginIndex::Plugin plugin;
+	  if (!(is >> name >> plugin.size >> plugin.mtime)) continue;
+	  plugin.path = directory + "/" + name;
+	  if (failed)
+	    {
+	      std::getline (is >> std::ws, plugin.error);
+	      if (plugin.error.empty ()) plugin.error = "unknown error";
+	    }
+	  else
+	    std::copy (std::istream_iterator<std::string> (is),
+		       std::istream_iterator<std::string> (),
+		       std::back_inserter (plugin.classes));
+	  plugins[name] = plugin;
+	}
+    }
+
+    bool writeIndexFile (const std::string& path, const Plugins& plugins)
+    {
+      std::ofstream file (path.c_str ());
+      if (!file) return false;
+      file << INDEX_HEADER << '\n';
+      for (Plugins::const_iterator it = plugins.begin ();
+	   it != plugins.end (); ++it)
+	{
+	  const PluginIndex::Plugin& plugin = it->second;
+	  if (!plugin.error.empty ())
+	    {
+	      // Errors are single line, see dlerror.
+	      file << FAILED_MARK << it->first << ' ' << plugin.size << ' '
+		   << plugin.mtime << ' ' << plugin.error << '\n';
+	      continue;
+	    }
+	  file << it->first << ' ' << plugin.size << ' ' << plugin.mtime;
+	  for (std::size_t i = 0; i < plugin.classes.size (); ++i)
+	    file << ' ' << plugin.classes[i];
+	  file << '\n';
+	}
+      file.close ();
+      return !file.fail ();
+    }
+
+    /// Write the index file of directory, or the index in the cache of
+    /// the user if the directory is not writable.
+    void writeIndex (const std::string& directory, const Plugins& plugins)
+    {
+      const std::string path = directory + "/" + PluginIndex::INDEX_FILE;
+      const std::string cached = cachedIndexPath (directory);
+      if (writeIndexFile (path, plugins))
+	{
+	  // The cached index is older: drop it.
+	  if (!cached.empty ()) std::remove (cached.c_str ());
+	  return;
+	}
+      dgDEBUG (15) << "Cannot write the plugin index " << path << std::endl;
+      if (cached.empty ()) return;
+      // Create the cache directories, which may already exist.
+      for (std::string::size_type slash = cached.find ('/', 1);
+	   slash != std::string::npos; slash = cached.find ('/', slash + 1))
+	if (mkdir (cached.substr (0, slash).c_str (), 0755) != 0
+	    && errno != EEXIST)
+	  break;
+      if (!writeIndexFile (cached, plugins))
+	{
+	  dgDEBUG (15) << "Cannot write the plugin index " << cached
+		       << std::endl;
+	}
+    }
+  } // end of anonymous namespace.
+
+  PluginIndex::Plugin::Plugin ()
+    : size (0), mtime (0), loaded (false), loadTime (0.)
+  {}
+
+  PluginIndex::PluginIndex ()
+  {}
+
+  void PluginIndex::scan (const std::string& directory)
+  {
+    const boost::posix_time::ptime start =
+      boost::posix_time::microsec_clock::local_time ();
+
+    // The cached index, if any, is more recent than the index of the
+    // directory, see writeIndex.
+    Plugins indexed;
+    readIndex (directory + "/" + INDEX_FILE, directory, indexed);
+    const std::string cached = cachedIndexPath (directory);
+    if (!cached.empty ()) readIndex (cached, directory, indexed);
+
+    DIR* dir = opendir (directory.c_str ());
+    if (dir == NULL)
+      {
+	DG_THROW ExceptionFactory (ExceptionFactory::READ_FILE,
+				   "Cannot read plugin directory ", "%s",
+				   directory.c_str ());
+      }
+    std::vector<std::string> names;
+    for (struct dirent* entry = readdir (dir); entry != NULL;
+	 entry = readdir (dir))
+      if (endsWith (entry->d_name, LIBRARY_SUFFIX))
+	names.push_back (entry->d_name);
+    closedir (dir);
+    std::sort (names.begin (), names.end ());
+
+    Plugins current;
+    bool changed = indexed.size () != names.size ();
+    for (std::size_t i = 0; i < names.size (); ++i)
+      {
+	Plugin plugin;
+	plugin.path = directory + "/" + names[i];
+	struct stat st;
+	if (stat (plugin.path.c_str (), &st) != 0) continue;
+	plugin.size = static_cast<boost::uint64_t> (st.st_size);
+	plugin.mtime = static_cast<boost::int64_t> (st.st_mtime);
+
+	Plugins::const_iterator it = indexed.find (names[i]);
+	std::map<std::string, std::vector<std::string> >::iterator
+	  dependency = dependencies_.find (names[i]);
+	if (it != indexed.end () && it->second.size == plugin.size
+	    && it->second.mtime == plugin.mtime)
+	  {
+	    // Up to date, including the plugins which failed to load:
+	    // they are not tried again until they change.
+	    plugin.classes = it->second.classes;
+	    plugin.error = it->second.error;
+	  }
+	else if (dependency != dependencies_.end ())
+	  {
+	    // Already loaded as a dependency of another plugin, which
+	    // recorded the classes it registers.
+	    changed = true;
+	    plugin.classes = dependency->second;
+	    plugin.loaded = true;
+	  }
+	else
+	  {
+	    // The classes registered by a library already loaded are
+	    // unknown: leave it out of the index.
+	    void* handle = dlopen (plugin.path.c_str (), RTLD_NOW | RTLD_NOLOAD);
+	    if (handle != NULL)
+	      {
+		dlclose (handle);
+		continue;
+	      }
+	    changed = true;
+	    loadPlugin (plugin);
+	  }
+	current[names[i]] = plugin;
+	addPlugin (plugin);
+      }
+    if (changed) writeIndex (directory, current);
+
+    scans_.push_back (std::make_pair (directory, elapsed (start)));
+  }
+
+  const PluginIndex::Plugin*
+  PluginIndex::find (const std::string& className) const
+  {
+    std::map<std::string, std::size_t>::const_iterator it =
+      classes_.find (className);
+    return it == classes_.end () ? NULL : &plugins_[it->second];
+  }
+
+  bool PluginIndex::load (const std::string& className)
+  {
+    std::map<std::string, std::size_t>::const_iterator it =
+      classes_.find (className);
+    if (it == classes_.end ()) return false;
+    Plugin& plugin = plugins_[it->second];
+    if (plugin.loaded) return true;
+
+    loadPlugin (plugin);
+    if (!plugin.loaded)
+      {
+	DG_THROW ExceptionFactory (ExceptionFactory::DYNAMIC_LOADING,
+				   "Failed to load plugin. ",
+				   "(while loading %s for class <%s>: %s).",
+				   plugin.path.c_str (), className.c_str (),
+				   plugin.error.c_str ());
+      }
+    return true;
+  }
+
+  void PluginIndex::report (std::ostream& os) const
+  {
+    double total = 0.;
+    for (std::size_t i = 0; i < scans_.size (); ++i)
+      {
+	os << "Scanned " << scans_[i].first << " in "
+	   << scans_[i].second * 1e3 << " ms." << std::endl;
+	total += scans_[i].second;
+      }
+    for (std::size_t i = 0; i < plugins_.size (); ++i)
+      {
+	const Plugin& plugin = plugins_[i];
+	os << "  " << plugin.path << ": " << plugin.classes.size ()
+	   << (plugin.classes.size () == 1 ? " class, " : " classes, ");
+	if (!plugin.error.empty ())
+	  os << "failed to load (" << plugin.error << ")";
+	else if (plugin.loaded)
+	  os << "loaded in " << plugin.loadTime * 1e3 << " ms";
+	else
+	  os << "not loaded";
+	os << std::endl;
+      }
+  }
+
+  void PluginIndex::loadPlugin (Plugin& plugin)
+  {
+    FactoryStorage* factory = FactoryStorage::getInstance ();
+    std::vector<std::string> before, after;
+    factory->listEntities (before);
+
+    dgDEBUG (15) << "Loading plugin " << plugin.path << std::endl;
+    const boost::posix_time::ptime start =
+      boost::posix_time::microsec_clock::local_time ();
+    void* handle = dlopen (plugin.path.c_str (), RTLD_NOW | RTLD_GLOBAL);
+    plugin.loadTime = elapsed (start);
+    if (handle == NULL)
+      {
+	const char* error = dlerror ();
+	plugin.error = error ? error : "unknown error";
+	return;
+      }
+    plugin.loaded = true;
+    plugin.error.clear ();
+
+    // The library is never unloaded: its entity classes stay registered.
+    factory->listEntities (after);
+    std::sort (before.begin (), before.end ());
+    std::sort (after.begin (), after.end ());
+    std::vector<std::string> added;
+    std::set_difference (after.begin (), after.end (),
+			 before.begin (), before.end (),
+			 std::back_inserter (added));
+
+    // Libraries loaded along with this one, such as a plugin it links
+    // to, register their classes too: attribute each class to the
+    // library defining its constructor.
+    const std::string name = baseName (plugin.path);
+    plugin.classes.clear ();
+    for (std::size_t i = 0; i < added.size (); ++i)
+      {
+	const std::string library =
+	  baseName (factory->getEntityLibrary (added[i]));
+	if (library.empty () || library == name)
+	  plugin.classes.push_back (added[i]);
+	else
+	  {
+	    dependencies_[library].push_back (added[i]);
+	    for (std::size_t j = 0; j < plugins_.size (); ++j)
+	      if (baseName (plugins_[j].path) == library)
+		plugins_[j].loaded = true;
+	  }
+      }
+  }
+
+  void PluginIndex::addPlugin (const Plugin& plugin)
+  {
+    std::size_t index = plugins_.size ();
+    for (std::size_t i = 0; i < plugins_.size (); ++i)
+      if (plugins_[i].path == plugin.path) index = i;
+    if (index == plugins_.size ())
+      plugins_.push_back (plugin);
+    else
+      {
+	// Keep the loading state of a library scanned again.
+	const bool loaded = plugins_[index].loaded;
+	const double loadTime = plugins_[index].loadTime;
+	plugins_[index] = plugin;
+	if (loaded)
+	  {
+	    plugins_[index].loaded = true;
+	    plugins_[index].loadTime = loadTime;
+	  }
+      }
+    for (std::size_t i = 0; i < plugin.classes.size (); ++i)
+      classes_[plugin.classes[i]] = index;
+  }
+} // end of namespace dynamicgraph
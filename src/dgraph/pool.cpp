@@ -23,13 +23,29 @@
 /* --------------------------------------------------------------------- */
 
 /* --- DYNAMIC-GRAPH --- */
+#include <algorithm>
+#include <fstream>
 #include <list>
+#include <set>
 #include <typeinfo>
 #include <sstream>
+#include <streambuf>
 #include <string>
+#include <dlfcn.h>
+#include <sys/stat.h>
+
+#include <boost/cstdint.hpp>
+#include <boost/thread/tss.hpp>
 #include "dynamic-graph/pool.h"
+#include "dynamic-graph/command.h"
 #include "dynamic-graph/debug.h"
 #include "dynamic-graph/entity.h"
+#include "dynamic-graph/exception-signal.h"
+#include "dynamic-graph/factory.h"
+#include "dynamic-graph/graph-builder.h"
+#include "dynamic-graph/linear-algebra.h"
+#include "dynamic-graph/reconfiguration.h"
+#include "dynamic-graph/value.h"
 
 using namespace dynamicgraph;
 
@@ -58,12 +74,14 @@ PoolStorage::
 {
   dgDEBUGIN(15);
 
-  for( Entities::iterator iter=entityMap.begin (); iter!=entityMap.end ();
-       iter++)
+  // Entities deregister themselves when deleted.
+  while( !entityMap.empty () )
     {
+      Entities::iterator iter = entityMap.begin ();
       dgDEBUG(15) << "Delete \""
 		   << (iter->first) <<"\""<<std::endl;
       Entity* entity = iter->second;
+      deregisterEntity( iter );
       delete (entity);
     }
   instance_ = 0;
@@ -73,9 +91,38 @@ PoolStorage::
 
 
 /* --------------------------------------------------------------------- */
+/* The innermost deferred registration of each thread. It is not owned by
+ * the thread specific pointer. */
+static void
+keepDeferredRegistration( PoolStorage::DeferredRegistration* )
+{}
+
+static boost::thread_specific_ptr<PoolStorage::DeferredRegistration>
+deferredRegistration( &keepDeferredRegistration );
+
+PoolStorage::DeferredRegistration::
+DeferredRegistration ()
+  : previous_( deferredRegistration.get () )
+{
+  deferredRegistration.reset( this );
+}
+
+PoolStorage::DeferredRegistration::
+~DeferredRegistration ()
+{
+  deferredRegistration.reset( previous_ );
+}
+
 void PoolStorage::
 registerEntity( const std::string& entname,Entity* ent )
 {
+  DeferredRegistration* deferred = deferredRegistration.get ();
+  if( deferred!=NULL )
+    {
+      deferred->entities_.push_back( ent );
+      return;
+    }
+
   Entities::iterator entkey = entityMap.find(entname);
   if( entkey != entityMap.end () ) // key does exist
     {
@@ -88,9 +135,43 @@ registerEntity( const std::string& entname,Entity* ent )
       dgDEBUG(10) << "Register entity <"<< entname
 		   << "> in the pool." <<std::endl;
       entityMap[entname] = ent;
+      concurrentEntities_.insert( InternedString( entname ),ent );
+
+      boost::uint32_t index;
+      if( freeEntitySlots_.empty () )
+	{
+	  index = static_cast<boost::uint32_t> (entitySlots_.size ());
+	  entitySlots_.push_back( EntitySlot () );
+	  entitySlots_.back ().generation = 1;
+	}
+      else
+	{
+	  index = freeEntitySlots_.back ();
+	  freeEntitySlots_.pop_back ();
+	}
+      entitySlots_[index].entity = ent;
+      entitySlotIndex_[entname] = index;
     }
 }
 
+void PoolStorage::
+registerEntities( const std::vector<Entity*>& entities )
+{
+  std::set<std::string> names;
+  for( std::size_t i=0;i<entities.size ();++i )
+    {
+      const std::string& entname = entities[i]->getName ();
+      if( entityMap.count( entname ) || !names.insert( entname ).second )
+	{
+	  DG_THROW ExceptionFactory( ExceptionFactory::OBJECT_CONFLICT,
+				     "Another entity already defined with the same name. ",
+				     "Entity name is <%s>.",entname.c_str () );
+	}
+    }
+  for( std::size_t i=0;i<entities.size ();++i )
+    registerEntity( entities[i]->getName (),entities[i] );
+}
+
 void PoolStorage::
 deregisterEntity( const std::string& entname )
 {
@@ -112,7 +193,211 @@ deregisterEntity( const std::string& entname )
 void PoolStorage::
 deregisterEntity( const Entities::iterator& entity )
 {
+  releaseEntitySlot( entity->first );
+  concurrentEntities_.erase( entity->first );
   entityMap.erase( entity );
+  // Counted once the entity can no longer be found, see
+  // Reconfiguration::prepare.
+  ++removals_;
+}
+
+void PoolStorage::
+deleteEntity( const std::string& name )
+{
+  Entity& entity = getEntity( name );
+  deregisterEntity( name );
+  concurrentEntities_.synchronize ();
+  entity.releaseSignalSnapshots ();
+  delete &entity;
+}
+
+void PoolStorage::
+synchronizeReaders ()
+{
+  concurrentEntities_.synchronize ();
+}
+
+/* --------------------------------------------------------------------- */
+bool PoolStorage::
+stageReconfiguration( Reconfiguration& reconfiguration )
+{
+  if( reconfiguration.state ()==Reconfiguration::RECORDING )
+    reconfiguration.prepare ();
+  if( reconfiguration.state ()!=Reconfiguration::PREPARED )
+    {
+      DG_THROW ExceptionFactory( ExceptionFactory::GENERIC,
+				 "The reconfiguration is not prepared." );
+    }
+  reconfiguration.state_ = Reconfiguration::STAGED;
+  Reconfiguration* expected = NULL;
+  if( stagedReconfiguration_.compare_exchange_strong( expected,
+						      &reconfiguration ) )
+    return true;
+  reconfiguration.state_ = Reconfiguration::PREPARED;
+  return false;
+}
+
+bool PoolStorage::
+applyStagedReconfiguration ()
+{
+  if( stagedReconfiguration_.load( boost::memory_order_relaxed )==NULL )
+    return false;
+  Reconfiguration* reconfiguration = stagedReconfiguration_.exchange( NULL );
+  return reconfiguration!=NULL && reconfiguration->apply ();
+}
+
+/* --------------------------------------------------------------------- */
+/* A slot gets a new generation when released, which invalidates the
+ * handles on it. Generation 0 is kept for default handles. */
+static void
+nextGeneration( boost::uint32_t& generation )
+{
+  if( ++generation==0 ) generation = 1;
+}
+
+void PoolStorage::
+releaseEntitySlot( const std::string& entname )
+{
+  std::map<std::string, boost::uint32_t>::iterator it =
+    entitySlotIndex_.find( entname );
+  if( it==entitySlotIndex_.end () ) return;
+  EntitySlot& slot = entitySlots_[it->second];
+  for( std::size_t i=0;i<slot.signals.size ();++i )
+    releaseSignalSlot( slot.signals[i] );
+  slot.signals.clear ();
+  slot.entity = NULL;
+  nextGeneration( slot.generation );
+  freeEntitySlots_.push_back( it->second );
+  entitySlotIndex_.erase( it );
+}
+
+void PoolStorage::
+releaseSignalSlot( boost::uint32_t index )
+{
+  signalSlots_[index].signal = NULL;
+  nextGeneration( signalSlots_[index].generation );
+  freeSignalSlots_.push_back( index );
+}
+
+EntityHandle PoolStorage::
+getEntityHandle( const std::string& name )
+{
+  std::map<std::string, boost::uint32_t>::const_iterator it =
+    entitySlotIndex_.find( name );
+  if( it==entitySlotIndex_.end () )
+    {
+      DG_THROW ExceptionFactory( ExceptionFactory::UNREFERED_OBJECT,
+				 "Unknown entity."," (while calling <%s>)",
+				 name.c_str () );
+    }
+  EntityHandle handle;
+  handle.index = it->second;
+  handle.generation = entitySlots_[it->second].generation;
+  return handle;
+}
+
+bool PoolStorage::
+isValid( const EntityHandle& handle ) const
+{
+  return handle.index<entitySlots_.size ()
+    && entitySlots_[handle.index].generation==handle.generation
+    && entitySlots_[handle.index].entity!=NULL;
+}
+
+Entity& PoolStorage::
+getEntity( const EntityHandle& handle ) const
+{
+  if(! isValid( handle ) )
+    {
+      DG_THROW ExceptionFactory( ExceptionFactory::UNREFERED_OBJECT,
+				 "Invalid entity handle."," (slot %d)",
+				 static_cast<int> (handle.index) );
+    }
+  return *entitySlots_[handle.index].entity;
+}
+
+SignalHandle PoolStorage::
+getSignalHandle( const EntityHandle& entity,const std::string& signame )
+{
+  SignalBase<int>& sig = getEntity( entity ).getSignal( signame );
+  EntitySlot& entitySlot = entitySlots_[entity.index];
+
+  // Share the slot if the signal has already been resolved.
+  SignalHandle handle;
+  for( std::size_t i=0;i<entitySlot.signals.size ();++i )
+    {
+      const SignalSlot& slot = signalSlots_[entitySlot.signals[i]];
+      if( slot.signal==&sig )
+	{
+	  handle.index = entitySlot.signals[i];
+	  handle.generation = slot.generation;
+	  return handle;
+	}
+    }
+
+  if( freeSignalSlots_.empty () )
+    {
+      handle.index = static_cast<boost::uint32_t> (signalSlots_.size ());
+      signalSlots_.push_back( SignalSlot () );
+      signalSlots_.back ().generation = 1;
+    }
+  else
+    {
+      handle.index = freeSignalSlots_.back ();
+      freeSignalSlots_.pop_back ();
+    }
+  signalSlots_[handle.index].signal = &sig;
+  handle.generation = signalSlots_[handle.index].generation;
+  entitySlot.signals.push_back( handle.index );
+  return handle;
+}
+
+SignalHandle PoolStorage::
+getSignalHandle( const std::string& sigpath )
+{
+  const std::string::size_type dot = sigpath.find( '.' );
+  if( dot==std::string::npos )
+    { DG_THROW ExceptionFactory( ExceptionFactory::UNREFERED_SIGNAL,
+				 "Parse error in signal name" ); }
+  return getSignalHandle( getEntityHandle( sigpath.substr( 0,dot ) ),
+			  sigpath.substr( dot+1 ) );
+}
+
+bool PoolStorage::
+isValid( const SignalHandle& handle ) const
+{
+  return handle.index<signalSlots_.size ()
+    && signalSlots_[handle.index].generation==handle.generation
+    && signalSlots_[handle.index].signal!=NULL;
+}
+
+SignalBase<int>& PoolStorage::
+getSignal( const SignalHandle& handle ) const
+{
+  if(! isValid( handle ) )
+    {
+      DG_THROW ExceptionFactory( ExceptionFactory::UNREFERED_SIGNAL,
+				 "Invalid signal handle."," (slot %d)",
+				 static_cast<int> (handle.index) );
+    }
+  return *signalSlots_[handle.index].signal;
+}
+
+void PoolStorage::
+invalidateSignalHandles( const Entity& entity,const SignalBase<int>& signal )
+{
+  ++removals_;
+  std::map<std::string, boost::uint32_t>::const_iterator it =
+    entitySlotIndex_.find( entity.getName () );
+  if( it==entitySlotIndex_.end () ) return;
+  std::vector<boost::uint32_t>& signals = entitySlots_[it->second].signals;
+  for( std::size_t i=0;i<signals.size ();++i )
+    if( signalSlots_[signals[i]].signal==&signal )
+      {
+	releaseSignalSlot( signals[i] );
+	signals.erase( signals.begin ()+i );
+	return;
+      }
 }
 
 Entity& PoolStorage::
@@ -152,6 +437,25 @@ existEntity (const std::string& name, Entity*& ptr)
     }
 }
 
+void PoolStorage::
+executeCommands( std::vector<CommandCall>& calls,
+		 std::vector<command::Value>& results )
+{
+  std::vector<command::Command*> commands( calls.size () );
+  for( std::size_t i=0;i<calls.size ();++i )
+    {
+      commands[i] =
+	getEntity( calls[i].entity ).getNewStyleCommand( calls[i].command );
+      commands[i]->checkParameterValues( calls[i].arguments );
+    }
+  results.resize( calls.size () );
+  for( std::size_t i=0;i<calls.size ();++i )
+    {
+      command::Value result( commands[i]->execute( calls[i].arguments ) );
+      results[i].swap( result );
+    }
+}
+
 
 void PoolStorage::
 clearPlugin( const std::string& name )
@@ -247,6 +551,641 @@ writeCompletionList(std::ostream& os)
 
 }
 
+/* --- BULK SIGNAL ACCESS ---------------------------------------------- */
+
+namespace
+{
+  /* Output stream buffer appending to a string, so that the buffer of
+   * readSignals keeps its capacity. */
+  class AppendBuffer : public std::streambuf
+  {
+  public:
+    explicit AppendBuffer( std::string& str ) : str_( str ) {}
+
+  protected:
+    virtual int_type overflow( int_type c )
+    {
+      if(! traits_type::eq_int_type( c,traits_type::eof () ) )
+	str_.push_back( traits_type::to_char_type( c ) );
+      return traits_type::not_eof( c );
+    }
+    virtual std::streamsize xsputn( const char* s,std::streamsize n )
+    {
+      str_.append( s,static_cast<std::size_t> (n) );
+      return n;
+    }
+
+  private:
+    std::string& str_;
+  };
+
+  /* Input stream buffer reading a range of a string without copy. */
+  class RangeBuffer : public std::streambuf
+  {
+  public:
+    RangeBuffer( const char* begin,std::size_t size )
+    {
+      char* b = const_cast<char*> (begin);
+      setg( b,b,b+size );
+    }
+
+    /* Whether the range has been read entirely. */
+    bool consumed () const { return gptr ()==egptr (); }
+  };
+} // end of anonymous namespace.
+
+void PoolStorage::
+readSignals( const std::vector<SignalHandle>& signals,
+	     std::string& buffer,std::vector<PackedSignal>& layout ) const
+{
+  /* Check the handles first. Resolving them again is cheaper than
+   * allocating an array of signals. */
+  for( std::size_t i=0;i<signals.size ();++i )
+    getSignal( signals[i] );
+
+  buffer.clear ();
+  layout.resize( signals.size () );
+  AppendBuffer sbuf( buffer );
+  std::ostream os( &sbuf );
+  for( std::size_t i=0;i<signals.size ();++i )
+    {
+      const SignalBase<int>& sig = getSignal( signals[i] );
+      layout[i].offset = buffer.size ();
+      layout[i].time = sig.getTime ();
+      const SignalCaster::Entry* entry = sig.getCastEntry ();
+      layout[i].type =
+	entry==NULL ? 0 : static_cast<boost::uint32_t> (entry->id ());
+      sig.serialize( os );
+      layout[i].size = buffer.size ()-layout[i].offset;
+    }
+}
+
+void PoolStorage::
+writeSignals( const std::vector<SignalHandle>& signals,
+	      const std::string& buffer,
+	      const std::vector<PackedSignal>& layout )
+{
+  if( layout.size ()!=signals.size () )
+    { DG_THROW ExceptionFactory( ExceptionFactory::GENERIC,
+				 "Layout does not fit the signals ",
+				 "(%d values for %d signals).",
+				 static_cast<int> (layout.size ()),
+				 static_cast<int> (signals.size ()) ); }
+  for( std::size_t i=0;i<signals.size ();++i )
+    {
+      const SignalBase<int>& sig = getSignal( signals[i] );
+      if( layout[i].offset>buffer.size ()
+	  || layout[i].size>buffer.size ()-layout[i].offset )
+	{ DG_THROW ExceptionFactory( ExceptionFactory::GENERIC,
+				     "Layout does not fit the buffer ",
+				     "(while writing %s).",
+				     sig.getName ().c_str () ); }
+    }
+
+  /* Read all the values before setting any signal. */
+  for( std::size_t i=0;i<signals.size ();++i )
+    {
+      SignalBase<int>& sig = getSignal( signals[i] );
+      RangeBuffer sbuf( buffer.data ()+layout[i].offset,
+			static_cast<std::size_t> (layout[i].size) );
+      std::istream is( &sbuf );
+      sig.deserializePending( is );
+      if(! sbuf.consumed () )
+	{ DG_THROW ExceptionSignal( ExceptionSignal::GENERIC,
+				    "Value does not fit the signal ",
+				    "(while writing %s).",
+				    sig.getName ().c_str () ); }
+    }
+  for( std::size_t i=0;i<signals.size ();++i )
+    getSignal( signals[i] ).commitPending ();
+}
+
+/* --- CHECKPOINT ------------------------------------------------------ */
+
+/* A checkpoint is made of the header, the number of entities, then for
+ * each entity its name, its state block, the number of signals and for
+ * each signal its name and its state block. Blocks and strings are
+ * prefixed by their size, so that the reader checks that each state is
+ * consumed entirely. */
+static const char CHECKPOINT_HEADER[8] = { 'D','G','C','K','P','T','0','1' };
+
+static void
+writeSize( std::ostream& os,boost::uint64_t size )
+{
+  os.write( reinterpret_cast<const char*> (&size),sizeof(size) );
+}
+
+static void
+writeBlock( std::ostream& os,const std::string& block )
+{
+  writeSize( os,block.size () );
+  os.write( block.data (),static_cast<std::streamsize> (block.size ()) );
+}
+
+static boost::uint64_t
+readSize( std::istream& is,const std::string& aFileName )
+{
+  boost::uint64_t size;
+  is.read( reinterpret_cast<char*> (&size),sizeof(size) );
+  if(! is )
+    { DG_THROW ExceptionFactory( ExceptionFactory::READ_FILE,
+				 "Truncated file ",
+				 "(%s).",aFileName.c_str () ); }
+  return size;
+}
+
+static void
+readBlock( std::istream& is,std::string& block,
+	   const std::string& aFileName )
+{
+  block.resize( static_cast<std::size_t> (readSize( is,aFileName )) );
+  if( !block.empty () )
+    is.read( &block[0],static_cast<std::streamsize> (block.size ()) );
+  if(! is )
+    { DG_THROW ExceptionFactory( ExceptionFactory::READ_FILE,
+				 "Truncated file ",
+				 "(%s).",aFileName.c_str () ); }
+}
+
+/* Restore a state block and check it has been consumed entirely. */
+template <typename Object>
+static void
+restoreBlock( Object& object,const std::string& block,
+	      const std::string& name )
+{
+  std::istringstream iss( block );
+  object.restoreState( iss );
+  if( iss.tellg () != static_cast<std::streampos> (block.size ()) )
+    { DG_THROW ExceptionFactory( ExceptionFactory::READ_FILE,
+				 "Checkpoint state does not match the graph ",
+				 "(%s).",name.c_str () ); }
+}
+
+std::vector<std::string> PoolStorage::
+checkpoint( const std::string& aFileName )
+{
+  std::ofstream file( aFileName.c_str (),
+		      std::ofstream::out | std::ofstream::binary );
+  if(! file.good () )
+    { DG_THROW ExceptionFactory( ExceptionFactory::GENERIC,
+				 "Cannot open checkpoint file ",
+				 "(%s).",aFileName.c_str () ); }
+  file.write( CHECKPOINT_HEADER,sizeof(CHECKPOINT_HEADER) );
+  writeSize( file,entityMap.size () );
+
+  std::vector<std::string> incomplete;
+  std::ostringstream state;
+  for( Entities::const_iterator iter=entityMap.begin ();
+       iter!=entityMap.end (); ++iter )
+    {
+      const Entity& ent = *iter->second;
+      writeBlock( file,iter->first );
+      state.str( "" );
+      ent.saveState( state );
+      writeBlock( file,state.str () );
+
+      const Entity::SignalTable& signals = ent.getSignals ();
+      writeSize( file,signals.size () );
+      for( Entity::SignalTable::const_iterator sig=signals.begin ();
+	   sig!=signals.end (); ++sig )
+	{
+	  writeBlock( file,sig->first.str () );
+	  state.str( "" );
+	  sig->second->saveState( state );
+	  writeBlock( file,state.str () );
+	  if(! sig->second->canSaveState () )
+	    incomplete.push_back( iter->first+"."+sig->first.str () );
+	}
+    }
+  file.close ();
+  if( file.fail () )
+    { DG_THROW ExceptionFactory( ExceptionFactory::GENERIC,
+				 "Cannot write checkpoint file ",
+				 "(%s).",aFileName.c_str () ); }
+  return incomplete;
+}
+
+void PoolStorage::
+restore( const std::string& aFileName )
+{
+  std::ifstream file( aFileName.c_str (),
+		      std::ifstream::in | std::ifstream::binary );
+  char header[sizeof(CHECKPOINT_HEADER)];
+  file.read( header,sizeof(header) );
+  if( !file || !std::equal( header,header+sizeof(header),CHECKPOINT_HEADER ) )
+    { DG_THROW ExceptionFactory( ExceptionFactory::READ_FILE,
+				 "Not a checkpoint file ",
+				 "(%s).",aFileName.c_str () ); }
+
+  std::string name, signame, state;
+  const boost::uint64_t nbEntities = readSize( file,aFileName );
+  for( boost::uint64_t i=0;i<nbEntities;++i )
+    {
+      readBlock( file,name,aFileName );
+      Entity& ent = getEntity( name );
+      readBlock( file,state,aFileName );
+      restoreBlock( ent,state,name );
+
+      const boost::uint64_t nbSignals = readSize( file,aFileName );
+      for( boost::uint64_t j=0;j<nbSignals;++j )
+	{
+	  readBlock( file,signame,aFileName );
+	  readBlock( file,state,aFileName );
+	  restoreBlock( ent.getSignal( signame ),state,
+			name+"."+signame );
+	}
+    }
+}
+
+/* --- TOPOLOGY -------------------------------------------------------- */
+
+/* The topology file is made of the header, then of lists, each prefixed
+ * by its size: the libraries defining the entity classes, the entities,
+ * the plugs, the dependencies and the setter commands. The library of
+ * dynamic-graph itself is recorded with an empty class name. */
+static const char TOPOLOGY_HEADER[8] = { 'D','G','T','O','P','O','0','1' };
+
+using dynamicgraph::command::Value;
+
+template <typename T>
+static void
+writeRaw( std::ostream& os,const T& value )
+{
+  os.write( reinterpret_cast<const char*> (&value),sizeof(value) );
+}
+
+template <typename T>
+static T
+readRaw( std::istream& is,const std::string& aFileName )
+{
+  T value;
+  is.read( reinterpret_cast<char*> (&value),sizeof(value) );
+  if(! is )
+    { DG_THROW ExceptionFactory( ExceptionFactory::READ_FILE,
+				 "Truncated file ",
+				 "(%s).",aFileName.c_str () ); }
+  return value;
+}
+
+static void
+writeDoubles( std::ostream& os,const double* data,std::size_t size )
+{
+  os.write( reinterpret_cast<const char*> (data),
+	    static_cast<std::streamsize> (size*sizeof(double)) );
+}
+
+static void
+readDoubles( std::istream& is,double* data,std::size_t size,
+	     const std::string& aFileName )
+{
+  is.read( reinterpret_cast<char*> (data),
+	   static_cast<std::streamsize> (size*sizeof(double)) );
+  if(! is )
+    { DG_THROW ExceptionFactory( ExceptionFactory::READ_FILE,
+				 "Truncated file ",
+				 "(%s).",aFileName.c_str () ); }
+}
+
+static void
+writeValue( std::ostream& os,const Value& value )
+{
+  writeSize( os,value.type () );
+  switch( value.type () )
+    {
+    case Value::BOOL: writeRaw( os,static_cast<char> (value.boolValue ()) ); break;
+    case Value::UNSIGNED: writeRaw( os,value.unsignedValue () ); break;
+    case Value::INT: writeRaw( os,value.intValue () ); break;
+    case Value::FLOAT: writeRaw( os,value.floatValue () ); break;
+    case Value::DOUBLE: writeRaw( os,value.doubleValue () ); break;
+    case Value::STRING: writeBlock( os,value.stringValue () ); break;
+    case Value::VECTOR:
+      {
+	const Vector v = value.vectorValue ();
+	writeSize( os,static_cast<boost::uint64_t> (v.size ()) );
+	writeDoubles( os,v.data (),static_cast<std::size_t> (v.size ()) );
+	break;
+      }
+    case Value::MATRIX:
+      {
+	const Eigen::MatrixXd m = value.matrixXdValue ();
+	writeSize( os,static_cast<boost::uint64_t> (m.rows ()) );
+	writeSize( os,static_cast<boost::uint64_t> (m.cols ()) );
+	writeDoubles( os,m.data (),static_cast<std::size_t> (m.size ()) );
+	break;
+      }
+    case Value::MATRIX4D:
+      {
+	const Eigen::Matrix4d m = value.matrix4dValue ();
+	writeDoubles( os,m.data (),16 );
+	break;
+      }
+    default: break;
+    }
+}
+
+static Value
+readValue( std::istream& is,const std::string& aFileName )
+{
+  switch( readSize( is,aFileName ) )
+    {
+    case Value::NONE: return Value ();
+    case Value::BOOL: return Value( readRaw<char>( is,aFileName )!=0 );
+    case Value::UNSIGNED: return Value( readRaw<unsigned>( is,aFileName ) );
+    case Value::INT: return Value( readRaw<int>( is,aFileName ) );
+    case Value::FLOAT: return Value( readRaw<float>( is,aFileName ) );
+    case Value::DOUBLE: return Value( readRaw<double>( is,aFileName ) );
+    case Value::STRING:
+      {
+	std::string str;
+	readBlock( is,str,aFileName );
+	return Value( str );
+      }
+    case Value::VECTOR:
+      {
+	Vector v( static_cast<Vector::Index> (readSize( is,aFileName )) );
+	readDoubles( is,v.data (),static_cast<std::size_t> (v.size ()),
+		     aFileName );
+	return Value( v );
+      }
+    case Value::MATRIX:
+      {
+	const boost::uint64_t rows = readSize( is,aFileName );
+	Eigen::MatrixXd m( static_cast<Eigen::MatrixXd::Index> (rows),
+			   static_cast<Eigen::MatrixXd::Index>
+			   (readSize( is,aFileName )) );
+	readDoubles( is,m.data (),static_cast<std::size_t> (m.size ()),
+		     aFileName );
+	return Value( m );
+      }
+    case Value::MATRIX4D:
+      {
+	Eigen::Matrix4d m;
+	readDoubles( is,m.data (),16,aFileName );
+	return Value( m );
+      }
+    default:
+      DG_THROW ExceptionFactory( ExceptionFactory::READ_FILE,
+				 "Unknown value type in topology ",
+				 "(%s).",aFileName.c_str () );
+    }
+}
+
+/* Size and modification time of a file, 0 if it does not exist. */
+static void
+fileStamp( const std::string& path,boost::uint64_t& size,
+	   boost::uint64_t& mtime )
+{
+  struct stat st;
+  if( path.empty () || stat( path.c_str (),&st )!=0 )
+    { size = mtime = 0; return; }
+  size = static_cast<boost::uint64_t> (st.st_size);
+  mtime = static_cast<boost::uint64_t> (st.st_mtime);
+}
+
+/* Library defining an entity class, or dynamic-graph if the class is
+ * empty. */
+static std::string
+classLibrary( const std::string& className )
+{
+  if(! className.empty () )
+    return FactoryStorage::getInstance ()->getEntityLibrary( className );
+  Dl_info info;
+  if( dladdr( reinterpret_cast<void*> (&fileStamp),&info )==0
+      || info.dli_fname==NULL )
+    return std::string ();
+  return info.dli_fname;
+}
+
+typedef std::map<const SignalBase<int>*, std::string> SignalPaths;
+
+/* Path "entity.signal" of each signal of the entities. */
+static void
+signalPaths( const PoolStorage::Entities& entities,SignalPaths& paths )
+{
+  for( PoolStorage::Entities::const_iterator iter=entities.begin ();
+       iter!=entities.end (); ++iter )
+    {
+      const Entity::SignalTable& signals = iter->second->getSignals ();
+      for( Entity::SignalTable::const_iterator sig=signals.begin ();
+	   sig!=signals.end (); ++sig )
+	paths[sig->second] = iter->first + "." + sig->first.str ();
+    }
+}
+
+void PoolStorage::
+exportTopology( const std::string& aFileName )
+{
+  SignalPaths paths;
+  signalPaths( entityMap,paths );
+
+  std::set<std::string> classes;
+  classes.insert( std::string () );
+  std::vector<std::pair<std::string, std::string> > plugs, dependencies;
+  std::vector<const SignalBase<int>*> list;
+  for( Entities::const_iterator iter=entityMap.begin ();
+       iter!=entityMap.end (); ++iter )
+    {
+      classes.insert( iter->second->getClassName () );
+      const Entity::SignalTable& signals = iter->second->getSignals ();
+      for( Entity::SignalTable::const_iterator sig=signals.begin ();
+	   sig!=signals.end (); ++sig )
+	{
+	  const std::string& path = paths[sig->second];
+	  SignalPaths::const_iterator source =
+	    paths.find( sig->second->getPluged () );
+	  if( source!=paths.end () && source->first!=sig->second )
+	    plugs.push_back( std::make_pair( source->second,path ) );
+
+	  list.clear ();
+	  sig->second->listDependencies( list );
+	  for( std::size_t i=0;i<list.size ();++i )
+	    {
+	      SignalPaths::const_iterator dependency = paths.find( list[i] );
+	      if( dependency!=paths.end () )
+		dependencies.push_back( std::make_pair( path,dependency->second ) );
+	    }
+	}
+    }
+
+  std::ofstream file( aFileName.c_str (),
+		      std::ofstream::out | std::ofstream::binary );
+  if(! file.good () )
+    { DG_THROW ExceptionFactory( ExceptionFactory::GENERIC,
+				 "Cannot open topology file ",
+				 "(%s).",aFileName.c_str () ); }
+  file.write( TOPOLOGY_HEADER,sizeof(TOPOLOGY_HEADER) );
+
+  writeSize( file,classes.size () );
+  for( std::set<std::string>::const_iterator it=classes.begin ();
+       it!=classes.end (); ++it )
+    {
+      const std::string library = classLibrary( *it );
+      boost::uint64_t size, mtime;
+      fileStamp( library,size,mtime );
+      writeBlock( file,*it );
+      writeBlock( file,library );
+      writeSize( file,size );
+      writeSize( file,mtime );
+    }
+
+  writeSize( file,entityMap.size () );
+  for( Entities::const_iterator iter=entityMap.begin ();
+       iter!=entityMap.end (); ++iter )
+    {
+      writeBlock( file,iter->second->getClassName () );
+      writeBlock( file,iter->first );
+    }
+
+  const std::vector<std::pair<std::string, std::string> >* edges[] =
+    { &plugs,&dependencies };
+  for( std::size_t e=0;e<2;++e )
+    {
+      writeSize( file,edges[e]->size () );
+      for( std::size_t i=0;i<edges[e]->size ();++i )
+	{
+	  writeBlock( file,(*edges[e])[i].first );
+	  writeBlock( file,(*edges[e])[i].second );
+	}
+    }
+
+  // The setter commands which have been executed.
+  std::ostringstream commands;
+  boost::uint64_t nbCommands = 0;
+  for( Entities::const_iterator iter=entityMap.begin ();
+       iter!=entityMap.end (); ++iter )
+    {
+      const Entity::CommandTable* tables[] =
+	{ &iter->second->getCommands (),&iter->second->getBoundCommands () };
+      for( std::size_t t=0;t<2;++t )
+	for( Entity::CommandTable::const_iterator cmd=tables[t]->begin ();
+	     cmd!=tables[t]->end (); ++cmd )
+	  {
+	    // Bound class commands overridden by the instance are not used.
+	    if( t==1 && tables[0]->find( cmd->first )!=NULL ) continue;
+	    const std::vector<Value>& values =
+	      cmd->second->getExecutedValues ();
+	    if( values.empty () ) continue;
+	    writeBlock( commands,iter->first );
+	    writeBlock( commands,cmd->first.str () );
+	    writeSize( commands,values.size () );
+	    for( std::size_t i=0;i<values.size ();++i )
+	      writeValue( commands,values[i] );
+	    ++nbCommands;
+	  }
+    }
+  writeSize( file,nbCommands );
+  file << commands.str ();
+
+  file.close ();
+  if( file.fail () )
+    { DG_THROW ExceptionFactory( ExceptionFactory::GENERIC,
+				 "Cannot write topology file ",
+				 "(%s).",aFileName.c_str () ); }
+}
+
+bool PoolStorage::
+importTopology( const std::string& aFileName )
+{
+  std::ifstream file( aFileName.c_str (),
+		      std::ifstream::in | std::ifstream::binary );
+  if(! file ) return false;
+  char header[sizeof(TOPOLOGY_HEADER)];
+  file.read( header,sizeof(header) );
+  if( !file || !std::equal( header,header+sizeof(header),TOPOLOGY_HEADER ) )
+    { DG_THROW ExceptionFactory( ExceptionFactory::READ_FILE,
+				 "Not a topology file ",
+				 "(%s).",aFileName.c_str () ); }
+
+  // The file is out of date if a library changed.
+  std::string first, second;
+  const boost::uint64_t nbClasses = readSize( file,aFileName );
+  for( boost::uint64_t i=0;i<nbClasses;++i )
+    {
+      readBlock( file,first,aFileName );
+      readBlock( file,second,aFileName );
+      const boost::uint64_t size = readSize( file,aFileName );
+      const boost::uint64_t mtime = readSize( file,aFileName );
+      try
+	{
+	  if( !first.empty ()
+	      && !FactoryStorage::getInstance ()->loadEntityClass( first ) )
+	    return false;
+	}
+      catch( const ExceptionFactory& )
+	{ return false; }
+      boost::uint64_t currentSize, currentMtime;
+      fileStamp( second,currentSize,currentMtime );
+      if( classLibrary( first )!=second
+	  || currentSize!=size || currentMtime!=mtime )
+	return false;
+    }
+
+  GraphBuilder builder;
+  std::vector<std::string> names;
+  const boost::uint64_t nbEntities = readSize( file,aFileName );
+  for( boost::uint64_t i=0;i<nbEntities;++i )
+    {
+      readBlock( file,first,aFileName );
+      readBlock( file,second,aFileName );
+      builder.newEntity( first,second );
+      names.push_back( second );
+    }
+  const boost::uint64_t nbPlugs = readSize( file,aFileName );
+  for( boost::uint64_t i=0;i<nbPlugs;++i )
+    {
+      readBlock( file,first,aFileName );
+      readBlock( file,second,aFileName );
+      builder.plug( first,second );
+    }
+  std::set<std::pair<std::string, std::string> > dependencies;
+  const boost::uint64_t nbDependencies = readSize( file,aFileName );
+  for( boost::uint64_t i=0;i<nbDependencies;++i )
+    {
+      readBlock( file,first,aFileName );
+      readBlock( file,second,aFileName );
+      builder.addDependency( first,second );
+      dependencies.insert( std::make_pair( first,second ) );
+    }
+  std::vector<Value> values;
+  const boost::uint64_t nbCommands = readSize( file,aFileName );
+  for( boost::uint64_t i=0;i<nbCommands;++i )
+    {
+      readBlock( file,first,aFileName );
+      readBlock( file,second,aFileName );
+      values.clear ();
+      const boost::uint64_t nbValues = readSize( file,aFileName );
+      for( boost::uint64_t j=0;j<nbValues;++j )
+	values.push_back( readValue( file,aFileName ) );
+      builder.runCommand( first,second,values );
+    }
+  builder.build ();
+
+  // The file lists all the dependencies between the signals of the pool:
+  // remove those added by the constructors which had been removed.
+  SignalPaths paths;
+  signalPaths( entityMap,paths );
+  std::vector<const SignalBase<int>*> list;
+  for( std::size_t i=0;i<names.size ();++i )
+    {
+      const Entity::SignalTable& signals = getEntity( names[i] ).getSignals ();
+      for( Entity::SignalTable::const_iterator sig=signals.begin ();
+	   sig!=signals.end (); ++sig )
+	{
+	  list.clear ();
+	  sig->second->listDependencies( list );
+	  for( std::size_t j=0;j<list.size ();++j )
+	    {
+	      SignalPaths::const_iterator dependency = paths.find( list[j] );
+	      if( dependency!=paths.end ()
+		  && !dependencies.count( std::make_pair( paths[sig->second],
+							 dependency->second ) ) )
+		sig->second->removeDependency( *list[j] );
+	    }
+	}
+    }
+  return true;
+}
+
 static bool
 objectNameParser( std::istringstream& cmdparse,
 		  std::string& objName,
@@ -0,0 +1,368 @@
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+// dynamic-graph is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.  You should
+// have received a copy of the GNU Lesser General Public License
+// along with dynamic-graph.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <map>
+#include <set>
+
+#include "dynamic-graph/entity.h"
+#include "dynamic-graph/exception-factory.h"
+#include "dynamic-graph/pool.h"
+#include "dynamic-graph/reconfiguration.h"
+
+namespace dynamicgraph
+{
+  namespace {
+    typedef std::vector<const SignalBase<int>*> SignalList;
+
+    bool contains (const SignalList& list, const SignalBase<int>* signal)
+    {
+      return std::find (list.begin (), list.end (), signal) != list.end ();
+    }
+
+    /// Resolve the path "entity.signal" through the snapshots of the
+    /// pool, which other threads may read while the graph changes. The
+    /// signal snapshots are kept so that the signals stay alive.
+    SignalBase<int>*
+    resolve (const PoolStorage::EntityTable::SnapshotPtr& entities,
+	     std::vector<Entity::ConcurrentSignalTable::SnapshotPtr>& signals,
+	     const std::string& path)
+    {
+      const std::string::size_type dot = path.find ('.');
+      if (dot == std::string::npos)
+	DG_THROW ExceptionFactory (ExceptionFactory::UNREFERED_SIGNAL,
+				   "Parse error in signal name ",
+				   "<%s>.", path.c_str ());
+      const std::string entityName = path.substr (0, dot);
+      Entity* const* entity = entities->find (entityName);
+      if (entity == NULL)
+	DG_THROW ExceptionFactory (ExceptionFactory::UNREFERED_OBJECT,
+				   "Unknown entity.", " (while calling <%s>)",
+				   entityName.c_str ());
+      signals.push_back ((*entity)->getSignalSnapshot ());
+      SignalBase<int>* const* signal =
+	signals.back ()->find (path.substr (dot + 1));
+      if (signal == NULL)
+	DG_THROW ExceptionFactory (ExceptionFactory::UNREFERED_SIGNAL,
+				   "The requested signal is not registered",
+				   ": %s", path.c_str ());
+      return *signal;
+    }
+
+    /// Edges of the graph once the changes are applied. The signals not
+    /// modified by the changes are read from the graph.
+    class Shadow
+    {
+    public:
+      typedef std::map<const SignalBase<int>*, SignalBase<int>*> PlugMap;
+      typedef std::map<const SignalBase<int>*, SignalList> DependencyMap;
+
+      /// Plug source on destination.
+      void plug (SignalBase<int>* destination, SignalBase<int>* source)
+      {
+	if (!plugs.count (destination))
+	  initialPlugs[destination] = destination->getPluged ();
+	plugs[destination] = source;
+      }
+
+      SignalList& dependencies (const SignalBase<int>* signal)
+      {
+	DependencyMap::iterator it = shadowDependencies.find (signal);
+	if (it != shadowDependencies.end ()) return it->second;
+	SignalList& list = initialDependencies[signal];
+	signal->listDependencies (list);
+	return shadowDependencies[signal] = list;
+      }
+
+      /// Whether to can be reached from from.
+      bool reaches (const SignalBase<int>* from,
+		    const SignalBase<int>* to) const
+      {
+	std::set<const SignalBase<int>*> visited;
+	SignalList stack (1, from);
+	SignalList next;
+	while (!stack.empty ())
+	  {
+	    const SignalBase<int>* signal = stack.back ();
+	    stack.pop_back ();
+	    if (signal == to) return true;
+	    if (!visited.insert (signal).second) continue;
+	    next.clear ();
+	    edges (signal, next);
+	    stack.insert (stack.end (), next.begin (), next.end ());
+	  }
+	return false;
+      }
+
+      PlugMap plugs, initialPlugs;
+      DependencyMap shadowDependencies, initialDependencies;
+
+    private:
+      /// Signals read by signal: its source and its dependencies.
+      void edges (const SignalBase<int>* signal, SignalList& list) const
+      {
+	PlugMap::const_iterator plug = plugs.find (signal);
+	const SignalBase<int>* source =
+	  plug == plugs.end () ? signal->getPluged () : plug->second;
+	if (source != NULL && source != signal) list.push_back (source);
+	DependencyMap::const_iterator dependencies =
+	  shadowDependencies.find (signal);
+	if (dependencies == shadowDependencies.end ())
+	  signal->listDependencies (list);
+	else
+	  list.insert (list.end (), dependencies->second.begin (),
+		       dependencies->second.end ());
+      }
+    };
+  } // end of anonymous namespace.
+
+  Reconfiguration::Reconfiguration ()
+    : removals_ (0)
+    , state_ (RECORDING)
+  {}
+
+  void Reconfiguration::record (Change::Kind kind, const std::string& first,
+				const std::string& second)
+  {
+    if (state () == STAGED)
+      DG_THROW ExceptionFactory (ExceptionFactory::GENERIC,
+				 "Cannot modify a staged reconfiguration.");
+    Change change;
+    change.kind = kind;
+    change.first = first;
+    change.second = second;
+    changes_.push_back (change);
+    state_ = RECORDING;
+  }
+
+  void Reconfiguration::plug (const std::string& source,
+			      const std::string& destination)
+  {
+    record (Change::PLUG, destination, source);
+  }
+
+  void Reconfiguration::unplug (const std::string& destination)
+  {
+    record (Change::UNPLUG, destination, std::string ());
+  }
+
+  void Reconfiguration::addDependency (const std::string& signal,
+				       const std::string& dependency)
+  {
+    record (Change::ADD_DEPENDENCY, signal, dependency);
+  }
+
+  void Reconfiguration::removeDependency (const std::string& signal,
+					  const std::string& dependency)
+  {
+    record (Change::REMOVE_DEPENDENCY, signal, dependency);
+  }
+
+  void Reconfiguration::prepare ()
+  {
+    if (state () == STAGED)
+      DG_THROW ExceptionFactory (ExceptionFactory::GENERIC,
+				 "Cannot prepare a staged reconfiguration.");
+    PoolStorage* pool = PoolStorage::getInstance ();
+    // Read before the snapshots: an entity or a signal removed after
+    // this point makes apply () reject the reconfiguration.
+    const boost::uint32_t removals = pool->getRemovalCount ();
+    const PoolStorage::EntityTable::SnapshotPtr entities =
+      pool->getEntitySnapshot ();
+    std::vector<Entity::ConcurrentSignalTable::SnapshotPtr> signals;
+    std::vector<std::string> errors;
+    Shadow shadow;
+
+    // Replay the changes on the shadow edges.
+    for (std::size_t i = 0; i < changes_.size (); ++i)
+      {
+	const Change& change = changes_[i];
+	SignalBase<int>* first = NULL;
+	SignalBase<int>* second = NULL;
+	try
+	  {
+	    first = resolve (entities, signals, change.first);
+	    if (change.kind != Change::UNPLUG)
+	      second = resolve (entities, signals, change.second);
+	    if (change.kind == Change::PLUG || change.kind == Change::UNPLUG)
+	      first->checkPlug (second);
+	  }
+	catch (const ExceptionAbstract& exc)
+	  {
+	    errors.push_back (exc.getStringMessage ());
+	    continue;
+	  }
+
+	if (change.kind == Change::PLUG || change.kind == Change::UNPLUG)
+	  {
+	    shadow.plug (first, second);
+	    continue;
+	  }
+	SignalList& dependencies = shadow.dependencies (first);
+	SignalList::iterator it =
+	  std::find (dependencies.begin (), dependencies.end (), second);
+	if (change.kind == Change::ADD_DEPENDENCY)
+	  {
+	    if (it == dependencies.end ())
+	      dependencies.push_back (second);
+	    else
+	      errors.push_back ("Signal <" + change.first
+				+ "> already depends on <" + change.second
+				+ ">.");
+	  }
+	else
+	  {
+	    if (it != dependencies.end ())
+	      dependencies.erase (it);
+	    else
+	      errors.push_back ("Signal <" + change.first
+				+ "> does not depend on <" + change.second
+				+ ">.");
+	  }
+      }
+
+    // Keep the net changes and reject those closing a cycle.
+    std::vector<PlugEdit> plugs;
+    for (Shadow::PlugMap::const_iterator it = shadow.plugs.begin ();
+	 it != shadow.plugs.end (); ++it)
+      {
+	PlugEdit edit;
+	edit.destination = const_cast<SignalBase<int>*> (it->first);
+	edit.source = it->second;
+	edit.previous = shadow.initialPlugs[it->first];
+	if (edit.source == edit.previous) continue;
+	if (edit.source != NULL && edit.source != edit.destination
+	    && shadow.reaches (edit.source, edit.destination))
+	  errors.push_back ("Plugging <" + edit.source->getName () + "> on <"
+			    + edit.destination->getName ()
+			    + "> creates a cycle.");
+	plugs.push_back (edit);
+      }
+    std::vector<DependencyEdit> dependencies;
+    for (Shadow::DependencyMap::const_iterator it =
+	   shadow.shadowDependencies.begin ();
+	 it != shadow.shadowDependencies.end (); ++it)
+      {
+	const SignalList& before = shadow.initialDependencies[it->first];
+	const SignalList& after = it->second;
+	DependencyEdit edit;
+	edit.signal = const_cast<SignalBase<int>*> (it->first);
+	edit.list = dynamic_cast<TimeDependency<int>*> (edit.signal);
+	for (std::size_t i = 0; i < after.size (); ++i)
+	  if (!contains (before, after[i]))
+	    {
+	      edit.dependency = after[i];
+	      edit.add = true;
+	      if (shadow.reaches (edit.dependency, edit.signal))
+		errors.push_back ("Adding the dependency of <"
+				  + edit.signal->getName () + "> on <"
+				  + edit.dependency->getName ()
+				  + "> creates a cycle.");
+	      dependencies.push_back (edit);
+	      dependencies.back ().node.push_back (edit.dependency);
+	    }
+	for (std::size_t i = 0; i < before.size (); ++i)
+	  if (!contains (after, before[i]))
+	    {
+	      edit.dependency = before[i];
+	      edit.add = false;
+	      dependencies.push_back (edit);
+	    }
+      }
+
+    if (!errors.empty ())
+      {
+	std::string message = "Cannot prepare the reconfiguration:";
+	for (std::size_t i = 0; i < errors.size (); ++i)
+	  message += "\n  " + errors[i];
+	DG_THROW ExceptionFactory (ExceptionFactory::GENERIC, message);
+      }
+    plugs_.swap (plugs);
+    dependencies_.swap (dependencies);
+    removals_ = removals;
+    state_ = PREPARED;
+  }
+
+  bool Reconfiguration::apply ()
+  {
+    const State current = state ();
+    if (current != PREPARED && current != STAGED)
+      DG_THROW ExceptionFactory (ExceptionFactory::GENERIC,
+				 "The reconfiguration is not prepared.");
+
+    // Check that the graph did not change, and locate the removed
+    // dependencies. The signals are not dereferenced if one of them may
+    // have been removed.
+    if (PoolStorage::getInstance ()->getRemovalCount () != removals_)
+      {
+	state_ = REJECTED;
+	return false;
+      }
+    for (std::size_t i = 0; i < plugs_.size (); ++i)
+      if (plugs_[i].destination->getPluged () != plugs_[i].previous)
+	{
+	  state_ = REJECTED;
+	  return false;
+	}
+    for (std::size_t i = 0; i < dependencies_.size (); ++i)
+      {
+	DependencyEdit& edit = dependencies_[i];
+	if (edit.list == NULL) continue;
+	Dependencies& list = edit.list->dependencies;
+	const Dependencies::iterator it =
+	  std::find (list.begin (), list.end (), edit.dependency);
+	if (edit.add == (it != list.end ()))
+	  {
+	    state_ = REJECTED;
+	    return false;
+	  }
+	edit.position = it;
+      }
+
+    // The nodes of the dependency lists are moved, not allocated.
+    for (std::size_t i = 0; i < plugs_.size (); ++i)
+      plugs_[i].destination->plug (plugs_[i].source);
+    for (std::size_t i = 0; i < dependencies_.size (); ++i)
+      {
+	DependencyEdit& edit = dependencies_[i];
+	if (edit.list == NULL)
+	  {
+	    if (edit.add)
+	      edit.signal->addDependency (*edit.dependency);
+	    else
+	      edit.signal->removeDependency (*edit.dependency);
+	  }
+	else if (edit.add)
+	  edit.list->dependencies.splice (edit.list->dependencies.begin (),
+					  edit.node);
+	else
+	  removed_.splice (removed_.end (), edit.list->dependencies,
+			   edit.position);
+      }
+    state_ = APPLIED;
+    return true;
+  }
+
+  void Reconfiguration::clear ()
+  {
+    if (state () == STAGED)
+      DG_THROW ExceptionFactory (ExceptionFactory::GENERIC,
+				 "Cannot clear a staged reconfiguration.");
+    changes_.clear ();
+    plugs_.clear ();
+    dependencies_.clear ();
+    removed_.clear ();
+    state_ = RECORDING;
+  }
+} // end of namespace dynamicgraph
@@ -0,0 +1,306 @@
+//
+// Copyright 2018 CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+// dynamic-graph is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.  You should
+// have received a copy of the GNU Lesser General Public License along
+// with dynamic-graph.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <string>
+
+#include <boost/cstdint.hpp>
+
+#include <dynamic-graph/eigen-io.h>
+
+namespace dynamicgraph {
+
+  namespace {
+    typedef std::char_traits<char> traits;
+
+    inline bool isBlank (int c)
+    {
+      return c == ' ' || c == '\t' || c == '\n' || c == '\r'
+	|| c == '\v' || c == '\f';
+    }
+
+    inline bool isDigit (int c)
+    {
+      return c >= '0' && c <= '9';
+    }
+
+    /// Characters which may appear in a number, including nan and inf.
+    inline bool isNumberChar (int c)
+    {
+      switch (c)
+	{
+	case '.': case '+': case '-': case 'e': case 'E':
+	case 'n': case 'a': case 'i': case 'f':
+	  return true;
+	default:
+	  return isDigit (c);
+	}
+    }
+
+    const double kPow10[] = {
+      1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    /// Convert the decimal number [first,last).
+    ///
+    /// When the significand fits in 53 bits and the power of ten is exact,
+    /// one multiplication or division gives the correctly rounded result
+    /// (Clinger's fast path). Other numbers are handed to strtod.
+    bool toDouble (const char* first, const char* last, double& value)
+    {
+      const std::size_t len = static_cast<std::size_t> (last - first);
+      if (len == 3 && std::strncmp (first, "nan", 3) == 0)
+	{ value = std::numeric_limits<double>::quiet_NaN (); return true; }
+      if ((len == 3 && std::strncmp (first, "inf", 3) == 0)
+	  || (len == 4 && std::strncmp (first, "+inf", 4) == 0))
+	{ value = std::numeric_limits<double>::infinity (); return true; }
+      if (len == 4 && std::strncmp (first, "-inf", 4) == 0)
+	{ value = -std::numeric_limits<double>::infinity (); return true; }
+
+      const char* p = first;
+      bool negative = false;
+      if (p != last && (*p == '-' || *p == '+'))
+	negative = (*p++ == '-');
+
+      boost::uint64_t significand = 0;
+      int nbDigits = 0, exponent = 0;
+      bool anyDigit = false;
+      for (; p != last && isDigit (*p); ++p)
+	{
+	  anyDigit = true;
+	  if (significand == 0 && *p == '0') continue;
+	  if (nbDigits < 19) significand = 10 * significand + (*p - '0');
+	  else ++exponent;
+	  ++nbDigits;
+	}
+      if (p != last && *p == '.')
+	for (++p; p != last && isDigit (*p); ++p)
+	  {
+	    anyDigit = true;
+	    if (significand == 0 && *p == '0') { --exponent; continue; }
+	    if (nbDigits < 19)
+	      {
+		significand = 10 * significand + (*p - '0');
+		--exponent;
+	      }
+	    ++nbDigits;
+	  }
+      if (!anyDigit) return false;
+      if (p != last && (*p == 'e' || *p == 'E'))
+	{
+	  ++p;
+	  bool negativeExp = false;
+	  if (p != last && (*p == '-' || *p == '+'))
+	    negativeExp = (*p++ == '-');
+	  if (p == last || !isDigit (*p)) return false;
+	  int e = 0;
+	  for (; p != last && isDigit (*p); ++p)
+	    if (e < 100000) e = 10 * e + (*p - '0');
+	  exponent += negativeExp ? -e : e;
+	}
+      if (p != last) return false;
+
+      if (nbDigits <= 15 && significand <= (boost::uint64_t (1) << 53)
+	  && exponent >= -22 && exponent <= 22)
+	{
+	  value = static_cast<double> (significand);
+	  if (exponent < 0) value /= kPow10[-exponent];
+	  else value *= kPow10[exponent];
+	  if (negative) value = -value;
+	  return true;
+	}
+
+      // Slow path: strtod needs a null terminated string.
+      char buffer[64];
+      if (len >= sizeof (buffer)) return false;
+      std::memcpy (buffer, first, len);
+      buffer[len] = '\0';
+      char* end;
+      value = std::strtod (buffer, &end);
+      return end == buffer + len;
+    }
+
+    /// Values allocated at once when the size of the input is unknown.
+    const std::size_t CHUNK_SIZE = 4096;
+
+    /// Make room for the value n of total values, doubling the size of
+    /// values when it is full.
+    void grow (Vector& values, std::size_t n, std::size_t total)
+    {
+      const std::size_t size = static_cast<std::size_t> (values.size ());
+      if (n < size) return;
+      const std::size_t next = std::min (total, std::max (CHUNK_SIZE, 2 * size));
+      values.conservativeResize (static_cast<Vector::Index> (next));
+    }
+
+    /// Non-owning stream buffer on a range of characters.
+    class CharRangeBuf : public std::streambuf
+    {
+    public:
+      CharRangeBuf (const char* first, const char* last)
+      {
+	char* f = const_cast<char*> (first);
+	setg (f, f, const_cast<char*> (last));
+      }
+      const char* position () const { return gptr (); }
+    };
+  } // end of anonymous namespace.
+
+  bool EigenReader::expect (char c)
+  {
+    int ch = sb_.sgetc ();
+    while (isBlank (ch)) ch = sb_.snextc ();
+    if (ch != traits::to_int_type (c)) return false;
+    sb_.sbumpc ();
+    return true;
+  }
+
+  void EigenReader::separator ()
+  {
+    int ch = sb_.sgetc ();
+    while (isBlank (ch)) ch = sb_.snextc ();
+    if (ch == ',') sb_.sbumpc ();
+  }
+
+  bool EigenReader::readSize (std::size_t& n)
+  {
+    int ch = sb_.sgetc ();
+    while (isBlank (ch)) ch = sb_.snextc ();
+    if (!isDigit (ch)) return false;
+    n = 0;
+    for (; isDigit (ch); ch = sb_.snextc ())
+      {
+	if (n > (std::numeric_limits<std::size_t>::max () - 9) / 10)
+	  return false;
+	n = 10 * n + static_cast<std::size_t> (ch - '0');
+      }
+    return true;
+  }
+
+  bool EigenReader::sizeKnown () const
+  {
+    // Other buffers, such as files or pipes, may only know the size of
+    // the characters they already read.
+    return dynamic_cast<const std::stringbuf*> (&sb_) != NULL;
+  }
+
+  bool EigenReader::fitsInput (std::size_t rows, std::size_t cols)
+  {
+    // Each value takes at least one character: this rejects sizes which
+    // cannot be read before allocating the destination.
+    if (rows == 0 || cols == 0) return true;
+    const std::streamsize avail = sb_.in_avail ();
+    if (avail <= 0) return false;
+    return rows <= static_cast<std::size_t> (avail) / cols;
+  }
+
+  bool EigenReader::readDouble (double& value)
+  {
+    int ch = sb_.sgetc ();
+    while (isBlank (ch)) ch = sb_.snextc ();
+
+    char buffer[64];
+    std::size_t len = 0;
+    for (; isNumberChar (ch); ch = sb_.snextc ())
+      {
+	if (len == sizeof (buffer)) return false;
+	buffer[len++] = traits::to_char_type (ch);
+      }
+    return len > 0 && toDouble (buffer, buffer + len, value);
+  }
+
+  bool EigenReader::readDoubles (double* values, std::size_t n)
+  {
+    for (std::size_t i = 0; i < n; ++i)
+      {
+	if (i > 0) separator ();
+	if (!readDouble (values[i])) return false;
+      }
+    return true;
+  }
+
+  bool EigenReader::readVector (Vector& v)
+  {
+    std::size_t size;
+    if (!expect ('[') || !readSize (size) || !expect (']') || !expect ('('))
+      return false;
+    if (sizeKnown ())
+      {
+	if (!fitsInput (size, 1)) return false;
+	v.resize (static_cast<Vector::Index> (size));
+	return readDoubles (v.data (), size) && expect (')');
+      }
+    v.resize (0);
+    for (std::size_t i = 0; i < size; ++i)
+      {
+	if (i > 0) separator ();
+	grow (v, i, size);
+	if (!readDouble (v.data ()[i])) return false;
+      }
+    return expect (')');
+  }
+
+  bool EigenReader::readMatrixHeader (std::size_t& rows, std::size_t& cols)
+  {
+    if (!expect ('[') || !readSize (rows)) return false;
+    separator ();
+    return readSize (cols) && expect (']') && expect ('(');
+  }
+
+  bool EigenReader::readRows (Vector& values, std::size_t rows,
+			      std::size_t cols)
+  {
+    if (cols > 0 && rows > std::numeric_limits<std::size_t>::max () / cols)
+      return false;
+    const std::size_t total = rows * cols;
+    values.resize (0);
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < rows; ++i)
+      {
+	if (i > 0) separator ();
+	if (!expect ('(')) return false;
+	for (std::size_t j = 0; j < cols; ++j, ++n)
+	  {
+	    if (j > 0) separator ();
+	    grow (values, n, total);
+	    if (!readDouble (values.data ()[n])) return false;
+	  }
+	if (!expect (')')) return false;
+      }
+    return expect (')');
+  }
+
+  const char* parseDoubles (const char* first, const char* last,
+			    double* values, std::size_t n)
+  {
+    CharRangeBuf buf (first, last);
+    if (!EigenReader (buf).readDoubles (values, n))
+      {
+	const std::size_t pos = static_cast<std::size_t> (buf.position () - first);
+	throw ExceptionSignal
+	  (ExceptionSignal::GENERIC,
+	   "Failed to parse values. ",
+	   "(%d values expected, parse error at character %d).",
+	   static_cast<int> (n), static_cast<int> (pos));
+      }
+    return buf.position ();
+  }
+
+} // namespace dynamicgraph
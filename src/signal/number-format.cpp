@@ -0,0 +1,437 @@
+/*
+ * Copyright 2018,
+ * CNRS
+ *
+ * This file is part of dynamic-graph.
+ * dynamic-graph is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ * dynamic-graph is distributed in the hope that it will be
+ * useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+ * of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.  You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with dynamic-graph.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+
+#include <boost/cstdint.hpp>
+#include <boost/math/special_functions/fpclassify.hpp>
+#include <boost/math/special_functions/sign.hpp>
+
+#include <dynamic-graph/number-format.h>
+
+// Shortest round-trip formatting of doubles.
+//
+// The digit generation is the Grisu2 algorithm of F. Loitsch, "Printing
+// Floating-Point Numbers Quickly and Accurately with Integers" (PLDI 2010).
+// It always produces a representation which reads back to the same double
+// and is the shortest one in more than 99.9% of the cases.
+
+namespace dynamicgraph
+{
+  namespace
+  {
+    typedef boost::uint64_t uint64;
+    typedef boost::uint32_t uint32;
+
+    /// Floating-point number f * 2^e with a 64 bits significand.
+    struct DiyFp
+    {
+      uint64 f;
+      int e;
+
+      DiyFp (uint64 f_, int e_) : f (f_), e (e_) {}
+
+      static DiyFp sub (const DiyFp& x, const DiyFp& y)
+      {
+	return DiyFp (x.f - y.f, x.e);
+      }
+
+      /// Product rounded to the upper 64 bits.
+      static DiyFp mul (const DiyFp& x, const DiyFp& y)
+      {
+	const uint64 u_lo = x.f & 0xFFFFFFFFu;
+	const uint64 u_hi = x.f >> 32;
+	const uint64 v_lo = y.f & 0xFFFFFFFFu;
+	const uint64 v_hi = y.f >> 32;
+
+	const uint64 p0 = u_lo * v_lo;
+	const uint64 p1 = u_lo * v_hi;
+	const uint64 p2 = u_hi * v_lo;
+	const uint64 p3 = u_hi * v_hi;
+
+	uint64 q = (p0 >> 32) + (p1 & 0xFFFFFFFFu) + (p2 & 0xFFFFFFFFu);
+	q += uint64 (1) << 31;
+	return DiyFp (p3 + (p1 >> 32) + (p2 >> 32) + (q >> 32), x.e + y.e + 64);
+      }
+
+      static DiyFp normalize (DiyFp x)
+      {
+	while ((x.f >> 63) == 0)
+	  {
+	    x.f <<= 1;
+	    x.e--;
+	  }
+	return x;
+      }
+
+      static DiyFp normalizeTo (const DiyFp& x, int e)
+      {
+	return DiyFp (x.f << (x.e - e), e);
+      }
+    };
+
+    /// Compute v and its boundaries m- and m+, normalized such that
+    /// m-.e == v.e == m+.e.
+    void computeBoundaries (double value, DiyFp& minus, DiyFp& v, DiyFp& plus)
+    {
+      const int kBias = 1023 + 52;
+      const int kMinExp = 1 - kBias;
+      const uint64 kHiddenBit = uint64 (1) << 52;
+
+      uint64 bits;
+      std::memcpy (&bits, &value, sizeof (bits));
+      const uint64 E = (bits >> 52) & 0x7FF;
+      const uint64 F = bits & (kHiddenBit - 1);
+
+      const DiyFp w = (E == 0)
+	? DiyFp (F, kMinExp)
+	: DiyFp (F + kHiddenBit, static_cast<int> (E) - kBias);
+
+      // The lower boundary is closer if the significand is a power of two.
+      const bool lowerIsCloser = (F == 0 && E > 1);
+      const DiyFp mPlus (2 * w.f + 1, w.e - 1);
+      const DiyFp mMinus = lowerIsCloser
+	? DiyFp (4 * w.f - 1, w.e - 2)
+	: DiyFp (2 * w.f - 1, w.e - 1);
+
+      plus = DiyFp::normalize (mPlus);
+      minus = DiyFp::normalizeTo (mMinus, plus.e);
+      v = DiyFp::normalize (w);
+    }
+
+    struct CachedPower
+    {
+      uint64 f;
+      int e;
+      int k;
+    };
+
+    // Normalized 64 bits approximations of 10^k for k = -300, -292, ..., 324.
+    const CachedPower kCachedPowers[] =
+    {
+      { 0xAB70FE17C79AC6CAULL, -1060, -300 },
+      { 0xFF77B1FCBEBCDC4FULL, -1034, -292 },
+      { 0xBE5691EF416BD60CULL, -1007, -284 },
+      { 0x8DD01FAD907FFC3CULL,  -980, -276 },
+      { 0xD3515C2831559A83ULL,  -954, -268 },
+      { 0x9D71AC8FADA6C9B5ULL,  -927, -260 },
+      { 0xEA9C227723EE8BCBULL,  -901, -252 },
+      { 0xAECC49914078536DULL,  -874, -244 },
+      { 0x823C12795DB6CE57ULL,  -847, -236 },
+      { 0xC21094364DFB5637ULL,  -821, -228 },
+      { 0x9096EA6F3848984FULL,  -794, -220 },
+      { 0xD77485CB25823AC7ULL,  -768, -212 },
+      { 0xA086CFCD97BF97F4ULL,  -741, -204 },
+      { 0xEF340A98172AACE5ULL,  -715, -196 },
+      { 0xB23867FB2A35B28EULL,  -688, -188 },
+      { 0x84C8D4DFD2C63F3BULL,  -661, -180 },
+      { 0xC5DD44271AD3CDBAULL,  -635, -172 },
+      { 0x936B9FCEBB25C996ULL,  -608, -164 },
+      { 0xDBAC6C247D62A584ULL,  -582, -156 },
+      { 0xA3AB66580D5FDAF6ULL,  -555, -148 },
+      { 0xF3E2F893DEC3F126ULL,  -529, -140 },
+      { 0xB5B5ADA8AAFF80B8ULL,  -502, -132 },
+      { 0x87625F056C7C4A8BULL,  -475, -124 },
+      { 0xC9BCFF6034C13053ULL,  -449, -116 },
+      { 0x964E858C91BA2655ULL,  -422, -108 },
+      { 0xDFF9772470297EBDULL,  -396, -100 },
+      { 0xA6DFBD9FB8E5B88FULL,  -369,  -92 },
+      { 0xF8A95FCF88747D94ULL,  -343,  -84 },
+      { 0xB94470938FA89BCFULL,  -316,  -76 },
+      { 0x8A08F0F8BF0F156BULL,  -289,  -68 },
+      { 0xCDB02555653131B6ULL,  -263,  -60 },
+      { 0x993FE2C6D07B7FACULL,  -236,  -52 },
+      { 0xE45C10C42A2B3B06ULL,  -210,  -44 },
+      { 0xAA242499697392D3ULL,  -183,  -36 },
+      { 0xFD87B5F28300CA0EULL,  -157,  -28 },
+      { 0xBCE5086492111AEBULL,  -130,  -20 },
+      { 0x8CBCCC096F5088CCULL,  -103,  -12 },
+      { 0xD1B71758E219652CULL,   -77,   -4 },
+      { 0x9C40000000000000ULL,   -50,    4 },
+      { 0xE8D4A51000000000ULL,   -24,   12 },
+      { 0xAD78EBC5AC620000ULL,     3,   20 },
+      { 0x813F3978F8940984ULL,    30,   28 },
+      { 0xC097CE7BC90715B3ULL,    56,   36 },
+      { 0x8F7E32CE7BEA5C70ULL,    83,   44 },
+      { 0xD5D238A4ABE98068ULL,   109,   52 },
+      { 0x9F4F2726179A2245ULL,   136,   60 },
+      { 0xED63A231D4C4FB27ULL,   162,   68 },
+      { 0xB0DE65388CC8ADA8ULL,   189,   76 },
+      { 0x83C7088E1AAB65DBULL,   216,   84 },
+      { 0xC45D1DF942711D9AULL,   242,   92 },
+      { 0x924D692CA61BE758ULL,   269,  100 },
+      { 0xDA01EE641A708DEAULL,   295,  108 },
+      { 0xA26DA3999AEF774AULL,   322,  116 },
+      { 0xF209787BB47D6B85ULL,   348,  124 },
+      { 0xB454E4A179DD1877ULL,   375,  132 },
+      { 0x865B86925B9BC5C2ULL,   402,  140 },
+      { 0xC83553C5C8965D3DULL,   428,  148 },
+      { 0x952AB45CFA97A0B3ULL,   455,  156 },
+      { 0xDE469FBD99A05FE3ULL,   481,  164 },
+      { 0xA59BC234DB398C25ULL,   508,  172 },
+      { 0xF6C69A72A3989F5CULL,   534,  180 },
+      { 0xB7DCBF5354E9BECEULL,   561,  188 },
+      { 0x88FCF317F22241E2ULL,   588,  196 },
+      { 0xCC20CE9BD35C78A5ULL,   614,  204 },
+      { 0x98165AF37B2153DFULL,   641,  212 },
+      { 0xE2A0B5DC971F303AULL,   667,  220 },
+      { 0xA8D9D1535CE3B396ULL,   694,  228 },
+      { 0xFB9B7CD9A4A7443CULL,   720,  236 },
+      { 0xBB764C4CA7A44410ULL,   747,  244 },
+      { 0x8BAB8EEFB6409C1AULL,   774,  252 },
+      { 0xD01FEF10A657842CULL,   800,  260 },
+      { 0x9B10A4E5E9913129ULL,   827,  268 },
+      { 0xE7109BFBA19C0C9DULL,   853,  276 },
+      { 0xAC2820D9623BF429ULL,   880,  284 },
+      { 0x80444B5E7AA7CF85ULL,   907,  292 },
+      { 0xBF21E44003ACDD2DULL,   933,  300 },
+      { 0x8E679C2F5E44FF8FULL,   960,  308 },
+      { 0xD433179D9C8CB841ULL,   986,  316 },
+      { 0x9E19DB92B4E31BA9ULL,  1013,  324 },
+    };
+
+    // The scaled significand must lie in [2^kAlpha, 2^kGamma) so that the
+    // integral part fits in 32 bits.
+    const int kAlpha = -60;
+    const int kGamma = -32;
+
+    const CachedPower& cachedPowerForBinaryExponent (int e)
+    {
+      const int kMinDecExp = -300;
+      const int kDecStep = 8;
+      // k = ceil((kAlpha - e - 1) * log10(2))
+      const int f = kAlpha - e - 1;
+      const int k = (f * 78913) / (1 << 18) + (f > 0);
+      const int index = (-kMinDecExp + k + (kDecStep - 1)) / kDecStep;
+      return kCachedPowers[index];
+    }
+
+    /// Number of digits of n and largest power of ten lower or equal to n.
+    int largestPow10 (uint32 n, uint32& pow10)
+    {
+      if (n >= 1000000000) { pow10 = 1000000000; return 10; }
+      if (n >= 100000000) { pow10 = 100000000; return 9; }
+      if (n >= 10000000) { pow10 = 10000000; return 8; }
+      if (n >= 1000000) { pow10 = 1000000; return 7; }
+      if (n >= 100000) { pow10 = 100000; return 6; }
+      if (n >= 10000) { pow10 = 10000; return 5; }
+      if (n >= 1000) { pow10 = 1000; return 4; }
+      if (n >= 100) { pow10 = 100; return 3; }
+      if (n >= 10) { pow10 = 10; return 2; }
+      pow10 = 1; return 1;
+    }
+
+    /// Move the last digit towards w while staying in the rounding interval.
+    void round (char* buf, int len, uint64 dist, uint64 delta,
+		uint64 rest, uint64 tenK)
+    {
+      while (rest < dist && delta - rest >= tenK
+	     && (rest + tenK < dist || dist - rest > rest + tenK - dist))
+	{
+	  buf[len - 1]--;
+	  rest += tenK;
+	}
+    }
+
+    void digitGen (char* buf, int& len, int& decimalExponent,
+		   const DiyFp& mMinus, const DiyFp& w, const DiyFp& mPlus)
+    {
+      uint64 delta = DiyFp::sub (mPlus, mMinus).f;
+      uint64 dist = DiyFp::sub (mPlus, w).f;
+
+      const DiyFp one (uint64 (1) << -mPlus.e, mPlus.e);
+
+      uint32 p1 = static_cast<uint32> (mPlus.f >> -one.e);
+      uint64 p2 = mPlus.f & (one.f - 1);
+
+      uint32 pow10;
+      int n = largestPow10 (p1, pow10);
+
+      // Integral part.
+      while (n > 0)
+	{
+	  const uint32 d = p1 / pow10;
+	  p1 = p1 % pow10;
+	  buf[len++] = static_cast<char> ('0' + d);
+	  n--;
+
+	  const uint64 rest = (uint64 (p1) << -one.e) + p2;
+	  if (rest <= delta)
+	    {
+	      decimalExponent += n;
+	      round (buf, len, dist, delta, rest, uint64 (pow10) << -one.e);
+	      return;
+	    }
+	  pow10 /= 10;
+	}
+
+      // Fractional part.
+      int m = 0;
+      for (;;)
+	{
+	  p2 *= 10;
+	  const uint64 d = p2 >> -one.e;
+	  p2 &= one.f - 1;
+	  buf[len++] = static_cast<char> ('0' + d);
+	  m++;
+
+	  delta *= 10;
+	  dist *= 10;
+	  if (p2 <= delta) break;
+	}
+      decimalExponent -= m;
+      round (buf, len, dist, delta, p2, one.f);
+    }
+
+    /// Generate the digits of a finite, strictly positive value.
+    /// value = buf[0..len) * 10^decimalExponent
+    void grisu2 (char* buf, int& len, int& decimalExponent, double value)
+    {
+      DiyFp mMinus (0, 0), v (0, 0), mPlus (0, 0);
+      computeBoundaries (value, mMinus, v, mPlus);
+
+      const CachedPower& cached = cachedPowerForBinaryExponent (mPlus.e);
+      const DiyFp c (cached.f, cached.e);
+
+      const DiyFp w = DiyFp::mul (v, c);
+      const DiyFp wMinus = DiyFp::mul (mMinus, c);
+      const DiyFp wPlus = DiyFp::mul (mPlus, c);
+
+      // Shrink the interval by one ulp on each side to account for the
+      // imprecision of the multiplications.
+      const DiyFp lower (wMinus.f + 1, wMinus.e);
+      const DiyFp upper (wPlus.f - 1, wPlus.e);
+
+      len = 0;
+      decimalExponent = -cached.k;
+      digitGen (buf, len, decimalExponent, lower, w, upper);
+    }
+
+    char* writeExponent (char* out, int e)
+    {
+      if (e < 0) { *out++ = '-'; e = -e; }
+      else *out++ = '+';
+
+      if (e >= 100)
+	{
+	  *out++ = static_cast<char> ('0' + e / 100);
+	  e %= 100;
+	}
+      *out++ = static_cast<char> ('0' + e / 10);
+      *out++ = static_cast<char> ('0' + e % 10);
+      return out;
+    }
+
+    /// Lay out the digits like printf("%.17g") would, without the
+    /// superfluous digits.
+    char* formatDigits (char* out, const char* digits, int len, int decimalExponent)
+    {
+      // Position of the decimal point relative to the first digit.
+      const int n = len + decimalExponent;
+      const int kMaxFixed = 17;
+      const int kMinFixed = -3;
+
+      if (len <= n && n <= kMaxFixed)
+	{
+	  // 12300
+	  std::memcpy (out, digits, static_cast<std::size_t> (len));
+	  out += len;
+	  for (int i = len; i < n; ++i) *out++ = '0';
+	  return out;
+	}
+      if (0 < n && n <= kMaxFixed)
+	{
+	  // 12.3
+	  std::memcpy (out, digits, static_cast<std::size_t> (n));
+	  out += n;
+	  *out++ = '.';
+	  std::memcpy (out, digits + n, static_cast<std::size_t> (len - n));
+	  return out + (len - n);
+	}
+      if (kMinFixed <= n && n <= 0)
+	{
+	  // 0.00123
+	  *out++ = '0';
+	  *out++ = '.';
+	  for (int i = n; i < 0; ++i) *out++ = '0';
+	  std::memcpy (out, digits, static_cast<std::size_t> (len));
+	  return out + len;
+	}
+      // 1.23e+45
+      *out++ = digits[0];
+      if (len > 1)
+	{
+	  *out++ = '.';
+	  std::memcpy (out, digits + 1, static_cast<std::size_t> (len - 1));
+	  out += len - 1;
+	}
+      *out++ = 'e';
+      return writeExponent (out, n - 1);
+    }
+  } // end of anonymous namespace.
+
+  char* formatDouble (char* first, double value)
+  {
+    if ((boost::math::isnan) (value))
+      {
+	std::memcpy (first, "nan", 3);
+	return first + 3;
+      }
+    if ((boost::math::signbit) (value))
+      {
+	*first++ = '-';
+	value = -value;
+      }
+    if ((boost::math::isinf) (value))
+      {
+	std::memcpy (first, "inf", 3);
+	return first + 3;
+      }
+    if (value == 0)
+      {
+	*first++ = '0';
+	return first;
+      }
+
+    char digits[32];
+    int len, decimalExponent;
+    grisu2 (digits, len, decimalExponent, value);
+    return formatDigits (first, digits, len, decimalExponent);
+  }
+
+  NumberWriter& NumberWriter::put (const Vector& v, char separator)
+  {
+    for (Vector::Index i = 0; i < v.size (); ++i)
+      put (separator).put (v (i));
+    return *this;
+  }
+
+  NumberWriter& NumberWriter::put (const Matrix& m, char separator)
+  {
+    for (Matrix::Index i = 0; i < m.rows (); ++i)
+      for (Matrix::Index j = 0; j < m.cols (); ++j)
+	put (separator).put (m (i, j));
+    return *this;
+  }
+
+  void NumberWriter::flush ()
+  {
+    if (end_ != buffer_)
+      os_.write (buffer_, end_ - buffer_);
+    end_ = buffer_;
+  }
+} // end of namespace dynamicgraph.
@@ -25,6 +25,7 @@
 #include <algorithm>
 #include <dynamic-graph/exception-signal.h>
 #include <dynamic-graph/linear-algebra.h>
+#include <dynamic-graph/number-format.h>
 
 namespace dynamicgraph
 {
@@ -67,6 +68,18 @@ namespace dynamicgraph
 	}
     }
 
+  /* Trace doubles with the shortest round-trip representation, without
+   * flushing the stream. Disp keeps the default stream formatting, which
+   * users read. */
+
+  template <>
+  void
+  DefaultCastRegisterer<double>::
+  trace (const boost::any& object, std::ostream& os)
+  {
+    NumberWriter (os).put (boost::any_cast<double> (object)).put ('\n');
+  }
+
   /* Specialize Matrix and Vector traces. */
 
   template <>
@@ -75,8 +88,7 @@ namespace dynamicgraph
   trace(const boost::any& object, std::ostream& os)
   {
     const dynamicgraph::Vector & v = boost::any_cast<dynamicgraph::Vector> (object);
-    for( int i=0;i<v.size();++i )
-      { os << "\t" << v(i); }
+    NumberWriter (os).put (v, '\t');
   }
   template <>
   void
@@ -84,9 +96,7 @@ namespace dynamicgraph
   trace(const boost::any& object, std::ostream& os)
   {
     const dynamicgraph::Matrix & m = boost::any_cast<dynamicgraph::Matrix> (object);
-    for(int i=0;i<m.rows();++i )
-      for(int j=0;j<m.cols();++j )
-	{ os << "\t" << m(i,j); }
+    NumberWriter (os).put (m, '\t');
   }
 
 
@@ -21,6 +21,7 @@
 #include <string>
 #include <sstream>
 #include <algorithm>
+#include <functional>
 #include <dynamic-graph/exception-signal.h>
 
 #include <dynamic-graph/linear-algebra.h>
@@ -28,16 +29,127 @@
 namespace dynamicgraph
 {
 
+  struct SignalCaster::Lookup
+  {
+    typedef std::pair<const std::type_info*, Entry*> TypeEntry;
+    /// Entries, indexed by their compact identifier.
+    std::vector<Entry*> entries;
+    /// Entries of the type_info already looked up, sorted by address.
+    /// A type has several type_info when it is defined by several
+    /// libraries: they share the entry of the type name.
+    std::vector<TypeEntry> types;
+  };
+
+  namespace
+  {
+    bool typeBefore (const std::pair<const std::type_info*,
+		     SignalCaster::Entry*>& entry,
+		     const std::type_info* type)
+    {
+      return std::less<const std::type_info*> () (entry.first, type);
+    }
+  } // end of anonymous namespace.
+
   SignalCaster::SignalCaster ()
   {}
 
   SignalCaster::~SignalCaster ()
-  {}
+  {
+    const std::vector<Entry*>& entries = registry ().entries;
+    for (std::size_t i = 0; i < entries.size (); ++i)
+      {
+	delete entries[i]->functions_.exchange (NULL);
+	entries[i]->type_ = NULL;
+      }
+    collectRetired ();
+  }
+
+  SignalCaster::Registry& SignalCaster::registry ()
+  {
+    static Registry* instance = new Registry;
+    return *instance;
+  }
+
+  void SignalCaster::collectRetired ()
+  {
+    boost::mutex::scoped_lock lock (mutex_);
+    for (std::size_t i = 0; i < retired_.size (); ++i)
+      delete retired_[i];
+    retired_.clear ();
+    for (std::size_t i = 0; i < retiredLookups_.size (); ++i)
+      delete retiredLookups_[i];
+    retiredLookups_.clear ();
+  }
 
   void SignalCaster::destroy()
   {
-    delete instance_;
-    instance_ = 0;
+    delete instance_.exchange (0);
+  }
+
+  const SignalCaster::Entry*
+  SignalCaster::findPublished (const std::type_info& type)
+  {
+    const Lookup* lookup =
+      registry ().lookup.load (boost::memory_order_acquire);
+    if (lookup == NULL) return NULL;
+    std::vector<Lookup::TypeEntry>::const_iterator it =
+      std::lower_bound (lookup->types.begin (), lookup->types.end (),
+			&type, typeBefore);
+    if (it == lookup->types.end () || it->first != &type) return NULL;
+    return it->second;
+  }
+
+  SignalCaster::Entry&
+  SignalCaster::findEntry (const std::type_info& type)
+  {
+    Registry& r = registry ();
+    Entry* entry;
+    std::map<std::string, std::size_t>::const_iterator it =
+      r.ids.find (type.name ());
+    if (it != r.ids.end ())
+      {
+	entry = r.entries[it->second];
+	if (findPublished (type) != NULL) return *entry;
+      }
+    else
+      {
+	entry = new Entry (r.entries.size (), type.name ());
+	r.entries.push_back (entry);
+	r.ids[type.name ()] = entry->id_;
+      }
+
+    // Publish a new lookup with the entry and the type.
+    const Lookup* previous = r.lookup.load (boost::memory_order_relaxed);
+    Lookup* lookup = previous == NULL ? new Lookup : new Lookup (*previous);
+    lookup->entries = r.entries;
+    lookup->types.insert
+      (std::lower_bound (lookup->types.begin (), lookup->types.end (),
+			 &type, typeBefore),
+       Lookup::TypeEntry (&type, entry));
+    r.lookup.store (lookup, boost::memory_order_release);
+    if (previous != NULL)
+      retiredLookups_.push_back (previous);
+    return *entry;
+  }
+
+  const SignalCaster::Entry&
+  SignalCaster::getEntry (const std::type_info& type)
+  {
+    const Entry* entry = findPublished (type);
+    if (entry != NULL) return *entry;
+    boost::mutex::scoped_lock lock (mutex_);
+    return findEntry (type);
+  }
+
+  const SignalCaster::Entry&
+  SignalCaster::getEntry (std::size_t id) const
+  {
+    const Lookup* lookup =
+      registry ().lookup.load (boost::memory_order_acquire);
+    if (lookup == NULL || id >= lookup->entries.size ())
+      throw ExceptionSignal (ExceptionSignal::BAD_CAST,
+			     "Unknown type identifier");
+    return *lookup->entries[id];
   }
 
   void
@@ -46,93 +158,149 @@ namespace dynamicgraph
 			      SignalCaster::caster_type caster,
 			      SignalCaster::tracer_type tracer)
   {
-    if (existsCast (type))
+    registerCast (type, displayer, caster, tracer,
+		  serializer_type (), deserializer_type ());
+  }
+
+  void
+  SignalCaster::registerCast (const std::type_info& type,
+			      SignalCaster::displayer_type displayer,
+			      SignalCaster::caster_type caster,
+			      SignalCaster::tracer_type tracer,
+			      SignalCaster::serializer_type serializer,
+			      SignalCaster::deserializer_type deserializer,
+			      SignalCaster::binary_writer_type binaryWriter,
+			      SignalCaster::binary_reader_type binaryReader)
+  {
+    CastFunctions* functions = new CastFunctions;
+    functions->displayer = displayer;
+    functions->caster = caster;
+    functions->tracer = tracer;
+    functions->serializer = serializer;
+    functions->deserializer = deserializer;
+    functions->binaryWriter = binaryWriter;
+    functions->binaryReader = binaryReader;
+
+    boost::mutex::scoped_lock lock (mutex_);
+    Entry& entry = findEntry (type);
+    // If type name has already been registered for same type, do not throw.
+    if (entry.registered () && entry.type_ != &type)
       {
-	// If type name has already been registered for same type, do not throw.
-	if (type_info_[type.name()] != &type)
-	  {
-	    std::string typeName(type.name());
-	    std::ostringstream os;
-	    os << "cast already registered for typename " << typeName << "\n"
-	       << "and types differ: " << &type << " != "
-	       << type_info_[type.name()]
-	       << ".\n"
-	       << "A possible reason is that the dynamic"
-	       << " library defining this type\n"
-	       << "has been loaded several times, defining different symbols"
-	       << " for the same type.";
-	    throw ExceptionSignal(ExceptionSignal::GENERIC,
-				  os.str());
-	  }
+	delete functions;
+	std::string typeName(type.name());
+	std::ostringstream os;
+	os << "cast already registered for typename " << typeName << "\n"
+	   << "and types differ: " << &type << " != "
+	   << entry.type_
+	   << ".\n"
+	   << "A possible reason is that the dynamic"
+	   << " library defining this type\n"
+	   << "has been loaded several times, defining different symbols"
+	   << " for the same type.";
+	throw ExceptionSignal(ExceptionSignal::GENERIC,
+			      os.str());
       }
-    functions_[type.name()] = cast_functions_type(displayer,caster, tracer);
-    type_info_[type.name()] = &type;
+    entry.type_ = &type;
+    const CastFunctions* previous =
+      entry.functions_.exchange (functions, boost::memory_order_acq_rel);
+    if (previous != NULL)
+      retired_.push_back (previous);
   }
 
   void
   SignalCaster::unregisterCast (const std::type_info& type)
   {
-    size_t n = functions_.erase(type.name ());
-    if (0 == n) // erase did not find element
+    boost::mutex::scoped_lock lock (mutex_);
+    const Registry& r = registry ();
+    std::map<std::string, std::size_t>::const_iterator it =
+      r.ids.find (type.name ());
+    const CastFunctions* previous = (it == r.ids.end ()) ? NULL :
+      r.entries[it->second]->functions_.exchange (NULL,
+						  boost::memory_order_acq_rel);
+    if (previous == NULL) // type was not registered
       // TODO: throw Cast not registered exception
       throw ExceptionSignal(ExceptionSignal::GENERIC);
+    retired_.push_back (previous);
   }
 
   bool
   SignalCaster::existsCast (const std::type_info& type) const
   {
-    return functions_.find (type.name ()) != functions_.end ();
+    const Entry* entry = findPublished (type);
+    if (entry != NULL) return entry->registered ();
+    boost::mutex::scoped_lock lock (mutex_);
+    const Registry& r = registry ();
+    std::map<std::string, std::size_t>::const_iterator it =
+      r.ids.find (type.name ());
+    return it != r.ids.end () && r.entries[it->second]->registered ();
   }
 
-  SignalCaster::cast_functions_type&
-  SignalCaster::getCast (const std::string& type_name)
+  void SignalCaster::disp (const boost::any& object, std::ostream& os)
   {
-    std::map<std::string, cast_functions_type>::iterator it =
-      functions_.find(type_name);
-
-    if (it == functions_.end ())
-      //TODO: throw "cast not registered" exception
-      throw ExceptionSignal(ExceptionSignal::BAD_CAST, "Cast not registered");
-    return it->second;
+    getEntry (object.type ()).functions ().displayer (object, os);
   }
 
-  void SignalCaster::disp (const boost::any& object, std::ostream& os)
+  void
+  SignalCaster::trace(const boost::any& object, std::ostream& os)
   {
-    getCast(object.type ().name ()).get<0> () (object, os);
-
-
+    getEntry (object.type ()).functions ().tracer (object, os);
   }
 
   void
-  SignalCaster::trace(const boost::any& object, std::ostream& os)
+  SignalCaster::serialize (const boost::any& object, std::ostream& os)
   {
-    getCast(object.type ().name ()).get<2> () (object, os);
+    const CastFunctions& functions = getEntry (object.type ()).functions ();
+    if (!functions.serializer)
+      throw ExceptionSignal (ExceptionSignal::BAD_CAST,
+			     "Binary serialization not registered");
+    functions.serializer (object, os);
+  }
+
+  boost::any
+  SignalCaster::deserialize (const std::type_info& type, std::istream& is)
+  {
+    const CastFunctions& functions = getEntry (type).functions ();
+    if (!functions.deserializer)
+      throw ExceptionSignal (ExceptionSignal::BAD_CAST,
+			     "Binary serialization not registered");
+    return functions.deserializer (is);
   }
 
   std::vector<std::string>
   SignalCaster::listTypenames() const
   {
+    boost::mutex::scoped_lock lock (mutex_);
+    const Registry& r = registry ();
     std::vector<std::string> typeList;
-    for (std::map<std::string, cast_functions_type>::const_iterator iter =
-	   functions_.begin(); iter != functions_.end(); iter++)
-      typeList.push_back(iter->first);
+    for (std::map<std::string, std::size_t>::const_iterator iter =
+	   r.ids.begin(); iter != r.ids.end(); iter++)
+      if (r.entries[iter->second]->registered ())
+	typeList.push_back(iter->first);
     return typeList;
   }
 
   boost::any
   SignalCaster::cast (const std::type_info& type, std::istringstream& iss)
   {
-    return getCast(type.name ()).get<1> () (iss);
+    return getEntry (type).functions ().caster (iss);
   }
 
   /// Singleton on the library-wide instance of SignalCaster
   SignalCaster* SignalCaster::getInstance(void)
   {
-    if (instance_ == 0) {
-      instance_ = new SignalCaster;
+    SignalCaster* instance = instance_.load (boost::memory_order_acquire);
+    if (instance == 0) {
+      // Plugins may be loaded from several threads: only one instance wins.
+      SignalCaster* expected = 0;
+      instance = new SignalCaster;
+      if (!instance_.compare_exchange_strong (expected, instance,
+					       boost::memory_order_acq_rel)) {
+	delete instance;
+	instance = expected;
+      }
     }
-    return instance_;
+    return instance;
   }
-  SignalCaster* SignalCaster::instance_ = 0;
+  boost::atomic<SignalCaster*> SignalCaster::instance_ (0);
 
 } // namespace dynamicgraph
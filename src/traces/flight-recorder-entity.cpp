@@ -0,0 +1,68 @@
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+// dynamic-graph is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.  You should
+// have received a copy of the GNU Lesser General Public License
+// along with dynamic-graph.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <dynamic-graph/flight-recorder-entity.h>
+#include <dynamic-graph/all-commands.h>
+#include <dynamic-graph/exception-traces.h>
+#include <dynamic-graph/factory.h>
+#include <dynamic-graph/real-time-logger.h>
+
+using namespace dynamicgraph;
+
+DYNAMICGRAPH_FACTORY_ENTITY_PLUGIN(FlightRecorderEntity,"FlightRecorder");
+
+FlightRecorderEntity::FlightRecorderEntity (const std::string& name)
+  : Entity (name)
+  , recorder_ (new FlightRecorder (BUFFER_SIZE_DEFAULT))
+{
+  RealTimeLogger::instance ().addOutputStream (recorder_);
+
+  /* --- Commands --- */
+  {
+    using namespace dynamicgraph::command;
+    std::string doc;
+
+    doc = docCommandVoid1 ("Write the last entries of the real-time logger"
+			   " to a file.", "string (filename)");
+    addCommand ("dump",
+		makeCommandVoid1 (*this, &FlightRecorderEntity::dump, doc));
+
+    doc = docCommandVoid1 ("Dump the last entries of the real-time logger"
+			   " to a file when the process crashes.",
+			   "string (filename, empty to disable)");
+    addCommand ("setCrashFile",
+		makeCommandVoid1 (*this, &FlightRecorderEntity::setCrashFile,
+				  doc));
+  } // using namespace command
+}
+
+FlightRecorderEntity::~FlightRecorderEntity ()
+{
+  recorder_->uninstallCrashHandler ();
+  RealTimeLogger::instance ().removeOutputStream (recorder_);
+}
+
+void FlightRecorderEntity::dump (const std::string& filename)
+{
+  recorder_->dump (filename);
+}
+
+void FlightRecorderEntity::setCrashFile (const std::string& filename)
+{
+  if (filename.empty ())
+    recorder_->uninstallCrashHandler ();
+  else if (!recorder_->installCrashHandler (filename))
+    DG_THROW ExceptionTraces (ExceptionTraces::GENERIC,
+			      "Crash handlers are not supported.");
+}
@@ -0,0 +1,152 @@
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of
+// the License, or (at your option) any later version.
+// dynamic-graph is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.  You should
+// have received a copy of the GNU Lesser General Public License
+// along with dynamic-graph.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <sstream>
+
+#include <dynamic-graph/signal-monitor-entity.h>
+#include <dynamic-graph/all-commands.h>
+#include <dynamic-graph/exception-factory.h>
+#include <dynamic-graph/factory.h>
+#include <dynamic-graph/signal-caster.h>
+
+using namespace dynamicgraph;
+
+DYNAMICGRAPH_FACTORY_ENTITY_PLUGIN(SignalMonitorEntity,"SignalMonitor");
+
+namespace
+{
+  /// Command returning the values read by SignalMonitorEntity::read.
+  class ReadCommand : public command::Command
+  {
+  public:
+    ReadCommand (SignalMonitorEntity& entity, const std::string& docstring)
+      : Command (entity, EMPTY_ARG, docstring)
+    {}
+
+  protected:
+    virtual command::Value doExecute ()
+    {
+      SignalMonitorEntity& entity =
+	static_cast<SignalMonitorEntity&> (owner ());
+      return command::Value (entity.read ());
+    }
+  };
+} // end of anonymous namespace.
+
+SignalMonitorEntity::SignalMonitorEntity (const std::string& name)
+  : Entity (name)
+{
+  /* --- Commands --- */
+  {
+    using namespace dynamicgraph::command;
+    std::string doc;
+
+    doc = docCommandVoid1 ("Set the signals read and written, as paths"
+			   " entity.signal separated by spaces.",
+			   "string (paths)");
+    addCommand ("setSignals",
+		makeCommandVoid1 (*this, &SignalMonitorEntity::setSignals,
+				  doc));
+
+    doc = "\nRead the current values of the signals in one pass.\n\n"
+      "No input.\nReturn a string packing the binary values, see"
+      " getLayout.\n\n";
+    addCommand ("read", new ReadCommand (*this, doc));
+
+    doc = "\nLayout of the last read: one row per signal, with the offset,"
+      " size, time and type identifier of its value.\n\nNo input.\n"
+      "Return a matrix.\n\n";
+    addCommand ("getLayout",
+		new Getter<SignalMonitorEntity, Matrix>
+		(*this, &SignalMonitorEntity::getLayout, doc));
+
+    doc = "\nNames of the types of the values of the last read, one per"
+      " line.\n\nNo input.\nReturn a string.\n\n";
+    addCommand ("getTypeNames",
+		new Getter<SignalMonitorEntity, std::string>
+		(*this, &SignalMonitorEntity::getTypeNames, doc));
+
+    doc = docCommandVoid2 ("Set the signals to packed binary values.",
+			   "string (values)",
+			   "matrix (offset and size of each value, by row)");
+    addCommand ("write",
+		makeCommandVoid2 (*this, &SignalMonitorEntity::write, doc));
+  } // using namespace command
+}
+
+void SignalMonitorEntity::setSignals (const std::string& paths)
+{
+  PoolStorage* pool = PoolStorage::getInstance ();
+  std::vector<SignalHandle> signals;
+  std::istringstream iss (paths);
+  std::string path;
+  while (iss >> path) signals.push_back (pool->getSignalHandle (path));
+  signals_.swap (signals);
+  layout_.clear ();
+}
+
+const std::string& SignalMonitorEntity::read ()
+{
+  PoolStorage::getInstance ()->readSignals (signals_, buffer_, layout_);
+  return buffer_;
+}
+
+Matrix SignalMonitorEntity::getLayout () const
+{
+  Matrix layout (layout_.size (), 4);
+  for (std::size_t i = 0; i < layout_.size (); ++i)
+    {
+      const Matrix::Index row = static_cast<Matrix::Index> (i);
+      layout (row, 0) = static_cast<double> (layout_[i].offset);
+      layout (row, 1) = static_cast<double> (layout_[i].size);
+      layout (row, 2) = layout_[i].time;
+      layout (row, 3) = layout_[i].type;
+    }
+  return layout;
+}
+
+std::string SignalMonitorEntity::getTypeNames () const
+{
+  SignalCaster* caster = SignalCaster::getInstance ();
+  std::string names;
+  for (std::size_t i = 0; i < layout_.size (); ++i)
+    names += caster->getEntry (layout_[i].type).typeName () + "\n";
+  return names;
+}
+
+void SignalMonitorEntity::write (const std::string& buffer,
+				 const Matrix& layout)
+{
+  if (layout.rows () != static_cast<Matrix::Index> (signals_.size ())
+      || (layout.rows () > 0 && layout.cols () < 2))
+    DG_THROW ExceptionFactory (ExceptionFactory::GENERIC,
+			       "Layout does not fit the signals ",
+			       "(%d rows and %d columns for %d signals).",
+			       static_cast<int> (layout.rows ()),
+			       static_cast<int> (layout.cols ()),
+			       static_cast<int> (signals_.size ()));
+  writeLayout_.resize (signals_.size ());
+  for (std::size_t i = 0; i < writeLayout_.size (); ++i)
+    {
+      const Matrix::Index row = static_cast<Matrix::Index> (i);
+      if (layout (row, 0) < 0 || layout (row, 1) < 0)
+	DG_THROW ExceptionFactory (ExceptionFactory::GENERIC,
+				   "Layout does not fit the buffer ",
+				   "(negative offset or size at row %d).",
+				   static_cast<int> (i));
+      writeLayout_[i].offset = static_cast<boost::uint64_t> (layout (row, 0));
+      writeLayout_[i].size = static_cast<boost::uint64_t> (layout (row, 1));
+    }
+  PoolStorage::getInstance ()->writeSignals (signals_, buffer, writeLayout_);
+}
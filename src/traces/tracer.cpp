@@ -60,51 +60,55 @@ Tracer::Tracer( const std::string n )
 {
   signalRegistration( triger );
 
-
   /* --- Commands --- */
-  {
-    using namespace dynamicgraph::command;
-    std::string doc;
-
-    doc = docCommandVoid2("Add a new signal to trace.",
-			  "string (signal name)","string (filename, empty for default");
-    addCommand("add",
-	       makeCommandVoid2(*this,&Tracer::addSignalToTraceByName,doc ));
-
-    doc = docCommandVoid0("Remove all signals. If necessary, close open files.");
-    addCommand("clear",
-	       makeCommandVoid0(*this,&Tracer::clearSignalToTrace,doc ));
-
-    doc = docCommandVoid3("Gives the args for file opening, and "
-			  "if signals have been set, open the corresponding files.",
-			  "string (dirname)","string (prefix)","string (suffix)");
-    addCommand("open",
-	       makeCommandVoid3(*this,&Tracer::openFiles,doc ));
-
-    doc = docCommandVoid0("Close all the open files.");
-    addCommand("close",
-	       makeCommandVoid0(*this,&Tracer::closeFiles,doc ));
-
-    doc = docCommandVoid0("If necessary, dump "
-			  "(can be done automatically for some traces type).");
-    addCommand("dump",
-	       makeCommandVoid0(*this,&Tracer::trace,doc ));
-
-    doc = docCommandVoid0("Start the tracing process.");
-    addCommand("start",
-	       makeCommandVoid0(*this,&Tracer::start,doc ));
-
-    doc = docCommandVoid0("Stop temporarily the tracing process.");
-    addCommand("stop",
-	       makeCommandVoid0(*this,&Tracer::stop,doc ));
-
-    addCommand("getTimeStart",
-	       makeDirectGetter(*this,&timeStart,
-				docDirectGetter("timeStart","int")));
-    addCommand("setTimeStart",
-	       makeDirectSetter(*this,&timeStart,
-				docDirectSetter("timeStart","int")));
-  } // using namespace command
+  static const ClassCommands commands (&addCommands);
+  setClassCommands (commands);
+}
+
+/// Commands shared by all the tracers.
+void Tracer::
+addCommands (ClassCommands& commands)
+{
+  std::string doc;
+
+  doc = docCommandVoid2("Add a new signal to trace.",
+			"string (signal name)","string (filename, empty for default");
+  commands.add("add",
+	       makeSharedCommandVoid2(&Tracer::addSignalToTraceByName,doc ));
+
+  doc = docCommandVoid0("Remove all signals. If necessary, close open files.");
+  commands.add("clear",
+	       makeSharedCommandVoid0(&Tracer::clearSignalToTrace,doc ));
+
+  doc = docCommandVoid3("Gives the args for file opening, and "
+			"if signals have been set, open the corresponding files.",
+			"string (dirname)","string (prefix)","string (suffix)");
+  commands.add("open",
+	       makeSharedCommandVoid3(&Tracer::openFiles,doc ));
+
+  doc = docCommandVoid0("Close all the open files.");
+  commands.add("close",
+	       makeSharedCommandVoid0(&Tracer::closeFiles,doc ));
+
+  doc = docCommandVoid0("If necessary, dump "
+			"(can be done automatically for some traces type).");
+  commands.add("dump",
+	       makeSharedCommandVoid0(&Tracer::trace,doc ));
+
+  doc = docCommandVoid0("Start the tracing process.");
+  commands.add("start",
+	       makeSharedCommandVoid0(&Tracer::start,doc ));
+
+  doc = docCommandVoid0("Stop temporarily the tracing process.");
+  commands.add("stop",
+	       makeSharedCommandVoid0(&Tracer::stop,doc ));
+
+  commands.add("getTimeStart",
+	       makeSharedDirectGetter(&Tracer::timeStart,
+				      docDirectGetter("timeStart","int")));
+  commands.add("setTimeStart",
+	       makeSharedDirectSetter(&Tracer::timeStart,
+				      docDirectSetter("timeStart","int")));
 }
 
 /* --------------------------------------------------------------------- */
@@ -252,7 +256,7 @@ recordSignal(  std::ostream& os,
     if( sig.getTime ()>timeStart )
       {
 	os<< sig.getTime () << "\t";
-	sig.trace(os); os<<endl;
+	sig.trace(os); os<<'\n';
       }
   }
   catch( ExceptionAbstract& exc ) { os << exc << std::endl; }
@@ -276,6 +280,9 @@ recordTrigger( int& dummy, const int& time )
 void Tracer::
 trace  ()
 {
+  // Records are not flushed one by one, push them to the files now.
+  for( FileList::iterator iter = files.begin ();files.end ()!=iter;++iter )
+    { (*iter)->flush (); }
 }
 
 /* --------------------------------------------------------------------- */
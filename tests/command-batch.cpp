@@ -0,0 +1,189 @@
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dynamic-graph is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public License
+// along with dynamic-graph.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <dynamic-graph/all-commands.h>
+#include <dynamic-graph/entity.h>
+#include <dynamic-graph/exception-abstract.h>
+#include <dynamic-graph/exception-factory.h>
+#include <dynamic-graph/linear-algebra.h>
+#include <dynamic-graph/pool.h>
+
+#define BOOST_TEST_MODULE command_batch
+
+#include <boost/test/unit_test.hpp>
+
+using namespace dynamicgraph;
+using command::Value;
+
+// Number of allocations, counted by operator new.
+static long nbAllocations = 0;
+
+void* operator new (std::size_t size)
+{
+  ++nbAllocations;
+  void* ptr = std::malloc (size ? size : 1);
+  if (ptr == NULL) throw std::bad_alloc ();
+  return ptr;
+}
+
+void operator delete (void* ptr) throw ()
+{
+  std::free (ptr);
+}
+
+namespace dynamicgraph
+{
+  // Entity recording where its arguments are stored.
+  class BatchEntity : public Entity
+  {
+  public:
+    static const std::string CLASS_NAME;
+    virtual const std::string& getClassName () const { return CLASS_NAME; }
+
+    BatchEntity (const std::string& name)
+      : Entity (name), gainsData (NULL), matrixData (NULL), count (0),
+	offset (Vector::Zero (10000))
+    {
+      using namespace command;
+      addCommand ("setGains", makeCommandVoid1
+		  (*this, &BatchEntity::setGains,
+		   docCommandVoid1 ("Set the gains.", "vector")));
+      addCommand ("setMatrix", makeCommandVoid1
+		  (*this, &BatchEntity::setMatrix,
+		   docCommandVoid1 ("Set the matrix.", "matrix")));
+      addCommand ("add", makeCommandVoid1
+		  (*this, &BatchEntity::add,
+		   docCommandVoid1 ("Add to the counter.", "int")));
+      addCommand ("getCount", makeDirectGetter
+		  (*this, &count, docDirectGetter ("counter", "int")));
+      addCommand ("setOffset", makeDirectSetter
+		  (*this, &offset, docDirectSetter ("offset", "vector")));
+    }
+
+    void setGains (const Eigen::Ref<const Vector>& gains)
+    {
+      gainsData = gains.data ();
+      sum = gains.sum ();
+    }
+
+    void setMatrix (const Matrix& matrix)
+    {
+      matrixData = matrix.data ();
+    }
+
+    void add (const int& n) { count += n; }
+
+    const double* gainsData;
+    const double* matrixData;
+    double sum;
+    int count;
+    Vector offset;
+  };
+  const std::string BatchEntity::CLASS_NAME = "BatchEntity";
+}
+
+BOOST_AUTO_TEST_CASE (zero_copy)
+{
+  BatchEntity entity ("entity");
+  command::Command* command = entity.getNewStyleCommand ("setGains");
+  std::vector<Value> values (1, Value (Vector (Vector::Ones (10000))));
+  const double* data = values[0].vectorRef ().data ();
+  command->execute (values);
+  // The vector reaches the entity without being copied.
+  BOOST_CHECK_EQUAL (entity.gainsData, data);
+  BOOST_CHECK_EQUAL (entity.sum, 10000.);
+  BOOST_CHECK (values.empty ());
+
+  values.push_back (Value (Matrix (Matrix::Zero (100, 100))));
+  data = values[0].matrixXdRef ().data ();
+  entity.getNewStyleCommand ("setMatrix")->execute (values);
+  BOOST_CHECK_EQUAL (entity.matrixData, data);
+
+  values.push_back (Value (std::string ("not a vector")));
+  BOOST_CHECK_THROW (command->execute (values), ExceptionAbstract);
+  BOOST_CHECK_EQUAL (values.size (), 1u);
+}
+
+BOOST_AUTO_TEST_CASE (setter_allocations)
+{
+  BatchEntity entity ("entity");
+  command::Command* command = entity.getNewStyleCommand ("setOffset");
+  BOOST_REQUIRE (command->isSetter ());
+  std::vector<Value> values;
+  for (int i = 0; i < 3; ++i)
+    {
+      values.clear ();
+      values.push_back (Value (Vector (Vector::Constant (10000, i))));
+      // Neither the arguments nor the executed values are copied.
+      const long before = nbAllocations;
+      command->execute (values);
+      BOOST_CHECK_EQUAL (nbAllocations - before, 0);
+      BOOST_CHECK_EQUAL (entity.offset (0), i);
+    }
+  BOOST_CHECK_EQUAL (command->getExecutedValues ()[0].vectorRef () (0), 2.);
+
+  // Values set but not executed are not the executed ones.
+  values.clear ();
+  values.push_back (Value (Vector (Vector::Constant (10000, 5.))));
+  command->setParameterValues (values);
+  BOOST_CHECK_EQUAL (command->getExecutedValues ()[0].vectorRef () (0), 2.);
+}
+
+static std::vector<PoolStorage::CommandCall> makeCalls ()
+{
+  std::vector<PoolStorage::CommandCall> calls (4);
+  calls[0].entity = "first";
+  calls[0].command = "add";
+  calls[0].arguments.push_back (Value (2));
+  calls[1].entity = "second";
+  calls[1].command = "setGains";
+  calls[1].arguments.push_back (Value (Vector (Vector::Constant (3, 2.))));
+  calls[2].entity = "first";
+  calls[2].command = "add";
+  calls[2].arguments.push_back (Value (3));
+  calls[3].entity = "first";
+  calls[3].command = "getCount";
+  return calls;
+}
+
+BOOST_AUTO_TEST_CASE (batch)
+{
+  BatchEntity first ("first"), second ("second");
+  PoolStorage* pool = PoolStorage::getInstance ();
+  std::vector<PoolStorage::CommandCall> calls = makeCalls ();
+  std::vector<Value> results;
+  pool->executeCommands (calls, results);
+  BOOST_REQUIRE_EQUAL (results.size (), 4u);
+  BOOST_CHECK_EQUAL (results[0].type (), Value::NONE);
+  BOOST_CHECK_EQUAL (results[3].intValue (), 5);
+  BOOST_CHECK_EQUAL (second.sum, 6.);
+  // The calls received the previous parameters of the commands.
+  BOOST_CHECK (calls[0].arguments.empty ());
+  BOOST_CHECK_EQUAL (calls[2].arguments[0].intValue (), 2);
+
+  // Nothing is executed if a call is wrong.
+  calls = makeCalls ();
+  calls[3].command = "missing";
+  BOOST_CHECK_THROW (pool->executeCommands (calls, results), ExceptionFactory);
+  calls = makeCalls ();
+  calls[3].command = "add";
+  BOOST_CHECK_THROW (pool->executeCommands (calls, results), ExceptionAbstract);
+  BOOST_CHECK_EQUAL (first.count, 5);
+}
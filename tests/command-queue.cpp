@@ -0,0 +1,188 @@
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dynamic-graph is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public License
+// along with dynamic-graph.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <dynamic-graph/all-commands.h>
+#include <dynamic-graph/command-queue.h>
+#include <dynamic-graph/entity.h>
+#include <dynamic-graph/exception-abstract.h>
+
+#define BOOST_TEST_MODULE command_queue
+
+#include <boost/test/unit_test.hpp>
+
+using namespace dynamicgraph;
+using command::CommandFuture;
+using command::CommandQueue;
+using command::Value;
+
+namespace dynamicgraph
+{
+  class QueuedEntity : public Entity
+  {
+  public:
+    static const std::string CLASS_NAME;
+    virtual const std::string& getClassName () const { return CLASS_NAME; }
+
+    QueuedEntity (const std::string& name)
+      : Entity (name), count (0)
+    {
+      using namespace command;
+      addCommand ("add", makeCommandVoid1
+		  (*this, &QueuedEntity::add,
+		   docCommandVoid1 ("Add to the counter.", "int")));
+      addCommand ("getCount", makeDirectGetter
+		  (*this, &count, docDirectGetter ("counter", "int")));
+    }
+
+    void add (const int& n)
+    {
+      if (n == -2)
+	throw n;
+      if (n < 0)
+	throw ExceptionAbstract (ExceptionAbstract::TOOLS, "negative");
+      count += n;
+    }
+
+    int count;
+  };
+  const std::string QueuedEntity::CLASS_NAME = "QueuedEntity";
+}
+
+static CommandFuture enqueueAdd (CommandQueue& queue, QueuedEntity& entity,
+				 int n)
+{
+  std::vector<Value> arguments (1, Value (n));
+  return queue.enqueue (*entity.getNewStyleCommand ("add"), arguments);
+}
+
+BOOST_AUTO_TEST_CASE (futures)
+{
+  QueuedEntity entity ("entity");
+  CommandQueue queue (2);
+  CommandFuture first = enqueueAdd (queue, entity, 2);
+  CommandFuture failing = enqueueAdd (queue, entity, -1);
+  BOOST_CHECK_THROW (enqueueAdd (queue, entity, 1), ExceptionAbstract);
+  std::vector<Value> wrong (1, Value (1.));
+  BOOST_CHECK_THROW (queue.enqueue (*entity.getNewStyleCommand ("add"), wrong),
+		     ExceptionAbstract);
+  BOOST_CHECK (!first.ready ());
+  BOOST_CHECK_EQUAL (entity.count, 0);
+
+  // At most one command per tick.
+  BOOST_CHECK_EQUAL (queue.execute (1), 1u);
+  BOOST_CHECK (first.ready ());
+  BOOST_CHECK (!failing.ready ());
+  BOOST_CHECK_EQUAL (entity.count, 2);
+  BOOST_CHECK_EQUAL (first.get ().type (), Value::NONE);
+  BOOST_CHECK (first.latency () >= 0.);
+  BOOST_CHECK_EQUAL (queue.execute (1), 1u);
+  BOOST_CHECK_EQUAL (queue.execute (1), 0u);
+  try
+    {
+      failing.get ();
+      BOOST_ERROR ("the exception of the command should be passed");
+    }
+  catch (const ExceptionAbstract& exc)
+    {
+      BOOST_CHECK_EQUAL (exc.getStringMessage (), "negative");
+    }
+
+  // Any exception fails the future, and frees the slot of the command.
+  CommandFuture unknown = enqueueAdd (queue, entity, -2);
+  BOOST_CHECK_EQUAL (queue.execute (1), 1u);
+  BOOST_CHECK_EQUAL (queue.size (), 0u);
+  try
+    {
+      unknown.get ();
+      BOOST_ERROR ("the exception of the command should be passed");
+    }
+  catch (const ExceptionAbstract& exc)
+    {
+      BOOST_CHECK_EQUAL (exc.getStringMessage (), "unknown exception");
+    }
+  enqueueAdd (queue, entity, 1);
+  enqueueAdd (queue, entity, -1);
+  BOOST_CHECK_EQUAL (queue.execute (2), 2u);
+  BOOST_CHECK_EQUAL (entity.count, 3);
+
+  std::vector<Value> none;
+  CommandFuture count =
+    queue.enqueue (*entity.getNewStyleCommand ("getCount"), none);
+  queue.execute (10);
+  BOOST_CHECK_EQUAL (count.get ().intValue (), 3);
+}
+
+// Thread evaluating the graph, executing the queued commands at each
+// tick.
+struct ControlLoop
+{
+  ControlLoop (CommandQueue& queue, QueuedEntity& entity,
+	       boost::atomic<bool>& stop, int& maxCount)
+    : queue (queue), entity (entity), stop (stop), maxCount (maxCount)
+  {}
+
+  void operator() () const
+  {
+    while (!stop)
+      {
+	queue.execute (4);
+	maxCount = std::max (maxCount, entity.count);
+	boost::this_thread::yield ();
+      }
+    queue.execute (queue.capacity ());
+  }
+
+  CommandQueue& queue;
+  QueuedEntity& entity;
+  boost::atomic<bool>& stop;
+  int& maxCount;
+};
+
+static void addMany (CommandQueue& queue, QueuedEntity& entity)
+{
+  for (int i = 0; i < 1000; ++i)
+    {
+      CommandFuture future = enqueueAdd (queue, entity, 1);
+      future.wait ();
+    }
+}
+
+BOOST_AUTO_TEST_CASE (threads)
+{
+  QueuedEntity entity ("entity");
+  CommandQueue queue (16);
+  boost::atomic<bool> stop (false);
+  int maxCount = 0;
+  boost::thread loop ((ControlLoop (queue, entity, stop, maxCount)));
+  boost::thread_group producers;
+  for (int i = 0; i < 4; ++i)
+    producers.create_thread (boost::bind (&addMany, boost::ref (queue),
+					  boost::ref (entity)));
+  producers.join_all ();
+  stop = true;
+  loop.join ();
+  // The entity is only written by the control loop.
+  BOOST_CHECK_EQUAL (entity.count, 4000);
+  BOOST_CHECK_EQUAL (maxCount, 4000);
+  BOOST_CHECK_EQUAL (queue.size (), 0u);
+}
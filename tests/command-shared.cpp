@@ -0,0 +1,257 @@
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dynamic-graph is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public License
+// along with dynamic-graph.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/assign/list_of.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <dynamic-graph/all-commands.h>
+#include <dynamic-graph/entity.h>
+#include <dynamic-graph/exception-factory.h>
+#include <dynamic-graph/factory.h>
+#include <dynamic-graph/pool.h>
+
+#define BOOST_TEST_MODULE command_shared
+
+#include <boost/test/unit_test.hpp>
+
+using namespace dynamicgraph;
+using boost::assign::list_of;
+using command::Value;
+
+namespace dynamicgraph
+{
+  // Entity creating one command object per instance.
+  class InstanceCommandEntity : public Entity
+  {
+  public:
+    static const std::string CLASS_NAME;
+    virtual const std::string& getClassName () const { return CLASS_NAME; }
+
+    InstanceCommandEntity (const std::string& name)
+      : Entity (name), gain (0.), count (0)
+    {
+      using namespace command;
+      addCommand ("setGain", makeDirectSetter
+		  (*this, &gain, docDirectSetter ("gain", "double")));
+      addCommand ("getGain", makeDirectGetter
+		  (*this, &gain, docDirectGetter ("gain", "double")));
+      addCommand ("reset", makeCommandVoid0
+		  (*this, &InstanceCommandEntity::reset,
+		   docCommandVoid0 ("Reset the counter.")));
+      addCommand ("add", makeCommandVoid1
+		  (*this, &InstanceCommandEntity::add,
+		   docCommandVoid1 ("Add to the counter.", "int")));
+      addCommand ("addScaled", makeCommandVoid2
+		  (*this, &InstanceCommandEntity::addScaled,
+		   docCommandVoid2 ("Add to the counter.", "int", "double")));
+    }
+
+    void reset () { count = 0; }
+    void add (const int& n) { count += n; }
+    void addScaled (const int& n, const double& scale)
+    {
+      count += static_cast<int> (n * scale);
+    }
+
+    double gain;
+    int count;
+  };
+  const std::string InstanceCommandEntity::CLASS_NAME = "InstanceCommandEntity";
+
+  // Same commands, shared by the instances of the class.
+  class SharedCommandEntity : public Entity
+  {
+  public:
+    static const std::string CLASS_NAME;
+    virtual const std::string& getClassName () const { return CLASS_NAME; }
+
+    SharedCommandEntity (const std::string& name)
+      : Entity (name), gain (0.), count (0)
+    {
+      static const command::ClassCommands commands (&addCommands);
+      setClassCommands (commands);
+    }
+
+    void reset () { count = 0; }
+    void add (const int& n) { count += n; }
+    void addScaled (const int& n, const double& scale)
+    {
+      count += static_cast<int> (n * scale);
+    }
+    void resetToTen () { count = 10; }
+
+    // Override the reset class command on this instance.
+    void overrideReset ()
+    {
+      addCommand ("reset", command::makeCommandVoid0
+		  (*this, &SharedCommandEntity::resetToTen,
+		   command::docCommandVoid0 ("Reset the counter to 10.")));
+    }
+
+    double gain;
+    int count;
+
+  private:
+    static void addCommands (command::ClassCommands& commands)
+    {
+      using namespace command;
+      commands.add ("setGain", makeSharedDirectSetter
+		    (&SharedCommandEntity::gain,
+		     docDirectSetter ("gain", "double")));
+      commands.add ("getGain", makeSharedDirectGetter
+		    (&SharedCommandEntity::gain,
+		     docDirectGetter ("gain", "double")));
+      commands.add ("reset", makeSharedCommandVoid0
+		    (&SharedCommandEntity::reset,
+		     docCommandVoid0 ("Reset the counter.")));
+      commands.add ("add", makeSharedCommandVoid1
+		    (&SharedCommandEntity::add,
+		     docCommandVoid1 ("Add to the counter.", "int")));
+      commands.add ("addScaled", makeSharedCommandVoid2
+		    (&SharedCommandEntity::addScaled,
+		     docCommandVoid2 ("Add to the counter.", "int", "double")));
+    }
+  };
+  const std::string SharedCommandEntity::CLASS_NAME = "SharedCommandEntity";
+
+  // Shared commands, one of which is overridden by some instances.
+  class OverridingEntity : public SharedCommandEntity
+  {
+  public:
+    OverridingEntity (const std::string& name)
+      : SharedCommandEntity (name)
+    {
+      overrideReset ();
+    }
+  };
+}
+
+static Value run (Entity& entity, const std::string& name,
+		  const std::vector<Value>& values = std::vector<Value> ())
+{
+  command::Command* command = entity.getNewStyleCommand (name);
+  command->setParameterValues (values);
+  return command->execute ();
+}
+
+BOOST_AUTO_TEST_CASE (shared_dispatch)
+{
+  SharedCommandEntity a ("shared-a");
+  SharedCommandEntity b ("shared-b");
+  BOOST_CHECK (a.getClassCommands () == b.getClassCommands ());
+  BOOST_CHECK (a.getCommands ().empty ());
+  // Bound at construction: looking them up does not modify the entity.
+  BOOST_CHECK_EQUAL (a.getBoundCommands ().size (), 5u);
+
+  run (a, "setGain", list_of (Value (2.5)));
+  run (b, "setGain", list_of (Value (-1.)));
+  BOOST_CHECK_EQUAL (a.gain, 2.5);
+  BOOST_CHECK_EQUAL (b.gain, -1.);
+  BOOST_CHECK_EQUAL (run (a, "getGain").doubleValue (), 2.5);
+
+  run (a, "add", list_of (Value (3)));
+  run (a, "addScaled", list_of (Value (2)) (Value (2.)));
+  BOOST_CHECK_EQUAL (a.count, 7);
+  BOOST_CHECK_EQUAL (b.count, 0);
+  run (a, "reset");
+  BOOST_CHECK_EQUAL (a.count, 0);
+
+  // The bound command keeps the shared prototype.
+  command::Command* add = a.getNewStyleCommand ("add");
+  BOOST_CHECK (add == a.getNewStyleCommand ("add"));
+  BOOST_CHECK (&add->owner () == &a);
+  BOOST_CHECK_EQUAL (add->valueTypes ().size (), 1u);
+  BOOST_CHECK_EQUAL (add->valueTypes ()[0], Value::INT);
+  BOOST_CHECK_THROW (add->setParameterValues (list_of (Value (1.))),
+		     ExceptionAbstract);
+
+  const Entity::CommandMap_t commands = b.getNewStyleCommandMap ();
+  BOOST_CHECK_EQUAL (commands.size (), 5u);
+  BOOST_CHECK (commands.find ("add")->second == b.getNewStyleCommand ("add"));
+  BOOST_CHECK_EQUAL (commands.find ("add")->second->getDocstring (),
+		     add->getDocstring ());
+  BOOST_CHECK_THROW (a.getNewStyleCommand ("unknown"), ExceptionFactory);
+}
+
+BOOST_AUTO_TEST_CASE (shared_override)
+{
+  SharedCommandEntity plain ("plain");
+  OverridingEntity overriding ("overriding");
+
+  run (plain, "add", list_of (Value (4)));
+  run (plain, "reset");
+  BOOST_CHECK_EQUAL (plain.count, 0);
+
+  run (overriding, "add", list_of (Value (4)));
+  run (overriding, "reset");
+  BOOST_CHECK_EQUAL (overriding.count, 10);
+  BOOST_CHECK_EQUAL (overriding.getNewStyleCommand ("reset")->getDocstring (),
+		     command::docCommandVoid0 ("Reset the counter to 10."));
+  BOOST_CHECK_EQUAL (overriding.getNewStyleCommandMap ().size (), 5u);
+  BOOST_CHECK (overriding.getNewStyleCommandMap ().find ("reset")
+	       ->second == overriding.getNewStyleCommand ("reset"));
+
+  // An instance command overrides a class command already bound.
+  SharedCommandEntity late ("late");
+  command::Command* shared = late.getNewStyleCommand ("reset");
+  BOOST_CHECK_NO_THROW (late.overrideReset ());
+  BOOST_CHECK (late.getNewStyleCommand ("reset") != shared);
+  run (late, "reset");
+  BOOST_CHECK_EQUAL (late.count, 10);
+}
+
+// Compare the construction of entities creating their commands with
+// entities sharing the commands of their class.
+BOOST_AUTO_TEST_CASE (construction_benchmark)
+{
+  const int nbEntities = 5000;
+  using boost::posix_time::microsec_clock;
+  using boost::posix_time::ptime;
+
+  std::vector<Entity*> entities;
+  entities.reserve (nbEntities);
+  ptime start = microsec_clock::local_time ();
+  for (int i = 0; i < nbEntities; ++i)
+    {
+      std::ostringstream name; name << "instance-" << i;
+      entities.push_back (new InstanceCommandEntity (name.str ()));
+    }
+  const double tInstance =
+    static_cast<double> ((microsec_clock::local_time () - start)
+			 .total_microseconds ()) * 1e-6;
+  for (std::size_t i = 0; i < entities.size (); ++i) delete entities[i];
+  entities.clear ();
+
+  start = microsec_clock::local_time ();
+  for (int i = 0; i < nbEntities; ++i)
+    {
+      std::ostringstream name; name << "shared-" << i;
+      entities.push_back (new SharedCommandEntity (name.str ()));
+    }
+  const double tShared =
+    static_cast<double> ((microsec_clock::local_time () - start)
+			 .total_microseconds ()) * 1e-6;
+  BOOST_CHECK (entities.back ()->getCommands ().empty ());
+  for (std::size_t i = 0; i < entities.size (); ++i) delete entities[i];
+
+  std::cout << "Constructing " << nbEntities << " entities with 5 commands:\n"
+	    << "  per-instance commands: " << tInstance << " s\n"
+	    << "  shared commands:       " << tShared << " s" << std::endl;
+}
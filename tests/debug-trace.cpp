@@ -0,0 +1,177 @@
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dynamic-graph is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public License
+// along with dynamic-graph.  If not, see <http://www.gnu.org/licenses/>.
+
+#define VP_DEBUG
+#define VP_DEBUG_MODE 10
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+
+#include <dynamic-graph/debug.h>
+
+#define BOOST_TEST_MODULE debug_trace
+
+#include <boost/test/unit_test.hpp>
+
+using namespace dynamicgraph;
+
+static const char* filename = "debug-trace.txt";
+
+static std::vector<std::string> readLines ()
+{
+  std::vector<std::string> lines;
+  std::ifstream file (filename);
+  std::string line;
+  while (std::getline (file, line)) lines.push_back (line);
+  return lines;
+}
+
+static int nbEvaluations = 0;
+
+static int evaluate ()
+{
+  return ++nbEvaluations;
+}
+
+BOOST_AUTO_TEST_CASE (levels)
+{
+  DebugTrace::openFile (filename);
+  dgDEBUGFLOW.setTraceLevel (5);
+  // The arguments of the filtered traces are not evaluated.
+  dgDEBUG (8) << evaluate () << std::endl;
+  dgDEBUGF (8, "value %d", 8);
+  BOOST_CHECK_EQUAL (nbEvaluations, 0);
+  dgDEBUG (5) << "value " << evaluate () << std::endl;
+  dgDEBUGF (3, "value %d", 2);
+
+  dgDEBUGFLOW.setTraceLevel (10);
+  BOOST_CHECK (dgDEBUG_ENABLE (8));
+  dgDEBUG (8) << "value " << evaluate () << std::endl;
+  dgERROR << "error" << std::endl;
+  DebugTrace::closeFile (filename);
+  // Closed: nothing is written.
+  dgDEBUG (1) << evaluate () << std::endl;
+  BOOST_CHECK_EQUAL (nbEvaluations, 2);
+  BOOST_CHECK (!dgDEBUG_ENABLE (1));
+
+  std::vector<std::string> lines = readLines ();
+  BOOST_REQUIRE_EQUAL (lines.size (), 4u);
+  BOOST_CHECK (lines[0].find (":value 1") != std::string::npos);
+  BOOST_CHECK (lines[1].find (":value 2") != std::string::npos);
+  BOOST_CHECK (lines[2].find (":value 2") != std::string::npos);
+  BOOST_CHECK_EQUAL (lines[3].substr (0, 4), "\t!! ");
+  BOOST_CHECK (lines[3].find (":error") != std::string::npos);
+}
+
+// Trace written while the arguments of another one are evaluated.
+static int nested ()
+{
+  dgDEBUG (1) << "inner" << std::endl;
+  return 1;
+}
+
+static void writeTraces (int thread)
+{
+  for (int i = 0; i < 1000; ++i)
+    dgDEBUGMUTE (1) << "thread " << thread << " trace " << i << std::endl;
+}
+
+BOOST_AUTO_TEST_CASE (threads)
+{
+  DebugTrace::openFile (filename);
+  dgDEBUGFLOW.setTraceLevel (10);
+  dgDEBUG (1) << "outer " << nested () << std::endl;
+  boost::thread_group threads;
+  for (int i = 0; i < 4; ++i)
+    threads.create_thread (boost::bind (&writeTraces, i));
+  threads.join_all ();
+  DebugTrace::closeFile (filename);
+
+  // The traces are not mixed, and those of a thread are in order.
+  std::vector<std::string> lines = readLines ();
+  BOOST_REQUIRE_EQUAL (lines.size (), 4002u);
+  BOOST_CHECK (lines[0].find (":inner") != std::string::npos);
+  BOOST_CHECK (lines[1].find (":outer 1") != std::string::npos);
+  std::vector<int> next (4, 0);
+  for (std::size_t i = 2; i < lines.size (); ++i)
+    {
+      int thread, trace;
+      BOOST_REQUIRE_EQUAL (std::sscanf (lines[i].c_str (), "thread %d trace %d",
+					&thread, &trace), 2);
+      BOOST_REQUIRE (thread >= 0 && thread < 4);
+      BOOST_CHECK_EQUAL (trace, next[thread]++);
+    }
+  std::remove (filename);
+}
+
+static void writeManyTraces (int thread)
+{
+  for (int i = 0; i < 20000; ++i)
+    dgDEBUGMUTE (1) << "thread " << thread << " trace " << i << std::endl;
+}
+
+BOOST_AUTO_TEST_CASE (overflow)
+{
+  DebugTrace::openFile (filename);
+  dgDEBUGFLOW.setTraceLevel (10);
+  // Longer than an entry of the logger: written as a single line.
+  const std::string longTrace (2000, 'a');
+  dgDEBUGMUTE (1) << longTrace << std::endl;
+  boost::thread_group threads;
+  for (int i = 0; i < 4; ++i)
+    threads.create_thread (boost::bind (&writeManyTraces, i));
+  threads.join_all ();
+  DebugTrace::closeFile (filename);
+
+  // Every trace is either written or counted as dropped.
+  std::vector<std::string> lines = readLines ();
+  BOOST_REQUIRE (!lines.empty ());
+  BOOST_CHECK_EQUAL (lines[0], longTrace);
+  unsigned long nbTraces = 0;
+  for (std::size_t i = 1; i < lines.size (); ++i)
+    {
+      int thread, trace;
+      unsigned long dropped;
+      if (std::sscanf (lines[i].c_str (), "thread %d trace %d",
+		       &thread, &trace) == 2)
+	++nbTraces;
+      else if (std::sscanf (lines[i].c_str (), "\t!! %lu traces dropped",
+			    &dropped) == 1)
+	nbTraces += dropped;
+      else
+	BOOST_ERROR ("Unexpected trace: " + lines[i]);
+    }
+  BOOST_CHECK_EQUAL (nbTraces, 80000ul);
+  std::remove (filename);
+}
+
+BOOST_AUTO_TEST_CASE (other_stream)
+{
+  // A trace on another stream does not depend on the debug file.
+  std::ostringstream os;
+  DebugTrace trace (os, "-- ");
+  BOOST_CHECK (trace.enabled ());
+  BOOST_CHECK (!dgDEBUGFLOW.enabled ());
+  trace.trace (1, "value %d", 1);
+  // Waits for the traces already written.
+  DebugTrace::closeFile (filename);
+  BOOST_CHECK (trace.enabled ());
+  BOOST_CHECK_EQUAL (os.str (), "value 1\n");
+}
@@ -13,9 +13,12 @@
 // You should have received a copy of the GNU Lesser General Public License
 // along with dynamic-graph.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <cstdlib>
+#include <map>
 #include <sstream>
 #include <dynamic-graph/entity.h>
 #include <dynamic-graph/exception-factory.h>
+#include <dynamic-graph/signal-helper.h>
 #include "dynamic-graph/factory.h"
 #include "dynamic-graph/pool.h"
 
@@ -42,6 +45,26 @@ namespace dynamicgraph
     }
   };
   DYNAMICGRAPH_FACTORY_ENTITY_PLUGIN (CustomEntity,"CustomEntity");
+
+  class SignalEntity : public Entity
+  {
+  public:
+    static const std::string CLASS_NAME;
+    virtual const std::string& getClassName () const
+    {
+      return CLASS_NAME;
+    }
+    SignalEntity (const std::string n)
+      : Entity (n)
+      ,CONSTRUCT_SIGNAL_IN (position, double)
+      ,CONSTRUCT_SIGNAL (velocity, OUT, double)
+    {
+      signalRegistration (velocitySOUT << positionSIN);
+    }
+    DECLARE_SIGNAL_IN (position, double);
+    DECLARE_SIGNAL (velocity, OUT, double);
+  };
+  DYNAMICGRAPH_FACTORY_ENTITY_PLUGIN (SignalEntity,"SignalEntity");
 }
 
 
@@ -153,3 +176,71 @@ BOOST_AUTO_TEST_CASE (wtf)
 
   entity.test2 (static_cast<dynamicgraph::SignalBase<int>*> (0));
 }
+
+BOOST_AUTO_TEST_CASE (signal_names)
+{
+  dynamicgraph::SignalEntity a ("a");
+  dynamicgraph::SignalEntity b ("b");
+
+  BOOST_CHECK_EQUAL (a.positionSIN.getName (),
+		     "SignalEntity(a)::input(double)::position");
+  BOOST_CHECK_EQUAL (a.velocitySOUT.getName (),
+		     "SignalEntity(a)::OUTput(double)::velocity");
+  BOOST_CHECK_EQUAL (a.positionSIN.shortName (), "position");
+  BOOST_CHECK_EQUAL (a.positionSIN.getNodeName ().str (), "a");
+  BOOST_CHECK_EQUAL (a.positionSIN.getNodeClassName ().str (), "SignalEntity");
+  BOOST_CHECK_EQUAL (&a.getSignal ("velocity"), &a.velocitySOUT);
+
+  // Components are shared between the signals.
+  BOOST_CHECK (a.positionSIN.getLocalName () == b.positionSIN.getLocalName ());
+  BOOST_CHECK (&a.positionSIN.getLocalName ().str ()
+	       == &b.positionSIN.getLocalName ().str ());
+  BOOST_CHECK (a.positionSIN.getNodeName () == a.velocitySOUT.getNodeName ());
+  BOOST_CHECK (a.positionSIN.getNodeName () != b.positionSIN.getNodeName ());
+  // The signals store no string of their own.
+  BOOST_CHECK_LE (sizeof (dynamicgraph::SignalBase<int>), 6 * sizeof (void*));
+  dynamicgraph::SignalBase<int> unnamed ("no entity:signal");
+  BOOST_CHECK_EQUAL (unnamed.getName (), "no entity:signal");
+  BOOST_CHECK (unnamed.getNodeName ().empty ());
+
+  std::string localName, nodeName;
+  b.velocitySOUT.ExtractNodeAndLocalNames (localName, nodeName);
+  BOOST_CHECK_EQUAL (localName, "velocity");
+  BOOST_CHECK_EQUAL (nodeName, "b");
+
+  // Signals are listed by name, whatever the registration order.
+  output_test_stream output;
+  b.writeCompletionList (output);
+  BOOST_CHECK (output.is_equal ("b.position\nb.velocity\n"
+				+ b.getCommandList () + "\n"));
+}
+
+// Compare InternedMap with std::map on random insertions and erasures.
+BOOST_AUTO_TEST_CASE (interned_map)
+{
+  dynamicgraph::InternedMap<int> map;
+  std::map<std::string, int> reference;
+  std::srand (42);
+  for (int i = 0; i < 20000; ++i)
+    {
+      std::ostringstream key;
+      key << "key" << std::rand () % 300;
+      if (std::rand () % 3 == 0)
+	BOOST_CHECK_EQUAL (map.erase (key.str ()),
+			   reference.erase (key.str ()) == 1);
+      else
+	BOOST_CHECK_EQUAL
+	  (map.insert (dynamicgraph::InternedString (key.str ()), i),
+	   reference.insert (std::make_pair (key.str (), i)).second);
+    }
+
+  BOOST_CHECK_EQUAL (map.size (), reference.size ());
+  for (std::map<std::string, int>::const_iterator it = reference.begin ();
+       it != reference.end (); ++it)
+    {
+      const int* value = map.find (it->first);
+      BOOST_REQUIRE (value != NULL);
+      BOOST_CHECK_EQUAL (*value, it->second);
+    }
+  BOOST_CHECK (map.find (std::string ("unknown")) == NULL);
+}
@@ -0,0 +1,135 @@
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dynamic-graph is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public License
+// along with dynamic-graph.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <dynamic-graph/exception-traces.h>
+#include <dynamic-graph/flight-recorder.h>
+#include <dynamic-graph/real-time-logger.h>
+
+#define BOOST_TEST_MODULE flight_recorder
+
+#include <boost/test/unit_test.hpp>
+
+using namespace dynamicgraph;
+
+static std::string dump (const FlightRecorder& recorder)
+{
+  std::ostringstream os;
+  recorder.dump (os);
+  return os.str ();
+}
+
+static std::string readFile (const std::string& filename)
+{
+  std::ifstream file (filename.c_str ());
+  std::ostringstream os;
+  os << file.rdbuf ();
+  return os.str ();
+}
+
+BOOST_AUTO_TEST_CASE (ring)
+{
+  FlightRecorder recorder (32);
+  BOOST_CHECK_EQUAL (dump (recorder), "");
+  recorder.write ("first\n");
+  recorder.write ("second\n");
+  BOOST_CHECK_EQUAL (dump (recorder), "first\nsecond\n");
+
+  // The oldest entries are overwritten, and the dump starts at the
+  // first complete entry.
+  recorder.write ("third entry\n");
+  recorder.write ("fourth entry\n");
+  BOOST_CHECK_EQUAL (recorder.size (), 32u);
+  BOOST_CHECK_EQUAL (dump (recorder), "third entry\nfourth entry\n");
+
+  // An entry longer than the ring keeps its end.
+  recorder.write (std::string (40, 'a').c_str ());
+  BOOST_CHECK_EQUAL (dump (recorder), "");
+  recorder.write ("\nlast\n");
+  BOOST_CHECK_EQUAL (dump (recorder), "last\n");
+
+  recorder.dump ("flight-recorder.log");
+  BOOST_CHECK_EQUAL (readFile ("flight-recorder.log"), "last\n");
+  std::remove ("flight-recorder.log");
+  BOOST_CHECK_THROW (recorder.dump ("missing-directory/flight-recorder.log"),
+		     ExceptionTraces);
+}
+
+BOOST_AUTO_TEST_CASE (logger_output)
+{
+  RealTimeLogger rtl (100);
+  FlightRecorder* recorder = new FlightRecorder (1 << 20);
+  const LoggerStreamPtr_t output (recorder);
+  rtl.addOutputStream (output);
+  for (int i = 0; i < 50; ++i)
+    rtl.front () << "entry " << i << '\n';
+  rtl.log ("value {}\n", 1.5);
+  rtl.spin ();
+  const std::string text = dump (*recorder);
+  BOOST_CHECK_EQUAL (text.compare (0, 16, "entry 0\nentry 1\n"), 0);
+  BOOST_CHECK (text.find ("entry 49\n[") != std::string::npos);
+  BOOST_CHECK_EQUAL (text.substr (text.size () - 10), "value 1.5\n");
+
+  // Once removed, the recorder is no longer written.
+  rtl.removeOutputStream (output);
+  rtl.front () << "removed\n";
+  rtl.spin ();
+  BOOST_CHECK_EQUAL (dump (*recorder), text);
+}
+
+BOOST_AUTO_TEST_CASE (crash_dump)
+{
+  const std::string filename = "flight-recorder-crash.log";
+  std::remove (filename.c_str ());
+  const pid_t pid = fork ();
+  BOOST_REQUIRE (pid >= 0);
+  if (pid == 0)
+    {
+      // Do not let the test framework catch the signal in the child.
+      signal (SIGABRT, SIG_DFL);
+      FlightRecorder recorder (1024);
+      recorder.installCrashHandler (filename);
+      recorder.write ("before the crash\n");
+      std::abort ();
+    }
+  int status;
+  BOOST_REQUIRE_EQUAL (waitpid (pid, &status, 0), pid);
+  BOOST_CHECK (WIFSIGNALED (status));
+  if (WIFSIGNALED (status))
+    BOOST_CHECK_EQUAL (WTERMSIG (status), SIGABRT);
+  BOOST_CHECK_EQUAL (readFile (filename), "before the crash\n");
+  std::remove (filename.c_str ());
+
+  // Uninstalled with the recorder.
+  struct sigaction action;
+  {
+    FlightRecorder recorder (16);
+    sigaction (SIGSEGV, NULL, &action);
+    BOOST_CHECK (recorder.installCrashHandler (filename));
+  }
+  struct sigaction restored;
+  sigaction (SIGSEGV, NULL, &restored);
+  BOOST_CHECK (restored.sa_handler == action.sa_handler);
+}
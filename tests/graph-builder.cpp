@@ -0,0 +1,311 @@
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dynamic-graph is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public License
+// along with dynamic-graph.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <utime.h>
+
+#include <boost/assign/list_of.hpp>
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <dynamic-graph/command-bind.h>
+#include <dynamic-graph/command-direct-setter.h>
+#include <dynamic-graph/entity.h>
+#include <dynamic-graph/exception-factory.h>
+#include <dynamic-graph/factory.h>
+#include <dynamic-graph/graph-builder.h>
+#include <dynamic-graph/linear-algebra.h>
+#include <dynamic-graph/pool.h>
+#include <dynamic-graph/signal-ptr.h>
+#include <dynamic-graph/signal-time-dependent.h>
+
+#define BOOST_TEST_MODULE graph_builder
+
+#include <boost/test/unit_test.hpp>
+
+using namespace dynamicgraph;
+using boost::assign::list_of;
+using command::Value;
+
+struct GainEntity : public Entity
+{
+  static const std::string CLASS_NAME;
+
+  GainEntity (const std::string& name)
+    : Entity (name),
+      gain (1.),
+      inSIN (NULL, "GainEntity(" + name + ")::input(double)::in"),
+      outSOUT (boost::bind (&GainEntity::compute, this, _1, _2), inSIN,
+	       "GainEntity(" + name + ")::output(double)::out"),
+      vectorSOUT ("GainEntity(" + name + ")::output(vector)::vector")
+  {
+    signalRegistration (inSIN << outSOUT << vectorSOUT);
+    addCommand ("setGain", command::makeDirectSetter
+		(*this, &gain, command::docDirectSetter ("gain", "double")));
+    addCommand ("fail", command::makeCommandVoid0
+		(*this, &GainEntity::fail, command::docCommandVoid0 ("Throw.")));
+  }
+
+  void fail ()
+  {
+    DG_THROW ExceptionFactory (ExceptionFactory::GENERIC, "Failing command.");
+  }
+
+  double& compute (double& res, int t)
+  {
+    res = gain * inSIN (t);
+    return res;
+  }
+
+  virtual const std::string& getClassName () const
+  {
+    return CLASS_NAME;
+  }
+
+  double gain;
+  SignalPtr<double, int> inSIN;
+  SignalTimeDependent<double, int> outSOUT;
+  Signal<Vector, int> vectorSOUT;
+};
+
+DYNAMICGRAPH_FACTORY_ENTITY_PLUGIN (GainEntity, "GainEntity");
+
+static std::string entityName (const std::string& prefix, int i)
+{
+  std::ostringstream os;
+  os << prefix << i;
+  return os.str ();
+}
+
+BOOST_AUTO_TEST_CASE (build_chain)
+{
+  PoolStorage* pool = PoolStorage::getInstance ();
+  GainEntity* source = new GainEntity ("chain-source");
+  source->inSIN.setConstant (1.);
+
+  // A chain of entities doubling the output of the previous one.
+  const int nbEntities = 20;
+  GraphBuilder builder (4);
+  for (int i = 0; i < nbEntities; ++i)
+    {
+      const std::string name = entityName ("chain", i);
+      builder.newEntity ("GainEntity", name);
+      builder.plug (i == 0 ? "chain-source.out"
+		    : entityName ("chain", i - 1) + ".out", name + ".in");
+      builder.runCommand (name, "setGain", list_of (Value (2.)));
+    }
+  BOOST_CHECK_EQUAL (builder.size (), static_cast<std::size_t> (nbEntities));
+  builder.build ();
+  BOOST_CHECK_EQUAL (builder.size (), 0u);
+
+  Entity* last;
+  BOOST_REQUIRE (pool->existEntity (entityName ("chain", nbEntities - 1), last));
+  BOOST_CHECK_EQUAL (static_cast<GainEntity*> (last)->outSOUT (1),
+		     static_cast<double> (1 << nbEntities));
+
+  for (int i = 0; i < nbEntities; ++i)
+    delete &pool->getEntity (entityName ("chain", i));
+  delete source;
+}
+
+BOOST_AUTO_TEST_CASE (build_errors)
+{
+  PoolStorage* pool = PoolStorage::getInstance ();
+  GainEntity* existing = new GainEntity ("errors-existing");
+  const std::size_t nbEntities = pool->getEntityMap ().size ();
+
+  // All the errors of the declarations are reported at once.
+  GraphBuilder builder;
+  builder.newEntity ("GainEntity", "errors-a");
+  builder.newEntity ("GainEntity", "errors-a");
+  builder.newEntity ("GainEntity", "errors-existing");
+  builder.newEntity ("UnknownClass", "errors-b");
+  builder.plug ("errors-missing.out", "errors-a.in");
+  builder.runCommand ("errors-missing", "setGain");
+  try
+    {
+      builder.build ();
+      BOOST_ERROR ("build should have failed");
+    }
+  catch (const ExceptionFactory& exc)
+    {
+      const std::string message = exc.getStringMessage ();
+      BOOST_CHECK (message.find ("<errors-a> declared twice") != std::string::npos);
+      BOOST_CHECK (message.find ("<errors-existing> already exists") != std::string::npos);
+      BOOST_CHECK (message.find ("class <UnknownClass>") != std::string::npos);
+      BOOST_CHECK (message.find ("<errors-missing> (for signal") != std::string::npos);
+      BOOST_CHECK (message.find ("<errors-missing> (for command") != std::string::npos);
+    }
+  BOOST_CHECK_EQUAL (pool->getEntityMap ().size (), nbEntities);
+
+  // Errors found once the entities are constructed.
+  builder.clear ();
+  builder.newEntity ("GainEntity", "errors-c");
+  builder.plug ("errors-c.missing", "errors-existing.in");
+  builder.runCommand ("errors-c", "setGain", list_of (Value (1)));
+  BOOST_CHECK_THROW (builder.build (), ExceptionFactory);
+  BOOST_CHECK_EQUAL (pool->getEntityMap ().size (), nbEntities);
+
+  // A plug failing undoes the previous ones.
+  existing->inSIN.setConstant (3.);
+  builder.clear ();
+  builder.newEntity ("GainEntity", "errors-d");
+  builder.plug ("errors-d.out", "errors-existing.in");
+  builder.plug ("errors-d.vector", "errors-d.in");
+  BOOST_CHECK_THROW (builder.build (), ExceptionSignal);
+  BOOST_CHECK_EQUAL (pool->getEntityMap ().size (), nbEntities);
+  BOOST_CHECK (existing->inSIN.getPluged () == &existing->inSIN);
+  BOOST_CHECK_EQUAL (existing->outSOUT (1), 3.);
+
+  // The commands of the new entities run first: when one fails, those
+  // of the entities of the pool have not run.
+  builder.clear ();
+  builder.newEntity ("GainEntity", "errors-e");
+  builder.runCommand ("errors-existing", "setGain", list_of (Value (5.)));
+  builder.runCommand ("errors-e", "fail");
+  BOOST_CHECK_THROW (builder.build (), ExceptionFactory);
+  BOOST_CHECK_EQUAL (pool->getEntityMap ().size (), nbEntities);
+  BOOST_CHECK_EQUAL (existing->gain, 1.);
+
+  delete existing;
+}
+
+BOOST_AUTO_TEST_CASE (topology_cache)
+{
+  PoolStorage* pool = PoolStorage::getInstance ();
+  GraphBuilder builder;
+  builder.newEntity ("GainEntity", "topology-a");
+  builder.newEntity ("GainEntity", "topology-b");
+  builder.plug ("topology-a.out", "topology-b.in");
+  builder.addDependency ("topology-b.out", "topology-a.vector");
+  builder.runCommand ("topology-a", "setGain", list_of (Value (3.)));
+  builder.runCommand ("topology-b", "setGain", list_of (Value (-2.)));
+  builder.build ();
+  GainEntity& exported =
+    static_cast<GainEntity&> (pool->getEntity ("topology-a"));
+  exported.inSIN.setConstant (1.);
+  // Neither parameters which are not executed, nor dependencies removed
+  // after construction, are restored.
+  exported.getNewStyleCommand ("setGain")
+    ->setParameterValues (list_of (Value (5.)));
+  exported.outSOUT.removeDependency (exported.inSIN);
+  pool->exportTopology ("topology.dat");
+  delete &pool->getEntity ("topology-a");
+  delete &pool->getEntity ("topology-b");
+
+  BOOST_CHECK (!pool->importTopology ("topology-missing.dat"));
+  BOOST_REQUIRE (pool->importTopology ("topology.dat"));
+  GainEntity& a = static_cast<GainEntity&> (pool->getEntity ("topology-a"));
+  GainEntity& b = static_cast<GainEntity&> (pool->getEntity ("topology-b"));
+  BOOST_CHECK_EQUAL (a.gain, 3.);
+  BOOST_CHECK_EQUAL (b.gain, -2.);
+  BOOST_CHECK (b.inSIN.getPluged () == &a.outSOUT);
+  std::vector<const SignalBase<int>*> dependencies;
+  b.outSOUT.listDependencies (dependencies);
+  BOOST_CHECK_EQUAL (dependencies.size (), 2u);
+  dependencies.clear ();
+  a.outSOUT.listDependencies (dependencies);
+  BOOST_CHECK (dependencies.empty ());
+  a.inSIN.setConstant (1.);
+  BOOST_CHECK_EQUAL (b.outSOUT (1), -6.);
+  delete &a;
+  delete &b;
+
+  // The cache is out of date once the library of a class changed.
+  const std::string library =
+    FactoryStorage::getInstance ()->getEntityLibrary ("GainEntity");
+  struct stat st;
+  BOOST_REQUIRE (stat (library.c_str (), &st) == 0);
+  struct utimbuf times;
+  times.actime = st.st_atime;
+  times.modtime = st.st_mtime + 1;
+  BOOST_REQUIRE (utime (library.c_str (), &times) == 0);
+  BOOST_CHECK (!pool->importTopology ("topology.dat"));
+  BOOST_CHECK (!pool->existEntity ("topology-a"));
+  times.modtime = st.st_mtime;
+  utime (library.c_str (), &times);
+
+  std::remove ("topology.dat");
+}
+
+// Compare the construction of a graph by individual calls with the
+// graph builder.
+BOOST_AUTO_TEST_CASE (build_benchmark)
+{
+  const int nbEntities = 10000;
+  PoolStorage* pool = PoolStorage::getInstance ();
+  FactoryStorage* factory = FactoryStorage::getInstance ();
+  using boost::posix_time::microsec_clock;
+  using boost::posix_time::ptime;
+
+  ptime start = microsec_clock::local_time ();
+  for (int i = 0; i < nbEntities; ++i)
+    {
+      const std::string name = entityName ("serial", i);
+      factory->newEntity ("GainEntity", name);
+      if (i > 0)
+	{
+	  std::istringstream source (entityName ("serial", i - 1) + ".out");
+	  std::istringstream destination (name + ".in");
+	  pool->getSignal (destination).plug (&pool->getSignal (source));
+	}
+      command::Command* setGain =
+	pool->getEntity (name).getNewStyleCommand ("setGain");
+      setGain->setParameterValues (list_of (Value (1.)));
+      setGain->execute ();
+    }
+  const double tSerial =
+    static_cast<double> ((microsec_clock::local_time () - start)
+			 .total_microseconds ()) * 1e-6;
+  for (int i = 0; i < nbEntities; ++i)
+    delete &pool->getEntity (entityName ("serial", i));
+
+  // The builder with one thread, then with the hardware threads: the
+  // difference is the gain of the parallel construction.
+  const unsigned nbThreads[] = { 1, 0 };
+  double tBulk[2];
+  for (int run = 0; run < 2; ++run)
+    {
+      start = microsec_clock::local_time ();
+      GraphBuilder builder (nbThreads[run]);
+      for (int i = 0; i < nbEntities; ++i)
+	{
+	  const std::string name = entityName ("bulk", i);
+	  builder.newEntity ("GainEntity", name);
+	  if (i > 0)
+	    builder.plug (entityName ("bulk", i - 1) + ".out", name + ".in");
+	  builder.runCommand (name, "setGain", list_of (Value (1.)));
+	}
+      builder.build ();
+      tBulk[run] = static_cast<double>
+	((microsec_clock::local_time () - start).total_microseconds ()) * 1e-6;
+      BOOST_CHECK (pool->existEntity (entityName ("bulk", nbEntities - 1)));
+      for (int i = 0; i < nbEntities; ++i)
+	delete &pool->getEntity (entityName ("bulk", i));
+    }
+
+  std::cout << "Building a graph of " << nbEntities << " entities:\n"
+	    << "  individual calls:         " << tSerial << " s\n"
+	    << "  GraphBuilder, 1 thread:   " << tBulk[0] << " s\n"
+	    << "  GraphBuilder, " << boost::thread::hardware_concurrency ()
+	    << " threads:  " << tBulk[1] << " s" << std::endl;
+}
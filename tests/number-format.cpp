@@ -0,0 +1,150 @@
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dynamic-graph is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public License
+// along with dynamic-graph.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+
+#include <boost/cstdint.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <dynamic-graph/linear-algebra.h>
+#include <dynamic-graph/number-format.h>
+#include <dynamic-graph/signal.h>
+
+#define BOOST_TEST_MODULE number_format
+
+#include <boost/test/unit_test.hpp>
+
+using namespace dynamicgraph;
+
+static std::string format (double value)
+{
+  char buffer[DOUBLE_MAX_CHARS];
+  return std::string (buffer, formatDouble (buffer, value));
+}
+
+BOOST_AUTO_TEST_CASE (format_double)
+{
+  BOOST_CHECK_EQUAL (format (0.), "0");
+  BOOST_CHECK_EQUAL (format (-0.), "-0");
+  BOOST_CHECK_EQUAL (format (42.), "42");
+  BOOST_CHECK_EQUAL (format (42.5), "42.5");
+  BOOST_CHECK_EQUAL (format (-12.), "-12");
+  BOOST_CHECK_EQUAL (format (0.1), "0.1");
+  BOOST_CHECK_EQUAL (format (0.1 + 0.2), "0.30000000000000004");
+  BOOST_CHECK_EQUAL (format (1e-3), "0.001");
+  BOOST_CHECK_EQUAL (format (1e-5), "1e-05");
+  BOOST_CHECK_EQUAL (format (1e100), "1e+100");
+  BOOST_CHECK_EQUAL (format (123456789.), "123456789");
+  BOOST_CHECK_EQUAL (format (1.5e300), "1.5e+300");
+  BOOST_CHECK_EQUAL (format (5e-324), "5e-324");
+  BOOST_CHECK_EQUAL (format (std::numeric_limits<double>::infinity ()), "inf");
+  BOOST_CHECK_EQUAL (format (-std::numeric_limits<double>::infinity ()), "-inf");
+  BOOST_CHECK_EQUAL (format (std::numeric_limits<double>::quiet_NaN ()), "nan");
+}
+
+BOOST_AUTO_TEST_CASE (round_trip)
+{
+  boost::uint64_t state = 88172645463325252ULL;
+  for (int i = 0; i < 1000000; ++i)
+    {
+      // xorshift64 on the bit pattern covers all the exponents.
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
+      double value;
+      std::memcpy (&value, &state, sizeof (value));
+      if (value != value || value - value != 0) continue;
+
+      const std::string str = format (value);
+      const double back = std::strtod (str.c_str (), NULL);
+      if (std::memcmp (&back, &value, sizeof (value)) != 0)
+	BOOST_ERROR ("Formatting " << str << " does not round-trip.");
+    }
+}
+
+BOOST_AUTO_TEST_CASE (number_writer)
+{
+  Vector v (3);
+  v << 1., -2.5, 1e-7;
+  Matrix m (2, 2);
+  m << 1., 2., 3., 4.;
+
+  std::ostringstream os;
+  {
+    NumberWriter writer (os);
+    writer.put (v, '\t').put ('\n').put (m, ' ');
+  }
+  BOOST_CHECK_EQUAL (os.str (), "\t1\t-2.5\t1e-07\n 1 2 3 4");
+}
+
+// Compare the trace of a vector signal with the iostream-based
+// implementation it replaces.
+BOOST_AUTO_TEST_CASE (trace_benchmark)
+{
+  const int nbSamples = 20000;
+  Vector v (30);
+  for (Vector::Index i = 0; i < v.size (); ++i)
+    v (i) = std::sin (static_cast<double> (i)) * 1e3;
+  Signal<Vector, int> sig ("vector");
+  sig.setConstant (v);
+
+  using boost::posix_time::microsec_clock;
+  using boost::posix_time::ptime;
+
+  std::ofstream before ("number-format-before.dat");
+  ptime start = microsec_clock::local_time ();
+  for (int s = 0; s < nbSamples; ++s)
+    {
+      before << s << "\t";
+      for (Vector::Index i = 0; i < v.size (); ++i)
+	before << "\t" << v (i);
+      before << std::endl;
+    }
+  const double tBefore =
+    static_cast<double> ((microsec_clock::local_time () - start)
+			 .total_microseconds ()) * 1e-6;
+
+  std::ofstream after ("number-format-after.dat");
+  start = microsec_clock::local_time ();
+  for (int s = 0; s < nbSamples; ++s)
+    {
+      after << s << "\t";
+      sig.trace (after);
+      after << '\n';
+    }
+  after.flush ();
+  const double tAfter =
+    static_cast<double> ((microsec_clock::local_time () - start)
+			 .total_microseconds ()) * 1e-6;
+
+  std::cout << "Tracing a vector of size " << v.size () << ":\n"
+	    << "  iostream:      " << nbSamples / tBefore << " samples/s\n"
+	    << "  NumberWriter:  " << nbSamples / tAfter << " samples/s"
+	    << std::endl;
+  BOOST_CHECK (after.good ());
+
+  before.close ();
+  after.close ();
+  std::remove ("number-format-before.dat");
+  std::remove ("number-format-after.dat");
+}
@@ -0,0 +1,31 @@
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dynamic-graph is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public License
+// along with dynamic-graph.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <dynamic-graph/entity.h>
+#include <dynamic-graph/factory.h>
+
+namespace dynamicgraph
+{
+  class PluginEntityA : public Entity
+  {
+    DYNAMIC_GRAPH_ENTITY_DECL ();
+  public:
+    PluginEntityA (const std::string& name)
+      : Entity (name)
+    {}
+  };
+
+  DYNAMICGRAPH_FACTORY_ENTITY_PLUGIN (PluginEntityA, "PluginEntityA");
+}
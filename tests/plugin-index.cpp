@@ -0,0 +1,175 @@
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dynamic-graph is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public License
+// along with dynamic-graph.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <dynamic-graph/entity.h>
+#include <dynamic-graph/exception-factory.h>
+#include <dynamic-graph/factory.h>
+#include <dynamic-graph/plugin-index.h>
+
+#define BOOST_TEST_MODULE plugin_index
+
+#include <boost/test/unit_test.hpp>
+
+using namespace dynamicgraph;
+
+static const std::string directory = "plugin-index-test";
+static const std::string libA = "libplugin-index-libA" TESTS_DYNLIBSUFFIX;
+static const std::string libB = "libplugin-index-libB" TESTS_DYNLIBSUFFIX;
+static const std::string libBExt =
+  "libplugin-index-libB-ext" TESTS_DYNLIBSUFFIX;
+
+static void copyFile (const std::string& from, const std::string& to)
+{
+  std::ifstream in (from.c_str (), std::ios::binary);
+  std::ofstream out (to.c_str (), std::ios::binary);
+  out << in.rdbuf ();
+  BOOST_REQUIRE (in && out);
+}
+
+static std::string readFile (const std::string& path)
+{
+  std::ifstream in (path.c_str ());
+  std::ostringstream os;
+  os << in.rdbuf ();
+  return os.str ();
+}
+
+BOOST_AUTO_TEST_CASE (lazy_loading)
+{
+  mkdir (directory.c_str (), 0755);
+  copyFile (std::string (TESTS_PLUGINDIR) + "/" + libA, directory + "/" + libA);
+  copyFile (std::string (TESTS_PLUGINDIR) + "/" + libB, directory + "/" + libB);
+  copyFile (std::string (TESTS_PLUGINDIR) + "/" + libBExt,
+	    directory + "/" + libBExt);
+
+  // Index libA only: libB and libBExt are indexed by loading them.
+  struct stat st;
+  BOOST_REQUIRE (stat ((directory + "/" + libA).c_str (), &st) == 0);
+  {
+    std::ofstream index ((directory + "/" + PluginIndex::INDEX_FILE).c_str ());
+    index << "# dynamic-graph plugin index\n"
+	  << libA << ' ' << st.st_size << ' ' << st.st_mtime
+	  << " PluginEntityA\n";
+  }
+
+  FactoryStorage* factory = FactoryStorage::getInstance ();
+  factory->indexPlugins (directory);
+  const PluginIndex& index = factory->getPluginIndex ();
+  BOOST_CHECK (!factory->existEntity ("PluginEntityA"));
+  BOOST_CHECK (factory->existEntity ("PluginEntityB"));
+  BOOST_REQUIRE (index.find ("PluginEntityA") != NULL);
+  BOOST_CHECK (!index.find ("PluginEntityA")->loaded);
+  BOOST_CHECK (index.find ("PluginEntityB")->loaded);
+  BOOST_CHECK (index.find ("Unknown") == NULL);
+
+  // libBExt is loaded first and loads libB: each class is attributed to
+  // the library defining it.
+  BOOST_REQUIRE (index.find ("PluginEntityBExt") != NULL);
+  BOOST_CHECK_EQUAL (index.find ("PluginEntityBExt")->path,
+		     directory + "/" + libBExt);
+  BOOST_CHECK_EQUAL (index.find ("PluginEntityB")->path,
+		     directory + "/" + libB);
+  BOOST_CHECK_EQUAL (index.find ("PluginEntityBExt")->classes.size (), 1u);
+
+  // The first instantiation loads libA.
+  Entity* entity = factory->newEntity ("PluginEntityA", "plugin-a");
+  BOOST_CHECK_EQUAL (entity->getClassName (), "PluginEntityA");
+  delete entity;
+  BOOST_CHECK (factory->existEntity ("PluginEntityA"));
+  BOOST_CHECK (index.find ("PluginEntityA")->loaded);
+  BOOST_CHECK_THROW (factory->newEntity ("Unknown", "unknown"),
+		     ExceptionFactory);
+
+  // The index file now lists both plugins.
+  const std::string content =
+    readFile (directory + "/" + PluginIndex::INDEX_FILE);
+  BOOST_CHECK (content.find (libA + " ") != std::string::npos);
+  BOOST_CHECK (content.find (" PluginEntityB\n") != std::string::npos);
+
+  std::ostringstream report;
+  index.report (report);
+  BOOST_CHECK (report.str ().find ("loaded in") != std::string::npos);
+  std::cout << report.str ();
+
+  // An up-to-date index is used without loading anything.
+  PluginIndex fresh;
+  fresh.scan (directory);
+  BOOST_CHECK_EQUAL (fresh.plugins ().size (), 3u);
+  BOOST_REQUIRE (fresh.find ("PluginEntityB") != NULL);
+  BOOST_CHECK (!fresh.find ("PluginEntityB")->loaded);
+  BOOST_CHECK_THROW (fresh.scan ("plugin-index-missing"), ExceptionFactory);
+
+  std::remove ((directory + "/" + PluginIndex::INDEX_FILE).c_str ());
+  std::remove ((directory + "/" + libA).c_str ());
+  std::remove ((directory + "/" + libB).c_str ());
+  std::remove ((directory + "/" + libBExt).c_str ());
+  rmdir (directory.c_str ());
+}
+
+BOOST_AUTO_TEST_CASE (cached_index)
+{
+  // The index file cannot be written in this directory.
+  const std::string readOnly = "plugin-index-read-only";
+  const std::string broken = "libbroken" TESTS_DYNLIBSUFFIX;
+  mkdir (readOnly.c_str (), 0755);
+  mkdir ((readOnly + "/" + PluginIndex::INDEX_FILE).c_str (), 0755);
+  {
+    std::ofstream library ((readOnly + "/" + broken).c_str ());
+    library << "not a library\n";
+  }
+  const std::string cacheHome = "plugin-index-cache";
+  setenv ("XDG_CACHE_HOME", cacheHome.c_str (), 1);
+
+  PluginIndex index;
+  index.scan (readOnly);
+  BOOST_REQUIRE_EQUAL (index.plugins ().size (), 1u);
+  const PluginIndex::Plugin& failed = index.plugins ()[0];
+  BOOST_CHECK (!failed.loaded);
+  BOOST_CHECK (!failed.error.empty ());
+
+  // The failure is recorded in the cache, and not tried again.
+  char* absolute = realpath (readOnly.c_str (), NULL);
+  std::string cached;
+  for (const char* c = absolute; *c != '\0'; ++c)
+    cached += (*c == '/') ? std::string ("%2F") : std::string (1, *c);
+  std::free (absolute);
+  cached = cacheHome + "/dynamic-graph/" + cached + ".index";
+  BOOST_CHECK (readFile (cached).find ("!" + broken + " ")
+	       != std::string::npos);
+
+  PluginIndex fresh;
+  fresh.scan (readOnly);
+  BOOST_REQUIRE_EQUAL (fresh.plugins ().size (), 1u);
+  BOOST_CHECK_EQUAL (fresh.plugins ()[0].error, failed.error);
+  BOOST_CHECK_EQUAL (fresh.plugins ()[0].loadTime, 0.);
+
+  std::remove (cached.c_str ());
+  rmdir ((cacheHome + "/dynamic-graph").c_str ());
+  rmdir (cacheHome.c_str ());
+  std::remove ((readOnly + "/" + broken).c_str ());
+  rmdir ((readOnly + "/" + PluginIndex::INDEX_FILE).c_str ());
+  rmdir (readOnly.c_str ());
+  unsetenv ("XDG_CACHE_HOME");
+}
@@ -13,11 +13,23 @@
 // You should have received a copy of the GNU Lesser General Public License
 // along with dynamic-graph.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
 #include <sstream>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread/thread.hpp>
+
 #include <dynamic-graph/entity.h>
 #include <dynamic-graph/factory.h>
 #include <dynamic-graph/exception-factory.h>
 #include <dynamic-graph/pool.h>
+#include <dynamic-graph/command-direct-getter.h>
+#include <dynamic-graph/linear-algebra.h>
+#include <dynamic-graph/signal-time-dependent.h>
 
 #define BOOST_TEST_MODULE pool
 
@@ -62,3 +74,439 @@ BOOST_AUTO_TEST_CASE (pool_display)
     (entity->getName());
   dynamicgraph::PoolStorage::destroy();
 }
+
+struct StatefulEntity : public dynamicgraph::Entity
+{
+  static const std::string CLASS_NAME;
+
+  StatefulEntity (const std::string& name)
+    : Entity (name),
+      counter (0),
+      outSOUT (boost::bind (&StatefulEntity::compute, this, _1, _2),
+	       dynamicgraph::sotNOSIGNAL,
+	       "StatefulEntity(" + name + ")::output(double)::out"),
+      paramSIN ("StatefulEntity(" + name + ")::input(double)::param")
+  {
+    signalRegistration (outSOUT << paramSIN);
+  }
+
+  double& compute (double& res, int)
+  {
+    res = ++counter;
+    return res;
+  }
+
+  virtual void saveState (std::ostream& os) const
+  {
+    os.write (reinterpret_cast<const char*> (&counter), sizeof (counter));
+  }
+
+  virtual void restoreState (std::istream& is)
+  {
+    is.read (reinterpret_cast<char*> (&counter), sizeof (counter));
+  }
+
+  virtual const std::string& getClassName () const
+  {
+    return CLASS_NAME;
+  }
+
+  int counter;
+  dynamicgraph::SignalTimeDependent<double, int> outSOUT;
+  dynamicgraph::Signal<dynamicgraph::Vector, int> paramSIN;
+};
+
+DYNAMICGRAPH_FACTORY_ENTITY_PLUGIN (StatefulEntity, "StatefulEntity");
+
+// Entity with a signal whose type has no binary functions.
+struct OpaqueEntity : public dynamicgraph::Entity
+{
+  static const std::string CLASS_NAME;
+
+  OpaqueEntity (const std::string& name)
+    : Entity (name),
+      listSOUT ("OpaqueEntity(" + name + ")::output(list)::list")
+  {
+    signalRegistration (listSOUT);
+  }
+
+  virtual const std::string& getClassName () const
+  {
+    return CLASS_NAME;
+  }
+
+  dynamicgraph::Signal<std::vector<int>, int> listSOUT;
+};
+
+DYNAMICGRAPH_FACTORY_ENTITY_PLUGIN (OpaqueEntity, "OpaqueEntity");
+
+BOOST_AUTO_TEST_CASE (pool_checkpoint)
+{
+  dynamicgraph::PoolStorage* pool = dynamicgraph::PoolStorage::getInstance ();
+  dynamicgraph::Vector param (2);
+  param << 1., 2.;
+
+  // Mark the output as ready at each tick to force its computation.
+  StatefulEntity* entity = new StatefulEntity ("stateful");
+  entity->paramSIN.setConstant (param);
+  entity->outSOUT.setReady ();
+  entity->outSOUT (1);
+  entity->outSOUT.setReady ();
+  entity->outSOUT (2);
+  pool->checkpoint ("pool-checkpoint.dat");
+  entity->outSOUT.setReady ();
+  BOOST_CHECK_EQUAL (entity->outSOUT (3), 3.);
+  pool->deregisterEntity ("stateful");
+  delete entity;
+
+  // Restore into a new graph and resume from time 2.
+  entity = new StatefulEntity ("stateful");
+  pool->restore ("pool-checkpoint.dat");
+  BOOST_CHECK_EQUAL (entity->counter, 2);
+  BOOST_CHECK_EQUAL (entity->outSOUT.getTime (), 2);
+  BOOST_CHECK_EQUAL (entity->outSOUT (2), 2.);
+  BOOST_CHECK (entity->paramSIN.accessCopy () == param);
+  entity->outSOUT.setReady ();
+  BOOST_CHECK_EQUAL (entity->outSOUT (3), 3.);
+  pool->deregisterEntity ("stateful");
+  delete entity;
+
+  // The graph must contain the entities of the checkpoint.
+  BOOST_CHECK_THROW (pool->restore ("pool-checkpoint.dat"),
+		     dynamicgraph::ExceptionFactory);
+  std::remove ("pool-checkpoint.dat");
+
+  // The signals whose value is not saved are reported.
+  OpaqueEntity* opaque = new OpaqueEntity ("opaque");
+  const std::vector<std::string> incomplete =
+    pool->checkpoint ("pool-checkpoint.dat");
+  BOOST_REQUIRE_EQUAL (incomplete.size (), 1u);
+  BOOST_CHECK_EQUAL (incomplete[0], "opaque.list");
+  delete opaque;
+  std::remove ("pool-checkpoint.dat");
+  dynamicgraph::PoolStorage::destroy();
+}
+
+BOOST_AUTO_TEST_CASE (pool_handles)
+{
+  dynamicgraph::PoolStorage* pool = dynamicgraph::PoolStorage::getInstance ();
+  StatefulEntity* entity = new StatefulEntity ("handled");
+
+  const dynamicgraph::EntityHandle entityHandle =
+    pool->getEntityHandle ("handled");
+  BOOST_CHECK_EQUAL (&pool->getEntity (entityHandle), entity);
+
+  const dynamicgraph::SignalHandle out = pool->getSignalHandle ("handled.out");
+  const dynamicgraph::SignalHandle param =
+    pool->getSignalHandle (entityHandle, "param");
+  BOOST_CHECK_EQUAL (&pool->getSignal (out),
+		     static_cast<dynamicgraph::SignalBase<int>*>
+		     (&entity->outSOUT));
+  BOOST_CHECK_EQUAL (&pool->getSignal (param),
+		     static_cast<dynamicgraph::SignalBase<int>*>
+		     (&entity->paramSIN));
+  BOOST_CHECK_EQUAL (pool->getSignalHandle ("handled.out").index, out.index);
+  BOOST_CHECK (!pool->isValid (dynamicgraph::SignalHandle ()));
+  BOOST_CHECK_THROW (pool->getSignalHandle ("handled.unknown"),
+		     dynamicgraph::ExceptionFactory);
+
+  // Deleting the entity invalidates its handles, and a new entity
+  // reusing the slots does not make them valid again.
+  delete entity;
+  BOOST_CHECK (!pool->isValid (entityHandle));
+  BOOST_CHECK (!pool->isValid (out));
+  BOOST_CHECK_THROW (pool->getSignal (param), dynamicgraph::ExceptionFactory);
+  entity = new StatefulEntity ("handled");
+  const dynamicgraph::SignalHandle newOut =
+    pool->getSignalHandle ("handled.out");
+  BOOST_CHECK (!pool->isValid (out));
+  BOOST_CHECK (pool->isValid (newOut));
+  delete entity;
+  dynamicgraph::PoolStorage::destroy();
+
+  // Deleting an entity after the pool does not recreate the pool.
+  entity = new StatefulEntity ("late");
+  dynamicgraph::PoolStorage::getInstance ()->deregisterEntity ("late");
+  dynamicgraph::PoolStorage::destroy();
+  BOOST_CHECK (!dynamicgraph::PoolStorage::existInstance ());
+  delete entity;
+  BOOST_CHECK (!dynamicgraph::PoolStorage::existInstance ());
+}
+
+BOOST_AUTO_TEST_CASE (pool_bulk_signals)
+{
+  typedef dynamicgraph::PoolStorage::PackedSignal PackedSignal;
+  dynamicgraph::PoolStorage* pool = dynamicgraph::PoolStorage::getInstance ();
+  StatefulEntity* first = new StatefulEntity ("first");
+  StatefulEntity* second = new StatefulEntity ("second");
+  dynamicgraph::Vector param (3);
+  param << 1., 2., 3.;
+  first->paramSIN.setConstant (param);
+  first->outSOUT.setReady ();
+  first->outSOUT (4);
+  second->paramSIN.setConstant (2 * param);
+
+  std::vector<dynamicgraph::SignalHandle> signals (3);
+  signals[0] = pool->getSignalHandle ("first.out");
+  signals[1] = pool->getSignalHandle ("first.param");
+  signals[2] = pool->getSignalHandle ("second.param");
+  std::string buffer;
+  std::vector<PackedSignal> layout;
+  pool->readSignals (signals, buffer, layout);
+  BOOST_REQUIRE_EQUAL (layout.size (), 3u);
+  BOOST_CHECK_EQUAL (layout[0].offset, 0u);
+  BOOST_CHECK_EQUAL (layout[0].size, sizeof (double));
+  BOOST_CHECK_EQUAL (layout[0].time, 4);
+  BOOST_CHECK_EQUAL (layout[1].offset, layout[0].size);
+  BOOST_CHECK_EQUAL (layout[2].offset + layout[2].size, buffer.size ());
+  double out;
+  std::copy (buffer.data (), buffer.data () + sizeof (double),
+	     reinterpret_cast<char*> (&out));
+  BOOST_CHECK_EQUAL (out, 1.);
+
+  // Swap the parameters of the entities.
+  std::vector<dynamicgraph::SignalHandle> params (2);
+  params[0] = signals[2];
+  params[1] = signals[1];
+  std::vector<PackedSignal> paramLayout (layout.begin () + 1, layout.end ());
+  pool->writeSignals (params, buffer, paramLayout);
+  BOOST_CHECK (first->paramSIN.accessCopy () == 2 * param);
+  BOOST_CHECK (second->paramSIN.accessCopy () == param);
+
+  // Wrong layouts are rejected before writing anything.
+  paramLayout[1].size = buffer.size ();
+  BOOST_CHECK_THROW (pool->writeSignals (params, buffer, paramLayout),
+		     dynamicgraph::ExceptionFactory);
+  BOOST_CHECK (second->paramSIN.accessCopy () == param);
+  // A value which does not fit its signal.
+  paramLayout[1] = layout[0];
+  BOOST_CHECK_THROW (pool->writeSignals (params, buffer, paramLayout),
+		     dynamicgraph::ExceptionSignal);
+
+  delete first;
+  BOOST_CHECK_THROW (pool->readSignals (signals, buffer, layout),
+		     dynamicgraph::ExceptionFactory);
+  delete second;
+  dynamicgraph::PoolStorage::destroy();
+}
+
+struct IntrospectedEntity : public dynamicgraph::Entity
+{
+  static const std::string CLASS_NAME;
+
+  IntrospectedEntity (const std::string& name)
+    : Entity (name), value (0)
+  {
+    for (int i = 0; i < 20; ++i)
+      {
+	std::ostringstream signame;
+	signame << CLASS_NAME << "(" << name << ")::output(double)::s" << i;
+	signals.push_back
+	  (new dynamicgraph::Signal<double, int> (signame.str ()));
+	signalRegistration (*signals.back ());
+      }
+    for (int i = 0; i < 10; ++i)
+      {
+	std::ostringstream cmdname;
+	cmdname << "get" << i;
+	addCommand (cmdname.str (),
+		    dynamicgraph::command::makeDirectGetter
+		    (*this, &value, "Get the value."));
+      }
+  }
+
+  ~IntrospectedEntity ()
+  {
+    for (std::size_t i = 0; i < signals.size (); ++i)
+      delete signals[i];
+  }
+
+  virtual const std::string& getClassName () const
+  {
+    return CLASS_NAME;
+  }
+
+  int value;
+  std::vector<dynamicgraph::Signal<double, int>*> signals;
+};
+
+DYNAMICGRAPH_FACTORY_ENTITY_PLUGIN (IntrospectedEntity, "IntrospectedEntity");
+
+// Walk the signals and commands of all the entities of the pool, with
+// the copying accessors and with the table views.
+BOOST_AUTO_TEST_CASE (introspection_benchmark)
+{
+  typedef dynamicgraph::PoolStorage::Entities Entities;
+  using boost::posix_time::microsec_clock;
+  using boost::posix_time::ptime;
+
+  const int nbEntities = 1000, nbWalks = 20;
+  for (int i = 0; i < nbEntities; ++i)
+    {
+      std::ostringstream name;
+      name << "introspected" << i;
+      new IntrospectedEntity (name.str ());
+    }
+  const Entities& entities =
+    dynamicgraph::PoolStorage::getInstance ()->getEntityMap ();
+
+  std::size_t nbCopied = 0;
+  ptime start = microsec_clock::local_time ();
+  for (int walk = 0; walk < nbWalks; ++walk)
+    for (Entities::const_iterator it = entities.begin ();
+	 it != entities.end (); ++it)
+      {
+	typedef dynamicgraph::Entity::SignalMap SignalMap;
+	typedef dynamicgraph::Entity::CommandMap_t CommandMap;
+	const SignalMap signals = it->second->getSignalMap ();
+	const CommandMap commands = it->second->getNewStyleCommandMap ();
+	for (SignalMap::const_iterator s = signals.begin ();
+	     s != signals.end (); ++s)
+	  nbCopied += s->first.size ();
+	for (CommandMap::const_iterator c = commands.begin ();
+	     c != commands.end (); ++c)
+	  nbCopied += c->first.size ();
+      }
+  const double tCopy =
+    static_cast<double> ((microsec_clock::local_time () - start)
+			 .total_microseconds ()) * 1e-6;
+
+  std::size_t nbViewed = 0;
+  start = microsec_clock::local_time ();
+  for (int walk = 0; walk < nbWalks; ++walk)
+    for (Entities::const_iterator it = entities.begin ();
+	 it != entities.end (); ++it)
+      {
+	typedef dynamicgraph::Entity::SignalTable SignalTable;
+	typedef dynamicgraph::Entity::CommandTable CommandTable;
+	const SignalTable& signals = it->second->getSignals ();
+	const CommandTable& commands = it->second->getCommands ();
+	for (SignalTable::const_iterator s = signals.begin ();
+	     s != signals.end (); ++s)
+	  nbViewed += s->first.str ().size ();
+	for (CommandTable::const_iterator c = commands.begin ();
+	     c != commands.end (); ++c)
+	  nbViewed += c->first.str ().size ();
+      }
+  const double tView =
+    static_cast<double> ((microsec_clock::local_time () - start)
+			 .total_microseconds ()) * 1e-6;
+
+  BOOST_CHECK_EQUAL (nbCopied, nbViewed);
+  std::cout << "Introspection of " << nbEntities << " entities:\n"
+	    << "  map copies:  " << nbWalks / tCopy << " walks/s\n"
+	    << "  table views: " << nbWalks / tView << " walks/s"
+	    << std::endl;
+  dynamicgraph::PoolStorage::destroy ();
+}
+
+// Thread looking up the entities and their signals while the main
+// thread creates and deletes them.
+struct SnapshotReader
+{
+  SnapshotReader (boost::atomic<bool>& stop, boost::atomic<int>& nbFound,
+		  boost::atomic<int>& nbErrors)
+    : stop (stop), nbFound (nbFound), nbErrors (nbErrors)
+  {}
+
+  void operator() () const
+  {
+    typedef dynamicgraph::PoolStorage::EntityTable EntityTable;
+    typedef dynamicgraph::Entity::ConcurrentSignalTable SignalTable;
+    dynamicgraph::PoolStorage* pool = dynamicgraph::PoolStorage::getInstance ();
+    while (!stop)
+      for (int i = 0; i < 10; ++i)
+	{
+	  std::ostringstream name;
+	  name << "concurrent" << i;
+	  EntityTable::SnapshotPtr entities = pool->getEntitySnapshot ();
+	  dynamicgraph::Entity* const* entity = entities->find (name.str ());
+	  if (entity == NULL) continue;
+	  SignalTable::SnapshotPtr signals = (*entity)->getSignalSnapshot ();
+	  dynamicgraph::SignalBase<int>* const* signal = signals->find ("s3");
+	  if (signal == NULL || (*signal)->getName ().find (name.str ())
+	      == std::string::npos)
+	    ++nbErrors;
+	  else
+	    ++nbFound;
+	}
+  }
+
+  boost::atomic<bool>& stop;
+  boost::atomic<int>& nbFound;
+  boost::atomic<int>& nbErrors;
+};
+
+BOOST_AUTO_TEST_CASE (concurrent_readers)
+{
+  dynamicgraph::PoolStorage* pool = dynamicgraph::PoolStorage::getInstance ();
+  boost::atomic<bool> stop (false);
+  boost::atomic<int> nbFound (0), nbErrors (0);
+  boost::thread reader ((SnapshotReader (stop, nbFound, nbErrors)));
+
+  for (int round = 0; round < 100; ++round)
+    {
+      // Entities are published once constructed, with all their signals.
+      std::vector<dynamicgraph::Entity*> entities;
+      {
+	dynamicgraph::PoolStorage::DeferredRegistration deferred;
+	for (int i = 0; i < 10; ++i)
+	  {
+	    std::ostringstream name;
+	    name << "concurrent" << i;
+	    new IntrospectedEntity (name.str ());
+	  }
+	entities = deferred.entities ();
+      }
+      pool->registerEntities (entities);
+      boost::this_thread::yield ();
+      for (int i = 0; i < 10; ++i)
+	{
+	  std::ostringstream name;
+	  name << "concurrent" << i;
+	  pool->deleteEntity (name.str ());
+	}
+    }
+  stop = true;
+  reader.join ();
+
+  BOOST_CHECK_EQUAL (nbErrors, 0);
+  BOOST_CHECK (!pool->existEntity ("concurrent0"));
+  BOOST_CHECK (pool->getEntitySnapshot ()->find ("concurrent0") == NULL);
+  std::cout << "Entities found by the reader: " << nbFound << std::endl;
+}
+
+// Thread holding a signal snapshot for a while.
+struct SignalSnapshotHolder
+{
+  typedef dynamicgraph::Entity::ConcurrentSignalTable SignalTable;
+
+  SignalSnapshotHolder (const SignalTable::SnapshotPtr& snapshot,
+			boost::atomic<bool>& released)
+    : snapshot (snapshot), released (released)
+  {}
+
+  void operator() ()
+  {
+    boost::this_thread::sleep (boost::posix_time::milliseconds (50));
+    released = true;
+    snapshot.reset ();
+  }
+
+  SignalTable::SnapshotPtr snapshot;
+  boost::atomic<bool>& released;
+};
+
+BOOST_AUTO_TEST_CASE (signal_snapshot_grace)
+{
+  dynamicgraph::PoolStorage* pool = dynamicgraph::PoolStorage::getInstance ();
+  IntrospectedEntity* entity = new IntrospectedEntity ("held");
+  boost::atomic<bool> released (false);
+  boost::thread holder
+    ((SignalSnapshotHolder (entity->getSignalSnapshot (), released)));
+
+  // The signals are not destroyed while the snapshot is held.
+  pool->deleteEntity ("held");
+  BOOST_CHECK (released);
+  holder.join ();
+}
@@ -17,9 +17,14 @@
  * with dynamic-graph.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <cstdio>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
 
 #define ENABLE_RT_LOG
+#define DG_RTLOG_MIN_LEVEL ::dynamicgraph::RTLOG_INFO
 #include <dynamic-graph/real-time-logger.h>
 
 #define BOOST_TEST_MODULE real_time_logger
@@ -27,6 +32,7 @@
 #include <boost/test/unit_test.hpp>
 #include <boost/test/output_test_stream.hpp>
 
+#include <boost/atomic.hpp>
 #include <boost/thread/thread.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
@@ -69,3 +75,315 @@ BOOST_AUTO_TEST_CASE (multithread)
 
   RealTimeLogger::destroy();
 }
+
+// Check the entries written concurrently by several threads.
+struct CheckingStream : public LoggerStream
+{
+  CheckingStream (int nbProducers)
+    : next (nbProducers, 0), nbErrors (0), nbRead (0) {}
+
+  virtual void write (const char* c)
+  {
+    int producer, index;
+    if (std::sscanf (c, "producer %d entry %d", &producer, &index) != 2
+	|| producer < 0 || producer >= static_cast<int> (next.size ())
+	|| index < next[producer])
+      ++nbErrors;
+    else
+      next[producer] = index + 1;
+    ++nbRead;
+  }
+
+  std::vector<int> next;
+  int nbErrors;
+  int nbRead;
+};
+
+struct Producer
+{
+  Producer (RealTimeLogger& logger, int id, int nbEntries)
+    : logger (logger), id (id), nbEntries (nbEntries) {}
+
+  void operator() () const
+  {
+    std::ostringstream name;
+    name << "producer " << id;
+    logger.registerProducer (name.str ());
+    for (int i = 0; i < nbEntries; ++i)
+      logger.front () << "producer " << id << " entry " << i << '\n';
+  }
+
+  RealTimeLogger& logger;
+  int id;
+  int nbEntries;
+};
+
+BOOST_AUTO_TEST_CASE (multiproducer)
+{
+  const int nbProducers = 4, nbEntries = 10000;
+  RealTimeLogger rtl (64);
+  CheckingStream* stream = new CheckingStream (nbProducers);
+  rtl.addOutputStream (LoggerStreamPtr_t (stream));
+
+  boost::thread_group producers;
+  for (int i = 0; i < nbProducers; ++i)
+    producers.create_thread (Producer (rtl, i, nbEntries));
+  // Read while the producers write.
+  for (int i = 0; i < 1000; ++i)
+    if (!rtl.spinOnce ()) boost::this_thread::yield ();
+  producers.join_all ();
+  while (rtl.spinOnce ()) {}
+  BOOST_CHECK (rtl.empty ());
+
+  std::vector<RealTimeLogger::ProducerStatistics> statistics =
+    rtl.getProducerStatistics ();
+  BOOST_REQUIRE_EQUAL (statistics.size (), static_cast<std::size_t> (nbProducers));
+  std::size_t nbWritten = 0, nbDiscarded = 0;
+  for (std::size_t i = 0; i < statistics.size (); ++i)
+    {
+      BOOST_CHECK_EQUAL (statistics[i].name.compare (0, 9, "producer "), 0);
+      BOOST_CHECK_EQUAL (statistics[i].nbWritten + statistics[i].nbDiscarded,
+			 static_cast<std::size_t> (nbEntries));
+      nbWritten += statistics[i].nbWritten;
+      nbDiscarded += statistics[i].nbDiscarded;
+    }
+  BOOST_CHECK_EQUAL (rtl.getNbDiscarded (), nbDiscarded);
+  BOOST_CHECK_EQUAL (stream->nbErrors, 0);
+  BOOST_CHECK_EQUAL (static_cast<std::size_t> (stream->nbRead), nbWritten);
+}
+
+// Count the entries and the batches written by the thread of the logger.
+struct CountingStream : public LoggerStream
+{
+  CountingStream () : nbEntries (0), nbBatches (0) {}
+
+  virtual void write (const char*)
+  {
+    ++nbEntries;
+  }
+
+  virtual void writev (const LoggerEntry*, std::size_t n)
+  {
+    nbEntries += static_cast<int> (n);
+    ++nbBatches;
+  }
+
+  boost::atomic<int> nbEntries;
+  boost::atomic<int> nbBatches;
+};
+
+static bool waitForEntries (const CountingStream& stream, int nbEntries)
+{
+  for (int i = 0; i < 1000 && stream.nbEntries < nbEntries; ++i)
+    boost::this_thread::sleep (boost::posix_time::milliseconds (1));
+  return stream.nbEntries == nbEntries;
+}
+
+BOOST_AUTO_TEST_CASE (wakeup)
+{
+  using boost::posix_time::microsec_clock;
+  using boost::posix_time::ptime;
+  RealTimeLogger& rtl = RealTimeLogger::instance ();
+  CountingStream* stream = new CountingStream;
+  rtl.addOutputStream (LoggerStreamPtr_t (stream));
+  // Let the thread of the logger wait for entries.
+  boost::this_thread::sleep (boost::posix_time::milliseconds (10));
+
+  // A message is written without waiting for a periodic wake up.
+  const ptime start = microsec_clock::local_time ();
+  dgRTLOG () << "Wake up\n";
+  BOOST_REQUIRE (waitForEntries (*stream, 1));
+  const long latency = (microsec_clock::local_time () - start)
+    .total_microseconds ();
+  BOOST_CHECK_LT (latency, 50000);
+
+  // A burst is written in batches.
+  const int nbEntries = 900;
+  for (int i = 0; i < nbEntries; ++i)
+    dgRTLOG () << "Burst " << i << '\n';
+  BOOST_CHECK (waitForEntries (*stream, nbEntries + 1));
+  BOOST_CHECK_EQUAL (rtl.getNbDiscarded (), 0u);
+  std::cout << "Wake up latency: " << latency << " us, "
+	    << stream->nbEntries << " entries in " << stream->nbBatches
+	    << " batches" << std::endl;
+
+  RealTimeLogger::destroy ();
+}
+
+// Entries longer than a slot are truncated, not reallocated.
+BOOST_AUTO_TEST_CASE (truncation)
+{
+  std::ostringstream os;
+  RealTimeLogger rtl (10);
+  rtl.addOutputStream (LoggerStreamPtr_t (new LoggerIOStream (os)));
+  const std::string longString (2 * RealTimeLogger::ENTRY_SIZE, 'a');
+  rtl.front () << "short" << '\n';
+  rtl.front () << longString << " is cut" << std::endl;
+  rtl.front () << "embedded '" << '\0' << "'\n";
+  BOOST_CHECK_EQUAL (rtl.spin (), 3u);
+  BOOST_CHECK_EQUAL (os.str (), "short\n" + longString.substr
+		     (0, RealTimeLogger::ENTRY_SIZE) + std::string ("embedded '\0'\n", 13));
+
+  std::vector<RealTimeLogger::ProducerStatistics> statistics =
+    rtl.getProducerStatistics ();
+  BOOST_REQUIRE_EQUAL (statistics.size (), 1u);
+  BOOST_CHECK_EQUAL (statistics[0].nbWritten, 3u);
+  BOOST_CHECK_EQUAL (statistics[0].nbTruncated, 1u);
+}
+
+// Remove the timestamps of the entries written by log.
+static std::string stripTimestamps (const std::string& text)
+{
+  std::string result;
+  std::size_t begin = 0;
+  while (begin < text.size ()) {
+    std::size_t end = text.find ('\n', begin);
+    end = (end == std::string::npos) ? text.size () : end + 1;
+    std::string line = text.substr (begin, end - begin);
+    if (!line.empty () && line[0] == '[')
+      line.erase (0, line.find ("] ") + 2);
+    result += line;
+    begin = end;
+  }
+  return result;
+}
+
+BOOST_AUTO_TEST_CASE (deferred)
+{
+  std::ostringstream os;
+  RealTimeLogger rtl (10);
+  rtl.addOutputStream (LoggerStreamPtr_t (new LoggerIOStream (os)));
+
+  Vector v (3);
+  v << 1, 2.5, -3;
+  Matrix m (2, 2);
+  m << 1, 2, 3, 4;
+  const std::string name ("robot");
+  rtl.log ("int {}, double {}, bool {}, char {}\n", -4, 0.5, true, 'x');
+  rtl.log ("string {} {}, vector {}, matrix {}\n", "a", name, v, m);
+  rtl.log ("unsigned {}, long {}, size {}\n", 7u, -8l, std::size_t (9));
+  rtl.log ("missing {} {}\n", 1);
+  rtl.log ("extra {}", 1, 2, "three");
+  rtl.front () << "stream\n";
+  rtl.log ("no argument\n");
+  BOOST_CHECK_EQUAL (rtl.spin (), 7u);
+  BOOST_CHECK_EQUAL (stripTimestamps (os.str ()),
+		     "int -4, double 0.5, bool true, char x\n"
+		     "string a robot, vector [1, 2.5, -3], matrix [[1, 2], [3, 4]]\n"
+		     "unsigned 7, long -8, size 9\n"
+		     "missing 1 {}\n"
+		     "extra 1 2 three"
+		     "stream\n"
+		     "no argument\n");
+  BOOST_CHECK_EQUAL (os.str ()[0], '[');
+
+  // The arguments are truncated to the size of a record.
+  os.str (std::string ());
+  const std::string longString (2 * RealTimeLogger::RECORD_SIZE, 'a');
+  rtl.log ("{} {}\n", longString, 1);
+  Vector large (Vector::Zero (RealTimeLogger::RECORD_SIZE));
+  rtl.log ("{} {}\n", 1, large);
+  rtl.spin ();
+  const std::string text = stripTimestamps (os.str ());
+  const std::size_t first = text.find ('\n');
+  BOOST_CHECK_EQUAL (text.substr (first - 5, 6), "a ...\n");
+  BOOST_CHECK_LT (first, RealTimeLogger::RECORD_SIZE);
+  BOOST_CHECK_EQUAL (text.substr (first + 1), "1 ...\n");
+}
+
+// Cost of writing an entry in the real-time thread, with and without
+// deferred formatting.
+BOOST_AUTO_TEST_CASE (deferred_benchmark)
+{
+  using boost::posix_time::microsec_clock;
+  using boost::posix_time::ptime;
+  using boost::posix_time::time_duration;
+  const int nbRounds = 100, nbEntries = 1000;
+  RealTimeLogger rtl (nbEntries + 1);
+  rtl.addOutputStream (LoggerStreamPtr_t (new CountingStream));
+  Vector v (Vector::Ones (6));
+
+  time_duration tStream, tDeferred;
+  for (int round = 0; round < nbRounds; ++round) {
+    ptime start = microsec_clock::local_time ();
+    for (int i = 0; i < nbEntries; ++i)
+      rtl.front () << "iteration " << i << ": error " << 0.5 * i
+		   << ", state " << v << '\n';
+    tStream += microsec_clock::local_time () - start;
+    rtl.spin ();
+
+    start = microsec_clock::local_time ();
+    for (int i = 0; i < nbEntries; ++i)
+      rtl.log ("iteration {}: error {}, state {}\n", i, 0.5 * i, v);
+    tDeferred += microsec_clock::local_time () - start;
+    BOOST_CHECK_EQUAL (rtl.spin (), static_cast<std::size_t> (nbEntries));
+  }
+  BOOST_CHECK_EQUAL (rtl.getNbDiscarded (), 0u);
+
+  const double n = nbRounds * nbEntries;
+  std::cout << "Cost of an entry in the writer thread:\n"
+	    << "  stream:   "
+	    << static_cast<double> (tStream.total_microseconds ()) * 1e3 / n
+	    << " ns\n"
+	    << "  deferred: "
+	    << static_cast<double> (tDeferred.total_microseconds ()) * 1e3 / n
+	    << " ns" << std::endl;
+}
+
+BOOST_AUTO_TEST_CASE (token_bucket)
+{
+  RTLogCallsite callsite ("file.cpp", 12, 10., 3);
+  for (int i = 0; i < 3; ++i)
+    BOOST_CHECK (callsite.acquire ());
+  BOOST_CHECK (!callsite.acquire ());
+  BOOST_CHECK (!callsite.acquire ());
+  BOOST_CHECK_EQUAL (callsite.getNbSuppressed (), 2u);
+
+  // A token is earned every 0.1 s.
+  RTLogCallsite::refill (0.05);
+  BOOST_CHECK (!callsite.acquire ());
+  RTLogCallsite::refill (0.05);
+  BOOST_CHECK (callsite.acquire ());
+  BOOST_CHECK (!callsite.acquire ());
+  RTLogCallsite::refill (10.);
+  for (int i = 0; i < 3; ++i)
+    BOOST_CHECK (callsite.acquire ());
+
+  std::ostringstream os;
+  RealTimeLogger rtl (10);
+  rtl.addOutputStream (LoggerStreamPtr_t (new LoggerIOStream (os)));
+  RTLogCallsite::reportSuppressed (rtl);
+  rtl.spin ();
+  BOOST_CHECK_EQUAL (stripTimestamps (os.str ()),
+		     "file.cpp:12: 4 entries suppressed\n");
+  BOOST_CHECK_EQUAL (callsite.getNbSuppressed (), 0u);
+  RTLogCallsite::reportSuppressed (rtl);
+  BOOST_CHECK (rtl.empty ());
+}
+
+BOOST_AUTO_TEST_CASE (levels)
+{
+  RealTimeLogger& rtl = RealTimeLogger::instance ();
+  CountingStream* stream = new CountingStream;
+  rtl.addOutputStream (LoggerStreamPtr_t (stream));
+
+  // Removed at compile time.
+  dgRTLOG_LEVEL (RTLOG_DEBUG) << "debug\n";
+  dgRTLOGF_LEVEL (RTLOG_DEBUG) ("debug {}\n", 1);
+  // Kept.
+  dgRTLOG_LEVEL (RTLOG_INFO) << "info\n";
+  dgRTLOGF_LEVEL (RTLOG_ERROR) ("error {}\n", 1);
+  BOOST_CHECK (waitForEntries (*stream, 2));
+
+  // A call site writing every iteration is limited to its burst.
+  for (int i = 0; i < 1000; ++i)
+    {
+      dgRTLOG_LIMIT (RTLOG_WARNING, 1., 5) << "limited " << i << '\n';
+      dgRTLOGF_LIMIT (RTLOG_DEBUG, 1000., 1000) ("removed {}\n", i);
+    }
+  BOOST_CHECK (waitForEntries (*stream, 7));
+  BOOST_CHECK_EQUAL (RTLogCallsite::count (), 1u);
+  boost::this_thread::sleep (boost::posix_time::milliseconds (20));
+  BOOST_CHECK_EQUAL (stream->nbEntries, 7);
+  RealTimeLogger::destroy ();
+}
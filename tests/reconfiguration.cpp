@@ -0,0 +1,275 @@
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dynamic-graph is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public License
+// along with dynamic-graph.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <dynamic-graph/entity.h>
+#include <dynamic-graph/exception-factory.h>
+#include <dynamic-graph/linear-algebra.h>
+#include <dynamic-graph/pool.h>
+#include <dynamic-graph/reconfiguration.h>
+#include <dynamic-graph/signal-ptr.h>
+#include <dynamic-graph/signal-time-dependent.h>
+
+#define BOOST_TEST_MODULE reconfiguration
+
+#include <boost/test/unit_test.hpp>
+
+using namespace dynamicgraph;
+
+struct GainEntity : public Entity
+{
+  static const std::string CLASS_NAME;
+
+  GainEntity (const std::string& name, double gain)
+    : Entity (name),
+      gain (gain),
+      inSIN (NULL, "GainEntity(" + name + ")::input(double)::in"),
+      outSOUT (boost::bind (&GainEntity::compute, this, _1, _2), inSIN,
+	       "GainEntity(" + name + ")::output(double)::out"),
+      vectorSOUT ("GainEntity(" + name + ")::output(vector)::vector")
+  {
+    signalRegistration (inSIN << outSOUT << vectorSOUT);
+  }
+
+  double& compute (double& res, int t)
+  {
+    res = gain * inSIN (t);
+    return res;
+  }
+
+  virtual const std::string& getClassName () const
+  {
+    return CLASS_NAME;
+  }
+
+  double gain;
+  SignalPtr<double, int> inSIN;
+  SignalTimeDependent<double, int> outSOUT;
+  Signal<Vector, int> vectorSOUT;
+};
+
+const std::string GainEntity::CLASS_NAME = "GainEntity";
+
+static std::size_t nbDependencies (const SignalBase<int>& signal)
+{
+  std::vector<const SignalBase<int>*> dependencies;
+  signal.listDependencies (dependencies);
+  return dependencies.size ();
+}
+
+BOOST_AUTO_TEST_CASE (apply)
+{
+  GainEntity source ("source", 1.), a ("a", 2.), b ("b", 3.);
+  source.inSIN.setConstant (1.);
+  a.inSIN.plug (&source.outSOUT);
+
+  Reconfiguration reconfiguration;
+  reconfiguration.unplug ("a.in");
+  reconfiguration.plug ("source.out", "b.in");
+  reconfiguration.addDependency ("b.out", "a.vector");
+  reconfiguration.addDependency ("a.out", "b.vector");
+  reconfiguration.removeDependency ("a.out", "b.vector");
+  BOOST_CHECK_EQUAL (reconfiguration.size (), 5u);
+  reconfiguration.prepare ();
+  BOOST_CHECK_EQUAL (reconfiguration.state (), Reconfiguration::PREPARED);
+  // Nothing changes before apply.
+  BOOST_CHECK (a.inSIN.getPluged () == &source.outSOUT);
+  BOOST_CHECK_EQUAL (nbDependencies (b.outSOUT), 1u);
+
+  BOOST_CHECK (reconfiguration.apply ());
+  BOOST_CHECK_EQUAL (reconfiguration.state (), Reconfiguration::APPLIED);
+  BOOST_CHECK (a.inSIN.getPluged () == NULL);
+  BOOST_CHECK (b.inSIN.getPluged () == &source.outSOUT);
+  BOOST_CHECK_EQUAL (nbDependencies (b.outSOUT), 2u);
+  BOOST_CHECK_EQUAL (nbDependencies (a.outSOUT), 1u);
+  BOOST_CHECK_EQUAL (b.outSOUT (1), 3.);
+  BOOST_CHECK_THROW (reconfiguration.apply (), ExceptionFactory);
+
+  // Undo.
+  reconfiguration.clear ();
+  reconfiguration.plug ("source.out", "a.in");
+  reconfiguration.unplug ("b.in");
+  reconfiguration.removeDependency ("b.out", "a.vector");
+  reconfiguration.prepare ();
+  BOOST_CHECK (reconfiguration.apply ());
+  BOOST_CHECK (a.inSIN.getPluged () == &source.outSOUT);
+  BOOST_CHECK (b.inSIN.getPluged () == NULL);
+  BOOST_CHECK_EQUAL (nbDependencies (b.outSOUT), 1u);
+}
+
+BOOST_AUTO_TEST_CASE (errors)
+{
+  GainEntity a ("a", 1.), b ("b", 1.);
+  b.inSIN.plug (&a.outSOUT);
+
+  Reconfiguration reconfiguration;
+  reconfiguration.plug ("a.vector", "b.in");
+  reconfiguration.plug ("b.out", "a.in");
+  reconfiguration.plug ("a.in", "a.out");
+  reconfiguration.addDependency ("a.out", "a.in");
+  reconfiguration.removeDependency ("b.out", "a.vector");
+  reconfiguration.plug ("missing.out", "a.in");
+  try
+    {
+      reconfiguration.prepare ();
+      BOOST_ERROR ("prepare should have failed");
+    }
+  catch (const ExceptionFactory& exc)
+    {
+      const std::string message = exc.getStringMessage ();
+      BOOST_CHECK (message.find ("Uncompatible types") != std::string::npos);
+      BOOST_CHECK (message.find ("creates a cycle") != std::string::npos);
+      BOOST_CHECK (message.find ("Plug-in operation not possible")
+		   != std::string::npos);
+      BOOST_CHECK (message.find ("already depends") != std::string::npos);
+      BOOST_CHECK (message.find ("does not depend") != std::string::npos);
+      BOOST_CHECK (message.find ("Unknown entity") != std::string::npos);
+    }
+  BOOST_CHECK_EQUAL (reconfiguration.state (), Reconfiguration::RECORDING);
+  BOOST_CHECK (b.inSIN.getPluged () == &a.outSOUT);
+
+  // The graph changes between prepare and apply.
+  reconfiguration.clear ();
+  reconfiguration.unplug ("b.in");
+  reconfiguration.addDependency ("b.out", "a.vector");
+  reconfiguration.prepare ();
+  b.inSIN.plug (&b.outSOUT);
+  BOOST_CHECK (!reconfiguration.apply ());
+  BOOST_CHECK_EQUAL (reconfiguration.state (), Reconfiguration::REJECTED);
+  BOOST_CHECK (b.inSIN.getPluged () == &b.outSOUT);
+  BOOST_CHECK_EQUAL (nbDependencies (b.outSOUT), 1u);
+
+  // An entity is removed between prepare and apply.
+  new GainEntity ("c", 1.);
+  reconfiguration.clear ();
+  reconfiguration.plug ("c.out", "a.in");
+  reconfiguration.prepare ();
+  PoolStorage::getInstance ()->deleteEntity ("c");
+  BOOST_CHECK (!reconfiguration.apply ());
+  BOOST_CHECK_EQUAL (reconfiguration.state (), Reconfiguration::REJECTED);
+  BOOST_CHECK (a.inSIN.getPluged () == NULL);
+}
+
+// Thread evaluating the graph and applying the staged reconfigurations
+// between two ticks.
+struct ControlLoop
+{
+  ControlLoop (GainEntity& output, boost::atomic<bool>& stop,
+	       std::vector<double>& values)
+    : output (output), stop (stop), values (values)
+  {}
+
+  void operator() () const
+  {
+    PoolStorage* pool = PoolStorage::getInstance ();
+    for (int t = 1; !stop; ++t)
+      {
+	pool->applyStagedReconfiguration ();
+	values.push_back (output.outSOUT (t));
+	boost::this_thread::yield ();
+      }
+  }
+
+  GainEntity& output;
+  boost::atomic<bool>& stop;
+  std::vector<double>& values;
+};
+
+BOOST_AUTO_TEST_CASE (staged)
+{
+  GainEntity source ("source", 1.), first ("first", 2.),
+    second ("second", 3.), output ("output", 1.);
+  source.inSIN.setConstant (1.);
+  first.inSIN.plug (&source.outSOUT);
+  second.inSIN.plug (&source.outSOUT);
+  output.inSIN.plug (&first.outSOUT);
+
+  boost::atomic<bool> stop (false);
+  std::vector<double> values;
+  values.reserve (1000000);
+  boost::thread loop ((ControlLoop (output, stop, values)));
+
+  // Switch from the first controller to the second one.
+  Reconfiguration reconfiguration;
+  reconfiguration.plug ("second.out", "output.in");
+  BOOST_CHECK (PoolStorage::getInstance ()->stageReconfiguration
+	       (reconfiguration));
+  Reconfiguration other;
+  other.plug ("first.out", "output.in");
+  BOOST_CHECK (!PoolStorage::getInstance ()->stageReconfiguration (other));
+  while (reconfiguration.state () == Reconfiguration::STAGED)
+    boost::this_thread::yield ();
+  stop = true;
+  loop.join ();
+
+  BOOST_CHECK_EQUAL (reconfiguration.state (), Reconfiguration::APPLIED);
+  BOOST_CHECK (output.inSIN.getPluged () == &second.outSOUT);
+  // Each tick sees either the old or the new graph.
+  for (std::size_t i = 0; i < values.size (); ++i)
+    BOOST_CHECK (values[i] == 2. || values[i] == 3.);
+  BOOST_CHECK_EQUAL (values.back (), 3.);
+}
+
+// Cost of applying a reconfiguration in the thread evaluating the graph.
+BOOST_AUTO_TEST_CASE (apply_benchmark)
+{
+  using boost::posix_time::microsec_clock;
+  using boost::posix_time::ptime;
+  const int nbEntities = 100;
+  std::vector<GainEntity*> entities;
+  for (int i = 0; i < nbEntities; ++i)
+    {
+      std::ostringstream name;
+      name << "entity" << i;
+      entities.push_back (new GainEntity (name.str (), 1.));
+    }
+
+  Reconfiguration reconfiguration;
+  for (int i = 1; i < nbEntities; ++i)
+    {
+      std::ostringstream source, destination;
+      source << "entity" << i - 1 << ".out";
+      destination << "entity" << i;
+      reconfiguration.plug (source.str (), destination.str () + ".in");
+      reconfiguration.addDependency (destination.str () + ".out",
+				     source.str ());
+    }
+  ptime start = microsec_clock::local_time ();
+  reconfiguration.prepare ();
+  const long tPrepare =
+    (microsec_clock::local_time () - start).total_microseconds ();
+  start = microsec_clock::local_time ();
+  BOOST_CHECK (reconfiguration.apply ());
+  const long tApply =
+    (microsec_clock::local_time () - start).total_microseconds ();
+  BOOST_CHECK (entities.back ()->inSIN.getPluged ()
+	       == &entities[nbEntities - 2]->outSOUT);
+
+  std::cout << "Reconfiguration of " << 2 * (nbEntities - 1)
+	    << " edges:\n"
+	    << "  prepare: " << tPrepare << " us\n"
+	    << "  apply:   " << tApply << " us" << std::endl;
+  for (int i = 0; i < nbEntities; ++i)
+    delete entities[i];
+}
@@ -13,10 +13,12 @@
 // You should have received a copy of the GNU Lesser General Public License
 // along with dynamic-graph.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <limits>
 #include <string>
 
 #include <boost/foreach.hpp>
 #include <boost/format.hpp>
+#include <boost/thread/thread.hpp>
 
 #include <Eigen/Dense>
 
@@ -189,3 +191,269 @@ BOOST_AUTO_TEST_CASE (typeid_issue)
   BOOST_CHECK_EQUAL (std::string (typeid(vA).name ()),
 		     std::string (typeid(vB).name ()));
 }
+
+BOOST_AUTO_TEST_CASE (eigen_reader)
+{
+  dynamicgraph::Signal<dynamicgraph::Matrix, int> myMatrixSignal("matrix");
+  {
+    std::istringstream ss (" [2, 3] ( (1,2 ,3), (4 5 6) )");
+    myMatrixSignal.set (ss);
+    dynamicgraph::Matrix expected (2, 3);
+    expected << 1, 2, 3, 4, 5, 6;
+    BOOST_CHECK (myMatrixSignal.accessCopy () == expected);
+  }
+
+  {
+    dynamicgraph::Vector v;
+    std::istringstream ss ("[4](-1.5e3, nan,inf -inf)");
+    ss >> v;
+    BOOST_CHECK_EQUAL (v.size (), 4);
+    BOOST_CHECK_EQUAL (v (0), -1500.);
+    BOOST_CHECK (v (1) != v (1));
+    BOOST_CHECK_EQUAL (v (2), std::numeric_limits<double>::infinity ());
+    BOOST_CHECK_EQUAL (v (3), -std::numeric_limits<double>::infinity ());
+  }
+
+  {
+    Eigen::Matrix4d m;
+    std::istringstream ss
+      ("[4,4]((1,0,0,0.1),(0,1,0,0.2),(0,0,1,0.3),(0,0,0,1))");
+    ss >> m;
+    BOOST_CHECK_EQUAL (m (2, 3), 0.3);
+    std::istringstream wrongSize ("[3,3]((1,0,0),(0,1,0),(0,0,1))");
+    BOOST_CHECK_THROW (wrongSize >> m, dynamicgraph::ExceptionSignal);
+  }
+
+  dynamicgraph::Vector v;
+  std::istringstream missing ("[3](1,2)");
+  BOOST_CHECK_THROW (missing >> v, dynamicgraph::ExceptionSignal);
+  std::istringstream invalid ("[2](1,two)");
+  BOOST_CHECK_THROW (invalid >> v, dynamicgraph::ExceptionSignal);
+  std::istringstream shortRow ("[2,2]((1,2),(3))");
+  BOOST_CHECK_THROW (myMatrixSignal.set (shortRow), std::exception);
+  std::istringstream word ("[2](1,2x)");
+  BOOST_CHECK_THROW (word >> v, dynamicgraph::ExceptionSignal);
+
+  // Sizes which cannot fit in the input are rejected before allocating.
+  std::istringstream huge ("[1000000000000](1,2)");
+  BOOST_CHECK_THROW (huge >> v, dynamicgraph::ExceptionSignal);
+  std::istringstream hugeMatrix ("[100000000,100000000]((1))");
+  BOOST_CHECK_THROW (myMatrixSignal.set (hugeMatrix), std::exception);
+  std::istringstream overflow ("[99999999999999999999999](1)");
+  BOOST_CHECK_THROW (overflow >> v, dynamicgraph::ExceptionSignal);
+}
+
+// Stream buffer giving one character at a time, as a pipe may.
+class PipeBuf : public std::streambuf
+{
+public:
+  explicit PipeBuf (const std::string& text) : text_ (text), pos_ (0) {}
+
+protected:
+  virtual int_type underflow ()
+  {
+    if (pos_ == text_.size ()) return traits_type::eof ();
+    ch_ = text_[pos_++];
+    setg (&ch_, &ch_, &ch_ + 1);
+    return traits_type::to_int_type (ch_);
+  }
+
+private:
+  std::string text_;
+  std::size_t pos_;
+  char ch_;
+};
+
+BOOST_AUTO_TEST_CASE (eigen_reader_unknown_size)
+{
+  // Only the characters already read are available.
+  dynamicgraph::Vector v;
+  PipeBuf vector ("[3](1,2,3)");
+  BOOST_CHECK (dynamicgraph::EigenReader (vector).readVector (v));
+  BOOST_CHECK_EQUAL (v.size (), 3);
+  BOOST_CHECK_EQUAL (v (2), 3.);
+
+  dynamicgraph::Matrix m;
+  PipeBuf matrix ("[2,3]((1,2,3),(4,5,6))");
+  BOOST_CHECK (dynamicgraph::EigenReader (matrix).readMatrix (m));
+  dynamicgraph::Matrix expected (2, 3);
+  expected << 1, 2, 3, 4, 5, 6;
+  BOOST_CHECK (m == expected);
+
+  // Sizes which do not fit in the input fail without being allocated.
+  PipeBuf huge ("[1000000000000](1,2)");
+  BOOST_CHECK (!dynamicgraph::EigenReader (huge).readVector (v));
+  PipeBuf hugeMatrix ("[100000000,100000000]((1))");
+  BOOST_CHECK (!dynamicgraph::EigenReader (hugeMatrix).readMatrix (m));
+  PipeBuf overflow ("[100000000000,100000000000]((1))");
+  BOOST_CHECK (!dynamicgraph::EigenReader (overflow).readMatrix (m));
+}
+
+BOOST_AUTO_TEST_CASE (parse_doubles)
+{
+  const std::string text ("0.1 2,3e-2 , 42 12345678901234567890 junk");
+  double values[4];
+  const char* end = dynamicgraph::parseDoubles
+    (text.data (), text.data () + text.size (), values, 4);
+  BOOST_CHECK_EQUAL (values[0], 0.1);
+  BOOST_CHECK_EQUAL (values[1], 2.);
+  BOOST_CHECK_EQUAL (values[2], 3e-2);
+  BOOST_CHECK_EQUAL (values[3], 42.);
+  BOOST_CHECK_EQUAL (std::string (end), " 12345678901234567890 junk");
+
+  end = dynamicgraph::parseDoubles
+    (end, text.data () + text.size (), values, 1);
+  BOOST_CHECK_EQUAL (values[0], 12345678901234567890.);
+  BOOST_CHECK_THROW (dynamicgraph::parseDoubles
+		     (end, text.data () + text.size (), values, 1),
+		     dynamicgraph::ExceptionSignal);
+}
+
+template <int N> struct Tag {};
+
+template <int N>
+std::ostream& operator<< (std::ostream& os, const Tag<N>&)
+{
+  return os << "tag" << N;
+}
+
+template <int N>
+std::istream& operator>> (std::istream& is, Tag<N>&)
+{
+  return is;
+}
+
+template <int N>
+void registerTag ()
+{
+  dynamicgraph::DefaultCastRegisterer<Tag<N> > registerer;
+}
+
+// Signals resolve their cast entry at construction: a cast registered
+// afterwards, possibly from several threads, must be used.
+BOOST_AUTO_TEST_CASE (concurrent_registration)
+{
+  dynamicgraph::SignalCaster* caster =
+    dynamicgraph::SignalCaster::getInstance ();
+  dynamicgraph::Signal<Tag<0>, int> mySignal ("tag");
+  BOOST_CHECK (!caster->existsCast (typeid (Tag<0>)));
+  output_test_stream output;
+  BOOST_CHECK_THROW (mySignal.get (output), dynamicgraph::ExceptionSignal);
+
+  boost::thread_group threads;
+  threads.create_thread (registerTag<0>);
+  threads.create_thread (registerTag<1>);
+  threads.create_thread (registerTag<2>);
+  threads.create_thread (registerTag<3>);
+  threads.join_all ();
+
+  BOOST_CHECK (caster->existsCast (typeid (Tag<3>)));
+  const dynamicgraph::SignalCaster::Entry& entry =
+    caster->getEntry (typeid (Tag<2>));
+  BOOST_CHECK_EQUAL (&caster->getEntry (entry.id ()), &entry);
+  BOOST_CHECK (caster->getEntry (typeid (Tag<1>)).id () != entry.id ());
+
+  mySignal.get (output);
+  BOOST_CHECK (output.is_equal ("tag0\n"));
+}
+
+struct Point
+{
+  double x, y;
+};
+
+std::ostream& operator<< (std::ostream& os, const Point& p)
+{
+  return os << p.x << " " << p.y;
+}
+
+std::istream& operator>> (std::istream& is, Point& p)
+{
+  return is >> p.x >> p.y;
+}
+
+namespace dynamicgraph
+{
+  DG_SIGNAL_CAST_DEFINITION_BINARY (Point);
+  DG_ADD_CASTER_BINARY (Point, point);
+} // end of namespace dynamicgraph
+
+BOOST_AUTO_TEST_CASE (binary_serialization)
+{
+  dynamicgraph::Matrix m (2, 3);
+  m << 1., -2.5, 1e-300, 4., 5., 6.;
+  dynamicgraph::Signal<dynamicgraph::Matrix, int> matrixIn ("matrixIn");
+  dynamicgraph::Signal<dynamicgraph::Matrix, int> matrixOut ("matrixOut");
+  matrixIn.setConstant (m);
+
+  Point p = { 0.5, -3. };
+  dynamicgraph::Signal<Point, int> pointIn ("pointIn");
+  dynamicgraph::Signal<Point, int> pointOut ("pointOut");
+  pointIn.setConstant (p);
+
+  dynamicgraph::Signal<double, int> doubleIn ("doubleIn");
+  dynamicgraph::Signal<double, int> doubleOut ("doubleOut");
+  doubleIn.setConstant (0.1);
+
+  std::stringstream buffer;
+  matrixIn.serialize (buffer);
+  pointIn.serialize (buffer);
+  doubleIn.serialize (buffer);
+  BOOST_CHECK_EQUAL (buffer.str ().size (),
+		     2 * 8 + 6 * sizeof (double) + sizeof (Point)
+		     + sizeof (double));
+
+  matrixOut.deserialize (buffer);
+  pointOut.deserialize (buffer);
+  doubleOut.deserialize (buffer);
+  BOOST_CHECK (matrixOut.accessCopy () == m);
+  BOOST_CHECK_EQUAL (pointOut.accessCopy ().x, p.x);
+  BOOST_CHECK_EQUAL (pointOut.accessCopy ().y, p.y);
+  BOOST_CHECK_EQUAL (doubleOut.accessCopy (), 0.1);
+
+  // Truncated data.
+  BOOST_CHECK_THROW (doubleOut.deserialize (buffer),
+		     dynamicgraph::ExceptionSignal);
+
+  // Wrong size for a fixed-size matrix.
+  std::stringstream matrixBuffer;
+  matrixIn.serialize (matrixBuffer);
+  Eigen::Matrix3d m3;
+  BOOST_CHECK_THROW
+    (dynamicgraph::BinaryCast<Eigen::Matrix3d>::deserialize
+     (matrixBuffer, m3), dynamicgraph::ExceptionSignal);
+
+  // The vector cast of this test is registered without binary functions.
+  dynamicgraph::Signal<dynamicgraph::Vector, int> vector ("vector");
+  std::ostringstream os;
+  BOOST_CHECK_THROW (vector.serialize (os), dynamicgraph::ExceptionSignal);
+}
+
+// Signals outliving the caster keep a valid entry. Run last, since the
+// casts registered at load time are lost.
+static void displayDouble (const boost::any& object, std::ostream& os)
+{
+  os << "double " << boost::any_cast<double> (object);
+}
+
+static boost::any castDouble (std::istringstream& iss)
+{
+  double d;
+  iss >> d;
+  return d;
+}
+
+BOOST_AUTO_TEST_CASE (destroy_caster)
+{
+  dynamicgraph::Signal<double, int> signal ("signal");
+  signal.setConstant (1.5);
+  dynamicgraph::SignalCaster::getInstance ()->collectRetired ();
+  dynamicgraph::SignalCaster::destroy ();
+
+  output_test_stream output;
+  BOOST_CHECK_THROW (signal.get (output), dynamicgraph::ExceptionSignal);
+  dynamicgraph::SignalCaster::getInstance ()->registerCast
+    (typeid (double), &displayDouble, &castDouble, &displayDouble);
+  signal.get (output);
+  BOOST_CHECK (output.is_equal ("double 1.5"));
+}
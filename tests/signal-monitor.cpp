@@ -0,0 +1,136 @@
+// Copyright 2018, CNRS
+//
+// This file is part of dynamic-graph.
+// dynamic-graph is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dynamic-graph is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+// You should have received a copy of the GNU Lesser General Public License
+// along with dynamic-graph.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <string>
+#include <vector>
+
+#include <dynamic-graph/command-queue.h>
+#include <dynamic-graph/entity.h>
+#include <dynamic-graph/exception-factory.h>
+#include <dynamic-graph/exception-signal.h>
+#include <dynamic-graph/linear-algebra.h>
+#include <dynamic-graph/pool.h>
+#include <dynamic-graph/signal.h>
+#include <dynamic-graph/signal-caster.h>
+#include <dynamic-graph/signal-monitor-entity.h>
+
+#define BOOST_TEST_MODULE signal_monitor
+
+#include <boost/test/unit_test.hpp>
+
+using namespace dynamicgraph;
+using command::CommandFuture;
+using command::Value;
+
+struct MonitoredEntity : public Entity
+{
+  static const std::string CLASS_NAME;
+
+  MonitoredEntity (const std::string& name)
+    : Entity (name)
+    , gainSIN ("MonitoredEntity(" + name + ")::input(double)::gain")
+    , offsetSIN ("MonitoredEntity(" + name + ")::input(vector)::offset")
+  {
+    signalRegistration (gainSIN << offsetSIN);
+  }
+
+  virtual const std::string& getClassName () const
+  {
+    return CLASS_NAME;
+  }
+
+  Signal<double, int> gainSIN;
+  Signal<Vector, int> offsetSIN;
+};
+const std::string MonitoredEntity::CLASS_NAME = "MonitoredEntity";
+
+static const Value& execute (SignalMonitorEntity& monitor,
+			     const std::string& name,
+			     std::vector<Value> arguments)
+{
+  // Queued as by another thread, executed by the thread of the graph.
+  // The queue takes the arguments.
+  PoolStorage* pool = PoolStorage::getInstance ();
+  static CommandFuture future;
+  future = pool->getCommandQueue ().enqueue
+    (*monitor.getNewStyleCommand (name), arguments);
+  pool->getCommandQueue ().execute (1);
+  return future.get ();
+}
+
+BOOST_AUTO_TEST_CASE (commands)
+{
+  MonitoredEntity* first = new MonitoredEntity ("first");
+  MonitoredEntity* second = new MonitoredEntity ("second");
+  SignalMonitorEntity* monitor = new SignalMonitorEntity ("monitor");
+  Vector offset (3);
+  offset << 1., 2., 3.;
+  first->gainSIN.setConstant (2.);
+  first->offsetSIN.setConstant (offset);
+  second->gainSIN.setConstant (3.);
+  second->offsetSIN.setConstant (2 * offset);
+
+  std::vector<Value> arguments (1, Value (std::string ("first.gain"
+						       " first.offset")));
+  execute (*monitor, "setSignals", arguments);
+  std::vector<Value> none;
+  const std::string buffer = execute (*monitor, "read", none).stringRef ();
+  const Matrix layout = execute (*monitor, "getLayout", none).matrixXdRef ();
+  BOOST_REQUIRE_EQUAL (layout.rows (), 2);
+  BOOST_CHECK_EQUAL (layout (0, 0), 0.);
+  BOOST_CHECK_EQUAL (layout (0, 1), static_cast<double> (sizeof (double)));
+  BOOST_CHECK_EQUAL (layout (1, 0), layout (0, 1));
+  BOOST_CHECK_EQUAL (layout (1, 0) + layout (1, 1),
+		     static_cast<double> (buffer.size ()));
+  BOOST_REQUIRE_EQUAL (layout.cols (), 4);
+  const SignalCaster::Entry& vectorEntry =
+    SignalCaster::getInstance ()->getEntry (typeid (Vector));
+  BOOST_CHECK_EQUAL (layout (1, 3), static_cast<double> (vectorEntry.id ()));
+  BOOST_CHECK_EQUAL (execute (*monitor, "getTypeNames", none).stringRef (),
+		     std::string (typeid (double).name ()) + "\n"
+		     + vectorEntry.typeName () + "\n");
+
+  // Write the values of first into second.
+  arguments[0] = Value (std::string ("second.gain second.offset"));
+  execute (*monitor, "setSignals", arguments);
+  std::vector<Value> values;
+  values.push_back (Value (buffer));
+  values.push_back (Value (layout));
+  execute (*monitor, "write", values);
+  BOOST_CHECK_EQUAL (second->gainSIN.accessCopy (), 2.);
+  BOOST_CHECK (second->offsetSIN.accessCopy () == offset);
+  BOOST_CHECK (monitor->read () == buffer);
+
+  // Wrong signals and layouts are rejected.
+  arguments[0] = Value (std::string ("second.gain missing.signal"));
+  BOOST_CHECK_THROW (execute (*monitor, "setSignals", arguments),
+		     ExceptionAbstract);
+  BOOST_CHECK_THROW (monitor->write (buffer, layout.topRows (1)),
+		     ExceptionFactory);
+  Matrix negative (layout);
+  negative (1, 1) = -1.;
+  BOOST_CHECK_THROW (monitor->write (buffer, negative), ExceptionFactory);
+  BOOST_CHECK (second->offsetSIN.accessCopy () == offset);
+
+  // A value which does not fit its signal sets none of the signals.
+  second->gainSIN.setConstant (3.);
+  Matrix truncated (layout);
+  truncated (1, 1) -= 1.;
+  BOOST_CHECK_THROW (monitor->write (buffer, truncated), ExceptionSignal);
+  BOOST_CHECK_EQUAL (second->gainSIN.accessCopy (), 3.);
+  BOOST_CHECK (second->offsetSIN.accessCopy () == offset);
+
+  PoolStorage::destroy ();
+}
@@ -14,6 +14,8 @@
 // along with dynamic-graph.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <iostream>
+#include <vector>
+#include "dynamic-graph/exception-abstract.h"
 #include "dynamic-graph/value.h"
 
 #define BOOST_TEST_MODULE value
@@ -59,3 +61,50 @@ BOOST_AUTO_TEST_CASE (value_string)
     BOOST_CHECK (output.is_equal ("Type=string, value=value #2"));
   }
 }
+
+BOOST_AUTO_TEST_CASE (value_assignment)
+{
+  using dynamicgraph::command::Value;
+  using dynamicgraph::Vector;
+
+  Eigen::Matrix4d m4 (Eigen::Matrix4d::Identity ());
+  m4 (0, 3) = 2.;
+  Vector v (3);
+  v << 1., 2., 3.;
+  std::vector<Value> values;
+  values.push_back (Value ());
+  values.push_back (Value (true));
+  values.push_back (Value (3));
+  values.push_back (Value (2.5));
+  values.push_back (Value (std::string ("text")));
+  values.push_back (Value (v));
+  values.push_back (Value (Eigen::MatrixXd (m4)));
+  values.push_back (Value (m4));
+
+  // Assign each value to a value of each type.
+  for (std::size_t i = 0; i < values.size (); ++i)
+    for (std::size_t j = 0; j < values.size (); ++j)
+      {
+	Value value (values[j]);
+	value = values[i];
+	BOOST_CHECK_EQUAL (value.type (), values[i].type ());
+      }
+  Value value;
+  value = values[7];
+  BOOST_CHECK (value.matrix4dValue () == m4);
+  Eigen::Matrix4d converted = value.value ();
+  BOOST_CHECK (converted == m4);
+  value = values[5];
+  BOOST_CHECK (value.vectorValue () == v);
+  value = value;
+  BOOST_CHECK (value.vectorValue () == v);
+  BOOST_CHECK_THROW (value.doubleValue (), dynamicgraph::ExceptionAbstract);
+  BOOST_CHECK_EQUAL ((int) values[2].value (), 3);
+  BOOST_CHECK_EQUAL (values[4].stringValue (), "text");
+
+  value.swap (values[4]);
+  BOOST_CHECK_EQUAL (value.stringValue (), "text");
+  BOOST_CHECK (values[4].vectorValue () == v);
+  value.deleteValue ();
+  BOOST_CHECK_EQUAL (value.type (), Value::NONE);
+}